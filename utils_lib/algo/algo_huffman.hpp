@@ -5,11 +5,19 @@
 #include "../utils_bits.hpp"
 #include "../utils_logger.hpp"
 #include "../utils_io.hpp"
+#include "../utils_threading.hpp"
+#include "../utils_algorithm.hpp"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
 #include <numeric>
+#include <optional>
+#include <type_traits>
 #include <unordered_map>
-#include <queue>
 #include <vector>
 
 namespace utils::algo {
@@ -108,45 +116,183 @@ namespace utils::algo {
     };
 
     /**
-     *  @brief Huffman class
+     *  @brief  Lookup tables to decode a prefix code with a single peek.
+     *
+     *          The primary table is indexed by the next PRIMARY_BITS bits and
+     *          resolves every code up to that length in one hit. Longer codes
+     *          continue in a secondary table for their PRIMARY_BITS prefix,
+     *          indexed by the bits that follow.
      */
     template<class T=uint8_t>
-    class Huffman {
+    class HuffmanTable {
         public:
-            using KeyPair = std::pair<T, Codeword>;
+            static constexpr inline uint32_t PRIMARY_BITS  = 11u;  ///< Index bits of the primary table
+            static constexpr inline uint32_t MAX_CODE_BITS = uint32_t(utils::bits::size_of<decltype(Codeword::word)>());  ///< Longest code that fits in Codeword::word
 
         private:
-            algo::Node<T> *tree_root;
+            struct Entry {
+                uint32_t value;     ///< The symbol, or the offset of a secondary table
+                uint8_t  len;       ///< The code length, or 0 for a secondary table
+                uint8_t  sub_bits;  ///< The index bits of the secondary table
+            };
 
-            std::unordered_map<T, Codeword> dict;
+            std::vector<Entry> entries;
+            uint32_t primary_bits;  ///< Index bits of the primary table (at most PRIMARY_BITS)
+            uint32_t peek_bits;     ///< The longest code length
+
+        public:
+            HuffmanTable(void) : primary_bits(0u), peek_bits(0u) {
+                // Empty
+            }
+
+            inline bool empty(void) const {
+                return this->entries.empty();
+            }
 
             /**
-             *  @brief  Add the given settings to the output stream according to the amount of bits
-             *          specified in the Huffman class.
-             *  @param  length
-             *      The length of the sequence that will follow this header.
-             *      If the length is 0, only one '0' bit will be written.
-             *  @param  bit_length
-             *      The amount of bits needed for every data element in the sequence following this header.
-             *      Keys always use KEY_BITS as length, and values use bit_length, which is different for each group.
-             *      This is done to minimize the amoutn of bits needed to save the Huffman dictionary.
-             *  @param  writer
-             *      The outputstream to write to.
+             *  @brief  Build the tables for the given prefix code.
+             *
+             *  @param  codes
+             *      The symbols with their code, which must form a prefix code.
              */
-            static void add_huffman_dict_header(uint32_t length, uint32_t bit_length, utils::io::BitStreamWriter& writer) {
-                if (length > 0) {
-                    // MSB is HAS_ITEMS setting + 7 bits length
-                    writer.put(algo::Huffman<T>::DICT_HDR_HAS_ITEMS_BITS, 1);
-                    writer.put(algo::Huffman<T>::DICT_HDR_SEQ_LENGTH_BITS,
-                               utils::bits::select_lsb<uint32_t>(length, algo::Huffman<T>::DICT_HDR_SEQ_LENGTH_BITS));
+            void build(const std::vector<std::pair<T, Codeword>>& codes) {
+                this->entries.clear();
+                this->primary_bits = this->peek_bits = 0u;
 
-                    // 4 bits for bit length of every dict item
-                    writer.put(algo::Huffman<T>::DICT_HDR_ITEM_BITS,
-                               utils::bits::select_lsb<uint32_t>(bit_length, algo::Huffman<T>::DICT_HDR_ITEM_BITS));
-                } else {
-                    writer.put_bit(0);
+                for (const auto& [symbol, code] : codes) {
+                    UNUSED(symbol);
+
+                    if (HEDLEY_UNLIKELY(code.len == 0 || code.len > HuffmanTable::MAX_CODE_BITS)) {
+                        throw utils::exceptions::Exception("HuffmanTable::build",
+                                                           utils::string::format("Invalid code length %u.", code.len));
+                    }
+
+                    this->peek_bits = std::max(this->peek_bits, code.len);
+                }
+
+                if (codes.empty()) {
+                    return;
+                }
+
+                this->primary_bits = std::min(this->peek_bits, HuffmanTable::PRIMARY_BITS);
+                this->entries.assign(size_t(1) << this->primary_bits, Entry{ 0u, 0u, 0u });
+
+                // Size a secondary table for every prefix of the long codes
+                for (const auto& [symbol, code] : codes) {
+                    UNUSED(symbol);
+
+                    if (code.len > this->primary_bits) {
+                        Entry& entry = this->entries[code.word >> (code.len - this->primary_bits)];
+                        entry.sub_bits = std::max(entry.sub_bits, uint8_t(code.len - this->primary_bits));
+                    }
+                }
+
+                for (size_t prefix = 0, primary = this->entries.size(); prefix < primary; prefix++) {
+                    if (this->entries[prefix].sub_bits) {
+                        this->entries[prefix].value = uint32_t(this->entries.size());
+                        this->entries.resize(this->entries.size() + (size_t(1) << this->entries[prefix].sub_bits),
+                                             Entry{ 0u, 0u, 0u });
+                    }
                 }
+
+                // Every code covers all table entries that start with it
+                for (const auto& [symbol, code] : codes) {
+                    size_t   start;
+                    uint32_t free_bits;
+
+                    if (code.len <= this->primary_bits) {
+                        free_bits = this->primary_bits - code.len;
+                        start     = size_t(code.word) << free_bits;
+                    } else {
+                        const uint32_t rest  = code.len - this->primary_bits;
+                        const Entry&   table = this->entries[code.word >> rest];
+
+                        free_bits = table.sub_bits - rest;
+                        start     = table.value + (size_t(code.word & utils::bits::mask_lsb<uint32_t>(rest)) << free_bits);
+                    }
+
+                    std::fill_n(this->entries.begin() + std::ptrdiff_t(start), size_t(1) << free_bits,
+                                Entry{ uint32_t(symbol), uint8_t(code.len), 0u });
+                }
+            }
+
+            /**
+             *  @brief  Decode the next symbol from \p reader.
+             *
+             *  @param  reader
+             *      The bitstream to read from.
+             *  @return Returns the decoded symbol.
+             */
+            inline T decode(utils::io::BitStreamReader& reader) const {
+                const uint64_t window = reader.peek(this->peek_bits);
+                Entry entry = this->entries[size_t(window >> (this->peek_bits - this->primary_bits))];
+
+                if (HEDLEY_UNLIKELY(entry.len == 0)) {
+                    const uint32_t shift = this->peek_bits - this->primary_bits - entry.sub_bits;
+                    const uint64_t index = (window >> shift) & utils::bits::mask_lsb<uint64_t>(entry.sub_bits);
+
+                    if (HEDLEY_UNLIKELY(entry.sub_bits == 0)) {
+                        throw utils::exceptions::Exception("HuffmanTable::decode", "Invalid code in stream.");
+                    }
+
+                    entry = this->entries[entry.value + size_t(index)];
+
+                    if (HEDLEY_UNLIKELY(entry.len == 0)) {
+                        throw utils::exceptions::Exception("HuffmanTable::decode", "Invalid code in stream.");
+                    }
+                }
+
+                reader.skip(entry.len);
+                return T(entry.value);
             }
+    };
+
+    template<class T=uint8_t>
+    class HuffmanStreamEncoder;
+
+    /**
+     *  @brief Huffman class
+     */
+    template<class T=uint8_t>
+    class Huffman {
+        friend class algo::HuffmanStreamEncoder<T>;
+
+        public:
+            using KeyPair = std::pair<T, Codeword>;
+
+            /**
+             *  @brief  The block index of a framed stream.
+             */
+            struct FrameIndex {
+                uint64_t size;                ///< Length in bytes of the source
+                uint64_t block_size;          ///< Length in bytes of every source block, except maybe the last
+                size_t   data_offset;         ///< Byte offset in the stream of the first block
+                std::vector<uint64_t> ends;   ///< End of every encoded block, relative to data_offset
+
+                inline size_t block_count(void) const {
+                    return this->ends.size();
+                }
+
+                inline uint64_t block_length(size_t block) const {
+                    return std::min(this->block_size, this->size - block * this->block_size);
+                }
+
+                inline uint64_t data_length(void) const {
+                    return this->ends.empty() ? 0u : this->ends.back();
+                }
+            };
+
+        private:
+            /// Index into the flat tree, wide enough for 2 * 2^KEY_BITS nodes.
+            using Index = std::conditional_t<(utils::bits::size_of<T>() <= 8u), uint16_t, uint32_t>;
+
+            algo::Node<T> *tree_root;
+
+            std::unordered_map<T, Codeword> dict;
+            algo::HuffmanTable<T>           table;
+
+            std::vector<uint64_t> tree_weight;  ///< Weight of every node of the flat tree: leaves, then internal nodes
+            std::vector<Index>    tree_parent;  ///< Parent of every node of the flat tree
 
             /**
              *  @brief  Read a dictionary header from the inputstream and set the given variables.
@@ -171,44 +317,149 @@ namespace utils::algo {
             }
 
             /**
-             *  @brief  Traverse Huffman tree starting from node and
-             *          add codes for leafs to the dictionary.
-             *  @param  node
-             *      The starting node.
-             *  @param  stream
-             *      The current stream of bits for a path in the tree.
+             *  @brief  Calculate the Huffman code length of every leaf with the two-queue method.
+             *
+             *          The leaves are sorted by weight and internal nodes are created in order of
+             *          increasing weight, so the two lightest nodes are always at the front of either
+             *          queue. Both queues live in one flat array, linked to their parent by index,
+             *          and the depths follow in a single pass from the root down, in place.
+             *
+             *  @param  leaves
+             *      The weight and the symbol of every leaf, sorted by weight.
+             *  @param  codes
+             *      The symbols with their code length (will be set, in the order of \p leaves).
+             *  @return Returns the longest code length.
              */
-            void buildDict(const algo::Node<T> * const node, std::vector<bool> stream) {
-                if (node == nullptr) {
-                    return;
+            uint32_t buildLengths(const std::vector<std::pair<uint64_t, T>>& leaves, std::vector<KeyPair>& codes) {
+                const size_t count = leaves.size();
+                codes.resize(count);
+
+                if (count == 1) {
+                    // A lone root gets a 1 bit code
+                    codes[0] = KeyPair(leaves[0].second, Codeword{ 0u, 1u });
+                    return 1u;
                 }
 
-                // Check if leaf
-                if (node->isLeaf()) {
-                    this->dict[node->data] = Codeword {
-                        // Concatenate the bits in stream to a value
-                        utils::bits::to_binary<uint32_t>(stream),
-                        // Get the amount of bits
-                        uint32_t(stream.size())
-                    };
+                const size_t nodes = 2u * count - 1u;
+                this->tree_weight.resize(nodes);
+                this->tree_parent.resize(nodes);
 
-                    return;
+                for (size_t i = 0; i < count; i++) {
+                    this->tree_weight[i] = leaves[i].first;
+                }
+
+                // Take the two lightest of the next leaf and the next internal node
+                size_t leaf = 0, node = count;
+
+                for (size_t next = count; next < nodes; next++) {
+                    uint64_t weight = 0u;
+
+                    for (int child = 0; child < 2; child++) {
+                        const size_t pick = (leaf < count && (node == next || this->tree_weight[leaf] <= this->tree_weight[node]))
+                                          ? leaf++ : node++;
+
+                        weight += this->tree_weight[pick];
+                        this->tree_parent[pick] = Index(next);
+                    }
+
+                    this->tree_weight[next] = weight;
+                }
+
+                // Parents come after their children, so walking down from the
+                // root replaces every parent index with the depth of the node.
+                this->tree_parent[nodes - 1u] = 0u;
+
+                for (size_t i = nodes - 1u; i--; ) {
+                    this->tree_parent[i] = Index(this->tree_parent[this->tree_parent[i]] + 1u);
+                }
+
+                uint32_t max_len = 0u;
+
+                for (size_t i = 0; i < count; i++) {
+                    codes[i] = KeyPair(leaves[i].second, Codeword{ 0u, uint32_t(this->tree_parent[i]) });
+                    max_len  = std::max(max_len, codes[i].second.len);
+                }
+
+                return max_len;
+            }
+
+            /**
+             *  @brief  Build a Huffman tree for the given frequencies and
+             *          return the canonical code for every symbol.
+             *
+             *          Only the code lengths are taken from the tree. While the tree
+             *          is deeper than MAX_CODE_BITS, the frequencies are halved and the
+             *          tree is rebuilt, which flattens it at a small cost in ratio.
+             *
+             *  @param  freqs
+             *      The amount of times every symbol occurs.
+             *  @return Returns the codes in canonical order.
+             */
+            std::vector<KeyPair> buildCodes(const std::unordered_map<T, uint64_t>& freqs) {
+                std::vector<std::pair<uint64_t, T>> leaves;
+                leaves.reserve(freqs.size());
+
+                for (const auto& [data, freq] : freqs) {
+                    leaves.emplace_back(freq, data);
+                }
+
+                std::sort(leaves.begin(), leaves.end());
+
+                std::vector<KeyPair> codes;
+
+                while (this->buildLengths(leaves, codes) > algo::Huffman<T>::MAX_CODE_BITS) {
+                    // Halving keeps the leaves sorted
+                    for (auto& [freq, data] : leaves) {
+                        UNUSED(data);
+                        freq = (freq >> 1u) | 1u;
+                    }
                 }
 
-                std::vector<bool> lstream(stream);
-                lstream.emplace_back(false);   // Go left  => '0'
-                stream.emplace_back(true);     // Go right => '1'
+                algo::Huffman<T>::assignCanonical(codes);
+                this->setCodes(codes);
+
+                return codes;
+            }
+
+            /**
+             *  @brief  Sort \p codes in canonical order and assign consecutive
+             *          codewords, so only the code lengths need to be stored.
+             *
+             *  @param  codes
+             *      The symbols with the length of their code.
+             */
+            static void assignCanonical(std::vector<KeyPair>& codes) {
+                std::sort(codes.begin(), codes.end(), algo::Huffman<T>::CodewordComparator());
+
+                uint64_t code = 0u;
+                uint32_t len  = codes.empty() ? 0u : codes.front().second.len;
+
+                for (auto& [key, word] : codes) {
+                    UNUSED(key);
+                    code <<= (word.len - len);
+                    len       = word.len;
+                    word.word = uint32_t(code++);
+                }
+            }
 
-                this->buildDict(node->left , lstream);
-                this->buildDict(node->right, stream);
+            /**
+             *  @brief  Replace the dictionary with the given codes.
+             *          The tree is only built when printed.
+             *
+             *  @param  codes
+             *      The codes to use.
+             */
+            void setCodes(const std::vector<KeyPair>& codes) {
+                this->dict.clear();
+                this->dict.insert(codes.begin(), codes.end());
             }
 
             /**
-             *  @brief  Read the dictionary from the given stream to build a Huffman tree structure.
-             *          Clear the previous tree and overwrite with the data from the dict.
+             *  @brief  Read the dictionary of a legacy (unversioned) stream to build
+             *          the decoding table. Clear the previous tree and overwrite with the data from the dict.
              *
-             *          Optionally also save dict internally, but only tree is needed for
-             *          proper decoding.
+             *          The dictionary is a series of groups with a header (see read_huffman_dict_header())
+             *          and {key: code} pairs, ending with a '0' bit.
              *
              *          If first bit was '0', no key: val sequence follows and reader
              *          already contains uncompressed data.
@@ -218,27 +469,20 @@ namespace utils::algo {
              */
             void buildTree(utils::io::BitStreamReader& reader) {
                 uint32_t dseq_len = 0u, dbit_len = 0u;
-
-                utils::memory::delete_var(this->tree_root);
-                this->tree_root = utils::memory::new_var<algo::Node<T>>(-1);
-                this->dict.clear();
+                std::vector<KeyPair> codes;
 
                 // While header is followed by sequence
                 while (this->read_huffman_dict_header(reader, dseq_len, dbit_len)) {
                     while (dseq_len--) {
                         // For each element, read {key: val}
-                        const KeyPair entry {
-                            T(reader.get(algo::Huffman<T>::KEY_BITS)),
-                            Codeword{ reader.get(dbit_len), dbit_len }
-                        };
-
-                        #if 0  // Optionally add to dict, but not necessary since decoding only needs tree.
-                            dict.insert(entry);
-                            // util::Logger::WriteLn(utils::string::format("%02X: %8X (%d bits)", entry.first, entry.second.word, entry.second.len));
-                        #endif
-                        this->treeAddLeaf(entry);
+                        const T key = T(reader.get(algo::Huffman<T>::KEY_BITS));
+                        codes.emplace_back(key, Codeword{ reader.get(dbit_len), dbit_len });
                     }
                 }
+
+                // Decoding only needs the table, the tree is kept for printTree().
+                this->table.build(codes);
+                this->setCodes(codes);
             }
 
             /**
@@ -279,208 +523,144 @@ namespace utils::algo {
             }
 
             /**
-             *  @brief  Traverse Huffman tree starting from node and
-             *          decode symbols according to the dictionary.
-             *  @param  node
-             *      The starting node.
+             *  @brief  Decode \p count symbols with the lookup table,
+             *          or less if \p reader runs out.
              *  @param  reader
              *      The bytestream to read from.
+             *  @param  writer
+             *      The bytestream to write to, with room for \p count symbols.
+             *  @param  count
+             *      The amount of symbols to decode.
              */
-            void decode(utils::io::BitStreamReader& reader, utils::io::BitStreamWriter& writer) {
-                if (this->tree_root == nullptr) {
-                    return;
-                }
-
-                algo::Node<T> *current = this->tree_root;
+            void decode(utils::io::BitStreamReader& reader, utils::io::BitStreamWriter& writer, size_t count) {
+                const size_t raw_bits = reader.get_size_bits();
 
-                while (!current->isLeaf()) {
-                    // Read next bit and go left or right untill a leaf is reached
-                    current = (reader.get_bit() ? current->right : current->left);
+                while (count-- && reader.get_position() < raw_bits) {
+                    writer.put_unchecked(algo::Huffman<T>::KEY_BITS, this->table.decode(reader));
                 }
-
-                writer.put(algo::Huffman<T>::KEY_BITS, current->data);
             }
 
             /**
-             *  @brief  A comparator to sort Codeword pairs by bit length.
+             *  @brief  A comparator to sort Codeword pairs in canonical order,
+             *          by bit length and then by key.
              */
             struct CodewordComparator {
                 inline bool operator()(const KeyPair& first, const KeyPair& second) {
-                    return first.second.len > second.second.len;
+                    return first.second.len != second.second.len
+                         ? first.second.len < second.second.len
+                         : first.first < second.first;
                 }
             };
 
-        public:
             /**
-             *  @brief  Default ctor
+             *  @brief  Write the header of a versioned stream.
+             *
+             *  @param  mode
+             *      How the data following the header is stored (MODE_STORED or MODE_CANONICAL).
+             *  @param  data_bytes
+             *      The length in bytes of the source.
+             *  @param  writer
+             *      The outputstream to write to.
              */
-            Huffman(void) : tree_root(nullptr) {
-                // Empty
+            static void add_header(uint8_t mode, uint64_t data_bytes, utils::io::BitStreamWriter& writer) {
+                writer.put(algo::Huffman<T>::HDR_FIELD_BITS, algo::Huffman<T>::HDR_MARKER);
+                writer.put(algo::Huffman<T>::HDR_FIELD_BITS, algo::Huffman<T>::HDR_VERSION);
+                writer.put(algo::Huffman<T>::HDR_FIELD_BITS, mode);
+                writer.put(algo::Huffman<T>::SIZE_BITS, data_bytes);
             }
 
             /**
-             *  @brief  Default dtor
+             *  @brief  Read a SIZE_BITS length field.
              */
-            ~Huffman(void) {
-                utils::memory::delete_var(this->tree_root);
+            static inline uint64_t read_size(utils::io::BitStreamReader& reader) {
+                return (uint64_t(reader.get(32u)) << 32u) | reader.get(32u);
             }
 
             /**
-             *  @brief  Encode bits of length sizeof(T) with Huffman encoding and
-             *          write the Huffman dict and the encoded data to an outputstream.
+             *  @brief  Check whether the stream at the position of \p reader starts with
+             *          a versioned header. Legacy streams start with either a '0' bit
+             *          or a dictionary group of at least one item, so never with HDR_MARKER.
              *
              *  @param  reader
-             *      The bytestream to read from.
-             *  @return Returns a new bitstream with the encoded data.
+             *      The stream to check.
+             *  @return Returns true if the stream is versioned.
              */
-            utils::memory::unique_t<utils::io::BitStreamWriter> encode(utils::io::BitStreamReader& reader) {
-                const size_t length          = reader.get_size_bits();
-                const size_t original_length = reader.get_size();
-
-                utils::memory::unique_t<utils::io::BitStreamWriter> writer;
-
-                // Calculate frequencies
-                std::unordered_map<T, uint32_t> freqs;
-
-                reader.reset();
-                while(reader.get_position() != length) {
-                    const T word = T(reader.get(algo::Huffman<T>::KEY_BITS));
-                    freqs[word]++;
-                }
-
-                if (freqs.empty()) {
-                    // Nothing to encode?
-                    writer.reset(nullptr);
-                    return writer;
-                }
-
-                // Create priority queue to sort tree with Nodes with data from frequency
-                std::priority_queue<algo::Node<T>*, std::vector<algo::Node<T>*>, typename algo::Node<T>::comparator> pq;
-
-                for (const auto& [data, freq]: freqs) {
-                    pq.emplace(utils::memory::new_var<algo::Node<T>>(data, freq));
-                    // utils::Logger::Writef("%02X: %d\n", data, freq);
-                }
-
-                while (pq.size() > 1) {
-                    // Empty out queue and build leaves, starting with lowest freq
-                    // Result is a single Node with references to other Nodes in tree structure.
-                    algo::Node<T> *left  = pq.top(); pq.pop();
-                    algo::Node<T> *right = pq.top(); pq.pop();
-
-                    pq.emplace(utils::memory::new_var<algo::Node<T>>(-1, left->freq + right->freq, left, right));
-                }
-
-                // Huffman tree root
-                this->tree_root = pq.top();
-
-                // Create dictionary by tree traversal
-                this->buildDict(this->tree_root, {});
-
-                // Create new list with dict elements sorted by bit length for saving to stream
-                std::vector<KeyPair> sorted_dict(this->dict.begin(), this->dict.end());
-
-                // Sort the dictionary by value bit length
-                std::sort(sorted_dict.begin(), sorted_dict.end(), algo::Huffman<T>::CodewordComparator());
+            static bool is_versioned(utils::io::BitStreamReader& reader) {
+                return reader.get_size_bits() - reader.get_position() >= algo::Huffman<T>::HDR_BITS
+                    && reader.peek(algo::Huffman<T>::HDR_FIELD_BITS) == algo::Huffman<T>::HDR_MARKER;
+            }
 
-                // Determine frequencies of each bit length with {bit_length: freq}
-                std::unordered_map<uint32_t, uint32_t> bit_freqs;
-                for (const auto& [value, word] : sorted_dict) {
-                    UNUSED(value);
-                    bit_freqs[word.len]++;
-                }
+            /**
+             *  @brief  Read the code lengths of a versioned stream and assign
+             *          the canonical codes.
+             *
+             *          The lengths are stored as the longest length (CODE_LEN_BITS),
+             *          the amount of codes of every length up to it (KEY_BITS + 1 each)
+             *          and the keys in canonical order.
+             *
+             *  @param  reader
+             *      The stream to read from.
+             *  @return Returns the codes in canonical order.
+             */
+            static std::vector<KeyPair> readCodes(utils::io::BitStreamReader& reader) {
+                const uint32_t max_len = reader.get(algo::Huffman<T>::CODE_LEN_BITS);
 
-                // Calculate total needed length for dict
-                size_t h_dict_total_length = (algo::Huffman<T>::KEY_BITS * this->dict.size())  // Amount of bits needed for keys
-                                           + ((algo::Huffman<T>::DICT_HDR_HAS_ITEMS_BITS + algo::Huffman<T>::DICT_HDR_ITEM_BITS + algo::Huffman<T>::DICT_HDR_SEQ_LENGTH_BITS)
-                                              * bit_freqs.size())                             // Amount of bits for each header
-                                           + 1;                                               // Stop bit
-                for (const auto& [bit_length, freq] : bit_freqs) {
-                    h_dict_total_length += bit_length * freq;  // Amount of bits for each header group
+                if (max_len == 0 || max_len > algo::Huffman<T>::MAX_CODE_BITS) {
+                    throw utils::exceptions::Exception("Huffman::decode", "Invalid code lengths in header.");
                 }
 
-                utils::Logger::Info("[Huffman] Table overhead with %d entries: %.1f bytes.",
-                                    this->dict.size(), float(h_dict_total_length) / 8.0f);
+                std::vector<uint64_t> counts(max_len + 1u, 0u);
+                uint64_t total = 0u, kraft = 0u;
 
-                // Save the Huffman dictionary to a stream
-                writer.reset(utils::memory::new_var<utils::io::BitStreamWriter>((h_dict_total_length + length) / 8 + 1));
-                uint32_t seq_len = 0u, bit_len = 0u;
+                for (uint32_t len = 1; len <= max_len; len++) {
+                    counts[len] = reader.get64(algo::Huffman<T>::KEY_BITS + 1u);
 
-                // Add headers for each group of same length key:val pairs
-                // and write them to the stream
-                for (const auto& [value, word] : sorted_dict) {
-                    if (seq_len == 0) {
-                        // New group
-                        bit_len = word.len;
-                        seq_len = bit_freqs[bit_len];
-                        this->add_huffman_dict_header(seq_len, bit_len, *writer);
+                    if (counts[len] > (uint64_t(1) << len)) {
+                        throw utils::exceptions::Exception("Huffman::decode", "Invalid code lengths in header.");
                     }
 
-                    writer->put(algo::Huffman<T>::KEY_BITS, value);  // Put Key
-                    writer->put(bit_len, word.word);                 // Put Val
-                    seq_len--;
+                    total += counts[len];
+                    kraft += counts[len] << (max_len - len);
                 }
 
-                this->add_huffman_dict_header(0, 0, *writer);  // Stop bit
-
-                // Store length in bytes of source
-                // FIXME capped at 65k due to LEN_BITS being *only* 16
-                //       Maybe 2 additional bits to indicate length of [0b00: 16, 0b01: 32: 0b10: 48, 0b11: 64]?
-                writer->put(algo::Huffman<T>::LEN_BITS, uint16_t(original_length));
-
-                // Encode
-                reader.reset();
-                while (reader.get_position() < length) {
-                    const T word = T(reader.get(algo::Huffman<T>::KEY_BITS));
-                    const auto& pair = this->dict[word];
-                    writer->put(pair.len, pair.word);
+                // The lengths must be able to form a prefix code
+                if (total == 0 || kraft > (uint64_t(1) << max_len)) {
+                    throw utils::exceptions::Exception("Huffman::decode", "Invalid code lengths in header.");
                 }
 
-                const size_t total_length = writer->get_last_byte_position();
-
-                utils::Logger::Info("[Huffman]           Input file size: %8d bytes", original_length);
-                utils::Logger::Info("[Huffman]           Compressed size: %8d bytes  => Ratio: %.2f%%",
-                                      total_length,
-                                      float(total_length) / original_length * 100.0f);
-
-                if (original_length < total_length) {
-                    utils::Logger::Warn("[Huffman] No extra compression achieved, reverting stream to encoded.");
+                if (total > (reader.get_size_bits() - reader.get_position()) / algo::Huffman<T>::KEY_BITS) {
+                    throw utils::exceptions::Exception("Huffman::decode", "Stream is truncated.");
+                }
 
-                    writer.reset(utils::memory::new_var<utils::io::BitStreamWriter>(original_length));
-                    writer->put_bit(0);
+                std::vector<KeyPair> codes;
+                codes.reserve(size_t(total));
 
-                    reader.reset();
-                    while(reader.get_position() < length) {
-                        writer->put(algo::Huffman<T>::KEY_BITS, reader.get(algo::Huffman<T>::KEY_BITS));
+                for (uint32_t len = 1; len <= max_len; len++) {
+                    for (uint64_t i = 0; i < counts[len]; i++) {
+                        codes.emplace_back(T(reader.get64(algo::Huffman<T>::KEY_BITS)), Codeword{ 0u, len });
                     }
                 }
 
-                return writer;
+                algo::Huffman<T>::assignCanonical(codes);
+                return codes;
             }
 
             /**
-             *  @brief  Read the Huffman dict from the stream and
-             *          write the decoded data to an outputstream.
+             *  @brief  Decode a legacy stream, with a 16-bit length.
              *
              *  @param  reader
              *      The bytestream to read from.
-             *  @return Returns true if current Node has higher frequency.
+             *  @return Returns a new bitstream with the decoded data.
              */
-            utils::memory::unique_t<utils::io::BitStreamReader> decode(utils::io::BitStreamReader& reader) {
+            utils::memory::unique_t<utils::io::BitStreamReader> decodeLegacy(utils::io::BitStreamReader& reader) {
                 utils::memory::unique_t<utils::io::BitStreamReader> result;
 
-                if (reader.get_size() == 0) {
-                    // Nothing to decode?
-                    result.reset(nullptr);
-                    return result;
-                }
-
                 this->buildTree(reader);
 
                 const size_t raw_bits  = reader.get_size_bits();
-                      size_t data_bits = raw_bits - reader.get_position();
+                const size_t data_bits = raw_bits - reader.get_position();
 
-                if (this->tree_root->isLeaf()) {
+                if (this->dict.empty()) {
                     // No tree was build => No Huffman used, just use passthrough of buffer by setting pointer
                     const size_t data_bytes = utils::bits::round_to_byte(data_bits - 8);
 
@@ -502,17 +682,9 @@ namespace utils::algo {
                     // Get length in bytes of source
                     const size_t data_bytes = reader.get(algo::Huffman<T>::LEN_BITS);
 
-                    // Consume all other data, bit by bit and traverse Huffman tree to find word
+                    // Consume all other data and look up every word in the decoding table
                     auto writer = utils::memory::new_unique_var<utils::io::BitStreamWriter>(data_bytes);
-
-                    while (reader.get_position() < raw_bits && writer->get_last_byte_position() < data_bytes) {
-                        this->decode(reader, *writer);
-
-                        if (writer->get_position() + 16 > data_bits) {
-                            // Resize buffer if decompression reaches buffer size.
-                            data_bits = writer->resize() * 8u;
-                        }
-                    }
+                    this->decode(reader, *writer, data_bytes * 8u / algo::Huffman<T>::KEY_BITS);
 
                     const size_t original_length = reader.get_size();
                     const size_t total_length    = writer->get_last_byte_position();
@@ -524,8 +696,8 @@ namespace utils::algo {
                     writer->set_managed(false);
                     result->set_managed(true);
 
-                    utils::Logger::Info("[Huffman]           Input file size: %8d bytes", original_length);
-                    utils::Logger::Info("[Huffman]         Decompressed size: %8d bytes  => Ratio: %.2f%%",
+                    utils::Logger::Info("[Huffman]           Input file size: %8zu bytes", original_length);
+                    utils::Logger::Info("[Huffman]         Decompressed size: %8zu bytes  => Ratio: %.2f%%",
                                           total_length,
                                           float(total_length) / original_length * 100.0f);
                 }
@@ -534,86 +706,1243 @@ namespace utils::algo {
             }
 
             /**
-             * @brief encode
-             * @param rawfile
-             * @param encfile
-             * @return
+             *  @brief  Read the header of a versioned stream.
+             *
+             *  @param  reader
+             *      The bytestream to read from, positioned at the marker.
+             *  @param  mode
+             *      How the data following the header is stored (will be set).
+             *  @param  data_bytes
+             *      The length in bytes of the source (will be set).
              */
-            static bool encode(const std::string& rawfile, const std::string& encfile) {
-                try {
-                    auto enc = utils::io::BitStreamReader::from_file(rawfile);
-
-                    algo::Huffman<T> hm;
-                    auto writer = hm.encode(*enc);
-
-                    if (writer) {
-                        utils::io::bytes_to_file(encfile,
-                                                 writer->get_buffer(),
-                                                 writer->get_last_byte_position());
-                    } else {
-                        utils::Logger::Warn("[Huffman] Nothing to encode! Check contents of '%s'" + utils::Logger::CRLF, rawfile.c_str());
-                        return false;
-                    }
+            static void read_header(utils::io::BitStreamReader& reader, uint32_t& mode, uint64_t& data_bytes) {
+                if (reader.get_size_bits() - reader.get_position() < algo::Huffman<T>::HDR_BITS
+                 || reader.get(algo::Huffman<T>::HDR_FIELD_BITS) != algo::Huffman<T>::HDR_MARKER)
+                {
+                    throw utils::exceptions::Exception("Huffman::decode", "Missing stream header.");
+                }
 
-                    return true;
-                } catch (utils::exceptions::FileReadException const& e) {
-                    utils::Logger::Error(e.getMessage());
+                if (reader.get(algo::Huffman<T>::HDR_FIELD_BITS) != algo::Huffman<T>::HDR_VERSION) {
+                    throw utils::exceptions::Exception("Huffman::decode", "Unsupported stream version.");
                 }
 
-                return false;
+                mode       = reader.get(algo::Huffman<T>::HDR_FIELD_BITS);
+                data_bytes = algo::Huffman<T>::read_size(reader);
             }
 
             /**
-             * @brief decode
-             * @param encfile
-             * @param decfile
-             * @return
+             *  @brief  Make sure the rest of \p reader can hold a stored or canonical stream
+             *          of \p data_bytes bytes, before anything is allocated for it.
+             *
+             *  @param  reader
+             *      The bytestream to read from, positioned after the header.
+             *  @param  mode
+             *      The mode from the header.
+             *  @param  data_bytes
+             *      The length in bytes of the source.
              */
-            static bool decode(const std::string& encfile, const std::string& decfile) {
-                try {
-                    auto enc = utils::io::BitStreamReader::from_file(encfile);
+            static void check_length(const utils::io::BitStreamReader& reader, uint32_t mode, uint64_t data_bytes) {
+                const uint64_t available = reader.get_size_bits() - reader.get_position();
+
+                // Stored bytes take 8 bits each, coded symbols at least one
+                const bool truncated = mode == algo::Huffman<T>::MODE_STORED
+                                     ? data_bytes > available / 8u
+                                     : data_bytes * 8u / algo::Huffman<T>::KEY_BITS > available;
 
-                    algo::Huffman<T> hm;
-                    auto writer = hm.decode(*enc);
+                if (truncated) {
+                    throw utils::exceptions::Exception("Huffman::decode", "Stream is truncated.");
+                }
+            }
 
-                    if (writer) {
-                        utils::io::bytes_to_file(decfile,
-                                                 writer->get_buffer(),
-                                                 writer->get_size());
+            /**
+             *  @brief  Decode the data following the header of a stored or canonical stream.
+             *
+             *  @param  reader
+             *      The bytestream to read from, positioned after the header.
+             *  @param  mode
+             *      The mode from the header.
+             *  @param  data_bytes
+             *      The length in bytes of the source.
+             *  @param  out
+             *      The buffer to decode to, with room for \p data_bytes bytes.
+             */
+            void decodeBody(utils::io::BitStreamReader& reader, uint32_t mode, uint64_t data_bytes, uint8_t *out) {
+                if (mode == algo::Huffman<T>::MODE_STORED) {
+                    algo::Huffman<T>::check_length(reader, mode, data_bytes);
+                    const size_t position = reader.get_position();
+
+                    if (position % 8u == 0) {
+                        std::copy_n(reader.get_buffer() + position / 8u, size_t(data_bytes), out);
+                        reader.set_position(position + size_t(data_bytes) * 8u);
                     } else {
-                        utils::Logger::Warn("[Huffman] Nothing to decode! Check contents of '%s'" + utils::Logger::CRLF, encfile.c_str());
-                        return false;
+                        for (size_t i = 0; i < data_bytes; i++) {
+                            out[i] = uint8_t(reader.get(8u));
+                        }
                     }
+                } else if (mode == algo::Huffman<T>::MODE_CANONICAL) {
+                    const auto codes = algo::Huffman<T>::readCodes(reader);
 
-                    return true;
-                } catch (utils::exceptions::FileReadException const& e) {
-                    utils::Logger::Error(e.getMessage());
-                }
+                    this->table.build(codes);
+                    this->setCodes(codes);
 
-                return false;
-            }
+                    algo::Huffman<T>::check_length(reader, mode, data_bytes);
+                    const uint64_t count = data_bytes * 8u / algo::Huffman<T>::KEY_BITS;
 
-            void printDict(void)  {
-                utils::Logger::Info("[Huffman] Dictionary:");
+                    utils::io::BitStreamWriter writer(out, size_t(data_bytes));
+                    this->decode(reader, writer, size_t(count));
+                    writer.get_buffer();  // Commit the last bits
 
-                for (const auto& [key, word_value] : this->dict) {
-                    utils::Logger::Writef("%02X: %8X (%d bits)\n",
-                                          key, word_value.word, word_value.len);
+                    if (writer.get_position() != count * algo::Huffman<T>::KEY_BITS) {
+                        throw utils::exceptions::Exception("Huffman::decode", "Stream is truncated.");
+                    }
+                } else {
+                    throw utils::exceptions::Exception("Huffman::decode", "Unknown stream mode.");
+                }
+            }
+
+            /**
+             *  @brief  Decode a single block of a framed stream.
+             *
+             *  @param  reader
+             *      The framed stream.
+             *  @param  index
+             *      The index of the stream, see readFrameIndex().
+             *  @param  block
+             *      The block to decode.
+             *  @param  out
+             *      The buffer to decode to, with room for the block.
+             */
+            static void decodeFrame(const utils::io::BitStreamReader& reader, const FrameIndex& index,
+                                    size_t block, uint8_t *out)
+            {
+                const uint64_t start = block ? index.ends[block - 1] : 0u;
+                utils::io::BitStreamReader packed(const_cast<uint8_t*>(reader.get_buffer()) + index.data_offset + start,
+                                                  size_t(index.ends[block] - start));
+
+                uint32_t mode;
+                uint64_t data_bytes;
+                algo::Huffman<T>::read_header(packed, mode, data_bytes);
+
+                if (data_bytes != index.block_length(block) || mode == algo::Huffman<T>::MODE_FRAMED) {
+                    throw utils::exceptions::Exception("Huffman::decode", "Invalid block in framed stream.");
+                }
+
+                algo::Huffman<T>().decodeBody(packed, mode, data_bytes, out);
+            }
+
+            /**
+             *  @brief  Decode all blocks of a framed stream, in parallel if a pool is given.
+             *
+             *  @param  reader
+             *      The framed stream, positioned after the index.
+             *  @param  index
+             *      The index of the stream, see readFrameIndex().
+             *  @param  out
+             *      The buffer to decode to, with room for index.size bytes.
+             *  @param  pool
+             *      The pool to decode the blocks on, or nullptr to decode them one by one.
+             */
+            static void decodeFrames(utils::io::BitStreamReader& reader, const FrameIndex& index,
+                                     uint8_t *out, utils::threading::ThreadPool *pool)
+            {
+                if (pool == nullptr) {
+                    for (size_t block = 0; block < index.block_count(); block++) {
+                        algo::Huffman<T>::decodeFrame(reader, index, block, out + block * index.block_size);
+                    }
+                } else {
+                    // The calling thread decodes blocks too, so this can run inside a task on pool
+                    utils::algorithm::parallel::internal::run_chunks(*pool, index.block_count(), [&](const size_t block) {
+                        algo::Huffman<T>::decodeFrame(reader, index, block, out + block * index.block_size);
+                    });
+                }
+
+                reader.set_position((index.data_offset + index.data_length()) * 8u);
+            }
+
+            /**
+             *  @brief  Decode a versioned stream.
+             *
+             *  @param  reader
+             *      The bytestream to read from, positioned at the marker.
+             *  @param  pool
+             *      The pool to decode the blocks of a framed stream on, or nullptr.
+             *  @return Returns a new bitstream with the decoded data.
+             */
+            utils::memory::unique_t<utils::io::BitStreamReader> decodeVersioned(utils::io::BitStreamReader& reader,
+                                                                                utils::threading::ThreadPool *pool)
+            {
+                utils::memory::unique_t<utils::io::BitStreamReader> result;
+
+                const size_t start = reader.get_position();
+                uint32_t mode;
+                uint64_t data_bytes;
+                algo::Huffman<T>::read_header(reader, mode, data_bytes);
+
+                utils::memory::unique_arr_t<uint8_t> data(nullptr, &utils::memory::delete_array<uint8_t>);
+
+                if (mode == algo::Huffman<T>::MODE_FRAMED) {
+                    reader.set_position(start);
+                    const FrameIndex index = algo::Huffman<T>::readFrameIndex(reader);
+
+                    data = utils::memory::new_unique_array<uint8_t>(size_t(data_bytes));
+                    algo::Huffman<T>::decodeFrames(reader, index, data.get(), pool);
+                } else {
+                    algo::Huffman<T>::check_length(reader, mode, data_bytes);
+
+                    data = utils::memory::new_unique_array<uint8_t>(size_t(data_bytes));
+                    this->decodeBody(reader, mode, data_bytes, data.get());
+                }
+
+                result.reset(utils::memory::new_var<utils::io::BitStreamReader>(data.release(), size_t(data_bytes)));
+                result->set_managed(true);
+
+                if (mode == algo::Huffman<T>::MODE_STORED) {
+                    utils::Logger::Warn("[Huffman] Stream was stored without compression. Skipping decompression.");
+                } else {
+                    const size_t original_length = reader.get_size();
+                    const size_t total_length    = result->get_size();
+
+                    utils::Logger::Info("[Huffman]           Input file size: %8zu bytes", original_length);
+                    utils::Logger::Info("[Huffman]         Decompressed size: %8zu bytes  => Ratio: %.2f%%",
+                                          total_length,
+                                          float(total_length) / original_length * 100.0f);
+                }
+
+                return result;
+            }
+
+            /**
+             *  @brief  Read the Huffman dict from the stream and
+             *          write the decoded data to an outputstream.
+             *
+             *  @param  reader
+             *      The bytestream to read from.
+             *  @param  pool
+             *      The pool to decode the blocks of a framed stream on, or nullptr.
+             *  @return Returns a new bitstream with the decoded data.
+             */
+            utils::memory::unique_t<utils::io::BitStreamReader> decodeStream(utils::io::BitStreamReader& reader,
+                                                                             utils::threading::ThreadPool *pool)
+            {
+                if (reader.get_size() == 0) {
+                    // Nothing to decode?
+                    return utils::memory::unique_t<utils::io::BitStreamReader>(nullptr);
+                }
+
+                if (algo::Huffman<T>::is_versioned(reader)) {
+                    return this->decodeVersioned(reader, pool);
+                }
+
+                return this->decodeLegacy(reader);
+            }
+
+            /**
+             *  @brief  Count every symbol from the position of \p reader to its end.
+             *
+             *          Byte and word symbols at an aligned position are counted with
+             *          utils::algorithm::histogram, the rest one by one.
+             *
+             *  @param  reader
+             *      The bytestream to read from.
+             *  @param  freqs
+             *      The amount of times every symbol occurs (will be added to).
+             */
+            static void count_symbols(utils::io::BitStreamReader& reader, std::unordered_map<T, uint64_t>& freqs) {
+                const size_t length = reader.get_size_bits();
+
+                if constexpr (algo::Huffman<T>::KEY_BITS == 8u || algo::Huffman<T>::KEY_BITS == 16u) {
+                    using Word = std::conditional_t<(algo::Huffman<T>::KEY_BITS == 8u), uint8_t, uint16_t>;
+
+                    const size_t   position = reader.get_position();
+                    const uint8_t *bytes    = reader.get_buffer() + position / 8u;
+
+                    if (position % 8u == 0 && reinterpret_cast<uintptr_t>(bytes) % alignof(Word) == 0) {
+                        const size_t count  = (length - position) / algo::Huffman<T>::KEY_BITS;
+                        const auto   counts = utils::algorithm::histogram(reinterpret_cast<const Word*>(bytes), count);
+
+                        for (size_t value = 0; value < counts.size(); value++) {
+                            if (counts[value]) {
+                                // Symbols are read MSB first, so a word is big-endian in the stream
+                                uint8_t order[sizeof(Word)];
+                                const Word word = Word(value);
+                                std::memcpy(order, &word, sizeof(Word));
+
+                                T symbol = T(order[0]);
+                                for (size_t b = 1; b < sizeof(Word); b++) {
+                                    symbol = T((symbol << 8u) | order[b]);
+                                }
+
+                                freqs[symbol] += counts[value];
+                            }
+                        }
+
+                        reader.set_position(position + count * algo::Huffman<T>::KEY_BITS);
+                    }
+                }
+
+                while(reader.get_position() < length) {
+                    const T word = T(reader.get(algo::Huffman<T>::KEY_BITS));
+                    freqs[word]++;
+                }
+            }
+
+            /**
+             *  @brief  The length in bits of the code lengths for \p codes in the stream.
+             */
+            static size_t table_bits(const std::vector<KeyPair>& codes) {
+                return algo::Huffman<T>::CODE_LEN_BITS
+                     + (algo::Huffman<T>::KEY_BITS + 1u) * codes.back().second.len  // Amount of codes per length
+                     + algo::Huffman<T>::KEY_BITS * codes.size();                   // Keys in canonical order
+            }
+
+            /**
+             *  @brief  Write the code lengths for \p codes, see readCodes().
+             *
+             *  @param  codes
+             *      The codes in canonical order.
+             *  @param  writer
+             *      The outputstream to write to.
+             */
+            static void add_table(const std::vector<KeyPair>& codes, utils::io::BitStreamWriter& writer) {
+                const uint32_t max_len = codes.back().second.len;
+                writer.put(algo::Huffman<T>::CODE_LEN_BITS, max_len);
+
+                for (uint32_t len = 1; len <= max_len; len++) {
+                    const auto count = std::count_if(codes.begin(), codes.end(),
+                                                     [len](const KeyPair& pair) { return pair.second.len == len; });
+                    writer.put(algo::Huffman<T>::KEY_BITS + 1u, uint64_t(count));
+                }
+
+                for (const auto& [value, word] : codes) {
+                    UNUSED(word);
+                    writer.put(algo::Huffman<T>::KEY_BITS, value);
+                }
+            }
+
+            /**
+             *  @brief  Encode every symbol from the position of \p reader to its end
+             *          with the current dictionary.
+             *
+             *  @param  reader
+             *      The bytestream to read from.
+             *  @param  writer
+             *      The outputstream to write to, with room for the encoded symbols.
+             */
+            void encodeSymbols(utils::io::BitStreamReader& reader, utils::io::BitStreamWriter& writer) {
+                const size_t length = reader.get_size_bits();
+
+                while (reader.get_position() < length) {
+                    const T word = T(reader.get(algo::Huffman<T>::KEY_BITS));
+                    const auto& pair = this->dict[word];
+                    writer.put_unchecked(pair.len, pair.word);
+                }
+            }
+
+            /**
+             *  @brief  Encode bits of length sizeof(T) with canonical Huffman codes and
+             *          write the code lengths and the encoded data to an outputstream.
+             *
+             *          The stream starts with a versioned header: HDR_MARKER, HDR_VERSION,
+             *          the mode and the source length in bytes (SIZE_BITS). If Huffman coding
+             *          does not make the data smaller, it is stored as is (MODE_STORED).
+             *
+             *  @param  reader
+             *      The bytestream to read from.
+             *  @param  verbose
+             *      Whether to log the table overhead and the ratio.
+             *  @return Returns a new bitstream with the encoded data.
+             */
+            utils::memory::unique_t<utils::io::BitStreamWriter> encodeStream(utils::io::BitStreamReader& reader, bool verbose) {
+                const size_t length          = reader.get_size_bits();
+                const size_t original_length = reader.get_size();
+
+                utils::memory::unique_t<utils::io::BitStreamWriter> writer;
+
+                // Calculate frequencies
+                std::unordered_map<T, uint64_t> freqs;
+
+                reader.reset();
+                algo::Huffman<T>::count_symbols(reader, freqs);
+
+                if (freqs.empty()) {
+                    // Nothing to encode?
+                    writer.reset(nullptr);
+                    return writer;
+                }
+
+                const std::vector<KeyPair> codes = this->buildCodes(freqs);
+
+                // Calculate total needed length for the header and the data
+                const size_t h_dict_total_length = algo::Huffman<T>::table_bits(codes);
+                size_t data_length = 0u;
+
+                for (const auto& [value, word] : codes) {
+                    data_length += freqs[value] * word.len;
+                }
+
+                const size_t total_length = utils::bits::round_to_byte(algo::Huffman<T>::HDR_BITS + h_dict_total_length + data_length);
+
+                if (verbose) {
+                    utils::Logger::Info("[Huffman] Table overhead with %zu entries: %.1f bytes.",
+                                        codes.size(), float(h_dict_total_length) / 8.0f);
+                    utils::Logger::Info("[Huffman]           Input file size: %8zu bytes", original_length);
+                    utils::Logger::Info("[Huffman]           Compressed size: %8zu bytes  => Ratio: %.2f%%",
+                                          total_length,
+                                          float(total_length) / original_length * 100.0f);
+                }
+
+                reader.reset();
+
+                if (total_length >= algo::Huffman<T>::HDR_BITS / 8u + original_length) {
+                    if (verbose) {
+                        utils::Logger::Warn("[Huffman] No extra compression achieved, storing stream as is.");
+                    }
+
+                    writer.reset(utils::memory::new_var<utils::io::BitStreamWriter>(algo::Huffman<T>::HDR_BITS / 8u + original_length));
+                    algo::Huffman<T>::add_header(algo::Huffman<T>::MODE_STORED, original_length, *writer);
+
+                    while(reader.get_position() < length) {
+                        writer->put_unchecked(algo::Huffman<T>::KEY_BITS, reader.get(algo::Huffman<T>::KEY_BITS));
+                    }
+
+                    return writer;
+                }
+
+                writer.reset(utils::memory::new_var<utils::io::BitStreamWriter>(total_length));
+                algo::Huffman<T>::add_header(algo::Huffman<T>::MODE_CANONICAL, original_length, *writer);
+                algo::Huffman<T>::add_table(codes, *writer);
+                this->encodeSymbols(reader, *writer);
+
+                return writer;
+            }
+
+            /**
+             *  @brief  A window over an input stream that is read in as needed,
+             *          so a stream can be decoded in bounded memory.
+             */
+            class StreamWindow {
+                private:
+                    std::istream&                             in;
+                    std::vector<uint8_t>                      buffer;
+                    std::optional<utils::io::BitStreamReader> reader;  ///< Rebuilt in place, so references stay valid
+                    bool                                      eof;
+
+                public:
+                    StreamWindow(std::istream& in, size_t capacity)
+                        : in(in), buffer(capacity), eof(false)
+                    {
+                        this->reader.emplace(this->buffer.data(), 0);
+                    }
+
+                    inline utils::io::BitStreamReader& get(void) {
+                        return *this->reader;
+                    }
+
+                    /**
+                     *  @brief  Returns true if the whole input has been read in.
+                     */
+                    inline bool at_eof(void) const {
+                        return this->eof;
+                    }
+
+                    /**
+                     *  @brief  The amount of bits in the window after the position.
+                     */
+                    inline size_t available(void) const {
+                        const size_t position = std::min(this->reader->get_position(), this->reader->get_size_bits());
+                        return this->reader->get_size_bits() - position;
+                    }
+
+                    /**
+                     *  @brief  Make at least \p bits bits after the position available,
+                     *          dropping the bytes before it and reading in as much as fits.
+                     *
+                     *  @param  bits
+                     *      The amount of bits needed.
+                     *  @return Returns false if the input ends before that.
+                     */
+                    bool ensure(const size_t bits) {
+                        if (this->available() >= bits) {
+                            return true;
+                        } else if (this->eof) {
+                            return false;
+                        }
+
+                        const size_t position = std::min(this->reader->get_position(), this->reader->get_size_bits());
+                        const size_t start    = position / 8u;
+                        const size_t kept     = this->reader->get_size() - start;
+                        const size_t needed   = utils::bits::round_to_byte(position % 8u + bits);
+
+                        std::copy_n(this->buffer.begin() + std::ptrdiff_t(start), kept, this->buffer.begin());
+
+                        if (needed > this->buffer.size()) {
+                            this->buffer.resize(std::max(needed, this->buffer.size() * 2u));
+                        }
+
+                        this->in.read(reinterpret_cast<char*>(this->buffer.data() + kept),
+                                      std::streamsize(this->buffer.size() - kept));
+                        this->eof = !this->in;
+
+                        this->reader.emplace(this->buffer.data(), kept + size_t(this->in.gcount()));
+                        this->reader->set_position(position % 8u);
+
+                        return this->available() >= bits;
+                    }
+            };
+
+            /**
+             *  @brief  Peek the length in bits of the code lengths at the position of \p reader,
+             *          see readCodes().
+             */
+            static size_t table_bits_at(utils::io::BitStreamReader& reader) {
+                const size_t   mark    = reader.get_position();
+                const uint32_t max_len = std::min(reader.get(algo::Huffman<T>::CODE_LEN_BITS), algo::Huffman<T>::MAX_CODE_BITS);
+                uint64_t total = 0u;
+
+                for (uint32_t len = 1; len <= max_len; len++) {
+                    total += reader.get64(algo::Huffman<T>::KEY_BITS + 1u);
+                }
+
+                reader.set_position(mark);
+
+                return algo::Huffman<T>::CODE_LEN_BITS
+                     + (algo::Huffman<T>::KEY_BITS + 1u) * max_len
+                     + algo::Huffman<T>::KEY_BITS * size_t(std::min(total, uint64_t(1) << algo::Huffman<T>::KEY_BITS));
+            }
+
+            /**
+             *  @brief  Decode the data following the header of a canonical stream,
+             *          reading the input and writing the output in chunks.
+             *
+             *  @param  window
+             *      The input, positioned after the header.
+             *  @param  data_bytes
+             *      The length in bytes of the source.
+             *  @param  output
+             *      The buffer to decode a chunk to.
+             *  @param  out
+             *      The stream to write the decoded chunks to.
+             */
+            void decodeWindow(StreamWindow& window, uint64_t data_bytes,
+                              std::vector<uint8_t>& output, std::ostream& out)
+            {
+                utils::io::BitStreamReader& reader = window.get();
+
+                window.ensure(algo::Huffman<T>::CODE_LEN_BITS + algo::Huffman<T>::MAX_CODE_BITS * (algo::Huffman<T>::KEY_BITS + 1u));
+
+                if (!window.ensure(algo::Huffman<T>::table_bits_at(reader))) {
+                    throw utils::exceptions::Exception("Huffman::decode", "Stream is truncated.");
+                }
+
+                const auto codes = algo::Huffman<T>::readCodes(reader);
+
+                this->table.build(codes);
+                this->setCodes(codes);
+
+                const size_t refill = output.size() * 4u;  // Half the output chunk, in bits
+                uint64_t count = data_bytes * 8u / algo::Huffman<T>::KEY_BITS;
+
+                while (count) {
+                    window.ensure(refill);
+
+                    // Every code must be in the window, unless the input ends
+                    const size_t end   = reader.get_size_bits();
+                    const size_t limit = window.at_eof() ? end : end - std::min<size_t>(end, algo::Huffman<T>::MAX_CODE_BITS);
+
+                    if (reader.get_position() >= limit) {
+                        throw utils::exceptions::Exception("Huffman::decode", "Stream is truncated.");
+                    }
+
+                    utils::io::BitStreamWriter writer(output.data(), output.size());
+                    size_t symbols = size_t(std::min<uint64_t>(count, output.size() * 8u / algo::Huffman<T>::KEY_BITS));
+
+                    while (symbols-- && reader.get_position() < limit) {
+                        writer.put_unchecked(algo::Huffman<T>::KEY_BITS, this->table.decode(reader));
+                    }
+
+                    out.write(reinterpret_cast<const char*>(writer.get_buffer()), std::streamsize(writer.get_position() / 8u));
+                    count -= writer.get_position() / algo::Huffman<T>::KEY_BITS;
+                }
+            }
+
+        public:
+            /**
+             *  @brief  Default ctor
+             */
+            Huffman(void) : tree_root(nullptr) {
+                // Empty
+            }
+
+            /**
+             *  @brief  Default dtor
+             */
+            ~Huffman(void) {
+                utils::memory::delete_var(this->tree_root);
+            }
+
+            /**
+             *  @brief  Encode bits of length sizeof(T) with canonical Huffman codes and
+             *          write the code lengths and the encoded data to an outputstream.
+             *
+             *  @param  reader
+             *      The bytestream to read from.
+             *  @return Returns a new bitstream with the encoded data.
+             */
+            utils::memory::unique_t<utils::io::BitStreamWriter> encode(utils::io::BitStreamReader& reader) {
+                return this->encodeStream(reader, true);
+            }
+
+            /**
+             *  @brief  Encode \p reader as a framed stream: independent blocks of
+             *          \p block_size bytes with their own table, encoded in parallel on \p pool.
+             *
+             *          After the header (with MODE_FRAMED) follow the block size and the end
+             *          offset of every block (SIZE_BITS each), so a decoder can start at any
+             *          block (see decodeBlock()). Every block is a complete versioned stream.
+             *
+             *  @param  reader
+             *      The bytestream to read from.
+             *  @param  pool
+             *      The pool to encode the blocks on.
+             *  @param  block_size
+             *      The length in bytes of every block, rounded down to whole symbols.
+             *  @return Returns a new bitstream with the encoded data.
+             */
+            static utils::memory::unique_t<utils::io::BitStreamWriter> encode(utils::io::BitStreamReader& reader,
+                                                                              utils::threading::ThreadPool& pool,
+                                                                              size_t block_size = FRAME_BLOCK_SIZE)
+            {
+                const size_t original_length = reader.get_size();
+
+                utils::memory::unique_t<utils::io::BitStreamWriter> writer;
+
+                if (original_length == 0) {
+                    // Nothing to encode?
+                    writer.reset(nullptr);
+                    return writer;
+                }
+
+                // Blocks hold whole symbols
+                block_size = std::max(block_size - block_size % sizeof(T), sizeof(T));
+                const size_t blocks = (original_length + block_size - 1u) / block_size;
+
+                std::vector<utils::memory::unique_t<utils::io::BitStreamWriter>> encoded(blocks);
+
+                // The calling thread encodes blocks too, so this can run inside a task on pool
+                utils::algorithm::parallel::internal::run_chunks(pool, blocks, [&](const size_t block) {
+                    const size_t offset = block * block_size;
+                    utils::io::BitStreamReader raw(reader.get_buffer() + offset,
+                                                   std::min(block_size, original_length - offset));
+                    encoded[block] = algo::Huffman<T>().encodeStream(raw, false);
+                });
+
+                // Header, block size and block index
+                const size_t index_length = (algo::Huffman<T>::HDR_BITS + algo::Huffman<T>::SIZE_BITS * (1u + blocks)) / 8u;
+                size_t data_length = 0u;
+
+                writer.reset(utils::memory::new_var<utils::io::BitStreamWriter>(index_length));
+                algo::Huffman<T>::add_header(algo::Huffman<T>::MODE_FRAMED, original_length, *writer);
+                writer->put(algo::Huffman<T>::SIZE_BITS, block_size);
+
+                for (const auto& block : encoded) {
+                    data_length += block->get_last_byte_position();
+                    writer->put(algo::Huffman<T>::SIZE_BITS, data_length);
+                }
+
+                writer->reserve(index_length + data_length);
+                uint8_t *out = writer->get_buffer() + index_length;
+
+                for (const auto& block : encoded) {
+                    out = std::copy_n(block->get_buffer(), block->get_last_byte_position(), out);
+                }
+
+                writer->set_position((index_length + data_length) * 8u);
+
+                utils::Logger::Info("[Huffman]           Input file size: %8zu bytes in %zu blocks", original_length, blocks);
+                utils::Logger::Info("[Huffman]           Compressed size: %8zu bytes  => Ratio: %.2f%%",
+                                      index_length + data_length,
+                                      float(index_length + data_length) / original_length * 100.0f);
+
+                return writer;
+            }
+
+            /**
+             *  @brief  Read the Huffman dict from the stream and
+             *          write the decoded data to an outputstream.
+             *
+             *          Streams written before the versioned header was
+             *          introduced are still recognised and decoded.
+             *
+             *  @param  reader
+             *      The bytestream to read from.
+             *  @return Returns a new bitstream with the decoded data.
+             */
+            utils::memory::unique_t<utils::io::BitStreamReader> decode(utils::io::BitStreamReader& reader) {
+                return this->decodeStream(reader, nullptr);
+            }
+
+            /**
+             *  @brief  Like decode(), but decode the blocks of a framed stream in parallel on \p pool.
+             *
+             *  @param  reader
+             *      The bytestream to read from.
+             *  @param  pool
+             *      The pool to decode the blocks on.
+             *  @return Returns a new bitstream with the decoded data.
+             */
+            static utils::memory::unique_t<utils::io::BitStreamReader> decode(utils::io::BitStreamReader& reader,
+                                                                              utils::threading::ThreadPool& pool)
+            {
+                return algo::Huffman<T>().decodeStream(reader, &pool);
+            }
+
+            /**
+             *  @brief  Read the header and the block index of a framed stream.
+             *
+             *  @param  reader
+             *      The framed stream, positioned at the marker on a byte boundary.
+             *      Will be positioned at the first block.
+             *  @return Returns the index of the stream.
+             */
+            static FrameIndex readFrameIndex(utils::io::BitStreamReader& reader) {
+                FrameIndex index;
+                uint32_t mode;
+
+                algo::Huffman<T>::read_header(reader, mode, index.size);
+
+                if (mode != algo::Huffman<T>::MODE_FRAMED) {
+                    throw utils::exceptions::Exception("Huffman::readFrameIndex", "Not a framed stream.");
+                }
+
+                index.block_size = algo::Huffman<T>::read_size(reader);
+
+                if (index.block_size == 0 || index.block_size % sizeof(T) || reader.get_position() % 8u) {
+                    throw utils::exceptions::Exception("Huffman::readFrameIndex", "Invalid framed stream.");
+                }
+
+                const uint64_t blocks = index.size / index.block_size + (index.size % index.block_size != 0);
+
+                if (blocks > (reader.get_size_bits() - reader.get_position()) / algo::Huffman<T>::SIZE_BITS) {
+                    throw utils::exceptions::Exception("Huffman::readFrameIndex", "Stream is truncated.");
+                }
+
+                index.ends.resize(size_t(blocks));
+
+                for (auto& end : index.ends) {
+                    end = algo::Huffman<T>::read_size(reader);
+                }
+
+                if (!std::is_sorted(index.ends.begin(), index.ends.end())) {
+                    throw utils::exceptions::Exception("Huffman::readFrameIndex", "Invalid framed stream.");
+                }
+
+                index.data_offset = reader.get_position() / 8u;
+
+                if (index.data_length() > reader.get_size() - index.data_offset) {
+                    throw utils::exceptions::Exception("Huffman::readFrameIndex", "Stream is truncated.");
+                }
+
+                // Every coded symbol takes at least one bit, so neither the source
+                // nor any block can be longer than its encoded bits allow.
+                const auto fits = [](uint64_t source_bytes, uint64_t encoded_bytes) {
+                    return source_bytes / sizeof(T) <= encoded_bytes * 8u;
+                };
+
+                if (!fits(index.size, index.data_length())) {
+                    throw utils::exceptions::Exception("Huffman::readFrameIndex", "Stream is truncated.");
+                }
+
+                for (size_t block = 0; block < index.block_count(); block++) {
+                    const uint64_t start = block ? index.ends[block - 1] : 0u;
+
+                    if (!fits(index.block_length(block), index.ends[block] - start)) {
+                        throw utils::exceptions::Exception("Huffman::readFrameIndex", "Invalid block in framed stream.");
+                    }
+                }
+
+                return index;
+            }
+
+            /**
+             *  @brief  Decode a single block of a framed stream.
+             *
+             *  @param  reader
+             *      The framed stream.
+             *  @param  index
+             *      The index of the stream, see readFrameIndex().
+             *  @param  block
+             *      The block to decode, it starts at byte block * index.block_size of the source.
+             *  @return Returns a new bitstream with the decoded block.
+             */
+            static utils::memory::unique_t<utils::io::BitStreamReader> decodeBlock(const utils::io::BitStreamReader& reader,
+                                                                                   const FrameIndex& index,
+                                                                                   size_t block)
+            {
+                if (block >= index.block_count()) {
+                    throw utils::exceptions::Exception("Huffman::decodeBlock", "Block index out of range.");
+                }
+
+                const size_t length = size_t(index.block_length(block));
+
+                auto data = utils::memory::new_unique_array<uint8_t>(length);
+                algo::Huffman<T>::decodeFrame(reader, index, block, data.get());
+
+                utils::memory::unique_t<utils::io::BitStreamReader> result(
+                    utils::memory::new_var<utils::io::BitStreamReader>(data.release(), length)
+                );
+                result->set_managed(true);
+
+                return result;
+            }
+
+            /**
+             *  @brief  Encode \p in to \p out in bounded memory.
+             *
+             *          If \p in is seekable, it is read twice: once to count the symbols
+             *          and once to encode them, which gives the same stream as encode().
+             *          Otherwise every chunk is encoded as a separate stream with its
+             *          own table, see HuffmanStreamEncoder.
+             *
+             *  @param  in
+             *      The stream to read from.
+             *  @param  out
+             *      The stream to write to.
+             *  @param  chunk_size
+             *      The amount of bytes to read at a time, rounded down to whole symbols.
+             *  @return Returns the amount of bytes read from \p in.
+             */
+            static uint64_t encode(std::istream& in, std::ostream& out, size_t chunk_size = STREAM_CHUNK_SIZE) {
+                chunk_size = std::max(chunk_size - chunk_size % sizeof(T), sizeof(T));
+
+                std::vector<uint8_t> chunk(chunk_size);
+                const auto read_chunk = [&in, &chunk] {
+                    in.read(reinterpret_cast<char*>(chunk.data()), std::streamsize(chunk.size()));
+                    return size_t(in.gcount());
+                };
+
+                const auto start = in.tellg();
+
+                if (start == std::istream::pos_type(-1)) {
+                    algo::HuffmanStreamEncoder<T> encoder(out, chunk_size);
+
+                    for (size_t n; (n = read_chunk()) > 0; ) {
+                        encoder.push(chunk.data(), n);
+                    }
+
+                    encoder.finish();
+                    return encoder.get_consumed();
+                }
+
+                // First pass: calculate frequencies
+                std::unordered_map<T, uint64_t> freqs;
+                uint64_t original_length = 0u;
+
+                for (size_t n; (n = read_chunk()) > 0; original_length += n) {
+                    utils::io::BitStreamReader raw(chunk.data(), n);
+                    algo::Huffman<T>::count_symbols(raw, freqs);
+                }
+
+                if (freqs.empty()) {
+                    // Nothing to encode?
+                    return 0u;
+                }
+
+                algo::Huffman<T> hm;
+                const std::vector<KeyPair> codes = hm.buildCodes(freqs);
+
+                const size_t h_dict_total_length = algo::Huffman<T>::table_bits(codes);
+                uint64_t data_length = 0u;
+
+                for (const auto& [value, word] : codes) {
+                    data_length += freqs[value] * word.len;
+                }
+
+                const bool stored = utils::bits::round_to_byte(h_dict_total_length + data_length) >= original_length;
+
+                in.clear();
+                in.seekg(start);
+
+                // Second pass: encode
+                if (stored) {
+                    utils::io::BitStreamWriter header(algo::Huffman<T>::HDR_BITS / 8u);
+                    algo::Huffman<T>::add_header(algo::Huffman<T>::MODE_STORED, original_length, header);
+                    out.write(reinterpret_cast<const char*>(header.get_buffer()), std::streamsize(header.get_size()));
+
+                    for (size_t n; (n = read_chunk()) > 0; ) {
+                        out.write(reinterpret_cast<const char*>(chunk.data()), std::streamsize(n));
+                    }
+
+                    return original_length;
+                }
+
+                // Room for the header, the table, a carried byte and an encoded chunk
+                std::vector<uint8_t> output(utils::bits::round_to_byte(algo::Huffman<T>::HDR_BITS + h_dict_total_length + 8u
+                                                                       + chunk_size * 8u / algo::Huffman<T>::KEY_BITS
+                                                                                    * codes.back().second.len));
+                uint8_t       carry      = 0u;
+                uint_fast32_t carry_bits = 0u;
+
+                for (bool first = true; ; first = false) {
+                    const size_t n = read_chunk();
+
+                    if (n == 0) {
+                        break;
+                    }
+
+                    utils::io::BitStreamWriter writer(output.data(), output.size());
+                    writer.put(carry_bits, carry);
+
+                    if (first) {
+                        algo::Huffman<T>::add_header(algo::Huffman<T>::MODE_CANONICAL, original_length, writer);
+                        algo::Huffman<T>::add_table(codes, writer);
+                    }
+
+                    utils::io::BitStreamReader raw(chunk.data(), n);
+                    hm.encodeSymbols(raw, writer);
+
+                    // Write the whole bytes and carry the bits of the last one to the next chunk
+                    const uint8_t *encoded = writer.get_buffer();
+                    const size_t   bytes   = writer.get_position() / 8u;
+                    out.write(reinterpret_cast<const char*>(encoded), std::streamsize(bytes));
+
+                    carry_bits = uint_fast32_t(writer.get_position() % 8u);
+                    carry      = carry_bits ? uint8_t(encoded[bytes] >> (8u - carry_bits)) : 0u;
+                }
+
+                if (carry_bits) {
+                    out.put(char(carry << (8u - carry_bits)));
+                }
+
+                return original_length;
+            }
+
+            /**
+             *  @brief  Decode \p in to \p out in bounded memory.
+             *
+             *          Accepts everything decode() does, and concatenated streams
+             *          as written by HuffmanStreamEncoder. The blocks of a framed
+             *          stream are decoded one by one.
+             *
+             *  @param  in
+             *      The stream to read from.
+             *  @param  out
+             *      The stream to write to.
+             *  @return Returns the amount of bytes written to \p out.
+             */
+            static uint64_t decode(std::istream& in, std::ostream& out) {
+                StreamWindow window(in, algo::Huffman<T>::STREAM_CHUNK_SIZE);
+                utils::io::BitStreamReader& reader = window.get();
+
+                std::vector<uint8_t> output(algo::Huffman<T>::STREAM_CHUNK_SIZE);
+                uint64_t written = 0u;
+
+                for (bool first = true; window.ensure(8u); first = false) {
+                    window.ensure(algo::Huffman<T>::HDR_BITS);
+
+                    if (first && !algo::Huffman<T>::is_versioned(reader)) {
+                        // Legacy streams are at most 64 KiB, decode them in memory
+                        while (window.ensure(window.available() + 8u));
+
+                        auto result = algo::Huffman<T>().decodeLegacy(reader);
+                        out.write(reinterpret_cast<const char*>(result->get_buffer()), std::streamsize(result->get_size()));
+                        written += result->get_size();
+                        break;
+                    }
+
+                    uint32_t mode;
+                    uint64_t data_bytes;
+                    algo::Huffman<T>::read_header(reader, mode, data_bytes);
+
+                    if (mode == algo::Huffman<T>::MODE_FRAMED) {
+                        // Skip the index, the blocks follow as separate streams
+                        if (!window.ensure(algo::Huffman<T>::SIZE_BITS)) {
+                            throw utils::exceptions::Exception("Huffman::decode", "Stream is truncated.");
+                        }
+
+                        const uint64_t block_size = algo::Huffman<T>::read_size(reader);
+
+                        if (block_size == 0 || block_size % sizeof(T)) {
+                            throw utils::exceptions::Exception("Huffman::decode", "Invalid framed stream.");
+                        }
+
+                        for (uint64_t blocks = data_bytes / block_size + (data_bytes % block_size != 0); blocks--; ) {
+                            if (!window.ensure(algo::Huffman<T>::SIZE_BITS)) {
+                                throw utils::exceptions::Exception("Huffman::decode", "Stream is truncated.");
+                            }
+
+                            reader.skip(algo::Huffman<T>::SIZE_BITS);
+                        }
+
+                        continue;
+                    } else if (mode == algo::Huffman<T>::MODE_STORED) {
+                        for (uint64_t left = data_bytes; left; ) {
+                            if (!window.ensure(8u)) {
+                                throw utils::exceptions::Exception("Huffman::decode", "Stream is truncated.");
+                            }
+
+                            const size_t bytes = size_t(std::min<uint64_t>(left, window.available() / 8u));
+                            out.write(reinterpret_cast<const char*>(reader.get_buffer() + reader.get_position() / 8u),
+                                      std::streamsize(bytes));
+
+                            reader.skip(bytes * 8u);
+                            left -= bytes;
+                        }
+                    } else if (mode == algo::Huffman<T>::MODE_CANONICAL) {
+                        algo::Huffman<T>().decodeWindow(window, data_bytes, output, out);
+
+                        // The next stream starts on a byte boundary
+                        reader.set_position(utils::bits::round_to_byte(reader.get_position()) * 8u);
+                    } else {
+                        throw utils::exceptions::Exception("Huffman::decode", "Unknown stream mode.");
+                    }
+
+                    written += data_bytes;
+                }
+
+                return written;
+            }
+
+            /**
+             * @brief encode
+             * @param rawfile
+             * @param encfile
+             * @param pool  If given, write a framed stream with blocks encoded on this pool.
+             *              Otherwise the file is streamed through in bounded memory.
+             * @return
+             */
+            static bool encode(const std::string& rawfile, const std::string& encfile,
+                               utils::threading::ThreadPool *pool = nullptr)
+            {
+                try {
+                    if (pool) {
+                        auto enc    = utils::io::BitStreamReader::from_file(rawfile);
+                        auto writer = algo::Huffman<T>::encode(*enc, *pool);
+
+                        if (writer) {
+                            utils::io::bytes_to_file(encfile,
+                                                     writer->get_buffer(),
+                                                     writer->get_last_byte_position());
+                            return true;
+                        }
+                    } else {
+                        std::ifstream in(rawfile, std::ifstream::binary);
+
+                        if (HEDLEY_UNLIKELY(!in.good())) {
+                            throw utils::exceptions::FileReadException(rawfile);
+                        }
+
+                        std::ofstream out(encfile, std::ofstream::binary);
+                        const uint64_t original_length = algo::Huffman<T>::encode(in, out);
+
+                        if (HEDLEY_UNLIKELY(!out.good())) {
+                            throw utils::exceptions::FileWriteException(encfile);
+                        }
+
+                        if (original_length) {
+                            utils::Logger::Info("[Huffman]           Input file size: %8zu bytes", size_t(original_length));
+                            utils::Logger::Info("[Huffman]           Compressed size: %8zu bytes  => Ratio: %.2f%%",
+                                                  size_t(out.tellp()),
+                                                  float(out.tellp()) / original_length * 100.0f);
+                            return true;
+                        }
+                    }
+
+                    utils::Logger::Warn("[Huffman] Nothing to encode! Check contents of '%s'" + utils::Logger::CRLF, rawfile.c_str());
+                    return false;
+                } catch (utils::exceptions::FileReadException const& e) {
+                    utils::Logger::Error(e.getMessage());
+                } catch (utils::exceptions::FileWriteException const& e) {
+                    utils::Logger::Error(e.getMessage());
+                }
+
+                return false;
+            }
+
+            /**
+             * @brief decode
+             * @param encfile
+             * @param decfile
+             * @param pool  If given, decode the blocks of a framed stream on this pool.
+             *              Otherwise the file is streamed through in bounded memory.
+             * @return
+             */
+            static bool decode(const std::string& encfile, const std::string& decfile,
+                               utils::threading::ThreadPool *pool = nullptr)
+            {
+                try {
+                    if (pool) {
+                        auto enc    = utils::io::BitStreamReader::from_file(encfile);
+                        auto writer = algo::Huffman<T>::decode(*enc, *pool);
+
+                        if (writer) {
+                            utils::io::bytes_to_file(decfile,
+                                                     writer->get_buffer(),
+                                                     writer->get_size());
+                            return true;
+                        }
+                    } else {
+                        std::ifstream in(encfile, std::ifstream::binary);
+
+                        if (HEDLEY_UNLIKELY(!in.good())) {
+                            throw utils::exceptions::FileReadException(encfile);
+                        }
+
+                        std::ofstream out(decfile, std::ofstream::binary);
+                        const uint64_t total_length = algo::Huffman<T>::decode(in, out);
+
+                        if (HEDLEY_UNLIKELY(!out.good())) {
+                            throw utils::exceptions::FileWriteException(decfile);
+                        }
+
+                        if (total_length) {
+                            utils::Logger::Info("[Huffman]         Decompressed size: %8zu bytes", size_t(total_length));
+                            return true;
+                        }
+                    }
+
+                    utils::Logger::Warn("[Huffman] Nothing to decode! Check contents of '%s'" + utils::Logger::CRLF, encfile.c_str());
+                    return false;
+                } catch (utils::exceptions::FileReadException const& e) {
+                    utils::Logger::Error(e.getMessage());
+                } catch (utils::exceptions::FileWriteException const& e) {
+                    utils::Logger::Error(e.getMessage());
+                }
+
+                return false;
+            }
+
+            void printDict(void)  {
+                utils::Logger::Info("[Huffman] Dictionary:");
+
+                for (const auto& [key, word_value] : this->dict) {
+                    utils::Logger::Writef("%02X: %8X (%d bits)\n",
+                                          key, word_value.word, word_value.len);
                 }
             }
 
             void printTree(void) {
                 utils::Logger::Info("[Huffman] Tree:");
+                utils::memory::delete_var(this->tree_root);
+                this->tree_root = utils::memory::new_var<algo::Node<T>>(-1);
+
+                for (const auto& entry : this->dict) {
+                    this->treeAddLeaf(entry);
+                }
+
                 algo::Node<T>::printTree(this->tree_root);
             }
 
-            static constexpr inline size_t KEY_BITS = utils::bits::size_of<T>();  ///< Bit length for keys in Huffman dict
-            static constexpr inline size_t LEN_BITS = 16ull;                      ///< Bit length to store byte length of source (65k max)
+            static constexpr inline size_t   KEY_BITS       = utils::bits::size_of<T>();  ///< Bit length for keys in Huffman dict
+            static constexpr inline size_t   LEN_BITS       = 16ull;  ///< Bit length to store byte length of source in legacy streams (65k max)
+            static constexpr inline size_t   SIZE_BITS      = 64ull;  ///< Bit length to store byte length of source
+            static constexpr inline uint32_t MAX_CODE_BITS  = 20u;    ///< Longest code the encoder assigns, keeps the secondary decoding tables small
+            static constexpr inline size_t   CODE_LEN_BITS  = 5ull;   ///< Bit length to store the longest code length
+
+            static constexpr inline size_t   HDR_FIELD_BITS = 8ull;   ///< Bit length of the marker, version and mode fields
+            static constexpr inline size_t   HDR_BITS       = 3ull * HDR_FIELD_BITS + SIZE_BITS;  ///< Bit length of the versioned header
+            static constexpr inline uint8_t  HDR_MARKER     = 0x80u;  ///< First byte of a versioned stream (an empty legacy dict group)
+            static constexpr inline uint8_t  HDR_VERSION    = 1u;     ///< Current stream version
+            static constexpr inline uint8_t  MODE_STORED    = 0u;     ///< The source follows the header as is
+            static constexpr inline uint8_t  MODE_CANONICAL = 1u;     ///< Code lengths and canonical Huffman coded data follow the header
+            static constexpr inline uint8_t  MODE_FRAMED    = 2u;     ///< A block index and independently coded blocks follow the header
+
+            static constexpr inline size_t   FRAME_BLOCK_SIZE  = 1ull << 20u;  ///< Default length in bytes of the blocks of a framed stream
+            static constexpr inline size_t   STREAM_CHUNK_SIZE = 1ull << 20u;  ///< Default length in bytes read or written at a time when streaming
 
             static constexpr inline size_t DICT_HDR_HAS_ITEMS_BITS  = 1ull;  ///< Whether there are dictionary items following (bit length)
             static constexpr inline size_t DICT_HDR_SEQ_LENGTH_BITS = 7ull;  ///< Amount of bits to represent the length of following items
             static constexpr inline size_t DICT_HDR_ITEM_BITS       = 4ull;  ///< Amount of bits to represent the length of following items
     };
+
+    /**
+     *  @brief  Encode data that is pushed in pieces, in bounded memory.
+     *
+     *          Every chunk of chunk_size bytes is written to the output as a separate
+     *          stream with its own table as soon as it is complete, so no more than one
+     *          chunk is held at a time. Huffman<T>::decode(std::istream&, std::ostream&)
+     *          reads the concatenated streams back.
+     */
+    template<class T>
+    class HuffmanStreamEncoder {
+        private:
+            std::ostream&        out;
+            std::vector<uint8_t> pending;
+            size_t               chunk_size;
+            uint64_t             consumed;   ///< Bytes pushed so far
+            uint64_t             written;    ///< Bytes written to out so far
+
+            /**
+             *  @brief  Encode and write the pending bytes.
+             */
+            void emit(void) {
+                if (this->pending.empty()) {
+                    return;
+                }
+
+                utils::io::BitStreamReader raw(this->pending.data(), this->pending.size());
+                auto encoded = algo::Huffman<T>().encodeStream(raw, false);
+
+                out.write(reinterpret_cast<const char*>(encoded->get_buffer()),
+                          std::streamsize(encoded->get_last_byte_position()));
+
+                this->written += encoded->get_last_byte_position();
+                this->pending.clear();
+            }
+
+        public:
+            /**
+             *  @brief  Default ctor
+             *
+             *  @param  out
+             *      The stream to write the encoded chunks to.
+             *  @param  chunk_size
+             *      The length in bytes of every chunk, rounded down to whole symbols.
+             */
+            HuffmanStreamEncoder(std::ostream& out, size_t chunk_size = algo::Huffman<T>::STREAM_CHUNK_SIZE)
+                : out(out)
+                , chunk_size(std::max(chunk_size - chunk_size % sizeof(T), sizeof(T)))
+                , consumed(0u)
+                , written(0u)
+            {
+                this->pending.reserve(this->chunk_size);
+            }
+
+            /**
+             *  @brief  Add \p length bytes to the input, writing every chunk that is completed.
+             */
+            void push(const uint8_t *data, size_t length) {
+                this->consumed += length;
+
+                while (length) {
+                    const size_t take = std::min(length, this->chunk_size - this->pending.size());
+                    this->pending.insert(this->pending.end(), data, data + take);
+
+                    data   += take;
+                    length -= take;
+
+                    if (this->pending.size() == this->chunk_size) {
+                        this->emit();
+                    }
+                }
+            }
+
+            /**
+             *  @brief  Write the last, partial chunk and flush the output.
+             *          Must be called once all input was pushed.
+             */
+            void finish(void) {
+                this->emit();
+                this->out.flush();
+            }
+
+            inline uint64_t get_consumed(void) const {
+                return this->consumed;
+            }
+
+            inline uint64_t get_written(void) const {
+                return this->written;
+            }
+    };
 }
 
 #endif // HUFFMAN_HPP
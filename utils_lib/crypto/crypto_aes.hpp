@@ -2,61 +2,255 @@
 #define ALGO_AES_HPP
 
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
+#include <functional>
+#include <vector>
+#include "../utils_algorithm.hpp"
+#include "../utils_compiler.hpp"
+#include "../utils_exceptions.hpp"
 #include "../utils_memory.hpp"
+#include "../utils_threading.hpp"
 
 /**
  *  TODO: https://github.com/SergeyBel/AES
  */
 
+/*
+ *  AES-NI (and PCLMULQDQ for GCM) is only compiled in for x86, and only used
+ *  when CPUID reports it. The intrinsics are enabled per function, so no -maes is needed.
+ */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define UTILS_CRYPTO_AES_NI 1
+    #include <wmmintrin.h>
+    #include <tmmintrin.h>
+
+    #ifdef UTILS_COMPILER_MSVC
+        #include <intrin.h>
+        #define UTILS_CRYPTO_AES_NI_TARGET
+        #define UTILS_CRYPTO_CLMUL_TARGET
+    #else
+        #include <cpuid.h>
+        #define UTILS_CRYPTO_AES_NI_TARGET __attribute__((target("aes,sse2")))
+        #define UTILS_CRYPTO_CLMUL_TARGET  __attribute__((target("pclmul,ssse3")))
+    #endif
+#endif
+
 namespace utils::crypto {
+    namespace internal {
+        inline constexpr uint8_t aes_sbox[256] = {
+            0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+            0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+            0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+            0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+            0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
+            0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+            0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
+            0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+            0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+            0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+            0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
+            0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+            0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
+            0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+            0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+            0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+            0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
+            0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+            0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+            0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+            0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+            0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+            0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
+            0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+            0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
+            0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+            0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+            0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+            0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
+            0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+            0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
+            0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+        };
+
+        inline constexpr uint8_t aes_inv_sbox[256] = {
+            0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38,
+            0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+            0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87,
+            0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+            0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d,
+            0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+            0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2,
+            0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+            0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16,
+            0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+            0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda,
+            0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+            0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a,
+            0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+            0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02,
+            0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+            0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea,
+            0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+            0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85,
+            0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+            0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89,
+            0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+            0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20,
+            0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+            0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31,
+            0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+            0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d,
+            0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+            0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0,
+            0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+            0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26,
+            0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d,
+        };
+
+        /**
+         *  @brief  Multiply \p a and \p b in GF(2^8).
+         */
+        constexpr uint8_t aes_mul(uint8_t a, uint8_t b) {
+            uint8_t c = 0;
+
+            while (b) {
+                if (b & 1) c ^= a;
+                a = uint8_t((a << 1) ^ ((a & 0x80) ? 0x1b : 0x00));
+                b >>= 1;
+            }
+
+            return c;
+        }
+
+        /**
+         *  @brief  Combined SubBytes and MixColumns lookups for 32-bit words,
+         *          with row 0 in the most significant byte.
+         *          enc[r] and dec[r] are enc[0] and dec[0] rotated right by r bytes.
+         */
+        struct AesTables {
+            uint32_t enc[4][256];
+            uint32_t dec[4][256];
+        };
+
+        constexpr AesTables make_aes_tables(void) {
+            AesTables tables{};
+
+            for (size_t x = 0; x < 256; x++) {
+                const uint8_t s = aes_sbox[x];
+                const uint8_t i = aes_inv_sbox[x];
+
+                const uint32_t e = uint32_t(aes_mul(s, 0x02)) << 24 | uint32_t(s) << 16
+                                 | uint32_t(s) << 8 | uint32_t(aes_mul(s, 0x03));
+                const uint32_t d = uint32_t(aes_mul(i, 0x0e)) << 24 | uint32_t(aes_mul(i, 0x09)) << 16
+                                 | uint32_t(aes_mul(i, 0x0d)) << 8 | uint32_t(aes_mul(i, 0x0b));
+
+                tables.enc[0][x] = e;
+                tables.dec[0][x] = d;
+
+                for (size_t r = 1; r < 4; r++) {
+                    tables.enc[r][x] = e >> (8 * r) | e << (32 - 8 * r);
+                    tables.dec[r][x] = d >> (8 * r) | d << (32 - 8 * r);
+                }
+            }
+
+            return tables;
+        }
+
+        inline constexpr AesTables aes_tables = make_aes_tables();
+    }
+
     class AES {
+        public:
+            static constexpr inline size_t BLOCK_BYTES = 16;  ///< Bytes per block (4 * Nb)
+            static constexpr inline int    MAX_ROUNDS  = 14;  ///< Rounds for the largest key
+            static constexpr inline size_t PIPELINE_BLOCKS = 8;  ///< Blocks processed together where the mode allows it
+
+            /**
+             *  @brief  The implementation used to encrypt and decrypt blocks.
+             *          Every engine gives the same output.
+             */
+            enum class Engine : uint8_t {
+                Reference,  ///< Byte-oriented, step by step as in FIPS-197
+                TTable,     ///< 32-bit table lookups, combining SubBytes, ShiftRows and MixColumns
+                AESNI,      ///< x86 AES instructions, if the CPU has them
+            };
+
+            /**
+             *  @brief  How the last block is filled up to BLOCK_BYTES.
+             */
+            enum class Padding : uint8_t {
+                None,   ///< No padding, ECB and CBC input must be whole blocks
+                Zeros,  ///< Zero bytes, only if the length is not a whole number of blocks; not removed on decrypt
+                PKCS7,  ///< n bytes of value n (RFC 5652), always added and checked and removed on decrypt
+            };
+
+            using bytes_t       = utils::memory::span<uint8_t>;
+            using const_bytes_t = utils::memory::span<const uint8_t>;
+
+            /**
+             *  @brief  A key schedule, expanded once and reused for every block.
+             *          Create with AES::MakeContext().
+             */
+            class Context {
+                friend class AES;
+
+                private:
+                    alignas(16) uint8_t round_keys[BLOCK_BYTES * (MAX_ROUNDS + 1)];
+                    alignas(16) uint8_t inv_round_keys[BLOCK_BYTES * (MAX_ROUNDS + 1)];  ///< With InvMixColumns applied, for the equivalent inverse cipher
+                    int rounds;
+                    Engine engine;
+
+                    Context(void) : round_keys{}, inv_round_keys{}, rounds(0), engine(Engine::Reference) {}
+
+                public:
+                    inline int get_rounds(void) const {
+                        return this->rounds;
+                    }
+
+                    inline Engine get_engine(void) const {
+                        return this->engine;
+                    }
+            };
+
         private:
             int Nb; ///< Number of blocks
             int Nk; ///< Number of keys uint32_ts in key (Nk * 32 is keysize)
             int Nr; ///< Number of rounds
 
-            uint32_t blockBytesLen;
+            /*
+             *  The state is kept as 16 bytes in input order, so byte r + 4 * c
+             *  is row r of column c and every column is 4 consecutive bytes.
+             */
 
-            void SubBytes(uint8_t **state) const {
-                for (int i = 0; i < 4; i++) {
-                    for (int j = 0; j < this->Nb; j++) {
-                        const uint8_t t = state[i][j];
-                        state[i][j] = this->sbox[t];
-                    }
+            static inline void SubBytes(uint8_t *state) {
+                for (size_t i = 0; i < BLOCK_BYTES; i++) {
+                    state[i] = internal::aes_sbox[state[i]];
                 }
             }
 
-            // shift row i on n positions
-            void ShiftRow(uint8_t **state, const int i, const int n) const {
-                for (int k = 0; k < n; k++) {
-                    const uint8_t t = state[i][0];
-
-                    for (int j = 0; j < this->Nb - 1; j++) {
-                        state[i][j] = state[i][j + 1];
-                    }
-
-                    state[i][this->Nb - 1] = t;
-                }
-            }
+            static inline void ShiftRows(uint8_t *state) {
+                const uint8_t s[BLOCK_BYTES] = {
+                    state[ 0], state[ 5], state[10], state[15],
+                    state[ 4], state[ 9], state[14], state[ 3],
+                    state[ 8], state[13], state[ 2], state[ 7],
+                    state[12], state[ 1], state[ 6], state[11],
+                };
 
-            inline void ShiftRows(uint8_t **state) const {
-                this->ShiftRow(state, 1, 1);
-                this->ShiftRow(state, 2, 2);
-                this->ShiftRow(state, 3, 3);
+                std::copy_n(s, BLOCK_BYTES, state);
             }
 
             // multiply on x
-            inline uint8_t xtime(uint8_t b) const {
+            static inline uint8_t xtime(uint8_t b) {
                 constexpr uint8_t mask = 0x80, m = 0x1b;
                 const uint8_t high_bit = b & mask;
-                b <<= 1;
+                b = uint8_t(b << 1);
 
                 // b ^ m => mod m(x)
                 return high_bit ? b ^ m : b;
             }
 
-            uint8_t mul_bytes(uint8_t a, uint8_t b) const {
+            static uint8_t mul_bytes(uint8_t a, uint8_t b) {
                 constexpr uint8_t mask = 1;
                 uint8_t c = 0;
 
@@ -68,7 +262,7 @@ namespace utils::crypto {
 
                         for (int j = 0; j < i; j++) {
                             // multiply on x^i
-                            d = xtime(d);
+                            d = AES::xtime(d);
                         }
 
                         c ^= d;    // xor to result
@@ -80,36 +274,27 @@ namespace utils::crypto {
                 return c;
             }
 
-            void MixColumns(uint8_t **state) const {
-                uint8_t s[4], s1[4];
+            static void MixColumns(uint8_t *state) {
+                for (size_t j = 0; j < BLOCK_BYTES; j += 4) {
+                    uint8_t *s = state + j;
+                    const uint8_t s0 = s[0], s1 = s[1], s2 = s[2], s3 = s[3];
 
-                for (int j = 0; j < this->Nb; j++) {
-                    for (int i = 0; i < 4; i++) {
-                        s[i] = state[i][j];
-                    }
-
-                    s1[0] = mul_bytes(0x02, s[0]) ^ mul_bytes(0x03, s[1]) ^ s[2] ^ s[3];
-                    s1[1] = s[0] ^ mul_bytes(0x02, s[1]) ^ mul_bytes(0x03, s[2]) ^ s[3];
-                    s1[2] = s[0] ^ s[1] ^ mul_bytes(0x02, s[2]) ^ mul_bytes(0x03, s[3]);
-                    s1[3] = mul_bytes(0x03, s[0]) ^ s[1] ^ s[2] ^ mul_bytes(0x02, s[3]);
-
-                    for (int i = 0; i < 4; i++) {
-                        state[i][j] = s1[i];
-                    }
+                    s[0] = AES::mul_bytes(0x02, s0) ^ AES::mul_bytes(0x03, s1) ^ s2 ^ s3;
+                    s[1] = s0 ^ AES::mul_bytes(0x02, s1) ^ AES::mul_bytes(0x03, s2) ^ s3;
+                    s[2] = s0 ^ s1 ^ AES::mul_bytes(0x02, s2) ^ AES::mul_bytes(0x03, s3);
+                    s[3] = AES::mul_bytes(0x03, s0) ^ s1 ^ s2 ^ AES::mul_bytes(0x02, s3);
                 }
             }
 
-            void AddRoundKey(uint8_t **state, const uint8_t *key) const {
-                for (int i = 0; i < 4; i++) {
-                    for (int j = 0; j < Nb; j++) {
-                        state[i][j] = state[i][j] ^ key[i + 4 * j];
-                    }
+            static inline void AddRoundKey(uint8_t *state, const uint8_t *key) {
+                for (size_t i = 0; i < BLOCK_BYTES; i++) {
+                    state[i] ^= key[i];
                 }
             }
 
             inline void SubWord(uint8_t *a) const {
                 for (int i = 0; i < 4; i++) {
-                    a[i] = this->sbox[a[i]];
+                    a[i] = internal::aes_sbox[a[i]];
                 }
             }
 
@@ -138,59 +323,37 @@ namespace utils::crypto {
                 a[1] = a[2] = a[3] = 0;
             }
 
-            void InvSubBytes(uint8_t **state) const {
-                for (int i = 0; i < 4; i++) {
-                    for (int j = 0; j < this->Nb; j++) {
-                        const uint8_t t = state[i][j];
-                        state[i][j] = this->inv_sbox[t];
-                    }
+            static inline void InvSubBytes(uint8_t *state) {
+                for (size_t i = 0; i < BLOCK_BYTES; i++) {
+                    state[i] = internal::aes_inv_sbox[state[i]];
                 }
             }
 
-            void InvMixColumns(uint8_t **state) const {
-                uint8_t s[4], s1[4];
-
-                for (int j = 0; j < Nb; j++) {
-                    for (int i = 0; i < 4; i++) {
-                        s[i] = state[i][j];
-                    }
-
-                    s1[0] = mul_bytes(0x0e, s[0]) ^ mul_bytes(0x0b, s[1]) ^ mul_bytes(0x0d, s[2]) ^ mul_bytes(0x09, s[3]);
-                    s1[1] = mul_bytes(0x09, s[0]) ^ mul_bytes(0x0e, s[1]) ^ mul_bytes(0x0b, s[2]) ^ mul_bytes(0x0d, s[3]);
-                    s1[2] = mul_bytes(0x0d, s[0]) ^ mul_bytes(0x09, s[1]) ^ mul_bytes(0x0e, s[2]) ^ mul_bytes(0x0b, s[3]);
-                    s1[3] = mul_bytes(0x0b, s[0]) ^ mul_bytes(0x0d, s[1]) ^ mul_bytes(0x09, s[2]) ^ mul_bytes(0x0e, s[3]);
+            static void InvMixColumns(uint8_t *state) {
+                for (size_t j = 0; j < BLOCK_BYTES; j += 4) {
+                    uint8_t *s = state + j;
+                    const uint8_t s0 = s[0], s1 = s[1], s2 = s[2], s3 = s[3];
 
-                    for (int i = 0; i < 4; i++) {
-                        state[i][j] = s1[i];
-                    }
+                    s[0] = AES::mul_bytes(0x0e, s0) ^ AES::mul_bytes(0x0b, s1) ^ AES::mul_bytes(0x0d, s2) ^ AES::mul_bytes(0x09, s3);
+                    s[1] = AES::mul_bytes(0x09, s0) ^ AES::mul_bytes(0x0e, s1) ^ AES::mul_bytes(0x0b, s2) ^ AES::mul_bytes(0x0d, s3);
+                    s[2] = AES::mul_bytes(0x0d, s0) ^ AES::mul_bytes(0x09, s1) ^ AES::mul_bytes(0x0e, s2) ^ AES::mul_bytes(0x0b, s3);
+                    s[3] = AES::mul_bytes(0x0b, s0) ^ AES::mul_bytes(0x0d, s1) ^ AES::mul_bytes(0x09, s2) ^ AES::mul_bytes(0x0e, s3);
                 }
             }
 
-            inline void InvShiftRows(uint8_t **state) const {
-                this->ShiftRow(state, 1, this->Nb - 1);
-                this->ShiftRow(state, 2, this->Nb - 2);
-                this->ShiftRow(state, 3, this->Nb - 3);
-            }
-
-            utils::memory::unique_arr_t<uint8_t> PaddingNulls(const uint8_t in[], const uint32_t inLen, const uint32_t alignLen) const {
-                auto aligned = utils::memory::new_unique_array<uint8_t>(alignLen);
-                std::copy_n(in, inLen, aligned.get());  // inlen to alignLen already 0
-                return aligned;
-            }
-
-            inline uint32_t GetPaddingLength(const uint32_t len) const {
-                uint32_t lengthWithPadding = (len / this->blockBytesLen);
-
-                if (len % blockBytesLen) {
-                    lengthWithPadding++;
-                }
+            static inline void InvShiftRows(uint8_t *state) {
+                const uint8_t s[BLOCK_BYTES] = {
+                    state[ 0], state[13], state[10], state[ 7],
+                    state[ 4], state[ 1], state[14], state[11],
+                    state[ 8], state[ 5], state[ 2], state[15],
+                    state[12], state[ 9], state[ 6], state[ 3],
+                };
 
-                return lengthWithPadding * this->blockBytesLen;
+                std::copy_n(s, BLOCK_BYTES, state);
             }
 
             void KeyExpansion(const uint8_t key[], uint8_t w[]) const {
-                auto temp = utils::memory::new_unique_array<uint8_t>(4);
-                auto rcon = utils::memory::new_unique_array<uint8_t>(4);
+                uint8_t temp[4], rcon[4];
                 int i = 0;
 
                 while (i < 4 * this->Nk) {
@@ -207,12 +370,12 @@ namespace utils::crypto {
                     temp[3] = w[i - 4 + 3];
 
                     if (((i / 4) % this->Nk) == 0) {
-                        this->RotWord(temp.get());
-                        this->SubWord(temp.get());
-                        this->Rcon(rcon.get(), i / (this->Nk * 4));
-                        this->XorWords(temp.get(), rcon.get(), temp.get());
+                        this->RotWord(temp);
+                        this->SubWord(temp);
+                        this->Rcon(rcon, i / (this->Nk * 4));
+                        this->XorWords(temp, rcon, temp);
                     } else if (Nk > 6 && ((i / 4) % this->Nk) == 4) {
-                        this->SubWord(temp.get());
+                        this->SubWord(temp);
                     }
 
                     w[i + 0] = w[i - 4 * this->Nk] ^ temp[0];
@@ -223,151 +386,921 @@ namespace utils::crypto {
                 }
             }
 
-            void EncryptBlock(const uint8_t in[], uint8_t out[], const uint8_t key[]) const {
-                auto w = utils::memory::new_unique_array<uint8_t>(size_t(4 * this->Nb * (this->Nr + 1)));
-                this->KeyExpansion(key, w.get());
+            static void EncryptBlockReference(const uint8_t in[], uint8_t out[], const Context& ctx) {
+                alignas(16) uint8_t state[BLOCK_BYTES];
+                std::copy_n(in, BLOCK_BYTES, state);
 
-                auto state = utils::memory::new_array<uint8_t>(4, size_t(this->Nb));
+                AES::AddRoundKey(state, ctx.round_keys);
 
-                for (int i = 0; i < 4; i++) {
-                    for (int j = 0; j < this->Nb; j++) {
-                        state[i][j] = in[i + 4 * j];
-                    }
+                for (int round = 1; round <= ctx.rounds - 1; round++) {
+                    AES::SubBytes(state);
+                    AES::ShiftRows(state);
+                    AES::MixColumns(state);
+                    AES::AddRoundKey(state, ctx.round_keys + round * BLOCK_BYTES);
                 }
 
-                this->AddRoundKey(state, w.get());
+                AES::SubBytes(state);
+                AES::ShiftRows(state);
+                AES::AddRoundKey(state, ctx.round_keys + ctx.rounds * BLOCK_BYTES);
+
+                std::copy_n(state, BLOCK_BYTES, out);
+            }
+
+            static void DecryptBlockReference(const uint8_t in[], uint8_t out[], const Context& ctx) {
+                alignas(16) uint8_t state[BLOCK_BYTES];
+                std::copy_n(in, BLOCK_BYTES, state);
+
+                AES::AddRoundKey(state, ctx.round_keys + ctx.rounds * BLOCK_BYTES);
 
-                for (int round = 1; round <= this->Nr - 1; round++) {
-                    this->SubBytes(state);
-                    this->ShiftRows(state);
-                    this->MixColumns(state);
-                    this->AddRoundKey(state, w.get() + round * 4 * this->Nb);
+                for (int round = ctx.rounds - 1; round >= 1; round--) {
+                    AES::InvSubBytes(state);
+                    AES::InvShiftRows(state);
+                    AES::AddRoundKey(state, ctx.round_keys + round * BLOCK_BYTES);
+                    AES::InvMixColumns(state);
                 }
 
-                this->SubBytes(state);
-                this->ShiftRows(state);
-                this->AddRoundKey(state, w.get() + this->Nr * 4 * this->Nb);
+                AES::InvSubBytes(state);
+                AES::InvShiftRows(state);
+                AES::AddRoundKey(state, ctx.round_keys);
 
-                for (int i = 0; i < 4; i++) {
-                    for (int j = 0; j < this->Nb; j++) {
-                        out[i + 4 * j] = state[i][j];
-                    }
+                std::copy_n(state, BLOCK_BYTES, out);
+            }
+
+            static inline uint32_t LoadWord(const uint8_t *p) {
+                return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]);
+            }
+
+            static inline void StoreWord(uint32_t w, uint8_t *p) {
+                p[0] = uint8_t(w >> 24);
+                p[1] = uint8_t(w >> 16);
+                p[2] = uint8_t(w >>  8);
+                p[3] = uint8_t(w);
+            }
+
+            /*
+             *  Every column is a big-endian word, so row r of a column is byte 3 - r.
+             *  One round is 16 table lookups: the row shift is in which word a byte is
+             *  taken from, the MixColumns row in which table it is looked up in.
+             */
+
+            static void EncryptBlockTTable(const uint8_t in[], uint8_t out[], const Context& ctx) {
+                const auto& te = internal::aes_tables.enc;
+                const uint8_t *rk = ctx.round_keys;
+
+                uint32_t s0 = AES::LoadWord(in     ) ^ AES::LoadWord(rk     );
+                uint32_t s1 = AES::LoadWord(in +  4) ^ AES::LoadWord(rk +  4);
+                uint32_t s2 = AES::LoadWord(in +  8) ^ AES::LoadWord(rk +  8);
+                uint32_t s3 = AES::LoadWord(in + 12) ^ AES::LoadWord(rk + 12);
+
+                for (int round = 1; round < ctx.rounds; round++) {
+                    rk += BLOCK_BYTES;
+
+                    const uint32_t t0 = te[0][s0 >> 24] ^ te[1][(s1 >> 16) & 0xFF] ^ te[2][(s2 >> 8) & 0xFF] ^ te[3][s3 & 0xFF] ^ AES::LoadWord(rk     );
+                    const uint32_t t1 = te[0][s1 >> 24] ^ te[1][(s2 >> 16) & 0xFF] ^ te[2][(s3 >> 8) & 0xFF] ^ te[3][s0 & 0xFF] ^ AES::LoadWord(rk +  4);
+                    const uint32_t t2 = te[0][s2 >> 24] ^ te[1][(s3 >> 16) & 0xFF] ^ te[2][(s0 >> 8) & 0xFF] ^ te[3][s1 & 0xFF] ^ AES::LoadWord(rk +  8);
+                    const uint32_t t3 = te[0][s3 >> 24] ^ te[1][(s0 >> 16) & 0xFF] ^ te[2][(s1 >> 8) & 0xFF] ^ te[3][s2 & 0xFF] ^ AES::LoadWord(rk + 12);
+
+                    s0 = t0; s1 = t1; s2 = t2; s3 = t3;
                 }
 
-                utils::memory::delete_array(state, 4);
+                // Last round has no MixColumns
+                const auto& sb = internal::aes_sbox;
+                rk += BLOCK_BYTES;
+
+                AES::StoreWord((uint32_t(sb[s0 >> 24]) << 24 | uint32_t(sb[(s1 >> 16) & 0xFF]) << 16
+                              | uint32_t(sb[(s2 >> 8) & 0xFF]) << 8 | uint32_t(sb[s3 & 0xFF])) ^ AES::LoadWord(rk     ), out     );
+                AES::StoreWord((uint32_t(sb[s1 >> 24]) << 24 | uint32_t(sb[(s2 >> 16) & 0xFF]) << 16
+                              | uint32_t(sb[(s3 >> 8) & 0xFF]) << 8 | uint32_t(sb[s0 & 0xFF])) ^ AES::LoadWord(rk +  4), out +  4);
+                AES::StoreWord((uint32_t(sb[s2 >> 24]) << 24 | uint32_t(sb[(s3 >> 16) & 0xFF]) << 16
+                              | uint32_t(sb[(s0 >> 8) & 0xFF]) << 8 | uint32_t(sb[s1 & 0xFF])) ^ AES::LoadWord(rk +  8), out +  8);
+                AES::StoreWord((uint32_t(sb[s3 >> 24]) << 24 | uint32_t(sb[(s0 >> 16) & 0xFF]) << 16
+                              | uint32_t(sb[(s1 >> 8) & 0xFF]) << 8 | uint32_t(sb[s2 & 0xFF])) ^ AES::LoadWord(rk + 12), out + 12);
             }
 
-            void DecryptBlock(const uint8_t in[], uint8_t out[], const uint8_t key[]) const {
-                auto w = utils::memory::new_unique_array<uint8_t>(size_t(4 * this->Nb * (this->Nr + 1)));
-                this->KeyExpansion(key, w.get());
+            static void DecryptBlockTTable(const uint8_t in[], uint8_t out[], const Context& ctx) {
+                const auto& td = internal::aes_tables.dec;
+                const uint8_t *rk = ctx.inv_round_keys + ctx.rounds * BLOCK_BYTES;
 
-                auto state = utils::memory::new_array<uint8_t>(4, size_t(this->Nb));
+                uint32_t s0 = AES::LoadWord(in     ) ^ AES::LoadWord(rk     );
+                uint32_t s1 = AES::LoadWord(in +  4) ^ AES::LoadWord(rk +  4);
+                uint32_t s2 = AES::LoadWord(in +  8) ^ AES::LoadWord(rk +  8);
+                uint32_t s3 = AES::LoadWord(in + 12) ^ AES::LoadWord(rk + 12);
 
-                for (int i = 0; i < 4; i++) {
-                    for (int j = 0; j < this->Nb; j++) {
-                        state[i][j] = in[i + 4 * j];
+                for (int round = ctx.rounds - 1; round >= 1; round--) {
+                    rk -= BLOCK_BYTES;
+
+                    const uint32_t t0 = td[0][s0 >> 24] ^ td[1][(s3 >> 16) & 0xFF] ^ td[2][(s2 >> 8) & 0xFF] ^ td[3][s1 & 0xFF] ^ AES::LoadWord(rk     );
+                    const uint32_t t1 = td[0][s1 >> 24] ^ td[1][(s0 >> 16) & 0xFF] ^ td[2][(s3 >> 8) & 0xFF] ^ td[3][s2 & 0xFF] ^ AES::LoadWord(rk +  4);
+                    const uint32_t t2 = td[0][s2 >> 24] ^ td[1][(s1 >> 16) & 0xFF] ^ td[2][(s0 >> 8) & 0xFF] ^ td[3][s3 & 0xFF] ^ AES::LoadWord(rk +  8);
+                    const uint32_t t3 = td[0][s3 >> 24] ^ td[1][(s2 >> 16) & 0xFF] ^ td[2][(s1 >> 8) & 0xFF] ^ td[3][s0 & 0xFF] ^ AES::LoadWord(rk + 12);
+
+                    s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+                }
+
+                // Last round has no InvMixColumns
+                const auto& sb = internal::aes_inv_sbox;
+                rk -= BLOCK_BYTES;
+
+                AES::StoreWord((uint32_t(sb[s0 >> 24]) << 24 | uint32_t(sb[(s3 >> 16) & 0xFF]) << 16
+                              | uint32_t(sb[(s2 >> 8) & 0xFF]) << 8 | uint32_t(sb[s1 & 0xFF])) ^ AES::LoadWord(rk     ), out     );
+                AES::StoreWord((uint32_t(sb[s1 >> 24]) << 24 | uint32_t(sb[(s0 >> 16) & 0xFF]) << 16
+                              | uint32_t(sb[(s3 >> 8) & 0xFF]) << 8 | uint32_t(sb[s2 & 0xFF])) ^ AES::LoadWord(rk +  4), out +  4);
+                AES::StoreWord((uint32_t(sb[s2 >> 24]) << 24 | uint32_t(sb[(s1 >> 16) & 0xFF]) << 16
+                              | uint32_t(sb[(s0 >> 8) & 0xFF]) << 8 | uint32_t(sb[s3 & 0xFF])) ^ AES::LoadWord(rk +  8), out +  8);
+                AES::StoreWord((uint32_t(sb[s3 >> 24]) << 24 | uint32_t(sb[(s2 >> 16) & 0xFF]) << 16
+                              | uint32_t(sb[(s1 >> 8) & 0xFF]) << 8 | uint32_t(sb[s0 & 0xFF])) ^ AES::LoadWord(rk + 12), out + 12);
+            }
+
+#ifdef UTILS_CRYPTO_AES_NI
+            static UTILS_CRYPTO_AES_NI_TARGET void EncryptBlockNI(const uint8_t in[], uint8_t out[], const Context& ctx) {
+                const __m128i *rk = reinterpret_cast<const __m128i*>(ctx.round_keys);
+                __m128i state = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), _mm_load_si128(rk));
+
+                for (int round = 1; round < ctx.rounds; round++) {
+                    state = _mm_aesenc_si128(state, _mm_load_si128(rk + round));
+                }
+
+                state = _mm_aesenclast_si128(state, _mm_load_si128(rk + ctx.rounds));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), state);
+            }
+
+            static UTILS_CRYPTO_AES_NI_TARGET void DecryptBlockNI(const uint8_t in[], uint8_t out[], const Context& ctx) {
+                const __m128i *rk = reinterpret_cast<const __m128i*>(ctx.inv_round_keys);
+                __m128i state = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), _mm_load_si128(rk + ctx.rounds));
+
+                for (int round = ctx.rounds - 1; round >= 1; round--) {
+                    state = _mm_aesdec_si128(state, _mm_load_si128(rk + round));
+                }
+
+                state = _mm_aesdeclast_si128(state, _mm_load_si128(rk));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), state);
+            }
+
+            /**
+             *  @brief  The feature flags in ECX of CPUID leaf 1, read once.
+             */
+            static uint32_t CpuFeatures(void) {
+                static const uint32_t features = [] {
+                    #ifdef UTILS_COMPILER_MSVC
+                        int info[4];
+                        __cpuid(info, 1);
+                        return uint32_t(info[2]);
+                    #else
+                        unsigned int a, b, c, d;
+                        return __get_cpuid(1, &a, &b, &c, &d) ? uint32_t(c) : 0u;
+                    #endif
+                }();
+
+                return features;
+            }
+
+            static inline bool HasAESNI(void) {
+                return (AES::CpuFeatures() & (1u << 25)) != 0;
+            }
+
+            static inline bool HasCLMUL(void) {
+                constexpr uint32_t pclmul = 1u << 1, ssse3 = 1u << 9;
+                return (AES::CpuFeatures() & (pclmul | ssse3)) == (pclmul | ssse3);
+            }
+#endif
+
+            static inline void EncryptBlock(const uint8_t in[], uint8_t out[], const Context& ctx) {
+                switch (ctx.engine) {
+#ifdef UTILS_CRYPTO_AES_NI
+                    case Engine::AESNI:
+                        AES::EncryptBlockNI(in, out, ctx);
+                        break;
+#endif
+                    case Engine::TTable:
+                        AES::EncryptBlockTTable(in, out, ctx);
+                        break;
+                    default:
+                        AES::EncryptBlockReference(in, out, ctx);
+                        break;
+                }
+            }
+
+            static inline void DecryptBlock(const uint8_t in[], uint8_t out[], const Context& ctx) {
+                switch (ctx.engine) {
+#ifdef UTILS_CRYPTO_AES_NI
+                    case Engine::AESNI:
+                        AES::DecryptBlockNI(in, out, ctx);
+                        break;
+#endif
+                    case Engine::TTable:
+                        AES::DecryptBlockTTable(in, out, ctx);
+                        break;
+                    default:
+                        AES::DecryptBlockReference(in, out, ctx);
+                        break;
+                }
+            }
+
+#ifdef UTILS_CRYPTO_AES_NI
+            /*
+             *  PIPELINE_BLOCKS independent blocks go through each round together,
+             *  so the latency of one aesenc is hidden behind the others.
+             */
+
+            static UTILS_CRYPTO_AES_NI_TARGET void EncryptBlocksNI(const uint8_t *in, uint8_t *out, size_t blocks, const Context& ctx) {
+                const __m128i *rk = reinterpret_cast<const __m128i*>(ctx.round_keys);
+                const __m128i *src = reinterpret_cast<const __m128i*>(in);
+                __m128i *dst = reinterpret_cast<__m128i*>(out);
+
+                for (; blocks >= PIPELINE_BLOCKS; blocks -= PIPELINE_BLOCKS, src += PIPELINE_BLOCKS, dst += PIPELINE_BLOCKS) {
+                    __m128i key = _mm_load_si128(rk);
+                    __m128i s0 = _mm_xor_si128(_mm_loadu_si128(src + 0), key);
+                    __m128i s1 = _mm_xor_si128(_mm_loadu_si128(src + 1), key);
+                    __m128i s2 = _mm_xor_si128(_mm_loadu_si128(src + 2), key);
+                    __m128i s3 = _mm_xor_si128(_mm_loadu_si128(src + 3), key);
+                    __m128i s4 = _mm_xor_si128(_mm_loadu_si128(src + 4), key);
+                    __m128i s5 = _mm_xor_si128(_mm_loadu_si128(src + 5), key);
+                    __m128i s6 = _mm_xor_si128(_mm_loadu_si128(src + 6), key);
+                    __m128i s7 = _mm_xor_si128(_mm_loadu_si128(src + 7), key);
+
+                    for (int round = 1; round < ctx.rounds; round++) {
+                        key = _mm_load_si128(rk + round);
+                        s0 = _mm_aesenc_si128(s0, key);
+                        s1 = _mm_aesenc_si128(s1, key);
+                        s2 = _mm_aesenc_si128(s2, key);
+                        s3 = _mm_aesenc_si128(s3, key);
+                        s4 = _mm_aesenc_si128(s4, key);
+                        s5 = _mm_aesenc_si128(s5, key);
+                        s6 = _mm_aesenc_si128(s6, key);
+                        s7 = _mm_aesenc_si128(s7, key);
+                    }
+
+                    key = _mm_load_si128(rk + ctx.rounds);
+                    _mm_storeu_si128(dst + 0, _mm_aesenclast_si128(s0, key));
+                    _mm_storeu_si128(dst + 1, _mm_aesenclast_si128(s1, key));
+                    _mm_storeu_si128(dst + 2, _mm_aesenclast_si128(s2, key));
+                    _mm_storeu_si128(dst + 3, _mm_aesenclast_si128(s3, key));
+                    _mm_storeu_si128(dst + 4, _mm_aesenclast_si128(s4, key));
+                    _mm_storeu_si128(dst + 5, _mm_aesenclast_si128(s5, key));
+                    _mm_storeu_si128(dst + 6, _mm_aesenclast_si128(s6, key));
+                    _mm_storeu_si128(dst + 7, _mm_aesenclast_si128(s7, key));
+                }
+
+                for (; blocks > 0; blocks--, src++, dst++) {
+                    AES::EncryptBlockNI(reinterpret_cast<const uint8_t*>(src), reinterpret_cast<uint8_t*>(dst), ctx);
+                }
+            }
+
+            static UTILS_CRYPTO_AES_NI_TARGET void DecryptBlocksNI(const uint8_t *in, uint8_t *out, size_t blocks, const Context& ctx) {
+                const __m128i *rk = reinterpret_cast<const __m128i*>(ctx.inv_round_keys);
+                const __m128i *src = reinterpret_cast<const __m128i*>(in);
+                __m128i *dst = reinterpret_cast<__m128i*>(out);
+
+                for (; blocks >= PIPELINE_BLOCKS; blocks -= PIPELINE_BLOCKS, src += PIPELINE_BLOCKS, dst += PIPELINE_BLOCKS) {
+                    __m128i key = _mm_load_si128(rk + ctx.rounds);
+                    __m128i s0 = _mm_xor_si128(_mm_loadu_si128(src + 0), key);
+                    __m128i s1 = _mm_xor_si128(_mm_loadu_si128(src + 1), key);
+                    __m128i s2 = _mm_xor_si128(_mm_loadu_si128(src + 2), key);
+                    __m128i s3 = _mm_xor_si128(_mm_loadu_si128(src + 3), key);
+                    __m128i s4 = _mm_xor_si128(_mm_loadu_si128(src + 4), key);
+                    __m128i s5 = _mm_xor_si128(_mm_loadu_si128(src + 5), key);
+                    __m128i s6 = _mm_xor_si128(_mm_loadu_si128(src + 6), key);
+                    __m128i s7 = _mm_xor_si128(_mm_loadu_si128(src + 7), key);
+
+                    for (int round = ctx.rounds - 1; round >= 1; round--) {
+                        key = _mm_load_si128(rk + round);
+                        s0 = _mm_aesdec_si128(s0, key);
+                        s1 = _mm_aesdec_si128(s1, key);
+                        s2 = _mm_aesdec_si128(s2, key);
+                        s3 = _mm_aesdec_si128(s3, key);
+                        s4 = _mm_aesdec_si128(s4, key);
+                        s5 = _mm_aesdec_si128(s5, key);
+                        s6 = _mm_aesdec_si128(s6, key);
+                        s7 = _mm_aesdec_si128(s7, key);
                     }
+
+                    key = _mm_load_si128(rk);
+                    _mm_storeu_si128(dst + 0, _mm_aesdeclast_si128(s0, key));
+                    _mm_storeu_si128(dst + 1, _mm_aesdeclast_si128(s1, key));
+                    _mm_storeu_si128(dst + 2, _mm_aesdeclast_si128(s2, key));
+                    _mm_storeu_si128(dst + 3, _mm_aesdeclast_si128(s3, key));
+                    _mm_storeu_si128(dst + 4, _mm_aesdeclast_si128(s4, key));
+                    _mm_storeu_si128(dst + 5, _mm_aesdeclast_si128(s5, key));
+                    _mm_storeu_si128(dst + 6, _mm_aesdeclast_si128(s6, key));
+                    _mm_storeu_si128(dst + 7, _mm_aesdeclast_si128(s7, key));
                 }
 
-                this->AddRoundKey(state, w.get() + this->Nr * 4 * this->Nb);
+                for (; blocks > 0; blocks--, src++, dst++) {
+                    AES::DecryptBlockNI(reinterpret_cast<const uint8_t*>(src), reinterpret_cast<uint8_t*>(dst), ctx);
+                }
+            }
+#endif
+
+            /**
+             *  @brief  Encrypt \p blocks consecutive blocks, checking the engine once.
+             *          \p in and \p out may be the same buffer.
+             */
+            static void EncryptBlocks(const uint8_t *in, uint8_t *out, size_t blocks, const Context& ctx) {
+                switch (ctx.engine) {
+#ifdef UTILS_CRYPTO_AES_NI
+                    case Engine::AESNI:
+                        AES::EncryptBlocksNI(in, out, blocks, ctx);
+                        break;
+#endif
+                    case Engine::TTable:
+                        for (size_t i = 0; i < blocks * BLOCK_BYTES; i += BLOCK_BYTES) {
+                            AES::EncryptBlockTTable(in + i, out + i, ctx);
+                        }
+                        break;
+                    default:
+                        for (size_t i = 0; i < blocks * BLOCK_BYTES; i += BLOCK_BYTES) {
+                            AES::EncryptBlockReference(in + i, out + i, ctx);
+                        }
+                        break;
+                }
+            }
 
-                for (int round = Nr - 1; round >= 1; round--) {
-                    this->InvSubBytes(state);
-                    this->InvShiftRows(state);
-                    this->AddRoundKey(state, w.get() + round * 4 * this->Nb);
-                    this->InvMixColumns(state);
+            /**
+             *  @brief  Decrypt \p blocks consecutive blocks, checking the engine once.
+             *          \p in and \p out may be the same buffer.
+             */
+            static void DecryptBlocks(const uint8_t *in, uint8_t *out, size_t blocks, const Context& ctx) {
+                switch (ctx.engine) {
+#ifdef UTILS_CRYPTO_AES_NI
+                    case Engine::AESNI:
+                        AES::DecryptBlocksNI(in, out, blocks, ctx);
+                        break;
+#endif
+                    case Engine::TTable:
+                        for (size_t i = 0; i < blocks * BLOCK_BYTES; i += BLOCK_BYTES) {
+                            AES::DecryptBlockTTable(in + i, out + i, ctx);
+                        }
+                        break;
+                    default:
+                        for (size_t i = 0; i < blocks * BLOCK_BYTES; i += BLOCK_BYTES) {
+                            AES::DecryptBlockReference(in + i, out + i, ctx);
+                        }
+                        break;
                 }
+            }
 
-                this->InvSubBytes(state);
-                this->InvShiftRows(state);
-                this->AddRoundKey(state, w.get());
+            /**
+             *  @brief  Add \p n to the big-endian counter in \p block.
+             *          With \p inc32, only the last 4 bytes count and wrap (as in GCM),
+             *          else the whole block does (as in SP 800-38A CTR).
+             */
+            static inline void AddCounter(uint8_t *block, uint64_t n, const bool inc32) {
+                const size_t first = inc32 ? BLOCK_BYTES - 4 : 0;
+
+                for (size_t i = BLOCK_BYTES; i-- > first && n != 0; ) {
+                    n += block[i];
+                    block[i] = uint8_t(n);
+                    n >>= 8;
+                }
+            }
 
-                for (int i = 0; i < 4; i++) {
-                    for (int j = 0; j < this->Nb; j++) {
-                        out[i + 4 * j] = state[i][j];
+            /**
+             *  @brief  XOR \p length bytes of \p in with the key stream starting at
+             *          \p counter, PIPELINE_BLOCKS counter blocks at a time.
+             */
+            static void CounterXor(const uint8_t *in, uint8_t *out, size_t length, const Context& ctx,
+                                   const uint8_t counter[], const bool inc32)
+            {
+                alignas(16) uint8_t ctr[BLOCK_BYTES];
+                alignas(16) uint8_t stream[PIPELINE_BLOCKS * BLOCK_BYTES];
+                std::copy_n(counter, BLOCK_BYTES, ctr);
+
+                while (length > 0) {
+                    const size_t blocks = std::min(PIPELINE_BLOCKS, (length + BLOCK_BYTES - 1) / BLOCK_BYTES);
+                    const size_t bytes  = std::min(length, blocks * BLOCK_BYTES);
+
+                    for (size_t b = 0; b < blocks; b++) {
+                        std::copy_n(ctr, BLOCK_BYTES, stream + b * BLOCK_BYTES);
+
+                        if (HEDLEY_LIKELY(ctr[BLOCK_BYTES - 1] != 0xFF)) {
+                            ctr[BLOCK_BYTES - 1]++;
+                        } else {
+                            AES::AddCounter(ctr, 1, inc32);
+                        }
                     }
+
+                    AES::EncryptBlocks(stream, stream, blocks, ctx);
+                    AES::XorBlocks(in, stream, out, bytes);
+
+                    in     += bytes;
+                    out    += bytes;
+                    length -= bytes;
+                }
+            }
+
+            /**
+             *  @brief  Split \p length bytes in chunks of whole blocks for \p pool,
+             *          or in a single chunk without a pool.
+             */
+            static inline utils::algorithm::parallel::internal::Partition Split(const size_t length, utils::threading::ThreadPool *pool) {
+                if (pool == nullptr) {
+                    return { 1, length, length };
                 }
 
-                utils::memory::delete_array(state, 4);
+                // Chunks are rounded to cache lines, so they hold whole blocks.
+                return utils::algorithm::parallel::internal::partition<uint8_t>(length, pool->size());
             }
 
-            inline void XorBlocks(const uint8_t *a, const uint8_t *b, uint8_t *c, const uint32_t len) const {
-                std::transform(a, a + len, b, c,
-                [](const uint8_t va, const uint8_t vb) {
-                    return va ^ vb;
-                });
+            /**
+             *  @brief  Call \p fn(i) for every chunk in \p part, on \p pool if there are several.
+             */
+            template<typename F>
+            static void ForEachChunk(const utils::algorithm::parallel::internal::Partition& part,
+                                     utils::threading::ThreadPool *pool, F&& fn)
+            {
+                if (pool == nullptr || part.chunks <= 1) {
+                    for (size_t i = 0; i < part.chunks; i++) {
+                        fn(i);
+                    }
+                } else {
+                    utils::algorithm::parallel::internal::run_chunks(*pool, part.chunks, fn);
+                }
             }
 
-            static inline constexpr uint8_t sbox[256] = {
-                0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
-                0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
-                0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
-                0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
-                0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
-                0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
-                0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
-                0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
-                0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
-                0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
-                0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
-                0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
-                0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
-                0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
-                0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
-                0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
-                0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
-                0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
-                0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
-                0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
-                0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
-                0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
-                0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
-                0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
-                0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
-                0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
-                0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
-                0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
-                0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
-                0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
-                0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
-                0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+            /**
+             *  @brief  An element of GF(2^128) in GCM bit order: the first bit of the
+             *          block is the most significant bit of hi.
+             */
+            struct Gf128 {
+                uint64_t hi = 0;
+                uint64_t lo = 0;
             };
 
-            static inline constexpr uint8_t inv_sbox[256] = {
-                0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38,
-                0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
-                0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87,
-                0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
-                0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d,
-                0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
-                0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2,
-                0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
-                0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16,
-                0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
-                0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda,
-                0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
-                0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a,
-                0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
-                0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02,
-                0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
-                0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea,
-                0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
-                0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85,
-                0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
-                0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89,
-                0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
-                0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20,
-                0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
-                0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31,
-                0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
-                0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d,
-                0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
-                0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0,
-                0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
-                0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26,
-                0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d,
+            static inline uint64_t LoadWord64(const uint8_t *p) {
+                return uint64_t(AES::LoadWord(p)) << 32 | AES::LoadWord(p + 4);
+            }
+
+            static inline void StoreWord64(uint64_t w, uint8_t *p) {
+                AES::StoreWord(uint32_t(w >> 32), p);
+                AES::StoreWord(uint32_t(w), p + 4);
+            }
+
+            /**
+             *  @brief  Multiply \p x and \p y bit by bit (SP 800-38D algorithm 1).
+             *          Only used for a few powers of H per call.
+             */
+            static Gf128 GfMul(const Gf128& x, const Gf128& y) {
+                Gf128 z, v = y;
+
+                for (size_t i = 0; i < 128; i++) {
+                    const uint64_t bit = i < 64 ? (x.hi >> (63 - i)) & 1u : (x.lo >> (127 - i)) & 1u;
+
+                    if (bit) {
+                        z.hi ^= v.hi;
+                        z.lo ^= v.lo;
+                    }
+
+                    const bool carry = v.lo & 1u;
+                    v.lo = (v.hi << 63) | (v.lo >> 1);
+                    v.hi = (v.hi >> 1) ^ (carry ? 0xE100000000000000ull : 0u);
+                }
+
+                return z;
+            }
+
+            static Gf128 GfPow(const Gf128& x, uint64_t n) {
+                Gf128 result{ 0x8000000000000000ull, 0u }, base = x;  // 1 in GCM bit order
+
+                for (; n != 0; n >>= 1) {
+                    if (n & 1u) result = AES::GfMul(result, base);
+                    base = AES::GfMul(base, base);
+                }
+
+                return result;
+            }
+
+#ifdef UTILS_CRYPTO_AES_NI
+            /**
+             *  @brief  y = (y + X_i) * H for every block X_i, with carry-less
+             *          multiplication (Intel's GCM white paper, algorithm 5).
+             *          Blocks are byte-reversed, so the 128-bit value is (hi, lo).
+             */
+            static UTILS_CRYPTO_CLMUL_TARGET void GHashCLMUL(const Gf128& h, Gf128& y, const uint8_t *data, size_t blocks) {
+                const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+                const __m128i hv = _mm_set_epi64x(int64_t(h.hi), int64_t(h.lo));
+                __m128i acc = _mm_set_epi64x(int64_t(y.hi), int64_t(y.lo));
+
+                for (; blocks > 0; blocks--, data += BLOCK_BYTES) {
+                    const __m128i a = _mm_xor_si128(acc, _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), reverse));
+
+                    // 256-bit product
+                    __m128i lo  = _mm_clmulepi64_si128(a, hv, 0x00);
+                    __m128i mid = _mm_xor_si128(_mm_clmulepi64_si128(a, hv, 0x10), _mm_clmulepi64_si128(a, hv, 0x01));
+                    __m128i hi  = _mm_clmulepi64_si128(a, hv, 0x11);
+                    lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+                    hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+                    // Shift left by one, the bits are reflected
+                    __m128i carry_lo = _mm_srli_epi32(lo, 31);
+                    __m128i carry_hi = _mm_srli_epi32(hi, 31);
+                    lo = _mm_slli_epi32(lo, 1);
+                    hi = _mm_slli_epi32(hi, 1);
+                    const __m128i carry_mid = _mm_srli_si128(carry_lo, 12);
+                    carry_hi = _mm_slli_si128(carry_hi, 4);
+                    carry_lo = _mm_slli_si128(carry_lo, 4);
+                    lo = _mm_or_si128(lo, carry_lo);
+                    hi = _mm_or_si128(_mm_or_si128(hi, carry_hi), carry_mid);
+
+                    // Reduce modulo x^128 + x^7 + x^2 + x + 1
+                    __m128i t = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30)), _mm_slli_epi32(lo, 25));
+                    const __m128i t_hi = _mm_srli_si128(t, 4);
+                    t  = _mm_slli_si128(t, 12);
+                    lo = _mm_xor_si128(lo, t);
+
+                    __m128i r = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo, 1), _mm_srli_epi32(lo, 2)), _mm_srli_epi32(lo, 7));
+                    r   = _mm_xor_si128(_mm_xor_si128(r, t_hi), lo);
+                    acc = _mm_xor_si128(hi, r);
+                }
+
+                alignas(16) uint64_t out[2];
+                _mm_store_si128(reinterpret_cast<__m128i*>(out), acc);
+                y = { out[1], out[0] };
+            }
+#endif
+
+            /**
+             *  @brief  GHASH with Shoup's 4-bit tables: multiples of H for every
+             *          nibble, so a block costs 32 lookups instead of 128 bit steps.
+             */
+            class GHash {
+                private:
+                    uint64_t hh[16], hl[16];
+                    bool clmul;
+
+                public:
+                    Gf128 h;
+
+                    explicit GHash(const uint8_t key[], const bool use_clmul = false) : hh{}, hl{}, clmul(use_clmul) {
+                        this->h = { AES::LoadWord64(key), AES::LoadWord64(key + 8) };
+
+                        uint64_t vh = this->h.hi, vl = this->h.lo;
+                        this->hh[8] = vh;
+                        this->hl[8] = vl;
+
+                        for (size_t i = 4; i > 0; i >>= 1) {
+                            const bool carry = vl & 1u;
+                            vl = (vh << 63) | (vl >> 1);
+                            vh = (vh >> 1) ^ (carry ? 0xE100000000000000ull : 0u);
+                            this->hh[i] = vh;
+                            this->hl[i] = vl;
+                        }
+
+                        for (size_t i = 2; i <= 8; i *= 2) {
+                            for (size_t j = 1; j < i; j++) {
+                                this->hh[i + j] = this->hh[i] ^ this->hh[j];
+                                this->hl[i + j] = this->hl[i] ^ this->hl[j];
+                            }
+                        }
+                    }
+
+                    /**
+                     *  @brief  y = y * H
+                     */
+                    void mul_h(Gf128& y) const {
+                        static constexpr uint64_t last4[16] = {
+                            0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+                            0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0,
+                        };
+
+                        uint8_t x[BLOCK_BYTES];
+                        AES::StoreWord64(y.hi, x);
+                        AES::StoreWord64(y.lo, x + 8);
+
+                        size_t nibble = x[15] & 0x0F;
+                        uint64_t zh = this->hh[nibble], zl = this->hl[nibble];
+
+                        for (size_t i = BLOCK_BYTES; i-- > 0; ) {
+                            if (i != 15) {
+                                nibble = x[i] & 0x0F;
+                                const size_t rem = zl & 0x0F;
+                                zl = (zh << 60) | (zl >> 4);
+                                zh = (zh >> 4) ^ (last4[rem] << 48) ^ this->hh[nibble];
+                                zl ^= this->hl[nibble];
+                            }
+
+                            nibble = x[i] >> 4;
+                            const size_t rem = zl & 0x0F;
+                            zl = (zh << 60) | (zl >> 4);
+                            zh = (zh >> 4) ^ (last4[rem] << 48) ^ this->hh[nibble];
+                            zl ^= this->hl[nibble];
+                        }
+
+                        y = { zh, zl };
+                    }
+
+                    /**
+                     *  @brief  Absorb \p length bytes into \p y, padding the last block with zeros.
+                     */
+                    void update(Gf128& y, const uint8_t *data, size_t length) const {
+#ifdef UTILS_CRYPTO_AES_NI
+                        if (this->clmul) {
+                            const size_t blocks = length / BLOCK_BYTES;
+                            AES::GHashCLMUL(this->h, y, data, blocks);
+                            data   += blocks * BLOCK_BYTES;
+                            length -= blocks * BLOCK_BYTES;
+                        }
+#endif
+
+                        for (; length >= BLOCK_BYTES; data += BLOCK_BYTES, length -= BLOCK_BYTES) {
+                            y.hi ^= AES::LoadWord64(data);
+                            y.lo ^= AES::LoadWord64(data + 8);
+                            this->mul_h(y);
+                        }
+
+                        if (length > 0) {
+                            uint8_t last[BLOCK_BYTES] = { 0 };
+                            std::copy_n(data, length, last);
+                            this->update(y, last, BLOCK_BYTES);
+                        }
+                    }
             };
 
+            /**
+             *  @brief  Shared part of EncryptGCM() and DecryptGCM(): run CTR over \p in
+             *          and GHASH over the ciphertext, chunk by chunk on \p pool.
+             *          Chunk hashes are joined as y = y * H^(blocks in chunk) + chunk hash.
+             *          \p tag is set to E(J0) XOR GHASH(A, C).
+             */
+            static void RunGCM(const uint8_t *in, uint8_t *out, const size_t length, const Context& ctx,
+                               const uint8_t *iv, const size_t ivLen, const uint8_t *aad, const size_t aadLen,
+                               uint8_t tag[], const bool encrypt, utils::threading::ThreadPool *pool)
+            {
+                alignas(16) uint8_t block[BLOCK_BYTES] = { 0 };
+                AES::EncryptBlocks(block, block, 1, ctx);
+#ifdef UTILS_CRYPTO_AES_NI
+                const GHash ghash(block, ctx.engine == Engine::AESNI && AES::HasCLMUL());
+#else
+                const GHash ghash(block);
+#endif
+
+                // J0, the counter for the tag; data starts at J0 + 1
+                alignas(16) uint8_t j0[BLOCK_BYTES] = { 0 };
+
+                if (ivLen == 12) {
+                    std::copy_n(iv, ivLen, j0);
+                    j0[BLOCK_BYTES - 1] = 1;
+                } else {
+                    Gf128 y;
+                    ghash.update(y, iv, ivLen);
+                    y.lo ^= uint64_t(ivLen) * 8u;
+                    ghash.mul_h(y);
+                    AES::StoreWord64(y.hi, j0);
+                    AES::StoreWord64(y.lo, j0 + 8);
+                }
+
+                Gf128 y;
+                ghash.update(y, aad, aadLen);
+
+                const auto part = AES::Split(length, pool);
+                std::vector<Gf128> partial(part.chunks);
+
+                AES::ForEachChunk(part, pool, [&](const size_t i) {
+                    const size_t begin = part.begin(i), end = part.end(i);
+                    alignas(16) uint8_t counter[BLOCK_BYTES];
+                    std::copy_n(j0, BLOCK_BYTES, counter);
+                    AES::AddCounter(counter, 1u + begin / BLOCK_BYTES, true);
+
+                    Gf128& hash = partial[i];
+
+                    if (encrypt) {
+                        AES::CounterXor(in + begin, out + begin, end - begin, ctx, counter, true);
+                        ghash.update(hash, out + begin, end - begin);
+                    } else {
+                        ghash.update(hash, in + begin, end - begin);
+                        AES::CounterXor(in + begin, out + begin, end - begin, ctx, counter, true);
+                    }
+                });
+
+                // Every chunk but the last one has the same amount of blocks
+                const Gf128 h_chunk = AES::GfPow(ghash.h, (part.chunk_size + BLOCK_BYTES - 1) / BLOCK_BYTES);
+
+                for (size_t i = 0; i < part.chunks; i++) {
+                    if (i + 1 < part.chunks) {
+                        y = AES::GfMul(y, h_chunk);
+                    } else {
+                        const size_t last = part.end(i) - part.begin(i);
+                        y = AES::GfMul(y, AES::GfPow(ghash.h, (last + BLOCK_BYTES - 1) / BLOCK_BYTES));
+                    }
+
+                    y.hi ^= partial[i].hi;
+                    y.lo ^= partial[i].lo;
+                }
+
+                y.hi ^= uint64_t(aadLen) * 8u;
+                y.lo ^= uint64_t(length) * 8u;
+                ghash.mul_h(y);
+
+                AES::EncryptBlocks(j0, block, 1, ctx);
+                AES::StoreWord64(y.hi, tag);
+                AES::StoreWord64(y.lo, tag + 8);
+                AES::XorBlocks(tag, block, tag, BLOCK_BYTES);
+            }
+
+            static inline void XorBlocks(const uint8_t *a, const uint8_t *b, uint8_t *c, const size_t len) {
+                size_t i = 0;
+
+                // 8 bytes at a time; c may be a or b, but must not overlap them otherwise
+                for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+                    uint64_t va, vb;
+                    std::memcpy(&va, a + i, sizeof(uint64_t));
+                    std::memcpy(&vb, b + i, sizeof(uint64_t));
+                    va ^= vb;
+                    std::memcpy(c + i, &va, sizeof(uint64_t));
+                }
+
+                for (; i < len; i++) {
+                    c[i] = a[i] ^ b[i];
+                }
+            }
+
+            /**
+             *  @brief  Check that \p out holds at least \p needed bytes, and that it
+             *          is either the same buffer as \p in or does not overlap it.
+             */
+            static void CheckBuffers(const char *where, const const_bytes_t in, const bytes_t out, const size_t needed) {
+                if (HEDLEY_UNLIKELY(out.size() < needed)) {
+                    throw utils::exceptions::Exception(where, "Output buffer is too small.");
+                }
+
+                const std::less<const uint8_t*> less;
+                const uint8_t *in_begin  = in.data(),  *in_end  = in_begin  + in.size();
+                const uint8_t *out_begin = out.data(), *out_end = out_begin + out.size();
+
+                if (HEDLEY_UNLIKELY(in_begin != out_begin && !in.empty() && !out.empty()
+                                    && less(out_begin, in_end) && less(in_begin, out_end)))
+                {
+                    throw utils::exceptions::Exception(where, "Output buffer partially overlaps the input.");
+                }
+            }
+
+            static inline void CheckIV(const char *where, const const_bytes_t iv) {
+                if (HEDLEY_UNLIKELY(iv.size() != BLOCK_BYTES)) {
+                    throw utils::exceptions::Exception(where, "IV must be BLOCK_BYTES long.");
+                }
+            }
+
+            static inline void CheckGCM(const char *where, const const_bytes_t iv, const size_t tag_size) {
+                if (HEDLEY_UNLIKELY(iv.empty())) {
+                    throw utils::exceptions::Exception(where, "IV must not be empty.");
+                }
+
+                if (HEDLEY_UNLIKELY(tag_size < 4 || tag_size > BLOCK_BYTES)) {
+                    throw utils::exceptions::Exception(where, "Tag must be 4 to BLOCK_BYTES long.");
+                }
+            }
+
+            static inline void CheckWholeBlocks(const char *where, const size_t length) {
+                if (HEDLEY_UNLIKELY(length % BLOCK_BYTES != 0)) {
+                    throw utils::exceptions::Exception(where, "Input is not a whole number of blocks.");
+                }
+            }
+
+            /**
+             *  @brief  Copy the \p tail bytes after the last whole block to \p block
+             *          and fill it up with \p padding.
+             *  @return Returns false if there is no last block to add.
+             */
+            static bool PadBlock(const uint8_t *in, const size_t tail, const Padding padding, uint8_t block[]) {
+                if (tail == 0 && padding != Padding::PKCS7) {
+                    return false;
+                }
+
+                std::copy_n(in, tail, block);
+                std::fill_n(block + tail, BLOCK_BYTES - tail,
+                            padding == Padding::PKCS7 ? uint8_t(BLOCK_BYTES - tail) : uint8_t(0));
+                return true;
+            }
+
+            /**
+             *  @brief  The length of the \p length decrypted bytes at \p data
+             *          without \p padding. Throws if the PKCS#7 padding is invalid.
+             */
+            static size_t Unpad(const char *where, const uint8_t *data, const size_t length, const Padding padding) {
+                if (padding != Padding::PKCS7) {
+                    return length;
+                }
+
+                if (HEDLEY_UNLIKELY(length == 0)) {
+                    throw utils::exceptions::Exception(where, "Invalid padding.");
+                }
+
+                // Check the whole last block, so the time taken tells nothing about the padding
+                const uint8_t *last = data + length - BLOCK_BYTES;
+                const uint8_t pad   = last[BLOCK_BYTES - 1];
+                uint8_t bad = uint8_t(pad == 0 || pad > BLOCK_BYTES);
+
+                for (size_t i = 0; i < BLOCK_BYTES; i++) {
+                    const uint8_t in_pad = uint8_t(BLOCK_BYTES - i <= pad);
+                    bad |= uint8_t(in_pad & (last[i] != pad));
+                }
+
+                if (HEDLEY_UNLIKELY(bad)) {
+                    throw utils::exceptions::Exception(where, "Invalid padding.");
+                }
+
+                return length - pad;
+            }
+
+            /**
+             *  @brief  Decrypt the \p blocks CBC blocks at \p in, chained on \p prev.
+             *          \p out may be \p in, then it goes PIPELINE_BLOCKS at a time.
+             */
+            static void DecryptChainCBC(const uint8_t *in, uint8_t *out, size_t blocks,
+                                        const uint8_t prev[], const Context& ctx)
+            {
+                if (blocks == 0) return;
+
+                if (in != out) {
+                    AES::DecryptBlocks(in, out, blocks, ctx);
+                    AES::XorBlocks(out, prev, out, BLOCK_BYTES);
+                    AES::XorBlocks(out + BLOCK_BYTES, in, out + BLOCK_BYTES, (blocks - 1) * BLOCK_BYTES);
+                    return;
+                }
+
+                // chain[0] is the previous ciphertext block, followed by a copy of the batch,
+                // so decrypting in place does not overwrite what the next block needs.
+                alignas(16) uint8_t chain[(PIPELINE_BLOCKS + 1) * BLOCK_BYTES];
+                std::copy_n(prev, BLOCK_BYTES, chain);
+
+                while (blocks > 0) {
+                    const size_t n = std::min(PIPELINE_BLOCKS, blocks);
+                    const size_t bytes = n * BLOCK_BYTES;
+
+                    std::copy_n(in, bytes, chain + BLOCK_BYTES);
+                    AES::DecryptBlocks(chain + BLOCK_BYTES, out, n, ctx);
+                    AES::XorBlocks(out, chain, out, bytes);
+                    std::copy_n(chain + bytes, BLOCK_BYTES, chain);
+
+                    in     += bytes;
+                    out    += bytes;
+                    blocks -= n;
+                }
+            }
+
+            /**
+             *  @brief  Decrypt \p length CFB bytes at \p in, chained on \p prev.
+             *          Only the last block may be partial. \p out may be \p in,
+             *          then it and the partial block go PIPELINE_BLOCKS at a time.
+             */
+            static void DecryptChainCFB(const uint8_t *in, uint8_t *out, size_t length,
+                                        const uint8_t prev[], const Context& ctx)
+            {
+                if (in != out && length >= BLOCK_BYTES) {
+                    // The key stream is the encrypted previous ciphertext block
+                    const size_t blocks = length / BLOCK_BYTES, bytes = blocks * BLOCK_BYTES;
+                    AES::EncryptBlock(prev, out, ctx);
+                    AES::EncryptBlocks(in, out + BLOCK_BYTES, blocks - 1, ctx);
+                    AES::XorBlocks(in, out, out, bytes);
+
+                    prev    = in + bytes - BLOCK_BYTES;
+                    in     += bytes;
+                    out    += bytes;
+                    length -= bytes;
+                }
+
+                alignas(16) uint8_t chain[(PIPELINE_BLOCKS + 1) * BLOCK_BYTES];
+                alignas(16) uint8_t stream[PIPELINE_BLOCKS * BLOCK_BYTES];
+                std::copy_n(prev, BLOCK_BYTES, chain);
+
+                while (length > 0) {
+                    const size_t n = std::min(PIPELINE_BLOCKS, (length + BLOCK_BYTES - 1) / BLOCK_BYTES);
+                    const size_t bytes = std::min(length, n * BLOCK_BYTES);
+
+                    std::copy_n(in, bytes, chain + BLOCK_BYTES);
+                    AES::EncryptBlocks(chain, stream, n, ctx);
+                    AES::XorBlocks(chain + BLOCK_BYTES, stream, out, bytes);
+                    std::copy_n(chain + n * BLOCK_BYTES, BLOCK_BYTES, chain);
+
+                    in     += bytes;
+                    out    += bytes;
+                    length -= bytes;
+                }
+            }
+
+            /**
+             *  @brief  Decrypt \p in with \p chain_fn per chunk on \p pool, after taking
+             *          the ciphertext block before every chunk, so \p out may be \p in.
+             */
+            template<typename F>
+            static void DecryptChained(const const_bytes_t in, const bytes_t out, const const_bytes_t iv,
+                                       utils::threading::ThreadPool *pool, F&& chain_fn)
+            {
+                const auto part = AES::Split(in.size(), pool);
+                std::vector<uint8_t> prev(part.chunks * BLOCK_BYTES);
+
+                for (size_t i = 0; i < part.chunks; i++) {
+                    const size_t begin = part.begin(i);
+                    std::copy_n(begin ? in.data() + begin - BLOCK_BYTES : iv.data(), BLOCK_BYTES,
+                                prev.data() + i * BLOCK_BYTES);
+                }
+
+                AES::ForEachChunk(part, pool, [&](const size_t i) {
+                    const size_t begin = part.begin(i);
+                    chain_fn(in.data() + begin, out.data() + begin, part.end(i) - begin,
+                             prev.data() + i * BLOCK_BYTES);
+                });
+            }
+
         public:
             AES(int keyLen = 256) {
                 this->Nb = 4;
@@ -391,93 +1324,851 @@ namespace utils::crypto {
                     default:
                         throw "Incorrect key length";
                 }
+            }
 
-                this->blockBytesLen = uint32_t(4 * this->Nb * int32_t(sizeof(uint8_t)));
+            /**
+             *  @brief  Expand \p key into a key schedule for this key length.
+             *          Pass it instead of the key to encrypt or decrypt many
+             *          buffers without expanding the key again.
+             *
+             *  @param  key
+             *      The key, keyLen / 8 bytes long.
+             *  @param  engine
+             *      The engine to use with this schedule, the fastest one by default.
+             *  @return Returns the expanded key schedule.
+             *          Throws if \p engine is not supported on this CPU.
+             */
+            Context MakeContext(const uint8_t key[], Engine engine = AES::BestEngine()) const {
+                if (HEDLEY_UNLIKELY(!AES::IsSupported(engine))) {
+                    throw utils::exceptions::Exception("AES::MakeContext", "Engine is not supported on this CPU.");
+                }
+
+                Context ctx;
+                ctx.rounds = this->Nr;
+                ctx.engine = engine;
+                this->KeyExpansion(key, ctx.round_keys);
+
+                // Equivalent inverse cipher: InvMixColumns moved into the middle round keys
+                std::copy_n(ctx.round_keys, BLOCK_BYTES * size_t(ctx.rounds + 1), ctx.inv_round_keys);
+
+                for (int round = 1; round < ctx.rounds; round++) {
+                    AES::InvMixColumns(ctx.inv_round_keys + round * BLOCK_BYTES);
+                }
+
+                return ctx;
             }
 
-            auto EncryptECB(const uint8_t in[], const uint32_t inLen, const uint8_t key[], uint32_t& outLen) const {
-                outLen = this->GetPaddingLength(inLen);
-                auto alignIn = PaddingNulls(in, inLen, outLen);
-                auto out     = utils::memory::new_unique_array<uint8_t>(outLen);
+            /**
+             *  @brief  Expand \p key into a key schedule, checking its length.
+             *          Throws if \p key is not keyLen / 8 bytes long.
+             */
+            Context MakeContext(const const_bytes_t key, Engine engine = AES::BestEngine()) const {
+                if (HEDLEY_UNLIKELY(key.size() != size_t(4 * this->Nk))) {
+                    throw utils::exceptions::Exception("AES::MakeContext", "Key length does not match the key size.");
+                }
+
+                return this->MakeContext(key.data(), engine);
+            }
 
-                for (uint32_t i = 0; i < outLen; i += this->blockBytesLen) {
-                    this->EncryptBlock(alignIn.get() + i, out.get() + i, key);
+            /**
+             *  @brief  The length of \p length bytes after adding \p padding.
+             */
+            static constexpr size_t PaddedSize(const size_t length, const Padding padding) {
+                switch (padding) {
+                    case Padding::Zeros:
+                        return (length + BLOCK_BYTES - 1) / BLOCK_BYTES * BLOCK_BYTES;
+                    case Padding::PKCS7:
+                        return (length / BLOCK_BYTES + 1) * BLOCK_BYTES;
+                    case Padding::None:
+                        break;
                 }
 
+                return length;
+            }
+
+            /**
+             *  @brief  Check whether \p engine can run on this CPU.
+             */
+            static bool IsSupported(Engine engine) {
+                switch (engine) {
+                    case Engine::Reference:
+                    case Engine::TTable:
+                        return true;
+                    case Engine::AESNI:
+#ifdef UTILS_CRYPTO_AES_NI
+                        return AES::HasAESNI();
+#else
+                        return false;
+#endif
+                }
+
+                return false;
+            }
+
+            /**
+             *  @brief  The fastest engine on this CPU: AES-NI if available,
+             *          else the T-tables. Checked once with CPUID.
+             */
+            static Engine BestEngine(void) {
+                return AES::IsSupported(Engine::AESNI) ? Engine::AESNI : Engine::TTable;
+            }
+
+            /*
+             *  Modes that take a ThreadPool split buffers of at least twice
+             *  utils::algorithm::parallel::MIN_CHUNK_BYTES over it. Without one,
+             *  everything runs on the calling thread.
+             *  CBC and CFB encryption chain every block on the previous one,
+             *  so only their decryption can be split.
+             */
+
+            /*
+             *  The span overloads write to a caller-provided buffer, which may be
+             *  the input itself, and return the amount of bytes written; decryption
+             *  returns the length without padding. Only the last partial block is
+             *  copied, to a block on the stack.
+             *  The pointer overloads allocate a new buffer, pad with zeros and keep
+             *  the padding on decryption.
+             */
+
+            /**
+             *  @brief  Encrypt \p in in ECB mode into \p out.
+             *
+             *  @param  in
+             *      The data to encrypt.
+             *  @param  out
+             *      At least PaddedSize(in.size(), padding) bytes, or \p in itself if it is large enough.
+             *  @param  ctx
+             *      The key schedule.
+             *  @param  padding
+             *      How to fill the last block. With Padding::None, \p in must be whole blocks.
+             *  @param  pool
+             *      The pool to split the buffer over, or nullptr.
+             *  @return Returns the amount of bytes written to \p out.
+             */
+            size_t EncryptECB(const const_bytes_t in, const bytes_t out, const Context& ctx,
+                              const Padding padding = Padding::PKCS7, utils::threading::ThreadPool *pool = nullptr) const
+            {
+                if (padding == Padding::None) {
+                    AES::CheckWholeBlocks("AES::EncryptECB", in.size());
+                }
+
+                const size_t total = AES::PaddedSize(in.size(), padding);
+                AES::CheckBuffers("AES::EncryptECB", in, out, total);
+
+                const size_t full = in.size() - in.size() % BLOCK_BYTES;
+                alignas(16) uint8_t last[BLOCK_BYTES];
+                const bool has_last = AES::PadBlock(in.data() + full, in.size() - full, padding, last);
+
+                const auto part = AES::Split(full, pool);
+
+                AES::ForEachChunk(part, pool, [&](const size_t i) {
+                    AES::EncryptBlocks(in.data() + part.begin(i), out.data() + part.begin(i),
+                                       (part.end(i) - part.begin(i)) / BLOCK_BYTES, ctx);
+                });
+
+                if (has_last) {
+                    AES::EncryptBlocks(last, out.data() + full, 1, ctx);
+                }
+
+                return total;
+            }
+
+            /**
+             *  @brief  Decrypt the whole blocks in \p in in ECB mode into \p out.
+             *  @return Returns the length of the plaintext without \p padding.
+             *          Throws if the PKCS#7 padding is invalid.
+             */
+            size_t DecryptECB(const const_bytes_t in, const bytes_t out, const Context& ctx,
+                              const Padding padding = Padding::PKCS7, utils::threading::ThreadPool *pool = nullptr) const
+            {
+                AES::CheckWholeBlocks("AES::DecryptECB", in.size());
+                AES::CheckBuffers("AES::DecryptECB", in, out, in.size());
+
+                const auto part = AES::Split(in.size(), pool);
+
+                AES::ForEachChunk(part, pool, [&](const size_t i) {
+                    AES::DecryptBlocks(in.data() + part.begin(i), out.data() + part.begin(i),
+                                       (part.end(i) - part.begin(i)) / BLOCK_BYTES, ctx);
+                });
+
+                return AES::Unpad("AES::DecryptECB", out.data(), in.size(), padding);
+            }
+
+            /**
+             *  @brief  Encrypt \p in in CBC mode into \p out, see EncryptECB().
+             *          Every block is chained on the previous one, so this runs on one thread.
+             *
+             *  @param  iv
+             *      The initialisation vector, BLOCK_BYTES long.
+             */
+            size_t EncryptCBC(const const_bytes_t in, const bytes_t out, const Context& ctx, const const_bytes_t iv,
+                              const Padding padding = Padding::PKCS7) const
+            {
+                AES::CheckIV("AES::EncryptCBC", iv);
+
+                if (padding == Padding::None) {
+                    AES::CheckWholeBlocks("AES::EncryptCBC", in.size());
+                }
+
+                const size_t total = AES::PaddedSize(in.size(), padding);
+                AES::CheckBuffers("AES::EncryptCBC", in, out, total);
+
+                const size_t full = in.size() - in.size() % BLOCK_BYTES;
+                alignas(16) uint8_t last[BLOCK_BYTES];
+                AES::PadBlock(in.data() + full, in.size() - full, padding, last);
+
+                alignas(16) uint8_t block[BLOCK_BYTES];
+                std::copy_n(iv.data(), BLOCK_BYTES, block);
+
+                for (size_t i = 0; i < total; i += BLOCK_BYTES) {
+                    AES::XorBlocks(block, i < full ? in.data() + i : last, block, BLOCK_BYTES);
+                    AES::EncryptBlock(block, block, ctx);
+                    std::copy_n(block, BLOCK_BYTES, out.data() + i);
+                }
+
+                return total;
+            }
+
+            /**
+             *  @brief  Decrypt the whole blocks in \p in in CBC mode into \p out, see DecryptECB().
+             */
+            size_t DecryptCBC(const const_bytes_t in, const bytes_t out, const Context& ctx, const const_bytes_t iv,
+                              const Padding padding = Padding::PKCS7, utils::threading::ThreadPool *pool = nullptr) const
+            {
+                AES::CheckIV("AES::DecryptCBC", iv);
+                AES::CheckWholeBlocks("AES::DecryptCBC", in.size());
+                AES::CheckBuffers("AES::DecryptCBC", in, out, in.size());
+
+                // Every plaintext block only needs its own and the previous ciphertext block
+                AES::DecryptChained(in, out, iv, pool, [&](const uint8_t *src, uint8_t *dst, size_t length, const uint8_t *prev) {
+                    AES::DecryptChainCBC(src, dst, length / BLOCK_BYTES, prev, ctx);
+                });
+
+                return AES::Unpad("AES::DecryptCBC", out.data(), in.size(), padding);
+            }
+
+            /**
+             *  @brief  Encrypt \p in in CFB mode into \p out, see EncryptECB().
+             *          Without padding, the last block may be partial and the
+             *          output is as long as \p in.
+             */
+            size_t EncryptCFB(const const_bytes_t in, const bytes_t out, const Context& ctx, const const_bytes_t iv,
+                              const Padding padding = Padding::None) const
+            {
+                AES::CheckIV("AES::EncryptCFB", iv);
+
+                const size_t total = AES::PaddedSize(in.size(), padding);
+                AES::CheckBuffers("AES::EncryptCFB", in, out, total);
+
+                const size_t full = in.size() - in.size() % BLOCK_BYTES;
+                alignas(16) uint8_t last[BLOCK_BYTES];
+                AES::PadBlock(in.data() + full, in.size() - full, padding, last);
+                const uint8_t *tail = padding == Padding::None ? in.data() + full : last;
+
+                alignas(16) uint8_t block[BLOCK_BYTES];
+                std::copy_n(iv.data(), BLOCK_BYTES, block);
+
+                for (size_t i = 0; i < full; i += BLOCK_BYTES) {
+                    AES::EncryptBlock(block, block, ctx);
+                    AES::XorBlocks(in.data() + i, block, block, BLOCK_BYTES);
+                    std::copy_n(block, BLOCK_BYTES, out.data() + i);
+                }
+
+                if (total > full) {
+                    AES::EncryptBlock(block, block, ctx);
+                    AES::XorBlocks(tail, block, out.data() + full, total - full);
+                }
+
+                return total;
+            }
+
+            /**
+             *  @brief  Decrypt \p in in CFB mode into \p out, see DecryptECB().
+             *          Without padding, the last block may be partial.
+             */
+            size_t DecryptCFB(const const_bytes_t in, const bytes_t out, const Context& ctx, const const_bytes_t iv,
+                              const Padding padding = Padding::None, utils::threading::ThreadPool *pool = nullptr) const
+            {
+                AES::CheckIV("AES::DecryptCFB", iv);
+
+                if (padding != Padding::None) {
+                    AES::CheckWholeBlocks("AES::DecryptCFB", in.size());
+                }
+
+                AES::CheckBuffers("AES::DecryptCFB", in, out, in.size());
+
+                AES::DecryptChained(in, out, iv, pool, [&](const uint8_t *src, uint8_t *dst, size_t length, const uint8_t *prev) {
+                    AES::DecryptChainCFB(src, dst, length, prev, ctx);
+                });
+
+                return AES::Unpad("AES::DecryptCFB", out.data(), in.size(), padding);
+            }
+
+            /**
+             *  @brief  Encrypt \p in in counter mode (SP 800-38A) into \p out,
+             *          incrementing the whole 16 byte counter block. No padding is added.
+             *
+             *  @param  in
+             *      The data to encrypt.
+             *  @param  out
+             *      At least in.size() bytes, or \p in itself.
+             *  @param  ctx
+             *      The key schedule.
+             *  @param  iv
+             *      The initial counter block, BLOCK_BYTES long. Never reuse it with the same key.
+             *  @param  pool
+             *      The pool to split the buffer over, or nullptr.
+             *  @return Returns the amount of bytes written to \p out.
+             */
+            size_t EncryptCTR(const const_bytes_t in, const bytes_t out, const Context& ctx, const const_bytes_t iv,
+                              utils::threading::ThreadPool *pool = nullptr) const
+            {
+                AES::CheckIV("AES::EncryptCTR", iv);
+                AES::CheckBuffers("AES::EncryptCTR", in, out, in.size());
+
+                const auto part = AES::Split(in.size(), pool);
+
+                AES::ForEachChunk(part, pool, [&](const size_t i) {
+                    alignas(16) uint8_t counter[BLOCK_BYTES];
+                    std::copy_n(iv.data(), BLOCK_BYTES, counter);
+                    AES::AddCounter(counter, part.begin(i) / BLOCK_BYTES, false);
+
+                    AES::CounterXor(in.data() + part.begin(i), out.data() + part.begin(i),
+                                    part.end(i) - part.begin(i), ctx, counter, false);
+                });
+
+                return in.size();
+            }
+
+            /**
+             *  @brief  Decrypt \p in in counter mode, the same operation as EncryptCTR().
+             */
+            size_t DecryptCTR(const const_bytes_t in, const bytes_t out, const Context& ctx, const const_bytes_t iv,
+                              utils::threading::ThreadPool *pool = nullptr) const
+            {
+                return this->EncryptCTR(in, out, ctx, iv, pool);
+            }
+
+            /**
+             *  @brief  Encrypt and authenticate \p in with AES-GCM (SP 800-38D) into \p out.
+             *          No padding is added.
+             *
+             *  @param  in
+             *      The data to encrypt.
+             *  @param  out
+             *      At least in.size() bytes, or \p in itself.
+             *  @param  ctx
+             *      The key schedule.
+             *  @param  iv
+             *      The nonce, preferably 12 bytes. Never reuse it with the same key.
+             *  @param  aad
+             *      Additional data that is authenticated but not encrypted, may be empty.
+             *  @param  tag
+             *      Will be set to the authentication tag, 4 to BLOCK_BYTES long.
+             *      Shorter tags are the first bytes of the full tag.
+             *  @param  pool
+             *      The pool to split the buffer over, or nullptr.
+             *  @return Returns the amount of bytes written to \p out.
+             */
+            size_t EncryptGCM(const const_bytes_t in, const bytes_t out, const Context& ctx, const const_bytes_t iv,
+                              const const_bytes_t aad, const bytes_t tag, utils::threading::ThreadPool *pool = nullptr) const
+            {
+                AES::CheckGCM("AES::EncryptGCM", iv, tag.size());
+                AES::CheckBuffers("AES::EncryptGCM", in, out, in.size());
+
+                uint8_t full_tag[BLOCK_BYTES];
+                AES::RunGCM(in.data(), out.data(), in.size(), ctx, iv.data(), iv.size(),
+                            aad.data(), aad.size(), full_tag, true, pool);
+                std::copy_n(full_tag, tag.size(), tag.data());
+
+                return in.size();
+            }
+
+            /**
+             *  @brief  Decrypt \p in with AES-GCM into \p out and check it against \p tag.
+             *          Throws if the data, \p aad or \p tag were changed, after
+             *          clearing \p out.
+             *
+             *  @param  tag
+             *      The tag from EncryptGCM().
+             *  @return Returns the amount of bytes written to \p out.
+             */
+            size_t DecryptGCM(const const_bytes_t in, const bytes_t out, const Context& ctx, const const_bytes_t iv,
+                              const const_bytes_t aad, const const_bytes_t tag, utils::threading::ThreadPool *pool = nullptr) const
+            {
+                AES::CheckGCM("AES::DecryptGCM", iv, tag.size());
+                AES::CheckBuffers("AES::DecryptGCM", in, out, in.size());
+
+                uint8_t expected[BLOCK_BYTES];
+                AES::RunGCM(in.data(), out.data(), in.size(), ctx, iv.data(), iv.size(),
+                            aad.data(), aad.size(), expected, false, pool);
+
+                // Compare every byte, so the time taken tells nothing about the tag
+                uint8_t diff = 0;
+                for (size_t i = 0; i < tag.size(); i++) {
+                    diff |= uint8_t(expected[i] ^ tag[i]);
+                }
+
+                if (HEDLEY_UNLIKELY(diff != 0)) {
+                    std::fill_n(out.data(), in.size(), uint8_t(0));
+                    throw utils::exceptions::Exception("AES::DecryptGCM", "Authentication failed.");
+                }
+
+                return in.size();
+            }
+
+            auto EncryptECB(const uint8_t in[], const uint32_t inLen, const Context& ctx, uint32_t& outLen,
+                            utils::threading::ThreadPool *pool = nullptr) const
+            {
+                outLen = uint32_t(AES::PaddedSize(inLen, Padding::Zeros));
+                auto out = utils::memory::new_unique_array<uint8_t>(outLen);
+                this->EncryptECB(const_bytes_t(in, inLen), bytes_t(out.get(), outLen), ctx, Padding::Zeros, pool);
                 return out;
             }
 
-            auto DecryptECB(const uint8_t in[], const uint32_t inLen, const uint8_t key[]) const {
+            auto EncryptECB(const uint8_t in[], const uint32_t inLen, const uint8_t key[], uint32_t& outLen) const {
+                return this->EncryptECB(in, inLen, this->MakeContext(key), outLen);
+            }
+
+            auto DecryptECB(const uint8_t in[], const uint32_t inLen, const Context& ctx,
+                            utils::threading::ThreadPool *pool = nullptr) const
+            {
                 auto out = utils::memory::new_unique_array<uint8_t>(inLen);
+                this->DecryptECB(const_bytes_t(in, inLen - inLen % BLOCK_BYTES), bytes_t(out.get(), inLen),
+                                 ctx, Padding::None, pool);
+                return out;
+            }
 
-                for (uint32_t i = 0; i < inLen; i += this->blockBytesLen) {
-                    DecryptBlock(in + i, out.get() + i, key);
-                }
+            auto DecryptECB(const uint8_t in[], const uint32_t inLen, const uint8_t key[]) const {
+                return this->DecryptECB(in, inLen, this->MakeContext(key));
+            }
 
+            auto EncryptCBC(const uint8_t in[], const uint32_t inLen, const Context& ctx, const uint8_t *iv, uint32_t& outLen) const {
+                outLen = uint32_t(AES::PaddedSize(inLen, Padding::Zeros));
+                auto out = utils::memory::new_unique_array<uint8_t>(outLen);
+                this->EncryptCBC(const_bytes_t(in, inLen), bytes_t(out.get(), outLen), ctx,
+                                 const_bytes_t(iv, BLOCK_BYTES), Padding::Zeros);
                 return out;
             }
 
             auto EncryptCBC(const uint8_t in[], const uint32_t inLen, const uint8_t key[], const uint8_t *iv, uint32_t& outLen) const {
-                outLen = this->GetPaddingLength(inLen);
-                auto alignIn = PaddingNulls(in, inLen, outLen);
-                auto out     = utils::memory::new_unique_array<uint8_t>(outLen);
-                auto block   = utils::memory::new_unique_array<uint8_t>(this->blockBytesLen);
-                std::copy_n(iv, this->blockBytesLen, block.get());
-
-                for (uint32_t i = 0; i < outLen; i += this->blockBytesLen) {
-                    this->XorBlocks(block.get(), alignIn.get() + i, block.get(), this->blockBytesLen);
-                    this->EncryptBlock(block.get(), out.get() + i, key);
-                    std::copy_n(out.get() + i, this->blockBytesLen, block.get());
-                }
+                return this->EncryptCBC(in, inLen, this->MakeContext(key), iv, outLen);
+            }
 
+            auto DecryptCBC(const uint8_t in[], const uint32_t inLen, const Context& ctx, const uint8_t *iv,
+                            utils::threading::ThreadPool *pool = nullptr) const
+            {
+                auto out = utils::memory::new_unique_array<uint8_t>(inLen);
+                this->DecryptCBC(const_bytes_t(in, inLen - inLen % BLOCK_BYTES), bytes_t(out.get(), inLen), ctx,
+                                 const_bytes_t(iv, BLOCK_BYTES), Padding::None, pool);
                 return out;
             }
 
             auto DecryptCBC(const uint8_t in[], const uint32_t inLen, const uint8_t key[], const uint8_t *iv) const {
-                auto out   = utils::memory::new_unique_array<uint8_t>(inLen);
-                auto block = utils::memory::new_unique_array<uint8_t>(this->blockBytesLen);
-                std::copy_n(iv, this->blockBytesLen, block.get());
-
-                for (uint32_t i = 0; i < inLen; i += this->blockBytesLen) {
-                    this->DecryptBlock(in + i, out.get() + i, key);
-                    this->XorBlocks(block.get(), out.get() + i, out.get() + i, this->blockBytesLen);
-                    std::copy_n(out.get() + i, this->blockBytesLen, block.get());
-                }
+                return this->DecryptCBC(in, inLen, this->MakeContext(key), iv);
+            }
 
+            auto EncryptCFB(const uint8_t in[], const uint32_t inLen, const Context& ctx, const uint8_t *iv, uint32_t& outLen) const {
+                outLen = uint32_t(AES::PaddedSize(inLen, Padding::Zeros));
+                auto out = utils::memory::new_unique_array<uint8_t>(outLen);
+                this->EncryptCFB(const_bytes_t(in, inLen), bytes_t(out.get(), outLen), ctx,
+                                 const_bytes_t(iv, BLOCK_BYTES), Padding::Zeros);
                 return out;
             }
 
             auto EncryptCFB(const uint8_t in[], const uint32_t inLen, const uint8_t key[], const uint8_t *iv, uint32_t& outLen) const {
-                outLen = this->GetPaddingLength(inLen);
-                auto alignIn        = this->PaddingNulls(in, inLen, outLen);
-                auto out            = utils::memory::new_unique_array<uint8_t>(outLen);
-                auto block          = utils::memory::new_unique_array<uint8_t>(this->blockBytesLen);
-                auto encryptedBlock = utils::memory::new_unique_array<uint8_t>(this->blockBytesLen);
-                std::copy_n(iv, this->blockBytesLen, block.get());
-
-                for (uint32_t i = 0; i < outLen; i += this->blockBytesLen) {
-                    this->EncryptBlock(block.get(), encryptedBlock.get(), key);
-                    this->XorBlocks(alignIn.get() + i, encryptedBlock.get(), out.get() + i, this->blockBytesLen);
-                    std::copy_n(out.get() + i, this->blockBytesLen, block.get());
-                }
+                return this->EncryptCFB(in, inLen, this->MakeContext(key), iv, outLen);
+            }
 
+            auto DecryptCFB(const uint8_t in[], const uint32_t inLen, const Context& ctx, const uint8_t *iv,
+                            utils::threading::ThreadPool *pool = nullptr) const
+            {
+                auto out = utils::memory::new_unique_array<uint8_t>(inLen);
+                this->DecryptCFB(const_bytes_t(in, inLen - inLen % BLOCK_BYTES), bytes_t(out.get(), inLen), ctx,
+                                 const_bytes_t(iv, BLOCK_BYTES), Padding::None, pool);
                 return out;
             }
 
             auto DecryptCFB(const uint8_t in[], const uint32_t inLen, const uint8_t key[], const uint8_t *iv) const {
-                auto out            = utils::memory::new_unique_array<uint8_t>(inLen);
-                auto block          = utils::memory::new_unique_array<uint8_t>(this->blockBytesLen);
-                auto encryptedBlock = utils::memory::new_unique_array<uint8_t>(this->blockBytesLen);
-                std::copy_n(iv, this->blockBytesLen, block.get());
+                return this->DecryptCFB(in, inLen, this->MakeContext(key), iv);
+            }
 
-                for (uint32_t i = 0; i < inLen; i += this->blockBytesLen) {
-                    this->EncryptBlock(block.get(), encryptedBlock.get(), key);
-                    this->XorBlocks(in + i, encryptedBlock.get(), out.get() + i, this->blockBytesLen);
-                    std::copy_n(in + i, this->blockBytesLen, block.get());
-                }
+            auto EncryptCTR(const uint8_t in[], const uint32_t inLen, const Context& ctx, const uint8_t *iv,
+                            utils::threading::ThreadPool *pool = nullptr) const
+            {
+                auto out = utils::memory::new_unique_array<uint8_t>(inLen);
+                this->EncryptCTR(const_bytes_t(in, inLen), bytes_t(out.get(), inLen), ctx,
+                                 const_bytes_t(iv, BLOCK_BYTES), pool);
+                return out;
+            }
+
+            auto EncryptCTR(const uint8_t in[], const uint32_t inLen, const uint8_t key[], const uint8_t *iv) const {
+                return this->EncryptCTR(in, inLen, this->MakeContext(key), iv);
+            }
+
+            auto DecryptCTR(const uint8_t in[], const uint32_t inLen, const Context& ctx, const uint8_t *iv,
+                            utils::threading::ThreadPool *pool = nullptr) const
+            {
+                return this->EncryptCTR(in, inLen, ctx, iv, pool);
+            }
+
+            auto DecryptCTR(const uint8_t in[], const uint32_t inLen, const uint8_t key[], const uint8_t *iv) const {
+                return this->DecryptCTR(in, inLen, this->MakeContext(key), iv);
+            }
+
+            /**
+             *  @brief  EncryptGCM() into a new buffer, with a BLOCK_BYTES long \p tag.
+             */
+            auto EncryptGCM(const uint8_t in[], const uint32_t inLen, const Context& ctx,
+                            const uint8_t *iv, const uint32_t ivLen, const uint8_t *aad, const uint32_t aadLen,
+                            uint8_t tag[], utils::threading::ThreadPool *pool = nullptr) const
+            {
+                AES::CheckGCM("AES::EncryptGCM", const_bytes_t(iv, ivLen), BLOCK_BYTES);
 
+                auto out = utils::memory::new_unique_array<uint8_t>(inLen);
+                AES::RunGCM(in, out.get(), inLen, ctx, iv, ivLen, aad, aadLen, tag, true, pool);
+                return out;
+            }
+
+            auto EncryptGCM(const uint8_t in[], const uint32_t inLen, const uint8_t key[],
+                            const uint8_t *iv, const uint32_t ivLen, const uint8_t *aad, const uint32_t aadLen,
+                            uint8_t tag[]) const
+            {
+                return this->EncryptGCM(in, inLen, this->MakeContext(key), iv, ivLen, aad, aadLen, tag);
+            }
+
+            /**
+             *  @brief  DecryptGCM() into a new buffer, with a BLOCK_BYTES long \p tag.
+             */
+            auto DecryptGCM(const uint8_t in[], const uint32_t inLen, const Context& ctx,
+                            const uint8_t *iv, const uint32_t ivLen, const uint8_t *aad, const uint32_t aadLen,
+                            const uint8_t tag[], utils::threading::ThreadPool *pool = nullptr) const
+            {
+                auto out = utils::memory::new_unique_array<uint8_t>(inLen);
+                this->DecryptGCM(const_bytes_t(in, inLen), bytes_t(out.get(), inLen), ctx, const_bytes_t(iv, ivLen),
+                                 const_bytes_t(aad, aadLen), const_bytes_t(tag, BLOCK_BYTES), pool);
                 return out;
             }
+
+            auto DecryptGCM(const uint8_t in[], const uint32_t inLen, const uint8_t key[],
+                            const uint8_t *iv, const uint32_t ivLen, const uint8_t *aad, const uint32_t aadLen,
+                            const uint8_t tag[]) const
+            {
+                return this->DecryptGCM(in, inLen, this->MakeContext(key), iv, ivLen, aad, aadLen, tag);
+            }
+
+            /**
+             *  @brief  Incremental CBC, CFB or CTR encryption or decryption, for data
+             *          that comes in pieces, like large files or sockets.
+             *          The chaining state is kept between calls to update(), so the
+             *          output is the same as encrypting all data at once.
+             *
+             *          Call init(), then update() for every piece, and finalize() once.
+             *          CBC keeps up to one block back, CFB and CTR output every byte right away.
+             */
+            class Stream {
+                public:
+                    enum class Mode : uint8_t {
+                        CBC,
+                        CFB,
+                        CTR,
+                    };
+
+                private:
+                    Context ctx;
+                    Mode    mode;
+                    bool    encrypt;
+                    Padding padding;
+                    bool    ready = false;
+
+                    alignas(16) uint8_t chain[BLOCK_BYTES];    ///< CBC and CFB: the last ciphertext block, CTR: the next counter block
+                    alignas(16) uint8_t pending[BLOCK_BYTES];  ///< CBC: input not processed yet, CFB: ciphertext of the current block
+                    alignas(16) uint8_t stream[BLOCK_BYTES];   ///< CFB and CTR: key stream of the current block
+                    size_t buffered = 0;                       ///< Bytes in pending (CBC), or used of stream (CFB and CTR)
+
+                    inline bool holds_last_block(void) const {
+                        return !this->encrypt && this->padding == Padding::PKCS7;
+                    }
+
+                    /**
+                     *  @brief  Run one CBC block from \p in to \p out.
+                     */
+                    inline void cbc_block(const uint8_t in[], uint8_t out[]) {
+                        if (this->encrypt) {
+                            AES::XorBlocks(this->chain, in, this->chain, BLOCK_BYTES);
+                            AES::EncryptBlock(this->chain, this->chain, this->ctx);
+                            std::copy_n(this->chain, BLOCK_BYTES, out);
+                        } else {
+                            AES::DecryptChainCBC(in, out, 1, this->chain, this->ctx);
+                            std::copy_n(in, BLOCK_BYTES, this->chain);
+                        }
+                    }
+
+                    size_t update_cbc(const uint8_t *in, size_t length, uint8_t *out) {
+                        const bool hold = this->holds_last_block();
+                        uint8_t *start = out;
+
+                        // Complete the pending block, but keep it if it may be the last one
+                        if (this->buffered > 0) {
+                            const size_t take = std::min(BLOCK_BYTES - this->buffered, length);
+                            std::copy_n(in, take, this->pending + this->buffered);
+                            this->buffered += take;
+                            in     += take;
+                            length -= take;
+
+                            if (this->buffered < BLOCK_BYTES || (hold && length == 0)) {
+                                return 0;
+                            }
+
+                            this->cbc_block(this->pending, out);
+                            this->buffered = 0;
+                            out += BLOCK_BYTES;
+                        }
+
+                        size_t blocks = length / BLOCK_BYTES;
+                        if (hold && blocks > 0 && length % BLOCK_BYTES == 0) {
+                            blocks--;
+                        }
+
+                        if (this->encrypt) {
+                            for (size_t i = 0; i < blocks; i++, in += BLOCK_BYTES, out += BLOCK_BYTES) {
+                                this->cbc_block(in, out);
+                            }
+                        } else if (blocks > 0) {
+                            AES::DecryptChainCBC(in, out, blocks, this->chain, this->ctx);
+                            std::copy_n(in + (blocks - 1) * BLOCK_BYTES, BLOCK_BYTES, this->chain);
+                            in  += blocks * BLOCK_BYTES;
+                            out += blocks * BLOCK_BYTES;
+                        }
+
+                        this->buffered = length - blocks * BLOCK_BYTES;
+                        std::copy_n(in, this->buffered, this->pending);
+
+                        return size_t(out - start);
+                    }
+
+                    /**
+                     *  @brief  En- or decrypt single CFB bytes until the current block
+                     *          is complete or \p length is 0.
+                     */
+                    inline void cfb_bytes(const uint8_t *&in, size_t& length, uint8_t *&out) {
+                        while (length > 0) {
+                            if (this->buffered == 0) {
+                                AES::EncryptBlock(this->chain, this->stream, this->ctx);
+                            }
+
+                            const uint8_t byte = *in++;
+                            const uint8_t res  = byte ^ this->stream[this->buffered];
+                            this->pending[this->buffered++] = this->encrypt ? res : byte;
+                            *out++ = res;
+                            length--;
+
+                            if (this->buffered == BLOCK_BYTES) {
+                                std::copy_n(this->pending, BLOCK_BYTES, this->chain);
+                                this->buffered = 0;
+                                return;
+                            }
+                        }
+                    }
+
+                    void update_cfb(const uint8_t *in, size_t length, uint8_t *out) {
+                        if (this->buffered > 0) {
+                            this->cfb_bytes(in, length, out);
+                        }
+
+                        const size_t blocks = length / BLOCK_BYTES, bytes = blocks * BLOCK_BYTES;
+
+                        if (blocks > 0 && this->encrypt) {
+                            for (size_t i = 0; i < bytes; i += BLOCK_BYTES) {
+                                AES::EncryptBlock(this->chain, this->stream, this->ctx);
+                                AES::XorBlocks(in + i, this->stream, this->chain, BLOCK_BYTES);
+                                std::copy_n(this->chain, BLOCK_BYTES, out + i);
+                            }
+                        } else if (blocks > 0) {
+                            // Keep the last ciphertext block, out may be in
+                            alignas(16) uint8_t last[BLOCK_BYTES];
+                            std::copy_n(in + bytes - BLOCK_BYTES, BLOCK_BYTES, last);
+                            AES::DecryptChainCFB(in, out, bytes, this->chain, this->ctx);
+                            std::copy_n(last, BLOCK_BYTES, this->chain);
+                        }
+
+                        in     += bytes;
+                        out    += bytes;
+                        length -= bytes;
+
+                        this->cfb_bytes(in, length, out);
+                    }
+
+                    void update_ctr(const uint8_t *in, size_t length, uint8_t *out) {
+                        // Use up the key stream of the current block first
+                        for (; this->buffered > 0 && length > 0; length--) {
+                            *out++ = *in++ ^ this->stream[this->buffered];
+                            this->buffered = (this->buffered + 1) % BLOCK_BYTES;
+                        }
+
+                        const size_t blocks = length / BLOCK_BYTES, bytes = blocks * BLOCK_BYTES;
+
+                        if (blocks > 0) {
+                            AES::CounterXor(in, out, bytes, this->ctx, this->chain, false);
+                            AES::AddCounter(this->chain, blocks, false);
+                            in     += bytes;
+                            out    += bytes;
+                            length -= bytes;
+                        }
+
+                        if (length > 0) {
+                            AES::EncryptBlock(this->chain, this->stream, this->ctx);
+                            AES::AddCounter(this->chain, 1, false);
+                            AES::XorBlocks(in, this->stream, out, length);
+                            this->buffered = length;
+                        }
+                    }
+
+                public:
+                    /**
+                     *  @param  mode
+                     *      The block cipher mode.
+                     *  @param  encrypt
+                     *      Whether to encrypt or decrypt.
+                     *  @param  padding
+                     *      How the last CBC block is padded, and removed when decrypting.
+                     *      CFB and CTR output as many bytes as they get and never pad.
+                     */
+                    Stream(Mode mode, bool encrypt, Padding padding = Padding::PKCS7)
+                        : mode(mode), encrypt(encrypt)
+                        , padding(mode == Mode::CBC ? padding : Padding::None)
+                        , chain{}, pending{}, stream{}
+                    {}
+
+                    /**
+                     *  @brief  Start a new message with \p key, which selects AES-128, 192 or 256.
+                     *
+                     *  @param  key
+                     *      The key, 16, 24 or 32 bytes long.
+                     *  @param  iv
+                     *      The initialisation vector or initial counter block, BLOCK_BYTES long.
+                     *  @param  engine
+                     *      The engine to use, the fastest one by default.
+                     */
+                    void init(const const_bytes_t key, const const_bytes_t iv, Engine engine = AES::BestEngine()) {
+                        if (HEDLEY_UNLIKELY(key.size() != 16 && key.size() != 24 && key.size() != 32)) {
+                            throw utils::exceptions::Exception("AES::Stream::init", "Key must be 16, 24 or 32 bytes long.");
+                        }
+
+                        this->init(AES(int(key.size() * 8)).MakeContext(key, engine), iv);
+                    }
+
+                    /**
+                     *  @brief  Start a new message with an expanded key, see AES::MakeContext().
+                     */
+                    void init(const Context& context, const const_bytes_t iv) {
+                        AES::CheckIV("AES::Stream::init", iv);
+
+                        this->ctx = context;
+                        std::copy_n(iv.data(), BLOCK_BYTES, this->chain);
+                        this->buffered = 0;
+                        this->ready    = true;
+                    }
+
+                    /**
+                     *  @brief  The most bytes update() writes for \p length bytes of input.
+                     */
+                    inline size_t update_size(const size_t length) const {
+                        if (this->mode == Mode::CBC) {
+                            return (this->buffered + length) / BLOCK_BYTES * BLOCK_BYTES;
+                        }
+
+                        return length;
+                    }
+
+                    /**
+                     *  @brief  En- or decrypt the next piece of the message.
+                     *
+                     *  @param  in
+                     *      The next piece, of any length.
+                     *  @param  out
+                     *      At least update_size(in.size()) bytes. May be \p in for CFB and CTR.
+                     *  @return Returns the amount of bytes written to \p out.
+                     */
+                    size_t update(const const_bytes_t in, const bytes_t out) {
+                        if (HEDLEY_UNLIKELY(!this->ready)) {
+                            throw utils::exceptions::Exception("AES::Stream::update", "Call init() first.");
+                        }
+
+                        AES::CheckBuffers("AES::Stream::update", in, out, this->update_size(in.size()));
+
+                        switch (this->mode) {
+                            case Mode::CBC:
+                                // Output lags or leads the input by the pending bytes
+                                if (HEDLEY_UNLIKELY(!in.empty() && in.data() == out.data())) {
+                                    throw utils::exceptions::Exception("AES::Stream::update", "CBC cannot work in place.");
+                                }
+
+                                return this->update_cbc(in.data(), in.size(), out.data());
+                            case Mode::CFB:
+                                this->update_cfb(in.data(), in.size(), out.data());
+                                break;
+                            case Mode::CTR:
+                                this->update_ctr(in.data(), in.size(), out.data());
+                                break;
+                        }
+
+                        return in.size();
+                    }
+
+                    /**
+                     *  @brief  Finish the message: pad and write the last CBC block, or
+                     *          remove the padding when decrypting. Call init() for the next one.
+                     *
+                     *  @param  out
+                     *      At least BLOCK_BYTES bytes for CBC, may be empty for CFB and CTR.
+                     *  @return Returns the amount of bytes written to \p out.
+                     *          Throws if CBC input was not a whole number of blocks,
+                     *          or the padding is invalid.
+                     */
+                    size_t finalize(const bytes_t out) {
+                        if (HEDLEY_UNLIKELY(!this->ready)) {
+                            throw utils::exceptions::Exception("AES::Stream::finalize", "Call init() first.");
+                        }
+
+                        this->ready = false;
+                        size_t written = 0;
+
+                        if (this->mode == Mode::CBC) {
+                            alignas(16) uint8_t block[BLOCK_BYTES];
+
+                            if (this->encrypt) {
+                                if (HEDLEY_UNLIKELY(this->padding == Padding::None && this->buffered > 0)) {
+                                    throw utils::exceptions::Exception("AES::Stream::finalize", "Input is not a whole number of blocks.");
+                                }
+
+                                if (AES::PadBlock(this->pending, this->buffered, this->padding, block)) {
+                                    AES::CheckBuffers("AES::Stream::finalize", {}, out, BLOCK_BYTES);
+                                    this->cbc_block(block, out.data());
+                                    written = BLOCK_BYTES;
+                                }
+                            } else if (this->holds_last_block()) {
+                                if (HEDLEY_UNLIKELY(this->buffered != BLOCK_BYTES)) {
+                                    throw utils::exceptions::Exception("AES::Stream::finalize", "Input is not a whole number of blocks.");
+                                }
+
+                                this->cbc_block(this->pending, block);
+                                written = AES::Unpad("AES::Stream::finalize", block, BLOCK_BYTES, Padding::PKCS7);
+                                AES::CheckBuffers("AES::Stream::finalize", {}, out, written);
+                                std::copy_n(block, written, out.data());
+                            } else if (HEDLEY_UNLIKELY(this->buffered > 0)) {
+                                throw utils::exceptions::Exception("AES::Stream::finalize", "Input is not a whole number of blocks.");
+                            }
+                        }
+
+                        // Nothing of the key stream or plaintext stays behind
+                        std::fill_n(this->pending, BLOCK_BYTES, uint8_t(0));
+                        std::fill_n(this->stream,  BLOCK_BYTES, uint8_t(0));
+                        this->buffered = 0;
+
+                        return written;
+                    }
+            };
     };
 }
 
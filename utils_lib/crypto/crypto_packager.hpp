@@ -11,7 +11,7 @@
 
 namespace utils::crypto {
     struct IPackageStrategy {
-        virtual ~IPackageStrategy();
+        virtual ~IPackageStrategy() = default;
     };
 
     struct PackageJSON : public IPackageStrategy {
@@ -80,6 +80,111 @@ namespace utils::crypto {
             auto dec = aes.DecryptECB(reader.get_buffer() + len_bits / 8, reader.get_size(), key.data());
             return {dec.get(), dec.get() + out_len};
         }
+
+        static inline constexpr size_t file_chunk_bytes = 64 * 1024;
+
+        using iv_t = std::array<uint8_t, utils::crypto::AES::BLOCK_BYTES>;
+
+        /**
+         *  \brief  Encrypt the file \p src to \p dst with AES-CBC and PKCS#7 padding,
+         *          file_chunk_bytes at a time, so memory use does not depend on the file size.
+         *          \p iv is written in front of the ciphertext, use a new random one for every file.
+         *
+         *  \exception  FileReadException, FileWriteException
+         *      Throws if \p src could not be read or \p dst could not be written.
+         */
+        void PackFile(const std::string& src, const std::string& dst, const std::array<uint8_t, KeyBytes>& key, const iv_t& iv) {
+            std::ifstream in(src, std::ifstream::binary);
+
+            if (HEDLEY_UNLIKELY(!in.good())) {
+                throw utils::exceptions::FileReadException(src);
+            }
+
+            std::ofstream out(dst, std::ofstream::binary);
+
+            if (HEDLEY_UNLIKELY(!out.write(reinterpret_cast<const char*>(iv.data()), std::streamsize(iv.size())))) {
+                throw utils::exceptions::FileWriteException(dst);
+            }
+
+            utils::crypto::AES::Stream stream(utils::crypto::AES::Stream::Mode::CBC, true);
+            stream.init(key, iv);
+            EncipherAES::Transfer(in, out, stream, src, dst);
+        }
+
+        /**
+         *  \brief  Decrypt the file \p src written by PackFile() to \p dst,
+         *          file_chunk_bytes at a time.
+         *
+         *  \exception  FileReadException, FileWriteException
+         *      Throws if \p src could not be read or \p dst could not be written.
+         *  \exception  Exception
+         *      Throws if the padding is invalid, \p dst is removed then.
+         *
+         *  \note  CBC is not authenticated: a wrong key or a changed file usually
+         *         breaks the padding, but about 1 in 256 times it decrypts to
+         *         garbage without throwing.
+         */
+        void UnpackFile(const std::string& src, const std::string& dst, const std::array<uint8_t, KeyBytes>& key) {
+            std::ifstream in(src, std::ifstream::binary);
+            iv_t iv;
+
+            if (HEDLEY_UNLIKELY(!in.read(reinterpret_cast<char*>(iv.data()), std::streamsize(iv.size())))) {
+                throw utils::exceptions::FileReadException(src);
+            }
+
+            std::ofstream out(dst, std::ofstream::binary);
+
+            if (HEDLEY_UNLIKELY(!out.good())) {
+                throw utils::exceptions::FileWriteException(dst);
+            }
+
+            utils::crypto::AES::Stream stream(utils::crypto::AES::Stream::Mode::CBC, false);
+            stream.init(key, iv);
+            EncipherAES::Transfer(in, out, stream, src, dst);
+        }
+
+        private:
+            /**
+             *  \brief  Run the rest of \p in through \p stream to \p out.
+             *          On any error \p dst is removed, so a wrong key or a bad padding
+             *          (only found in finalize()) does not leave a partial file behind.
+             */
+            static void Transfer(std::ifstream& in, std::ofstream& out, utils::crypto::AES::Stream& stream,
+                                 const std::string& src, const std::string& dst)
+            {
+                try {
+                    EncipherAES::TransferChunks(in, out, stream, src, dst);
+                } catch (...) {
+                    std::error_code ec;
+                    out.close();
+                    utils::io::fs::remove(dst, ec);
+                    throw;
+                }
+            }
+
+            static void TransferChunks(std::ifstream& in, std::ofstream& out, utils::crypto::AES::Stream& stream,
+                                       const std::string& src, const std::string& dst)
+            {
+                std::vector<uint8_t> in_buf(file_chunk_bytes), out_buf(file_chunk_bytes + utils::crypto::AES::BLOCK_BYTES);
+
+                while (in) {
+                    in.read(reinterpret_cast<char*>(in_buf.data()), std::streamsize(in_buf.size()));
+                    const size_t length  = size_t(in.gcount());
+                    const size_t written = stream.update(utils::crypto::AES::const_bytes_t(in_buf.data(), length), out_buf);
+                    out.write(reinterpret_cast<const char*>(out_buf.data()), std::streamsize(written));
+                }
+
+                if (HEDLEY_UNLIKELY(in.bad())) {
+                    throw utils::exceptions::FileReadException(src);
+                }
+
+                const size_t written = stream.finalize(out_buf);
+                out.write(reinterpret_cast<const char*>(out_buf.data()), std::streamsize(written));
+
+                if (HEDLEY_UNLIKELY(!out.flush())) {
+                    throw utils::exceptions::FileWriteException(dst);
+                }
+            }
     };
 }
 
@@ -4,12 +4,19 @@
 #include "external/cppitertools/itertools.hpp"
 #include "utils_compiler.hpp"
 #include "utils_traits.hpp"
+#include "utils_threading.hpp"
 
 #include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <numeric>
 #include <optional>
 #include <tuple>
+#include <type_traits>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <exception>
 
 
 namespace utils::algorithm {
@@ -604,6 +611,757 @@ namespace utils::algorithm {
         }
     }
 
+    /**
+     *  \brief  The amount of bins in a histogram of values of type \p T.
+     */
+    template<typename T>
+    inline constexpr size_t histogram_bins_v = size_t(1) << (8 * sizeof(T));
+
+    /**
+     *  \brief  Count how many times every value occurs in \p data, and add
+     *          the counts to \p counts.
+     *
+     *          Neighbouring elements are counted in separate, interleaved tables
+     *          (4 for bytes, 2 for words), so a run of equal values does not make
+     *          every increment wait for the store of the previous one.
+     *          The tables hold 32-bit counts and are flushed to \p counts in blocks.
+     *
+     *  \param  data
+     *      The values to count.
+     *  \param  length
+     *      The amount of values in \p data.
+     *  \param  counts
+     *      The histogram to add to, with histogram_bins_v<T> entries.
+     */
+    template<
+        typename T,
+        typename = typename std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T> && (sizeof(T) <= 2)>
+    > ATTR_MAYBE_UNUSED
+    static inline void histogram(const T *data, size_t length, uint64_t *counts) {
+        constexpr size_t BINS   = histogram_bins_v<T>;
+        constexpr size_t TABLES = sizeof(T) == 1 ? 4 : 2;
+        constexpr size_t BLOCK  = size_t(1) << 30;  // Far below the 32-bit limit of every table
+
+        std::vector<uint32_t> tables(TABLES * BINS);
+        uint32_t *const t0 = tables.data();
+        uint32_t *const t1 = t0 + BINS;
+
+        while (length > 0) {
+            const size_t block = std::min(length, BLOCK);
+            size_t i = 0;
+
+            // Spelled out, a loop over the tables is not always unrolled
+            if constexpr (TABLES == 4) {
+                uint32_t *const t2 = t1 + BINS;
+                uint32_t *const t3 = t2 + BINS;
+
+                for (; i + 4 <= block; i += 4) {
+                    t0[data[i    ]]++;
+                    t1[data[i + 1]]++;
+                    t2[data[i + 2]]++;
+                    t3[data[i + 3]]++;
+                }
+            } else {
+                for (; i + 2 <= block; i += 2) {
+                    t0[data[i    ]]++;
+                    t1[data[i + 1]]++;
+                }
+            }
+
+            for (; i < block; i++) {
+                t0[data[i]]++;
+            }
+
+            for (size_t t = 0; t < TABLES; t++) {
+                for (size_t bin = 0; bin < BINS; bin++) {
+                    counts[bin] += t0[t * BINS + bin];
+                }
+            }
+
+            std::fill(tables.begin(), tables.end(), 0u);
+            data   += block;
+            length -= block;
+        }
+    }
+
+    /**
+     *  \brief  Count how many times every value occurs in \p data.
+     *
+     *  \param  data
+     *      The values to count.
+     *  \param  length
+     *      The amount of values in \p data.
+     *  \return Returns the count for every value, with histogram_bins_v<T> entries.
+     */
+    template<
+        typename T,
+        typename = typename std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T> && (sizeof(T) <= 2)>
+    > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+    static inline std::vector<uint64_t> histogram(const T *data, const size_t length) {
+        std::vector<uint64_t> counts(histogram_bins_v<T>, 0u);
+        utils::algorithm::histogram(data, length, counts.data());
+        return counts;
+    }
+
+    /**
+     *  Parallel versions of some of the algorithms above, executed on a
+     *  utils::threading::ThreadPool (or parallel::default_pool()).
+     *
+     *  Ranges are split in chunks of at least parallel::MIN_CHUNK_BYTES,
+     *  rounded up to whole cache lines, with at most parallel::CHUNKS_PER_WORKER
+     *  chunks per worker. Ranges too small to split, or without random access
+     *  iterators, are handled by the sequential version on the calling thread.
+     *
+     *  The calling thread also processes chunks and only waits for chunks that
+     *  are already being processed, so these can be called from within a task
+     *  on the same pool without deadlocking.
+     */
+    namespace parallel {
+        constexpr size_t CACHE_LINE_SIZE   = 64;
+        constexpr size_t MIN_CHUNK_BYTES   = 16 * 1024;
+        constexpr size_t CHUNKS_PER_WORKER = 4;
+
+        /**
+         *  \brief  Return a lazily created, process wide work-stealing pool
+         *          with `std::thread::hardware_concurrency()` workers.
+         */
+        ATTR_MAYBE_UNUSED
+        inline utils::threading::ThreadPool& default_pool(void) {
+            static utils::threading::ThreadPool pool(std::thread::hardware_concurrency(),
+                                                     utils::threading::ThreadPool::Mode::WorkStealing);
+            return pool;
+        }
+
+        namespace internal {
+            /**
+             *  \brief  The amount of chunks and elements per chunk to split a range in.
+             */
+            struct Partition {
+                size_t chunks;
+                size_t chunk_size;
+                size_t length;
+
+                inline size_t begin(const size_t chunk) const {
+                    return chunk * this->chunk_size;
+                }
+
+                inline size_t end(const size_t chunk) const {
+                    return std::min(this->begin(chunk) + this->chunk_size, this->length);
+                }
+            };
+
+            /**
+             *  \brief  Calculate the partition of \p length elements of type \p T
+             *          for \p workers threads.
+             */
+            template<typename T>
+            static inline Partition partition(const size_t length, const size_t workers) {
+                constexpr size_t per_line  = std::max<size_t>(1, CACHE_LINE_SIZE / sizeof(T));
+                constexpr size_t min_chunk = std::max<size_t>(per_line, MIN_CHUNK_BYTES / sizeof(T));
+
+                if (workers < 1 || length < 2 * min_chunk) {
+                    return { 1, length, length };
+                }
+
+                const size_t chunks = std::min(workers * CHUNKS_PER_WORKER, length / min_chunk);
+                size_t chunk_size   = (length + chunks - 1) / chunks;
+                chunk_size          = ((chunk_size + per_line - 1) / per_line) * per_line;
+
+                return { (length + chunk_size - 1) / chunk_size, chunk_size, length };
+            }
+
+            /**
+             *  \brief  Shared state between the caller and the helper tasks.
+             *          Kept alive by the helpers, which may start after all chunks are done.
+             */
+            struct ChunkState {
+                std::atomic<size_t> next{0};
+                std::atomic<size_t> done{0};
+                size_t count = 0;
+
+                void  *fn = nullptr;
+                void (*invoke)(void*, size_t) = nullptr;
+
+                std::mutex              mutex;
+                std::condition_variable condition;
+                std::exception_ptr      error;
+
+                inline void work(void) {
+                    for (size_t i = this->next.fetch_add(1); i < this->count; i = this->next.fetch_add(1)) {
+                        try {
+                            this->invoke(this->fn, i);
+                        } catch (...) {
+                            LOCK_BLOCK(this->mutex);
+                            if (!this->error) {
+                                this->error = std::current_exception();
+                            }
+                        }
+
+                        if (this->done.fetch_add(1) + 1 == this->count) {
+                            LOCK_BLOCK(this->mutex);
+                            this->condition.notify_all();
+                        }
+                    }
+                }
+            };
+
+            /**
+             *  \brief  Call \p fn(i) for every i in [0, count) on \p pool and the
+             *          calling thread, and wait until all calls have finished.
+             *          The first exception thrown by \p fn is rethrown.
+             */
+            template<typename F>
+            static inline void run_chunks(utils::threading::ThreadPool& pool, const size_t count, F&& fn) {
+                if (HEDLEY_UNLIKELY(count == 0)) return;
+
+                auto state    = std::make_shared<ChunkState>();
+                state->count  = count;
+                state->fn     = static_cast<void*>(std::addressof(fn));
+                state->invoke = [](void *f, size_t i) {
+                    (*static_cast<std::remove_reference_t<F>*>(f))(i);
+                };
+
+                const size_t helpers = std::min(pool.size(), count - 1);
+
+                for (size_t i = 0; i < helpers; ++i) {
+                    pool.post([state] { state->work(); });
+                }
+
+                state->work();
+
+                {
+                    LOCK_UNIQUE_BLOCK(state->mutex);
+                    state->condition.wait(__lock, [&]{ return state->done.load() == count; });
+                }
+
+                if (state->error) {
+                    std::rethrow_exception(state->error);
+                }
+            }
+
+            template<typename Iterator>
+            inline constexpr bool is_random_access_v =
+                std::is_base_of_v<std::random_access_iterator_tag,
+                                  typename std::iterator_traits<Iterator>::iterator_category>;
+        }
+
+        /**
+         *  \brief  Reduce all elements between \p start and \p end with \p op,
+         *          starting from \p init. \p op must be associative,
+         *          partial results are combined in order.
+         *
+         *  \param  pool
+         *      The pool to run on.
+         *  \param  start
+         *      The start iterator to begin from.
+         *  \param  end
+         *      The end iterator to stop at.
+         *  \param  init
+         *      The initial value.
+         *  \param  op
+         *      The binary operation to combine elements with.
+         *  \return Returns the reduced value.
+         */
+        template <
+            typename Iterator,
+            typename T,
+            typename F = std::plus<>,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline T reduce(utils::threading::ThreadPool& pool, Iterator start, Iterator end, T init, F&& op = F{}) {
+            using value_t = typename std::iterator_traits<Iterator>::value_type;
+
+            if constexpr (!internal::is_random_access_v<Iterator>) {
+                return std::accumulate(start, end, init, std::forward<F>(op));
+            } else {
+                const auto part = internal::partition<value_t>(size_t(std::distance(start, end)), pool.size());
+
+                if (part.chunks <= 1) {
+                    return std::accumulate(start, end, init, std::forward<F>(op));
+                }
+
+                std::vector<std::optional<T>> partial(part.chunks);
+
+                internal::run_chunks(pool, part.chunks, [&](const size_t i) {
+                    auto first = start + std::ptrdiff_t(part.begin(i));
+                    auto last  = start + std::ptrdiff_t(part.end(i));
+                    T acc      = *first;
+
+                    for (++first; first != last; ++first) {
+                        acc = op(std::move(acc), *first);
+                    }
+
+                    partial[i].emplace(std::move(acc));
+                });
+
+                for (auto& p : partial) {
+                    init = op(std::move(init), std::move(*p));
+                }
+
+                return init;
+            }
+        }
+
+        template <
+            typename Iterator,
+            typename T,
+            typename F = std::plus<>,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline T reduce(Iterator start, Iterator end, T init, F&& op = F{}) {
+            return utils::algorithm::parallel::reduce(utils::algorithm::parallel::default_pool(),
+                                                      start, end, std::move(init), std::forward<F>(op));
+        }
+
+        /**
+         *  \brief  Calculate the sum of all elements between \p start and \p end.
+         *
+         *  \param  pool
+         *      The pool to run on.
+         *  \param  start
+         *      The start iterator to begin from.
+         *  \param  end
+         *      The end iterator to stop at.
+         *  \return Returns the sum of the elements with type `Iterator::value_type`.
+         */
+        template <
+            typename Iterator,
+            typename T = typename std::iterator_traits<Iterator>::value_type,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline T sum(utils::threading::ThreadPool& pool, Iterator start, Iterator end) {
+            return utils::algorithm::parallel::reduce(pool, start, end, T{0}, std::plus<T>{});
+        }
+
+        template <
+            typename Iterator,
+            typename T = typename std::iterator_traits<Iterator>::value_type,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline T sum(Iterator start, Iterator end) {
+            return utils::algorithm::parallel::sum(utils::algorithm::parallel::default_pool(), start, end);
+        }
+
+        template <
+            typename Container,
+            typename = typename std::enable_if_t<utils::traits::is_iterable_v<Container>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline auto sum(utils::threading::ThreadPool& pool, const Container& cont) {
+            return utils::algorithm::parallel::sum(pool, std::begin(cont), std::end(cont));
+        }
+
+        template <
+            typename Container,
+            typename = typename std::enable_if_t<utils::traits::is_iterable_v<Container>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline auto sum(const Container& cont) {
+            return utils::algorithm::parallel::sum(std::begin(cont), std::end(cont));
+        }
+
+        /**
+         *  \brief  Calculate the product of all elements between \p start and \p end.
+         *
+         *  \param  pool
+         *      The pool to run on.
+         *  \param  start
+         *      The start iterator to begin from.
+         *  \param  end
+         *      The end iterator to stop at.
+         *  \return Returns the product of the elements with type `Iterator::value_type`,
+         *          or 0 if the range is empty.
+         */
+        template <
+            typename Iterator,
+            typename T = typename std::iterator_traits<Iterator>::value_type,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline T product(utils::threading::ThreadPool& pool, Iterator start, Iterator end) {
+            return start != end
+                 ? utils::algorithm::parallel::reduce(pool, start, end, T{1}, std::multiplies<T>{})
+                 : T{0};
+        }
+
+        template <
+            typename Iterator,
+            typename T = typename std::iterator_traits<Iterator>::value_type,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline T product(Iterator start, Iterator end) {
+            return utils::algorithm::parallel::product(utils::algorithm::parallel::default_pool(), start, end);
+        }
+
+        template <
+            typename Container,
+            typename = typename std::enable_if_t<utils::traits::is_iterable_v<Container>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline auto product(utils::threading::ThreadPool& pool, const Container& cont) {
+            return utils::algorithm::parallel::product(pool, std::begin(cont), std::end(cont));
+        }
+
+        template <
+            typename Container,
+            typename = typename std::enable_if_t<utils::traits::is_iterable_v<Container>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline auto product(const Container& cont) {
+            return utils::algorithm::parallel::product(std::begin(cont), std::end(cont));
+        }
+
+        /**
+         *  \brief  Call \p fn on every element between \p start and \p end.
+         *          Elements are visited in no particular order, \p fn is
+         *          called concurrently and must be thread safe.
+         *
+         *  \param  pool
+         *      The pool to run on.
+         *  \param  start
+         *      The start iterator to begin from.
+         *  \param  end
+         *      The end iterator to stop at.
+         *  \param  fn
+         *      The action to call. Must be invocable with Iterator::value_type.
+         */
+        template <
+            typename Iterator,
+            typename F,
+            typename T = typename std::iterator_traits<Iterator>::value_type,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED
+        static inline void for_each(utils::threading::ThreadPool& pool, Iterator start, Iterator end, F&& fn) {
+            static_assert(utils::traits::is_invocable_v<F, T>,
+                          "utils::algorithm::parallel::for_each: Callable function required.");
+
+            if constexpr (!internal::is_random_access_v<Iterator>) {
+                std::for_each(start, end, std::forward<F>(fn));
+            } else {
+                const auto part = internal::partition<T>(size_t(std::distance(start, end)), pool.size());
+
+                if (part.chunks <= 1) {
+                    std::for_each(start, end, std::forward<F>(fn));
+                    return;
+                }
+
+                internal::run_chunks(pool, part.chunks, [&](const size_t i) {
+                    std::for_each(start + std::ptrdiff_t(part.begin(i)),
+                                  start + std::ptrdiff_t(part.end(i)),
+                                  fn);
+                });
+            }
+        }
+
+        template <
+            typename Iterator,
+            typename F,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED
+        static inline void for_each(Iterator start, Iterator end, F&& fn) {
+            utils::algorithm::parallel::for_each(utils::algorithm::parallel::default_pool(),
+                                                 start, end, std::forward<F>(fn));
+        }
+
+        template <
+            typename Container,
+            typename F,
+            typename = typename std::enable_if_t<utils::traits::is_iterable_v<Container>>
+        > ATTR_MAYBE_UNUSED
+        static inline void for_each(utils::threading::ThreadPool& pool, Container& cont, F&& fn) {
+            utils::algorithm::parallel::for_each(pool, std::begin(cont), std::end(cont), std::forward<F>(fn));
+        }
+
+        template <
+            typename Container,
+            typename F,
+            typename = typename std::enable_if_t<utils::traits::is_iterable_v<Container>>
+        > ATTR_MAYBE_UNUSED
+        static inline void for_each(Container& cont, F&& fn) {
+            utils::algorithm::parallel::for_each(std::begin(cont), std::end(cont), std::forward<F>(fn));
+        }
+
+        namespace internal {
+            /**
+             *  \brief  Find the first element for which no other element
+             *          is `better(other, element)`, in parallel.
+             */
+            template <typename Iterator, typename Better>
+            static inline Iterator select_element(utils::threading::ThreadPool& pool,
+                                                  Iterator start, Iterator end, Better&& better)
+            {
+                using value_t = typename std::iterator_traits<Iterator>::value_type;
+
+                const auto select = [&](Iterator first, const Iterator last) {
+                    Iterator best = first;
+
+                    if (first != last) {
+                        for (++first; first != last; ++first) {
+                            if (better(*first, *best)) best = first;
+                        }
+                    }
+
+                    return best;
+                };
+
+                if constexpr (!internal::is_random_access_v<Iterator>) {
+                    return select(start, end);
+                } else {
+                    const auto part = internal::partition<value_t>(size_t(std::distance(start, end)), pool.size());
+
+                    if (part.chunks <= 1) {
+                        return select(start, end);
+                    }
+
+                    std::vector<Iterator> partial(part.chunks);
+
+                    internal::run_chunks(pool, part.chunks, [&](const size_t i) {
+                        partial[i] = select(start + std::ptrdiff_t(part.begin(i)),
+                                            start + std::ptrdiff_t(part.end(i)));
+                    });
+
+                    // Chunks are in order, so ties keep the first occurrence.
+                    Iterator best = partial.front();
+
+                    for (size_t i = 1; i < partial.size(); ++i) {
+                        if (better(*partial[i], *best)) best = partial[i];
+                    }
+
+                    return best;
+                }
+            }
+        }
+
+        /**
+         *  \brief  Parallel version of utils::algorithm::min_element.
+         *
+         *  \param  pool
+         *      The pool to run on.
+         *  \param  start
+         *      The start iterator to begin from.
+         *  \param  end
+         *      The end iterator to stop at.
+         *  \param  fn_compare
+         *      The compare function to call. Must be invocable with Iterator::value_type.
+         *  \return Returns an iterator to the (first) smallest element.
+         */
+        template <
+            typename Iterator,
+            typename T = typename std::iterator_traits<Iterator>::value_type,
+            typename F = typename std::less<T>,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline auto min_element(utils::threading::ThreadPool& pool, Iterator start, Iterator end, F&& fn_compare = F{}) {
+            static_assert(utils::traits::is_invocable_v<F, T, T>,
+                          "utils::algorithm::parallel::min_element: Callable function required.");
+            return internal::select_element(pool, start, end, [&](const T& a, const T& b) {
+                return fn_compare(a, b);
+            });
+        }
+
+        template <
+            typename Iterator,
+            typename T = typename std::iterator_traits<Iterator>::value_type,
+            typename F = typename std::less<T>,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline auto min_element(Iterator start, Iterator end, F&& fn_compare = F{}) {
+            return utils::algorithm::parallel::min_element(utils::algorithm::parallel::default_pool(),
+                                                           start, end, std::forward<F>(fn_compare));
+        }
+
+        template <
+            typename Container,
+            typename T = typename Container::value_type,
+            typename F = typename std::less<T>,
+            typename = typename std::enable_if_t<utils::traits::is_iterable_v<Container>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline auto min_element(utils::threading::ThreadPool& pool, const Container& cont, F&& fn_compare = F{}) {
+            return utils::algorithm::parallel::min_element(pool, std::begin(cont), std::end(cont),
+                                                           std::forward<F>(fn_compare));
+        }
+
+        template <
+            typename Container,
+            typename T = typename Container::value_type,
+            typename F = typename std::less<T>,
+            typename = typename std::enable_if_t<utils::traits::is_iterable_v<Container>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline auto min_element(const Container& cont, F&& fn_compare = F{}) {
+            return utils::algorithm::parallel::min_element(std::begin(cont), std::end(cont),
+                                                           std::forward<F>(fn_compare));
+        }
+
+        /**
+         *  \brief  Parallel version of utils::algorithm::max_element.
+         *
+         *  \param  pool
+         *      The pool to run on.
+         *  \param  start
+         *      The start iterator to begin from.
+         *  \param  end
+         *      The end iterator to stop at.
+         *  \param  fn_compare
+         *      The compare function to call. Must be invocable with Iterator::value_type.
+         *  \return Returns an iterator to the (first) largest element.
+         */
+        template <
+            typename Iterator,
+            typename T = typename std::iterator_traits<Iterator>::value_type,
+            typename F = typename std::less<T>,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline auto max_element(utils::threading::ThreadPool& pool, Iterator start, Iterator end, F&& fn_compare = F{}) {
+            static_assert(utils::traits::is_invocable_v<F, T, T>,
+                          "utils::algorithm::parallel::max_element: Callable function required.");
+            return internal::select_element(pool, start, end, [&](const T& a, const T& b) {
+                return fn_compare(b, a);
+            });
+        }
+
+        template <
+            typename Iterator,
+            typename T = typename std::iterator_traits<Iterator>::value_type,
+            typename F = typename std::less<T>,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline auto max_element(Iterator start, Iterator end, F&& fn_compare = F{}) {
+            return utils::algorithm::parallel::max_element(utils::algorithm::parallel::default_pool(),
+                                                           start, end, std::forward<F>(fn_compare));
+        }
+
+        template <
+            typename Container,
+            typename T = typename Container::value_type,
+            typename F = typename std::less<T>,
+            typename = typename std::enable_if_t<utils::traits::is_iterable_v<Container>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline auto max_element(utils::threading::ThreadPool& pool, const Container& cont, F&& fn_compare = F{}) {
+            return utils::algorithm::parallel::max_element(pool, std::begin(cont), std::end(cont),
+                                                           std::forward<F>(fn_compare));
+        }
+
+        template <
+            typename Container,
+            typename T = typename Container::value_type,
+            typename F = typename std::less<T>,
+            typename = typename std::enable_if_t<utils::traits::is_iterable_v<Container>>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline auto max_element(const Container& cont, F&& fn_compare = F{}) {
+            return utils::algorithm::parallel::max_element(std::begin(cont), std::end(cont),
+                                                           std::forward<F>(fn_compare));
+        }
+
+        /**
+         *  \brief  Parallel sort: sort every chunk with std::sort, then
+         *          merge neighbouring runs pairwise until one run remains.
+         *
+         *  \param  pool
+         *      The pool to run on.
+         *  \param  start
+         *      The start iterator to begin from.
+         *  \param  end
+         *      The end iterator to stop at.
+         *  \param  fn_compare
+         *      The compare function to call. Must be invocable with Iterator::value_type.
+         */
+        template <
+            typename Iterator,
+            typename T = typename std::iterator_traits<Iterator>::value_type,
+            typename F = typename std::less<T>,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED
+        static inline void sort(utils::threading::ThreadPool& pool, Iterator start, Iterator end, F&& fn_compare = F{}) {
+            static_assert(internal::is_random_access_v<Iterator>,
+                          "utils::algorithm::parallel::sort: Random access iterators required.");
+
+            const auto part = internal::partition<T>(size_t(std::distance(start, end)), pool.size());
+
+            if (part.chunks <= 1) {
+                std::sort(start, end, fn_compare);
+                return;
+            }
+
+            internal::run_chunks(pool, part.chunks, [&](const size_t i) {
+                std::sort(start + std::ptrdiff_t(part.begin(i)),
+                          start + std::ptrdiff_t(part.end(i)),
+                          fn_compare);
+            });
+
+            for (size_t width = part.chunk_size; width < part.length; width *= 2) {
+                const size_t merges = (part.length + 2 * width - 1) / (2 * width);
+
+                internal::run_chunks(pool, merges, [&](const size_t i) {
+                    const size_t lo  = i * 2 * width;
+                    const size_t mid = std::min(lo + width, part.length);
+                    const size_t hi  = std::min(lo + 2 * width, part.length);
+
+                    if (mid < hi) {
+                        std::inplace_merge(start + std::ptrdiff_t(lo),
+                                           start + std::ptrdiff_t(mid),
+                                           start + std::ptrdiff_t(hi),
+                                           fn_compare);
+                    }
+                });
+            }
+        }
+
+        template <
+            typename Iterator,
+            typename T = typename std::iterator_traits<Iterator>::value_type,
+            typename F = typename std::less<T>,
+            typename = typename std::enable_if_t<utils::traits::is_iterator_v<Iterator>>
+        > ATTR_MAYBE_UNUSED
+        static inline void sort(Iterator start, Iterator end, F&& fn_compare = F{}) {
+            utils::algorithm::parallel::sort(utils::algorithm::parallel::default_pool(),
+                                             start, end, std::forward<F>(fn_compare));
+        }
+
+        /**
+         *  \brief  Parallel histogram: count every chunk into its own
+         *          histogram, then add the histograms together.
+         *
+         *  \param  pool
+         *      The pool to run on.
+         *  \param  data
+         *      The values to count.
+         *  \param  length
+         *      The amount of values in \p data.
+         *  \return Returns the count for every value, with histogram_bins_v<T> entries.
+         */
+        template<
+            typename T,
+            typename = typename std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T> && (sizeof(T) <= 2)>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline std::vector<uint64_t> histogram(utils::threading::ThreadPool& pool, const T *data, const size_t length) {
+            // A chunk should be worth the tables it has to clear and merge
+            const auto part = internal::partition<T>(length, std::min(pool.size(), length / (16 * histogram_bins_v<T>)));
+
+            if (part.chunks <= 1) {
+                return utils::algorithm::histogram(data, length);
+            }
+
+            std::vector<std::vector<uint64_t>> partial(part.chunks);
+
+            internal::run_chunks(pool, part.chunks, [&](const size_t i) {
+                partial[i] = utils::algorithm::histogram(data + part.begin(i), part.end(i) - part.begin(i));
+            });
+
+            std::vector<uint64_t> counts(std::move(partial[0]));
+
+            for (size_t i = 1; i < part.chunks; i++) {
+                for (size_t bin = 0; bin < counts.size(); bin++) {
+                    counts[bin] += partial[i][bin];
+                }
+            }
+
+            return counts;
+        }
+
+        template<
+            typename T,
+            typename = typename std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T> && (sizeof(T) <= 2)>
+        > ATTR_MAYBE_UNUSED ATTR_NODISCARD
+        static inline std::vector<uint64_t> histogram(const T *data, const size_t length) {
+            return utils::algorithm::parallel::histogram(utils::algorithm::parallel::default_pool(), data, length);
+        }
+    }
+
     /**
      *  \brief  Enumerate wrapper for containers.
      *          Return an iterator that also holds an index, starting at \p start_t.
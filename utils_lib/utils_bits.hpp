@@ -7,6 +7,7 @@
 #include "utils_algorithm.hpp"
 
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <numeric>
 
@@ -18,10 +19,16 @@
     #define UTILS_BITS_CLZ_ULL  utils::bits::internal::_clz_template
     #define UTILS_BITS_FFS_LL   utils::bits::internal::_ffs_template
     #define UTILS_BITS_CNT_LL   utils::bits::internal::_cnt_template
+    #define UTILS_BITS_BSWAP64  _byteswap_uint64
 #else
     #define UTILS_BITS_CLZ_ULL  __builtin_clzll
     #define UTILS_BITS_FFS_LL   __builtin_ffsll
     #define UTILS_BITS_CNT_LL   __builtin_popcountll
+    #define UTILS_BITS_BSWAP64  __builtin_bswap64
+#endif
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    #define UTILS_BITS_BIG_ENDIAN 1
 #endif
 
 #define UTILS_BITS_ASSERT_SHIFT_SIGNED_SIZE 0
@@ -369,6 +376,45 @@ namespace utils::bits {
         return ((value >> n) & mask_right) | ((value & mask_data) << (bit_length - n));
     }
 
+    /**
+     *  \brief  Reverse the byte order of \p value.
+     */
+    ATTR_MAYBE_UNUSED ATTR_NODISCARD
+    static inline uint64_t byteswap(const uint64_t value) {
+        return UTILS_BITS_BSWAP64(value);
+    }
+
+    /**
+     *  \brief  Load 8 bytes from \p src as a big-endian value,
+     *          i.e. with `src[0]` in the most significant byte.
+     *          \p src does not need to be aligned.
+     */
+    ATTR_MAYBE_UNUSED ATTR_NODISCARD
+    static inline uint64_t load_be64(const uint8_t *src) {
+        uint64_t value;
+        std::memcpy(&value, src, sizeof(value));
+
+        #ifdef UTILS_BITS_BIG_ENDIAN
+            return value;
+        #else
+            return utils::bits::byteswap(value);
+        #endif
+    }
+
+    /**
+     *  \brief  Store \p value big-endian into 8 bytes at \p dst,
+     *          i.e. with the most significant byte in `dst[0]`.
+     *          \p dst does not need to be aligned.
+     */
+    ATTR_MAYBE_UNUSED
+    static inline void store_be64(uint8_t *dst, uint64_t value) {
+        #ifndef UTILS_BITS_BIG_ENDIAN
+            value = utils::bits::byteswap(value);
+        #endif
+
+        std::memcpy(dst, &value, sizeof(value));
+    }
+
     /**
      *  \brief  Determine if given value is a power of 2.
      *
@@ -590,4 +636,6 @@ namespace utils::bits {
 #undef UTILS_BITS_CLZ_ULL
 #undef UTILS_BITS_FFS_LL
 #undef UTILS_BITS_CNT_LL
+#undef UTILS_BITS_BSWAP64
+#undef UTILS_BITS_BIG_ENDIAN
 #endif // UTILS_BITS_HPP
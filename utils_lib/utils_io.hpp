@@ -13,6 +13,18 @@
 #include <vector>
 #include <chrono>
 #include <cstdio>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <system_error>
+
+#if !defined(UTILS_OS_WIN)
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
 
 // Ignore warnings
 HEDLEY_DIAGNOSTIC_PUSH
@@ -333,6 +345,259 @@ namespace utils::io {
     };
 #endif  // UTILS_IO_FS_SUPPORTED
 
+    /**
+     *  Bulk file I/O: whole files are moved with as few read()/write() calls as
+     *  possible, straight from or into the destination buffer, instead of going
+     *  through the formatted or per-character paths of the standard streams.
+     *
+     *  On POSIX systems this uses pread()/write() on a file descriptor, with
+     *  posix_fadvise() hints where available. Elsewhere it falls back to
+     *  unformatted std::fstream read() and write() calls.
+     */
+    namespace bulk {
+        /// The largest amount of bytes moved by a single call.
+        constexpr size_t CALL_SIZE = size_t(1) << 30;
+        /// The size of the bounce buffer for Hint::Direct reads.
+        constexpr size_t DIRECT_BLOCK_SIZE = size_t(1) << 20;
+        /// The alignment of the bounce buffer for Hint::Direct reads.
+        constexpr size_t DIRECT_ALIGNMENT = 4096;
+        /// The initial buffer size for files that do not report their size.
+        constexpr size_t PROBE_SIZE = 4096;
+
+        /**
+         *  \brief  How the file will be used, passed on to the OS where supported.
+         */
+        enum class Hint : uint8_t {
+            Sequential,  ///< The file is read front to back once (the default).
+            NoCache,     ///< Drop the file from the page cache when done.
+            Direct,      ///< Read with O_DIRECT through an aligned buffer, bypassing the page cache.
+                         ///< Writes are handled like NoCache.
+        };
+
+#if !defined(UTILS_OS_WIN)
+        namespace internal {
+            /**
+             *  \brief  A file descriptor that closes itself.
+             */
+            struct Descriptor {
+                int fd;
+
+                explicit Descriptor(int d) : fd(d) {}
+                Descriptor(const Descriptor&) = delete;
+                Descriptor& operator=(const Descriptor&) = delete;
+
+                ~Descriptor(void) {
+                    if (this->fd >= 0) {
+                        ::close(this->fd);
+                    }
+                }
+            };
+
+            /**
+             *  \brief  Open \p filename with \p flags, retrying without O_DIRECT
+             *          if the file system does not support it.
+             */
+            static inline int open(const std::string& filename, int flags, const bool direct) {
+                #ifdef O_CLOEXEC
+                    flags |= O_CLOEXEC;
+                #endif
+
+                #ifdef O_DIRECT
+                    if (direct) {
+                        const int fd = ::open(filename.c_str(), flags | O_DIRECT, 0666);
+                        if (fd >= 0 || errno != EINVAL) return fd;
+                    }
+                #else
+                    UNUSED(direct);
+                #endif
+
+                int fd;
+                while ((fd = ::open(filename.c_str(), flags, 0666)) < 0 && errno == EINTR);
+                return fd;
+            }
+
+            static inline void advise(ATTR_MAYBE_UNUSED const int fd, ATTR_MAYBE_UNUSED const int advice) {
+                #ifdef POSIX_FADV_SEQUENTIAL
+                    ::posix_fadvise(fd, 0, 0, advice);
+                #endif
+            }
+
+            /**
+             *  \brief  Read up to \p length bytes at \p offset, retrying when interrupted.
+             *  \return Returns the amount of bytes read, 0 at the end of the file or -1 on errors.
+             */
+            static inline ssize_t pread(const int fd, void *dst, const size_t length, const size_t offset) {
+                ssize_t n;
+                while ((n = ::pread(fd, dst, std::min(length, CALL_SIZE), off_t(offset))) < 0 && errno == EINTR);
+                return n;
+            }
+        }
+#endif
+
+        /**
+         *  \brief  Read the whole file into \p out, replacing its contents.
+         *
+         *          \p out is sized to the file up front and filled in place. Files that
+         *          report no size, like pipes or /proc entries, are read until the end.
+         *
+         *  \param  filename
+         *      The (path and) name of the file to read.
+         *  \param  out
+         *      A contiguous container of bytes, like std::string or std::vector<uint8_t>.
+         *  \param  hint
+         *      How the file will be used.
+         *
+         *  \exception  FileReadException
+         *      Throws FileReadException if the file could not be read properly.
+         */
+        template<typename Container> ATTR_MAYBE_UNUSED
+        static void read(const std::string& filename, Container& out, const Hint hint = Hint::Sequential) {
+            static_assert(sizeof(typename Container::value_type) == 1,
+                          "utils::io::bulk::read: The container must hold bytes.");
+
+#if !defined(UTILS_OS_WIN)
+            internal::Descriptor file(internal::open(filename, O_RDONLY, hint == Hint::Direct));
+            struct stat info;
+
+            if (HEDLEY_UNLIKELY(file.fd < 0 || ::fstat(file.fd, &info) != 0)) {
+                throw utils::exceptions::FileReadException(filename);
+            }
+
+            #ifdef POSIX_FADV_SEQUENTIAL
+                internal::advise(file.fd, POSIX_FADV_SEQUENTIAL);
+            #endif
+
+            // Only regular files have a size to trust, if it is not 0 (like /proc entries)
+            const bool sized  = S_ISREG(info.st_mode) && info.st_size > 0;
+            const bool direct = sized && hint == Hint::Direct;
+
+            std::unique_ptr<void, decltype(&std::free)> bounce(nullptr, &std::free);
+
+            if (direct) {
+                void *block = nullptr;
+
+                if (HEDLEY_UNLIKELY(::posix_memalign(&block, DIRECT_ALIGNMENT, DIRECT_BLOCK_SIZE) != 0)) {
+                    throw utils::exceptions::FileReadException(filename);
+                }
+
+                bounce.reset(block);
+            }
+
+            out.resize(sized ? size_t(info.st_size) : PROBE_SIZE);
+            size_t done = 0;
+
+            while (!sized || done < out.size()) {
+                if (done == out.size()) {
+                    out.resize(out.size() * 2u);
+                }
+
+                const size_t want = out.size() - done;
+                ssize_t n;
+
+                if (direct) {
+                    // Aligned offsets, since every read but the last is a whole block
+                    n = internal::pread(file.fd, bounce.get(), DIRECT_BLOCK_SIZE, done);
+
+                    if (n > 0) {
+                        n = ssize_t(std::min(size_t(n), want));
+                        std::memcpy(&out[done], bounce.get(), size_t(n));
+                    }
+                } else {
+                    n = internal::pread(file.fd, &out[done], want, done);
+                }
+
+                if (HEDLEY_UNLIKELY(n < 0)) {
+                    throw utils::exceptions::FileReadException(filename);
+                } else if (n == 0) {
+                    break;  // Shrunk, or the end of an unsized file
+                }
+
+                done += size_t(n);
+            }
+
+            out.resize(done);
+
+            #ifdef POSIX_FADV_DONTNEED
+                if (hint != Hint::Sequential) {
+                    internal::advise(file.fd, POSIX_FADV_DONTNEED);
+                }
+            #endif
+#else
+            UNUSED(hint);
+            std::ifstream file(filename, std::ifstream::binary | std::ifstream::ate);
+
+            if (HEDLEY_UNLIKELY(!file.good())) {
+                throw utils::exceptions::FileReadException(filename);
+            }
+
+            out.resize(size_t(file.tellg()));
+            file.seekg(0, std::ios::beg);
+
+            if (!out.empty() && HEDLEY_UNLIKELY(!file.read(reinterpret_cast<char*>(&out[0]), std::streamsize(out.size())))) {
+                throw utils::exceptions::FileReadException(filename);
+            }
+#endif
+        }
+
+        /**
+         *  \brief  Write \p length bytes from \p buffer to the given file,
+         *          replacing its contents.
+         *
+         *  \param  filename
+         *      The (path and) name of the file to write to (will be created if it does not exist).
+         *  \param  buffer
+         *      The bytes to write.
+         *  \param  length
+         *      The amount of bytes to write.
+         *  \param  hint
+         *      How the file will be used.
+         *
+         *  \exception  FileWriteException
+         *      Throws FileWriteException if the file could not be written properly.
+         */
+        ATTR_MAYBE_UNUSED
+        static void write(const std::string& filename, const void *buffer, size_t length,
+                          const Hint hint = Hint::Sequential)
+        {
+#if !defined(UTILS_OS_WIN)
+            internal::Descriptor file(internal::open(filename, O_WRONLY | O_CREAT | O_TRUNC, false));
+
+            if (HEDLEY_UNLIKELY(file.fd < 0)) {
+                throw utils::exceptions::FileWriteException(filename);
+            }
+
+            const char *src = static_cast<const char*>(buffer);
+
+            while (length > 0) {
+                const ssize_t n = ::write(file.fd, src, std::min(length, CALL_SIZE));
+
+                if (HEDLEY_UNLIKELY(n < 0)) {
+                    if (errno == EINTR) continue;
+                    throw utils::exceptions::FileWriteException(filename);
+                }
+
+                src    += n;
+                length -= size_t(n);
+            }
+
+            #ifdef POSIX_FADV_DONTNEED
+                if (hint != Hint::Sequential) {
+                    // Only clean pages can be dropped
+                    ::fdatasync(file.fd);
+                    internal::advise(file.fd, POSIX_FADV_DONTNEED);
+                }
+            #endif
+#else
+            UNUSED(hint);
+            std::ofstream file(filename, std::ofstream::binary);
+
+            if (HEDLEY_UNLIKELY(!file.write(static_cast<const char*>(buffer), std::streamsize(length)))) {
+                throw utils::exceptions::FileWriteException(filename);
+            }
+#endif
+        }
+    }
+
     /**	\brief	Read the given file and return a pointer to a string containing its contents.
      *
      *	\param	filename
@@ -346,41 +611,25 @@ namespace utils::io {
     ATTR_MAYBE_UNUSED ATTR_NODISCARD
     static auto file_to_string(const std::string& filename) {
         auto str = utils::memory::new_unique_var<std::string>();
-        std::ifstream file;
-
-        try {
-            file.open(filename, std::fstream::in | std::fstream::ate);
-
-            str->reserve(size_t(file.tellg()));
-            file.seekg(0, std::ios::beg);
-
-            str->assign(std::istreambuf_iterator<char>(file),
-                        std::istreambuf_iterator<char>());
-            file.close();
-        } catch (...) {
-            file.close();
-            throw utils::exceptions::FileReadException(filename);
-        }
-
+        utils::io::bulk::read(filename, *str);
         return str;
     }
 
     /**
-     *	\brief TODO comment and test
-     *	\param filename
-     *	\param str
+     *	\brief	Write the given string to the given file.
+     *
+     *	\param	filename
+     *		The (path and) name of the file to write to (will be created if it does not exist).
+     *	\param	str
+     *		The string to write to a file.
+     *		Nothing is written if the file cannot be opened, use bulk::write() to detect that.
      */
     ATTR_MAYBE_UNUSED
     static void string_to_file(const std::string& filename, const std::string_view str) {
-        std::ofstream file;
-
         try {
-            file.open(filename);
-            file << str;
-            file.close();
-        } catch (...) {
-            file.close();
-            throw utils::exceptions::FileWriteException(filename);
+            utils::io::bulk::write(filename, str.data(), str.size());
+        } catch (utils::exceptions::FileWriteException const&) {
+            // Like the stream it replaced, an unwritable file is skipped silently
         }
     }
 
@@ -399,27 +648,8 @@ namespace utils::io {
      */
     ATTR_MAYBE_UNUSED ATTR_NODISCARD
     static auto file_to_bytes(const std::string& filename) {
-        std::ifstream file(filename, std::ifstream::binary | std::ifstream::ate);
-
-        if (HEDLEY_UNLIKELY(!file.good())) {
-            file.close();
-            throw utils::exceptions::FileReadException(filename);
-        }
-
         auto v_buff = utils::memory::new_unique_var<std::vector<uint8_t>>();
-
-        try {
-            // Filepointer is already at end due to ::ate option, so tellg() gives filesize
-            v_buff->reserve(size_t(file.tellg()));
-            file.seekg(0, std::ios::beg);
-            v_buff->assign(std::istreambuf_iterator<char>(file),
-                           std::istreambuf_iterator<char>());
-        } catch (...) {
-            file.close();
-            throw utils::exceptions::FileReadException(filename);
-        }
-
-        file.close();
+        utils::io::bulk::read(filename, *v_buff);
         return v_buff;
     }
 
@@ -432,24 +662,80 @@ namespace utils::io {
      *		The char buffer to write to a file.
      *	\param	length
      *		The length of the given char buffer.
-     *
-     *	\exception	FileWriteException
-     *		Throws FileWriteException if the file could not be written properly.
+     *		Nothing is written if the file cannot be opened, use bulk::write() to detect that.
      */
     ATTR_MAYBE_UNUSED
     static void bytes_to_file(const std::string& filename, const uint8_t* buffer, size_t length) {
-        std::ofstream file(filename, std::ofstream::binary);
-
         try {
-            file.write(reinterpret_cast<const char*>(buffer), std::streamsize(length));
-        } catch (...) {
-            file.close();
-            throw utils::exceptions::FileWriteException(filename);
+            utils::io::bulk::write(filename, buffer, length);
+        } catch (utils::exceptions::FileWriteException const&) {
+            // Like the stream it replaced, an unwritable file is skipped silently
         }
-
-        file.close();
     }
 
+    /**
+     *  \brief  A read-only memory mapping of a whole file.
+     *
+     *          The contents are paged in by the OS on first access instead of
+     *          being copied to the heap, so large files open in constant time.
+     *          Views and pointers into the mapping are valid as long as it lives.
+     */
+    class MappedFile {
+        private:
+            mio::ummap_source source;
+
+        public:
+            /**
+             *  \brief  Map the given file.
+             *
+             *  \param  filename
+             *      The (path and) name of the file to map.
+             *
+             *  \exception  FileReadException
+             *      Throws FileReadException if the file could not be mapped.
+             */
+            explicit MappedFile(const std::string& filename) {
+                std::error_code error;
+                this->source.map(filename, error);
+
+                if (HEDLEY_UNLIKELY(error)) {
+                    // An empty file cannot be mapped, but can be read just fine
+                    std::ifstream file(filename, std::ifstream::binary | std::ifstream::ate);
+
+                    if (!file.good() || file.tellg() != 0) {
+                        throw utils::exceptions::FileReadException(filename);
+                    }
+                }
+            }
+
+            inline const uint8_t* data(void) const {
+                return this->source.data();
+            }
+
+            inline size_t size(void) const {
+                return this->source.size();
+            }
+
+            inline bool empty(void) const {
+                return this->source.empty();
+            }
+
+            inline const uint8_t* begin(void) const {
+                return this->data();
+            }
+
+            inline const uint8_t* end(void) const {
+                return this->data() + this->size();
+            }
+
+            /**
+             *  \brief  Return the contents as characters, without copying.
+             */
+            inline std::string_view view(void) const {
+                return std::string_view(reinterpret_cast<const char*>(this->data()), this->size());
+            }
+    };
+
     ////////////////////////////////////////////////////////////////////////////
 
     class BitStream {
@@ -545,8 +831,115 @@ namespace utils::io {
 
     /**
      * Class which eases reading bitwise from a buffer.
+     *
+     * Reads are served from a 64-bit cache of the bits at the current position,
+     * refilled with a single unaligned big-endian load (or byte-wise near the end
+     * of the buffer), so get(), peek() and skip() of up to MAX_BITS bits take
+     * constant work. Bits past the end of the buffer read as zero.
+     *
+     * The cache is refilled whenever the position was changed from outside the
+     * reader, but not when the underlying buffer is modified in place.
      */
     class BitStreamReader : public BitStream {
+        public:
+            /// The maximum amount of bits for a single peek() or skip().
+            static constexpr uint_fast32_t MAX_BITS = 57;
+
+        private:
+            std::shared_ptr<const MappedFile> mapping;  ///< Keeps a shared mapping alive, if any
+
+            uint64_t      cache      = 0;  ///< Bits from cache_pos onwards, MSB first
+            size_t        cache_pos  = 0;  ///< Bit position of the MSB of cache
+            uint_fast32_t cache_bits = 0;  ///< Amount of valid bits in cache, at most 63
+
+            /**
+             *  \brief  Reload the cache from the current position.
+             *          Afterwards at least MAX_BITS bits are available,
+             *          unless less remain in the buffer.
+             */
+            HEDLEY_NEVER_INLINE
+            void refill(void) {
+                const size_t        byte   = this->position / 8u;
+                const uint_fast32_t offset = this->position % 8u;
+
+                if (HEDLEY_LIKELY(byte + 8u <= this->size)) {
+                    this->cache = utils::bits::load_be64(this->buffer + byte);
+                } else {
+                    // Tail: pad the bytes past the end with zeroes.
+                    this->cache = 0;
+
+                    for (size_t i = 0; i < 8u && byte + i < this->size; i++) {
+                        this->cache |= uint64_t(this->buffer[byte + i]) << (56u - 8u * i);
+                    }
+                }
+
+                const size_t end = this->get_size_bits();
+
+                this->cache    <<= offset;
+                this->cache_pos  = this->position;
+                this->cache_bits = uint_fast32_t(std::min<size_t>(63u - offset,
+                                                                  end - std::min(end, this->position)));
+            }
+
+            /**
+             *  \brief  Whether the n bits at the current position are in the cache.
+             *          The cache is not consumed, only the position moves on
+             *          until it runs out of the cached bits.
+             */
+            inline bool is_cached(const uint_fast32_t n) const {
+                const size_t rel = this->position - this->cache_pos;  // Wraps if moved back
+                return rel < 64u && rel + n <= this->cache_bits;
+            }
+
+            inline uint64_t top(const uint_fast32_t n) const {
+                // Two shifts to allow n == 0 without a branch.
+                return ((this->cache << (this->position - this->cache_pos)) >> 1u) >> (63u - n);
+            }
+
+            inline void consume(const uint_fast32_t n) {
+                this->position += n;
+            }
+
+            /**
+             *  \brief  Skip n bits that are not in the cache,
+             *          stopping at the end of the buffer.
+             */
+            HEDLEY_NEVER_INLINE
+            void skip_slow(const size_t n) {
+                const size_t end = this->get_size_bits();
+
+                this->position = std::max(this->position, std::min(this->position + n, end));
+            }
+
+            HEDLEY_NEVER_INLINE
+            uint64_t take_slow(const uint_fast32_t n) {
+                this->refill();
+                const uint64_t value = this->top(n);
+
+                if (n <= this->cache_bits) {
+                    this->consume(n);
+                } else {
+                    this->skip_slow(n);
+                }
+
+                return value;
+            }
+
+            /**
+             *  \brief  Read and consume n <= MAX_BITS bits.
+             */
+            inline uint64_t take(const uint_fast32_t n) {
+                ASSERT(n <= BitStreamReader::MAX_BITS);
+
+                if (HEDLEY_UNLIKELY(!this->is_cached(n))) {
+                    return this->take_slow(n);
+                }
+
+                const uint64_t value = this->top(n);
+                this->consume(n);
+                return value;
+            }
+
         public:
             /**
              * Create a bitstreamreader which reads from the provided buffer.
@@ -560,6 +953,28 @@ namespace utils::io {
                 // Empty
             }
 
+            /**
+             * Create a bitstreamreader which borrows the contents of a mapped file, without copying.
+             *
+             * @param [in] file The mapping to read from, which must outlive the reader.
+             */
+            explicit BitStreamReader(const MappedFile& file)
+                : BitStream(const_cast<uint8_t*>(file.data()), file.size(), 0, false)
+            {
+                // Empty
+            }
+
+            /**
+             * Create a bitstreamreader which shares ownership of a mapped file, without copying.
+             *
+             * @param [in] file The mapping to read from, kept alive by the reader.
+             */
+            explicit BitStreamReader(std::shared_ptr<const MappedFile> file)
+                : BitStreamReader(*file)
+            {
+                this->mapping = std::move(file);
+            }
+
             template <
                 typename Iterator,
                 typename = typename std::enable_if_t<
@@ -585,71 +1000,203 @@ namespace utils::io {
 
             ~BitStreamReader() {}
 
+            /**
+             * Look at the next n bits without advancing the position.
+             *
+             * @param [in] n number of bits to read, at most MAX_BITS
+             * @return The value of the bits, the first bit as MSB
+             */
+            inline uint64_t peek(uint_fast32_t n) {
+                ASSERT(n <= BitStreamReader::MAX_BITS);
+
+                if (HEDLEY_UNLIKELY(!this->is_cached(n))) {
+                    this->refill();
+                }
+
+                return this->top(n);
+            }
+
+            /**
+             * Advance the position by n bits, but not past the end of the buffer.
+             *
+             * @param [in] n number of bits to skip
+             */
+            inline void skip(size_t n) {
+                if (HEDLEY_LIKELY(n <= BitStreamReader::MAX_BITS && this->is_cached(uint_fast32_t(n)))) {
+                    this->consume(uint_fast32_t(n));
+                } else {
+                    this->skip_slow(n);
+                }
+            }
+
             /**
              * Read one bit from the bitstream.
              *
              * @return The value of the bit.
              */
-            uint8_t get_bit(void) {
-                const size_t current_start_byte = this->position / 8u;
+            inline uint8_t get_bit(void) {
+                const size_t rel = this->position - this->cache_pos;
 
-                if (HEDLEY_UNLIKELY(current_start_byte >= this->get_size())) {
-                    // Prevent reading byte outside of array (-> Valgrind flagged)
-                    return 0u;
+                if (HEDLEY_UNLIKELY(rel >= this->cache_bits)) {
+                    return uint8_t(this->take_slow(1));
                 }
 
-                const uint_fast32_t bits_taken = this->position % 8;
-                const uint8_t value = this->buffer[current_start_byte];
-
                 this->position++;
-
-                return utils::bits::select_one<uint8_t>(value, 8 - bits_taken);
+                return uint8_t((this->cache << rel) >> 63u);
             }
 
             /**
              * Get l bits from the bitstream
              *
              * @param [in] l number of bits to read
-             * @return The value of the bits read
+             * @return The value of the bits read (the last 32 if l > 32)
              *
              * buffer: 0101 1100, position==0
              * get(4) returns value 5, position==4
              */
-            uint32_t get(uint_fast32_t l) {
-                uint32_t value = 0;
-
-                while (l--) {
-                    value <<= 1;
-                    value |= this->get_bit() & 1;
+            inline uint32_t get(uint_fast32_t l) {
+                if (HEDLEY_UNLIKELY(l > 32u)) {
+                    this->skip(l - 32u);
+                    l = 32u;
                 }
 
-                return value;
+                return uint32_t(this->take(l));
+            }
+
+            /**
+             * Get up to MAX_BITS bits from the bitstream.
+             *
+             * @param [in] n number of bits to read
+             * @return The value of the bits read
+             */
+            inline uint64_t get64(uint_fast32_t n) {
+                return this->take(n);
             }
 
             /**
-             * @brief from_file
-             * @param filename
-             * @return
+             * @brief Create a bitstreamreader over a memory mapping of the given file.
+             *        Nothing is copied, the reader keeps the mapping alive.
+             * @param filename The (path and) name of the file to read.
+             * @return Returns a new reader over the file.
+             * @exception FileReadException if the file could not be mapped.
              */
             static auto from_file(const std::string& filename) {
-                utils::memory::unique_t<BitStreamReader> reader;
-
-                try {
-                    auto invec = utils::io::file_to_bytes(filename);
-                    reader.reset(utils::memory::new_var<BitStreamReader>(*invec));
-                } catch (utils::exceptions::FileReadException const& e) {
-                    reader.reset(nullptr);
-                    throw e;
-                }
-
-                return reader;
+                auto file = std::make_shared<const MappedFile>(filename);
+                return utils::memory::unique_t<BitStreamReader>(utils::memory::new_var<BitStreamReader>(std::move(file)));
             }
     };
 
     /**
      * Class which eases writing bitwise into a buffer.
+     *
+     * Bits are gathered in a 64-bit accumulator and stored a whole word at a
+     * time. Pending bits are written out to the buffer by get_buffer(), and
+     * the position may be moved freely in between writes.
+     *
+     * A managed buffer grows by at least 50% when a write does not fit, an
+     * unmanaged buffer throws instead. put_unchecked() skips both the capacity
+     * and position checks, for callers that reserve() the space up front.
      */
     class BitStreamWriter : public BitStream {
+        public:
+            /// The maximum amount of bits for a single put().
+            static constexpr uint_fast32_t MAX_BITS = 64;
+
+        private:
+            uint64_t      acc      = 0;  ///< Pending bits from acc_pos onwards, MSB first
+            size_t        acc_pos  = 0;  ///< Bit position of the MSB of acc, byte aligned
+            uint_fast32_t acc_bits = 0;  ///< Amount of pending bits in acc, less than 64
+
+            inline bool is_synced(void) const {
+                return this->position == this->acc_pos + this->acc_bits;
+            }
+
+            HEDLEY_NEVER_INLINE
+            void grow(const size_t bytes) {
+                if (HEDLEY_UNLIKELY(!this->managed)) {
+                    throw utils::exceptions::Exception("BitStreamWriter",
+                                                       "Write past the end of an unmanaged buffer.");
+                }
+
+                this->resize(std::max(bytes, this->size + this->size / 2u));
+            }
+
+            /**
+             *  \brief  Write the pending bits to the buffer, keeping the unwritten
+             *          bits of the last byte. The bits stay pending.
+             */
+            void commit(void) {
+                if (this->acc_bits == 0) {
+                    return;
+                }
+
+                const size_t byte  = this->acc_pos / 8u;
+                const size_t bytes = (this->acc_bits + 7u) / 8u;
+                this->reserve(byte + bytes);
+
+                uint8_t word[8];
+                utils::bits::store_be64(word, this->acc);
+                std::copy_n(word, bytes - 1u, this->buffer + byte);
+
+                const uint8_t keep = uint8_t(0xFFu >> (this->acc_bits - 8u * (bytes - 1u)));
+                uint8_t& last = this->buffer[byte + bytes - 1u];
+                last = uint8_t((last & keep) | word[bytes - 1u]);
+            }
+
+            /**
+             *  \brief  Move the accumulator to a position set from outside,
+             *          picking up the bits before it in the same byte.
+             */
+            HEDLEY_NEVER_INLINE
+            void resync(void) {
+                const size_t target = this->position;
+                this->commit();
+
+                this->acc_pos  = target - target % 8u;
+                this->acc_bits = uint_fast32_t(target % 8u);
+                this->acc      = 0;
+
+                if (this->acc_bits && this->acc_pos / 8u < this->size) {
+                    const uint8_t prefix = this->buffer[this->acc_pos / 8u] & BitStream::bitmasks[this->acc_bits];
+                    this->acc = uint64_t(prefix) << 56u;
+                }
+            }
+
+            template<bool checked>
+            inline void put_bits(const uint_fast32_t length, uint64_t value) {
+                ASSERT(length <= BitStreamWriter::MAX_BITS);
+
+                if constexpr (checked) {
+                    if (HEDLEY_UNLIKELY(!this->is_synced())) {
+                        this->resync();
+                    }
+
+                    this->reserve((this->position + length + 7u) / 8u);
+                }
+
+                value &= utils::bits::mask_lsb<uint64_t>(length);
+
+                const uint_fast32_t free = 64u - this->acc_bits;
+
+                if (HEDLEY_LIKELY(length < free)) {
+                    // Two shifts to allow a shift by 64 when empty.
+                    this->acc      |= (value << (free - length - 1u)) << 1u;
+                    this->acc_bits += length;
+                } else {
+                    const uint_fast32_t rest = length - free;
+                    this->acc |= value >> rest;
+
+                    // All 64 bits are written, so this fits if the position does.
+                    utils::bits::store_be64(this->buffer + this->acc_pos / 8u, this->acc);
+
+                    this->acc       = (value << (63u - rest)) << 1u;
+                    this->acc_bits  = rest;
+                    this->acc_pos  += 64u;
+                }
+
+                this->position += length;
+            }
+
         public:
             /**
              * Create a bitstreamwriter which writes into the provided buffer.
@@ -676,34 +1223,62 @@ namespace utils::io {
 
             ~BitStreamWriter() {}
 
+            /**
+             * Get the buffer, with all bits written so far.
+             *
+             * This writes the pending bits out first, so there is no const
+             * overload: reading the buffer changes the writer.
+             */
+            inline uint8_t* get_buffer(void) {
+                this->commit();
+                return this->buffer;
+            }
+
+            inline uint8_t operator[](size_t idx) {
+                return this->get_buffer()[idx];
+            }
+
+            /**
+             * Make sure the buffer holds at least the given amount of bytes,
+             * growing a managed buffer by at least 50%.
+             *
+             * @param [in] bytes The required size in bytes.
+             */
+            inline void reserve(const size_t bytes) {
+                if (HEDLEY_UNLIKELY(bytes > this->size)) {
+                    this->grow(bytes);
+                }
+            }
+
             /**
              * Write one bit into the bitstream.
              * @param [in] value The value to put into the bitstream.
              */
-            void put_bit(uint8_t value) {
-                const size_t current_start_byte = this->position / 8u;
-                const uint_fast32_t bits_taken  = this->position % 8;
-
-                utils::bits::set_one(this->buffer[current_start_byte],
-                                     value,
-                                     8 - bits_taken);
-                this->position++;
+            inline void put_bit(uint8_t value) {
+                this->put_bits<true>(1u, value & 1u);
             }
 
             /**
              * Put 'length' bits with value 'value' into the bitstream
              *
-             * @param [in] length Number of bits to use for storing the value
+             * @param [in] length Number of bits to use for storing the value, at most MAX_BITS
              * @param [in] value The value to store
              *
              * buffer: xxxx xxxx, position==0
              * put(4, 5)
              * buffer: 1010 xxxx, position==4
              */
-            void put(uint_fast32_t length, uint_fast32_t value) {
-                while (length) {
-                    this->put_bit(uint8_t(utils::bits::select_one(value, length--)));
-                }
+            inline void put(uint_fast32_t length, uint64_t value) {
+                this->put_bits<true>(length, value);
+            }
+
+            /**
+             * Like put(), but the caller guarantees that the buffer has room
+             * for the bits (see reserve()) and that the position was not set
+             * since the previous put.
+             */
+            inline void put_unchecked(uint_fast32_t length, uint64_t value) {
+                this->put_bits<false>(length, value);
             }
 
             /**
@@ -711,9 +1286,9 @@ namespace utils::io {
              */
             void flush(void) {
                 // Only keep written bits in current byte, make rest 0
-                this->buffer[this->position / 8] &= BitStream::bitmasks[this->position % 8];
-
-                BitStream::flush();
+                if (this->position % 8u) {
+                    this->put(8u - this->position % 8u, 0u);
+                }
             }
 
             void write_to_file(const std::string &filename) {
@@ -12,7 +12,16 @@
 #include <iostream>
 #include <ostream>
 #include <fstream>
+#include <sstream>
 #include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+#include <new>
 
 
 #ifdef LOG_ERROR_TRACE
@@ -51,7 +60,83 @@ namespace utils {
                 LOG_DEBUG     = 7  // Debug         - Info useful to developers for debugging the application, not useful during operations.
             };
 
+            /**
+             *  \brief  What a producer does when the async ring is full.
+             */
+            enum class OverflowPolicy {
+                Block,      ///< Wait for the writer thread to make room.
+                Drop,       ///< Discard the new record.
+                DropOldest  ///< Discard the oldest queued record to make room.
+            };
+
         private:
+            static inline constexpr size_t ASYNC_BATCH   = 256;
+            static inline constexpr size_t DEFERRED_SIZE = 64;
+
+            /**
+             *  \brief  An entry in the async ring.
+             *
+             *          Either `text` holds the final text, or `render` is set
+             *          and `text` holds a copy of the format string (plus any
+             *          string arguments), while the raw arguments are packed
+             *          in `args`. The writer thread then does the formatting.
+             *          The text buffer keeps its capacity between uses.
+             */
+            struct Record {
+                enum class Kind : uint8_t { Text, Command, Message };
+
+                Kind                 kind      = Kind::Text;
+                Logger::Level        level     = Logger::Level::LOG_EMERGENCY;
+                bool                 timestamp = false;
+                std::time_t          time      = 0;
+                utils::os::command_t cmd       = utils::os::Console::RESET;
+                std::string_view     header;
+                std::string          text;
+                void (*render)(std::string&, const Record&) = nullptr;
+                alignas(std::max_align_t) unsigned char args[Logger::DEFERRED_SIZE];
+            };
+
+            /**
+             *  \brief  A string argument copied into Record::text.
+             */
+            struct DeferredString {
+                uint32_t offset;
+            };
+
+            template<class T>
+            static inline constexpr bool is_deferred_string_v =
+                   std::is_pointer_v<std::decay_t<T>>
+                && (   std::is_same_v<std::remove_const_t<std::remove_pointer_t<std::decay_t<T>>>, char>
+                    || std::is_same_v<std::remove_const_t<std::remove_pointer_t<std::decay_t<T>>>, signed char>
+                    || std::is_same_v<std::remove_const_t<std::remove_pointer_t<std::decay_t<T>>>, unsigned char>);
+
+            /**
+             *  \brief  Only void pointers (for `%p`) are stored as is, any
+             *          other pointer may be dereferenced by the format.
+             */
+            template<class T>
+            static inline constexpr bool is_deferred_pointer_v =
+                   std::is_pointer_v<std::decay_t<T>>
+                && std::is_void_v<std::remove_pointer_t<std::decay_t<T>>>;
+
+            template<class T>
+            using deferred_t = std::conditional_t<Logger::is_deferred_string_v<T>,
+                                                  DeferredString,
+                                                  std::decay_t<T>>;
+
+            /**
+             *  \brief  Whether the given printf arguments can be packed
+             *          into a Record and formatted later.
+             */
+            template<class ...Type>
+            static inline constexpr bool can_defer_v =
+                   ((   std::is_arithmetic_v<std::decay_t<Type>>
+                     || std::is_enum_v<std::decay_t<Type>>
+                     || Logger::is_deferred_pointer_v<Type>
+                     || Logger::is_deferred_string_v<Type>) && ...)
+                && sizeof(std::tuple<deferred_t<Type>...>) <= Logger::DEFERRED_SIZE
+                && alignof(std::tuple<deferred_t<Type>...>) <= alignof(std::max_align_t);
+
             bool screen_enabled;
             bool screen_paused;
             bool file_enabled;
@@ -67,6 +152,22 @@ namespace utils {
             std::mutex file_mutex;
             std::mutex screen_mutex;
 
+            utils::time::TimestampCache file_stamp;  ///< Guarded by file_mutex.
+
+            std::unique_ptr<utils::threading::RingBuffer<Record>> async_queue;
+            std::thread             async_writer;
+            Logger::OverflowPolicy  async_policy;
+            std::atomic<bool>       async_enabled;
+            std::atomic<bool>       async_stop;
+            std::atomic<bool>       async_sleeping;
+            std::atomic<size_t>     async_completed;
+            std::atomic<size_t>     async_dropped;
+            std::mutex              async_mutex;
+            std::condition_variable async_condition;
+            std::condition_variable flush_condition;
+            std::ostringstream      async_commands;
+            std::string             async_format;
+
             static /*inline*/ Logger& get() {
                 static Logger instance;
                 return instance;
@@ -98,7 +199,7 @@ namespace utils {
                 if (HEDLEY_LIKELY(this->canLogFile())) {
                     try {
                         if (HEDLEY_LIKELY(this->IsFileTimestampEnabled())) {
-                            this->log_file << utils::time::Timestamp("[%Y-%m-%d %H:%M:%S] ");
+                            this->log_file << this->file_stamp.render(std::time(nullptr));
                         }
 
                         this->log_file << text;
@@ -109,6 +210,260 @@ namespace utils {
                 }
             }
 
+            inline void async_wake(void) {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                if (this->async_sleeping.load()) {
+                    { LOCK_BLOCK(this->async_mutex); }
+                    this->async_condition.notify_one();
+                }
+            }
+
+            /**
+             *  \brief  Claim a ring slot and fill it with \p fill,
+             *          applying the overflow policy when the ring is full.
+             *
+             *          The slot is claimed before \p fill runs, so it must always
+             *          be published. If \p fill throws (e.g. std::bad_alloc while
+             *          copying the text), the slot is published as an empty
+             *          record and counted as dropped.
+             */
+            template<class F>
+            void async_push(F&& fill) {
+                auto& queue = *this->async_queue;
+
+                const auto safe_fill = [&](Record& r) noexcept {
+                    try {
+                        fill(r);
+                    } catch (...) {
+                        r.kind      = Record::Kind::Text;
+                        r.timestamp = false;
+                        r.render    = nullptr;
+                        r.text.clear();
+                        this->async_dropped++;
+                    }
+                };
+
+                while (HEDLEY_UNLIKELY(!queue.try_push_with(safe_fill))) {
+                    switch (this->async_policy) {
+                        case Logger::OverflowPolicy::Drop:
+                            this->async_dropped++;
+                            return;
+                        case Logger::OverflowPolicy::DropOldest:
+                            if (queue.try_pop_with([](Record&) {})) {
+                                this->async_dropped++;
+                            }
+                            break;
+                        case Logger::OverflowPolicy::Block:
+                        default:
+                            this->async_wake();
+                            std::this_thread::yield();
+                            break;
+                    }
+                }
+
+                this->async_wake();
+            }
+
+            template<class T>
+            static inline deferred_t<T> defer_arg(std::string& text, const T& arg) {
+                if constexpr (Logger::is_deferred_string_v<T>) {
+                    using Char = std::remove_const_t<std::remove_pointer_t<std::decay_t<T>>>;
+                    const Char *chars = arg;
+                    const char *str   = reinterpret_cast<const char*>(chars);
+
+                    if constexpr (!std::is_array_v<T>) {
+                        if (str == nullptr) str = "(null)";
+                    }
+
+                    const DeferredString ref{ uint32_t(text.size()) };
+                    text.append(str, std::strlen(str) + 1);
+                    return ref;
+                } else {
+                    return arg;
+                }
+            }
+
+            template<class T>
+            static inline auto undefer_arg(const char *base, const T& arg) {
+                if constexpr (std::is_same_v<T, DeferredString>) {
+                    return base + arg.offset;
+                } else {
+                    return arg;
+                }
+            }
+
+            /**
+             *  \brief  Writer side of deferred formatting: unpack the
+             *          arguments of \p record and format them into \p out.
+             */
+            template<class ...Stored>
+            static void render_deferred(std::string& out, const Record& record) {
+                using Packed = std::tuple<Stored...>;
+                const auto& packed = *std::launder(reinterpret_cast<const Packed*>(record.args));
+                const char *base   = record.text.data();
+
+                std::apply([&](const Stored& ...args) {
+                    out.resize(out.capacity());
+                    const int size = std::snprintf(out.data(), out.size() + 1, base,
+                                                   Logger::undefer_arg(base, args)...);
+
+                    if (HEDLEY_UNLIKELY(size < 0)) {
+                        out.clear();
+                        return;
+                    }
+
+                    if (size_t(size) > out.size()) {
+                        out.resize(size_t(size));
+                        std::snprintf(out.data(), out.size() + 1, base,
+                                      Logger::undefer_arg(base, args)...);
+                    }
+
+                    out.resize(size_t(size));
+                }, packed);
+            }
+
+            /**
+             *  \brief  Fill the text of \p record with \p format and \p args.
+             *
+             *          If the arguments can be deferred, only the format (and
+             *          string arguments) are copied into the reused text buffer
+             *          and the raw arguments are packed; formatting happens on
+             *          the writer thread. Otherwise the text is formatted here.
+             */
+            template<class ...Type>
+            static void async_fill(Record& record, const std::string_view format, const Type& ...args) {
+                if constexpr (sizeof...(Type) == 0) {
+                    record.render = nullptr;
+                    record.text.assign(format);
+                } else if constexpr (Logger::can_defer_v<Type...>) {
+                    using Packed = std::tuple<deferred_t<Type>...>;
+
+                    record.text.assign(format);
+                    record.text.push_back('\0');
+                    ::new (static_cast<void*>(record.args)) Packed{ Logger::defer_arg(record.text, args)... };
+                    record.render = &Logger::render_deferred<deferred_t<Type>...>;
+                } else {
+                    record.render = nullptr;
+                    record.text   = utils::string::format(format, args...);
+                }
+            }
+
+            inline std::string_view async_text(const Record& record) {
+                if (record.render != nullptr) {
+                    record.render(this->async_format, record);
+                    return this->async_format;
+                }
+
+                return record.text;
+            }
+
+            inline void async_command(const utils::os::command_t cmd) {
+                this->async_commands.str("");
+                utils::os::Command(cmd, this->async_commands);
+                this->screen_output << this->async_commands.str();
+            }
+
+            /**
+             *  \brief  Write a single record from the writer thread.
+             *          Requires both screen_mutex and file_mutex to be held.
+             */
+            void async_write(const Record& record) {
+                const bool to_screen = this->canLogScreen(record.level);
+                const bool to_file   = this->canLogFile(record.level);
+
+                if (record.kind == Record::Kind::Command) {
+                    if (to_screen) this->async_command(record.cmd);
+                    return;
+                }
+
+                if (!to_screen && !to_file) return;
+
+                const std::string_view text = this->async_text(record);
+
+                switch (record.kind) {
+                    case Record::Kind::Command:
+                        break;
+                    case Record::Kind::Text:
+                        if (to_screen) this->screen_output << text;
+                        break;
+                    case Record::Kind::Message:
+                        if (to_screen) {
+                            this->async_command(  utils::os::Console::FG
+                                                | utils::os::Console::BOLD
+                                                | record.cmd);
+                            this->screen_output << '[' << record.header << ']';
+                            this->async_command(  utils::os::Console::RESET
+                                                | utils::os::Console::WHITE);
+                            this->screen_output << ' ' << text << utils::Logger::CRLF;
+                            this->async_command(utils::os::Console::RESET);
+                        }
+                        break;
+                }
+
+                if (to_file) {
+                    try {
+                        if (record.timestamp) {
+                            this->log_file << this->file_stamp.render(record.time);
+                        }
+
+                        if (record.kind == Record::Kind::Message) {
+                            this->log_file << '[' << record.header << "] " << text << utils::Logger::CRLF;
+                        } else {
+                            this->log_file << text;
+                        }
+                    } catch (std::exception const& e) {
+                        std::cerr << "[Logger][ERROR] " << e.what() << '\n';
+                        this->log_file.close();
+                        this->file_enabled = false;
+                    }
+                }
+            }
+
+            /**
+             *  \brief  Writer thread: drain the ring in batches, flushing
+             *          the streams once per batch, and sleep when it is empty.
+             */
+            void async_run(void) {
+                auto& queue = *this->async_queue;
+
+                for (;;) {
+                    size_t batch = 0;
+
+                    {
+                        LOCK_BLOCK(this->screen_mutex);
+                        LOCK_BLOCK(this->file_mutex);
+
+                        while (batch < Logger::ASYNC_BATCH
+                            && queue.try_pop_with([this](Record& r) { this->async_write(r); }))
+                        {
+                            batch++;
+                        }
+
+                        if (batch > 0) {
+                            this->screen_output.flush();
+                            if (this->file_enabled) this->log_file.flush();
+                        }
+                    }
+
+                    LOCK_UNIQUE_BLOCK(this->async_mutex);
+                    this->async_completed = queue.popped();
+                    this->flush_condition.notify_all();
+
+                    if (batch > 0) continue;
+
+                    this->async_sleeping = true;
+                    this->async_condition.wait(__lock, [&] {
+                        return this->async_stop
+                            || !queue.empty()
+                            || this->async_completed != queue.popped();
+                    });
+                    this->async_sleeping = false;
+
+                    if (this->async_stop && queue.empty()) break;
+                }
+            }
+
             template<typename ...Type>
             void hdr_colour_format(const Logger::Level level,
                                    const utils::os::command_t hdr_colour,
@@ -116,6 +471,24 @@ namespace utils {
                                    const std::string_view format,
                                    const Type& ...args)
             {
+                if (this->async_enabled) {
+                    if (HEDLEY_LIKELY(this->canLog(level))) {
+                        const std::time_t now = std::time(nullptr);
+
+                        this->async_push([&](Record& r) {
+                            r.kind      = Record::Kind::Message;
+                            r.level     = level;
+                            r.timestamp = true;
+                            r.time      = now;
+                            r.cmd       = hdr_colour;
+                            r.header    = hdr_str;
+                            Logger::async_fill(r, format, args...);
+                        });
+                    }
+
+                    return;
+                }
+
                 LOCK_BLOCK(utils::Logger::get().logger_mutex);
 
                 if (HEDLEY_LIKELY(this->canLog(level))) {
@@ -143,6 +516,13 @@ namespace utils {
                 , screen_output(std::cout)
                 , level_screen(Level::LOG_INFO)
                 , level_file(Level::LOG_INFO)
+                , file_stamp("[%Y-%m-%d %H:%M:%S] ")
+                , async_policy(OverflowPolicy::Block)
+                , async_enabled(false)
+                , async_stop(false)
+                , async_sleeping(false)
+                , async_completed(0)
+                , async_dropped(0)
             {
                 utils::os::EnableVirtualConsole();
 
@@ -156,6 +536,8 @@ namespace utils {
              *  Dtor: write line to outputs and close streams.
              */
             ~Logger() {
+                utils::Logger::DisableAsync();
+
                 const std::string end_line =
                         utils::Logger::CRLF
                       + utils::Logger::LINE<>
@@ -269,6 +651,100 @@ namespace utils {
                 return utils::Logger::get().log_file;
             }
 
+            /**
+             *  \brief  Switch to asynchronous logging.
+             *
+             *          Producers format their text into a bounded lock-free
+             *          ring and return; a dedicated writer thread drains it
+             *          and flushes the screen and file once per batch.
+             *          Levels, pauses and timestamps are applied as usual.
+             *
+             *          Must not be called while other threads are logging.
+             *
+             *  \param  capacity
+             *      The amount of records the ring can hold (rounded up to a power of 2).
+             *  \param  policy
+             *      What to do with a new record when the ring is full.
+             */
+            static void EnableAsync(const size_t capacity = 8192,
+                                    const utils::Logger::OverflowPolicy policy = utils::Logger::OverflowPolicy::Block)
+            {
+                auto& self = utils::Logger::get();
+                utils::Logger::DisableAsync();
+
+                self.async_queue     = std::make_unique<utils::threading::RingBuffer<Record>>(capacity);
+                self.async_policy    = policy;
+                self.async_stop      = false;
+                self.async_completed = 0;
+                self.async_dropped   = 0;
+                self.async_writer    = std::thread(&Logger::async_run, &self);
+                self.async_enabled   = true;
+            }
+
+            /**
+             *  \brief  Write out everything still queued, stop the writer
+             *          thread and return to synchronous logging.
+             *
+             *          Must not be called while other threads are logging.
+             */
+            static void DisableAsync(void) {
+                auto& self = utils::Logger::get();
+
+                if (!self.async_enabled) return;
+
+                self.async_enabled = false;
+
+                {
+                    LOCK_BLOCK(self.async_mutex);
+                    self.async_stop = true;
+                }
+
+                self.async_condition.notify_one();
+                self.async_writer.join();
+                self.async_queue.reset();
+            }
+
+            static inline bool IsAsync(void) {
+                return utils::Logger::get().async_enabled;
+            }
+
+            /**
+             *  \brief  Block until every record logged before this call has
+             *          been written and flushed to its outputs.
+             *          Records dropped by the overflow policy count as done.
+             */
+            static void Flush(void) {
+                auto& self = utils::Logger::get();
+
+                if (self.async_enabled) {
+                    const size_t target = self.async_queue->pushed();
+
+                    LOCK_UNIQUE_BLOCK(self.async_mutex);
+                    self.async_condition.notify_one();
+                    self.flush_condition.wait(__lock, [&] {
+                        return self.async_completed >= target;
+                    });
+                } else {
+                    {
+                        LOCK_BLOCK(self.screen_mutex);
+                        self.screen_output.flush();
+                    }
+                    {
+                        LOCK_BLOCK(self.file_mutex);
+                        if (self.file_enabled) self.log_file.flush();
+                    }
+                }
+            }
+
+            /**
+             *  \brief  The amount of records discarded by the overflow policy,
+             *          or because they could not be filled, since async logging
+             *          was enabled.
+             */
+            static inline size_t GetDroppedCount(void) {
+                return utils::Logger::get().async_dropped;
+            }
+
             /**
              *  \brief  Write a separator (line) to the stream.
              */
@@ -285,6 +761,25 @@ namespace utils {
              */
             template<typename ...Type>
             static void Writef(const std::string_view format, const Type& ...args) {
+                auto& self = utils::Logger::get();
+
+                if (self.async_enabled) {
+                    if (HEDLEY_LIKELY(self.canLog())) {
+                        const bool        stamp = utils::Logger::IsFileTimestampEnabled();
+                        const std::time_t now   = stamp ? std::time(nullptr) : 0;
+
+                        self.async_push([&](Record& r) {
+                            r.kind      = Record::Kind::Text;
+                            r.level     = Logger::Level::LOG_EMERGENCY;
+                            r.timestamp = stamp;
+                            r.time      = now;
+                            Logger::async_fill(r, format, args...);
+                        });
+                    }
+
+                    return;
+                }
+
                 if constexpr (sizeof...(args) > 0) {
                     utils::Logger::Write(utils::string::format(format, args...), utils::Logger::IsFileTimestampEnabled());
                 } else {
@@ -299,7 +794,26 @@ namespace utils {
              *      The text to write.
              */
             static void Write(const std::string_view text, const bool timestamp = false) {
-                if (HEDLEY_LIKELY(utils::Logger::get().canLog())) {
+                auto& self = utils::Logger::get();
+
+                if (self.async_enabled) {
+                    if (HEDLEY_LIKELY(self.canLog())) {
+                        const std::time_t now = timestamp ? std::time(nullptr) : 0;
+
+                        self.async_push([&](Record& r) {
+                            r.kind      = Record::Kind::Text;
+                            r.level     = Logger::Level::LOG_EMERGENCY;
+                            r.timestamp = timestamp;
+                            r.time      = now;
+                            r.render    = nullptr;
+                            r.text.assign(text);
+                        });
+                    }
+
+                    return;
+                }
+
+                if (HEDLEY_LIKELY(self.canLog())) {
                     const bool stamp = utils::Logger::IsFileTimestampEnabled();
                     utils::Logger::SetFileTimestamp(timestamp);
 
@@ -549,7 +1063,21 @@ namespace utils {
             }
 
             static inline void Command(const utils::os::command_t cmd) {
-                LOCK_BLOCK(utils::Logger::get().screen_mutex);
+                auto& self = utils::Logger::get();
+
+                if (self.async_enabled) {
+                    if (HEDLEY_LIKELY(self.canLogScreen())) {
+                        self.async_push([&](Record& r) {
+                            r.kind  = Record::Kind::Command;
+                            r.level = Logger::Level::LOG_EMERGENCY;
+                            r.cmd   = cmd;
+                        });
+                    }
+
+                    return;
+                }
+
+                LOCK_BLOCK(self.screen_mutex);
 
                 if (HEDLEY_LIKELY(utils::Logger::get().canLogScreen())) {
                     utils::os::Command(cmd, utils::Logger::GetConsoleStream());
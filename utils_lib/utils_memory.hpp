@@ -11,6 +11,8 @@
 #include <vector>
 #include <memory>
 #include <cstring>
+#include <iterator>
+#include <type_traits>
 
 #if UTILS_MEMORY_ALLOC_LOG
     #include <cstdio>
@@ -117,6 +119,107 @@ namespace utils::memory {
         #endif
     }
 
+    /**
+     *  \brief  A non-owning view on \p count contiguous elements of T,
+     *          like C++20's std::span with a dynamic extent.
+     *          A span<T> converts to a span<const T>.
+     *
+     *  \tparam T
+     *      The element type, const for a read-only view.
+     */
+    template<typename T>
+    class span {
+        public:
+            using element_type = T;
+            using value_type   = std::remove_cv_t<T>;
+            using size_type    = size_t;
+            using pointer      = T*;
+            using reference    = T&;
+            using iterator     = T*;
+
+            static constexpr size_t npos = size_t(-1);
+
+        private:
+            T     *ptr;
+            size_t count;
+
+            template<typename Container>
+            using enable_container_t = std::enable_if_t<
+                !std::is_array_v<Container>
+                && std::is_convertible_v<std::remove_pointer_t<decltype(std::data(std::declval<Container&>()))>(*)[], T(*)[]>
+            >;
+
+        public:
+            constexpr span(void) noexcept : ptr(nullptr), count(0) {}
+
+            constexpr span(T *data, const size_t size) noexcept : ptr(data), count(size) {}
+
+            template<size_t N>
+            constexpr span(T (&arr)[N]) noexcept : ptr(arr), count(N) {}
+
+            /**
+             *  \brief  View on anything with data() and size(), like std::vector,
+             *          std::array or std::string.
+             */
+            template<typename Container, typename = enable_container_t<Container>>
+            constexpr span(Container& cont) : ptr(std::data(cont)), count(std::size(cont)) {}
+
+            template<typename Container, typename = enable_container_t<const Container>>
+            constexpr span(const Container& cont) : ptr(std::data(cont)), count(std::size(cont)) {}
+
+            template<typename U, typename = std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>>>
+            constexpr span(const span<U>& other) noexcept : ptr(other.data()), count(other.size()) {}
+
+            constexpr T* data(void) const noexcept {
+                return this->ptr;
+            }
+
+            constexpr size_t size(void) const noexcept {
+                return this->count;
+            }
+
+            constexpr size_t size_bytes(void) const noexcept {
+                return this->count * sizeof(T);
+            }
+
+            constexpr bool empty(void) const noexcept {
+                return this->count == 0;
+            }
+
+            constexpr T* begin(void) const noexcept {
+                return this->ptr;
+            }
+
+            constexpr T* end(void) const noexcept {
+                return this->ptr + this->count;
+            }
+
+            constexpr T& operator[](const size_t index) const {
+                return this->ptr[index];
+            }
+
+            /**
+             *  \brief  The first \p n elements.
+             */
+            constexpr span first(const size_t n) const {
+                return span(this->ptr, n);
+            }
+
+            /**
+             *  \brief  The last \p n elements.
+             */
+            constexpr span last(const size_t n) const {
+                return span(this->ptr + this->count - n, n);
+            }
+
+            /**
+             *  \brief  \p n elements starting at \p offset, or all of them up to the end.
+             */
+            constexpr span subspan(const size_t offset, const size_t n = npos) const {
+                return span(this->ptr + offset, n == npos ? this->count - offset : n);
+            }
+    };
+
     /*
      *	Overloaded methods to allocate an array of T of size x, y, z.
      */
@@ -9,11 +9,25 @@
 #include <sstream>
 #include <iomanip>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <string>
 #include <string_view>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <cinttypes>
+#include <cmath>
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <charconv>
 
 #include "utils_compiler.hpp"
 #include "utils_time.hpp"
 #include "utils_threading.hpp"
+#include "utils_bits.hpp"
 
 namespace utils {
 
@@ -30,73 +44,674 @@ namespace utils {
      *          UTILS_PROFILE_SCOPE(<name>) within a nested scope to trace its walltime.
      *
      *          Returning from the (function) scope will cause the scoped ProfileTimer
-     *          to write the walltime to the trace file.
+     *          to append a fixed-size binary event to a buffer owned by the calling
+     *          thread, without locking or formatting. The buffers are merged into
+     *          the trace file by Profiler::Flush() and at the end of the session.
+     *          Scope names are stored by pointer and must outlive the session
+     *          (string literals and UTILS_FUNCTION_NAME do).
      */
     class Profiler {
+        public:
+            /**
+             *  \brief  Amount of events per buffer chunk.
+             */
+            static constexpr size_t CHUNK_EVENTS = 4096;
+
+            /**
+             *  \brief  Latency histogram layout: every power of 2 (in ns) is
+             *          split in 2^HISTOGRAM_SUB_BITS linear buckets, so a bucket
+             *          is at most 12.5% wide. Durations from 2^HISTOGRAM_MAX_EXP
+             *          ns (~18 min) on end up in the last bucket.
+             */
+            static constexpr size_t HISTOGRAM_SUB_BITS = 3;
+            static constexpr size_t HISTOGRAM_MAX_EXP  = 40;
+            static constexpr size_t HISTOGRAM_BUCKETS  =
+                (HISTOGRAM_MAX_EXP - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS;
+
+            enum class Mode : uint8_t {
+                Trace,      ///< Write (sampled) events to the trace file.
+                Aggregate   ///< Keep per-scope statistics, and optionally write sampled events.
+            };
+
+            enum class Format : uint8_t {
+                Text,
+                Json
+            };
+
+            /**
+             *  \brief  Merged statistics of one scope name, all times in ns.
+             */
+            struct ScopeSummary {
+                std::string name;
+                uint64_t count;
+                uint64_t total;
+                uint64_t min;
+                uint64_t max;
+                double   mean;
+                uint64_t p50;
+                uint64_t p90;
+                uint64_t p99;
+                uint64_t p999;
+            };
+
         private:
+            static constexpr size_t WRITE_BLOCK = 1 << 16;
+            static constexpr size_t STATS_BLOCK = 8;
+
+            /**
+             *  \brief  A trace event. `phase` is the Chrome trace phase:
+             *          'X' complete, 'C' counter, 'b'/'e' async begin/end,
+             *          's'/'f' flow start/end and 'i' instant.
+             */
+            struct Event {
+                const char *name;
+                uint32_t    name_len;
+                char        phase;
+                int64_t     start_ns;
+                union {
+                    int64_t  duration_ns;  ///< 'X'
+                    uint64_t id;           ///< 'b', 'e', 's', 'f'
+                    double   value;        ///< 'C'
+                };
+            };
+
+            struct Chunk {
+                Event events[Profiler::CHUNK_EVENTS];
+                std::atomic<Chunk*> next{nullptr};
+            };
+
+            /**
+             *  \brief  Statistics of one scope name in one thread.
+             *          Only the owning thread writes, so plain loads and stores
+             *          suffice; they are atomic so the stats can be read at runtime.
+             */
+            struct ScopeStats {
+                const char *name = nullptr;
+                uint32_t    name_len = 0;
+                std::atomic<uint64_t> count{0};
+                std::atomic<uint64_t> total{0};
+                std::atomic<uint64_t> min{UINT64_MAX};
+                std::atomic<uint64_t> max{0};
+                std::atomic<uint64_t> histogram[Profiler::HISTOGRAM_BUCKETS] = {};
+
+                static inline void bump(std::atomic<uint64_t>& v, const uint64_t by) {
+                    v.store(v.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+                }
+
+                inline void add(const uint64_t duration) {
+                    ScopeStats::bump(this->count, 1);
+                    ScopeStats::bump(this->total, duration);
+                    ScopeStats::bump(this->histogram[Profiler::histogram_bucket(duration)], 1);
+
+                    if (duration < this->min.load(std::memory_order_relaxed)) {
+                        this->min.store(duration, std::memory_order_relaxed);
+                    }
+                    if (duration > this->max.load(std::memory_order_relaxed)) {
+                        this->max.store(duration, std::memory_order_relaxed);
+                    }
+                }
+            };
+
+            struct StatsBlock {
+                ScopeStats entries[Profiler::STATS_BLOCK];
+                std::atomic<StatsBlock*> next{nullptr};
+            };
+
+            /**
+             *  \brief  Single producer event buffer of one thread.
+             *
+             *          The owning thread appends to the tail chunk and publishes
+             *          the event count; the merger reads up to that count from
+             *          the head, and frees chunks it has completely consumed.
+             *
+             *          In aggregate mode the thread also keeps a ScopeStats per
+             *          scope name. Entries are appended to a list of blocks and
+             *          published by count, so readers can walk them at any time;
+             *          the owning thread finds them through a private hash index.
+             */
+            struct ThreadBuffer {
+                struct IndexSlot {
+                    const char *name;
+                    uint32_t    name_len;
+                    ScopeStats *stats;
+                };
+
+                const uint64_t session;
+                const uint32_t tid;
+                const bool     aggregate;
+                const bool     tracing;
+                const size_t   sample_every;
+
+                // Owning thread
+                Chunk *tail;
+                size_t tail_pos;
+                size_t sample_countdown;
+                std::atomic<size_t> committed;
+
+                StatsBlock *stats_tail;
+                std::vector<IndexSlot> index;
+                size_t index_used;
+                std::atomic<size_t> stats_count;
+
+                // Merger, under buffers_mutex
+                alignas(64) Chunk *head;
+                size_t consumed;
+
+                StatsBlock *stats_head;
+
+                // Under buffers_mutex
+                std::string name;
+                bool        name_dirty;
+
+                ThreadBuffer(const uint64_t session, const uint32_t tid,
+                             const bool aggregate, const bool tracing,
+                             const size_t sample_every, const std::string& name)
+                    : session{session}
+                    , tid{tid}
+                    , aggregate{aggregate}
+                    , tracing{tracing}
+                    , sample_every{tracing ? sample_every : 0}
+                    , tail{new Chunk}
+                    , tail_pos{0}
+                    , sample_countdown{sample_every}
+                    , committed{0}
+                    , stats_tail{nullptr}
+                    , index_used{0}
+                    , stats_count{0}
+                    , head{tail}
+                    , consumed{0}
+                    , stats_head{nullptr}
+                    , name{name}
+                    , name_dirty{!name.empty()}
+                {
+                    if (this->aggregate) {
+                        this->stats_tail = this->stats_head = new StatsBlock;
+                        this->index.resize(64, IndexSlot{ nullptr, 0, nullptr });
+                    }
+                }
+
+                ThreadBuffer(const ThreadBuffer&)            = delete;
+                ThreadBuffer& operator=(const ThreadBuffer&) = delete;
+
+                ~ThreadBuffer() {
+                    while (this->head != nullptr) {
+                        Chunk *next = this->head->next.load(std::memory_order_relaxed);
+                        delete this->head;
+                        this->head = next;
+                    }
+
+                    while (this->stats_head != nullptr) {
+                        StatsBlock *next = this->stats_head->next.load(std::memory_order_relaxed);
+                        delete this->stats_head;
+                        this->stats_head = next;
+                    }
+                }
+
+                static inline size_t hash(const char *name) {
+                    return size_t((uint64_t(reinterpret_cast<uintptr_t>(name)) * 0x9E3779B97F4A7C15ull) >> 32);
+                }
+
+                ScopeStats* new_stats(const char *name, const uint32_t name_len) {
+                    const size_t n   = this->stats_count.load(std::memory_order_relaxed);
+                    const size_t idx = n % Profiler::STATS_BLOCK;
+
+                    if (idx == 0 && n > 0) {
+                        StatsBlock *block = new StatsBlock;
+                        this->stats_tail->next.store(block, std::memory_order_release);
+                        this->stats_tail = block;
+                    }
+
+                    ScopeStats *stats = &this->stats_tail->entries[idx];
+                    stats->name     = name;
+                    stats->name_len = name_len;
+                    this->stats_count.store(n + 1, std::memory_order_release);
+                    return stats;
+                }
+
+                void grow_index(void) {
+                    std::vector<IndexSlot> old(this->index.size() * 2, IndexSlot{ nullptr, 0, nullptr });
+                    old.swap(this->index);
+                    const size_t mask = this->index.size() - 1;
+
+                    for (const auto& slot : old) {
+                        if (slot.stats == nullptr) continue;
+                        size_t i = ThreadBuffer::hash(slot.name) & mask;
+                        while (this->index[i].stats != nullptr) i = (i + 1) & mask;
+                        this->index[i] = slot;
+                    }
+                }
+
+                inline ScopeStats& stats_for(const char *name, const uint32_t name_len) {
+                    const size_t mask = this->index.size() - 1;
+                    size_t i = ThreadBuffer::hash(name) & mask;
+
+                    for (;; i = (i + 1) & mask) {
+                        IndexSlot& slot = this->index[i];
+
+                        if (HEDLEY_LIKELY(slot.name == name && slot.name_len == name_len)) {
+                            return *slot.stats;
+                        }
+
+                        if (slot.stats == nullptr) break;
+                    }
+
+                    ScopeStats *stats = this->new_stats(name, name_len);
+                    this->index[i] = IndexSlot{ name, name_len, stats };
+
+                    if (++this->index_used * 2 > this->index.size()) {
+                        this->grow_index();
+                    }
+
+                    return *stats;
+                }
+
+                /**
+                 *  \brief  Call \p f for every published ScopeStats.
+                 */
+                template<class F>
+                void for_each_stats(F&& f) const {
+                    const size_t count = this->stats_count.load(std::memory_order_acquire);
+                    const StatsBlock *block = this->stats_head;
+
+                    for (size_t i = 0; i < count; i++) {
+                        if (i > 0 && i % Profiler::STATS_BLOCK == 0) {
+                            block = block->next.load(std::memory_order_acquire);
+                        }
+
+                        f(block->entries[i % Profiler::STATS_BLOCK]);
+                    }
+                }
+
+                /**
+                 *  \brief  Record a finished scope: update its statistics and
+                 *          buffer one in every `sample_every` as trace event.
+                 */
+                inline void record(const Event& event) {
+                    if (this->aggregate) {
+                        this->stats_for(event.name, event.name_len).add(uint64_t(event.duration_ns));
+                    }
+
+                    if (this->sample_every > 0 && --this->sample_countdown == 0) {
+                        this->sample_countdown = this->sample_every;
+                        this->push(event);
+                    }
+                }
+
+                /**
+                 *  \brief  Buffer an event that is not sampled, if a trace is written.
+                 */
+                inline void emit(const Event& event) {
+                    if (this->tracing) {
+                        this->push(event);
+                    }
+                }
+
+                inline void push(const Event& event) {
+                    if (HEDLEY_UNLIKELY(this->tail_pos == Profiler::CHUNK_EVENTS)) {
+                        Chunk *chunk = new Chunk;
+                        this->tail->next.store(chunk, std::memory_order_release);
+                        this->tail     = chunk;
+                        this->tail_pos = 0;
+                    }
+
+                    this->tail->events[this->tail_pos++] = event;
+                    this->committed.store(this->committed.load(std::memory_order_relaxed) + 1,
+                                          std::memory_order_release);
+                }
+
+                /**
+                 *  \brief  Call \p f for every event published since the last call.
+                 */
+                template<class F>
+                void consume(F&& f) {
+                    const size_t available = this->committed.load(std::memory_order_acquire);
+
+                    for (; this->consumed < available; this->consumed++) {
+                        const size_t idx = this->consumed % Profiler::CHUNK_EVENTS;
+
+                        if (idx == 0 && this->consumed > 0) {
+                            Chunk *next = this->head->next.load(std::memory_order_acquire);
+                            delete this->head;
+                            this->head = next;
+                        }
+
+                        f(this->head->events[idx]);
+                    }
+                }
+            };
+
             struct ProfileTimer {
                 const std::string_view name;
-                utils::time::timepoint_t start;
+                const int64_t start;
 
                 ProfileTimer(std::string_view name)
                     : name{name}
-                    , start{utils::time::Timer::Start()}
+                    , start{Profiler::now_ns()}
                 {
                     // Empty
                 }
 
                 ~ProfileTimer() {
-                    const auto elapsed_us = utils::time::Timer::time_ns::duration(this->start) / 1000;
-                    utils::Profiler::get().AppendResults(this->name,
-                                                         utils::time::microseconds{this->start.time_since_epoch()}.count(),
-                                                         elapsed_us,
-                                                         std::this_thread::get_id());
+                    const int64_t end = Profiler::now_ns();
+                    utils::Profiler::get().AppendResults(this->name, this->start, end - this->start);
                 }
             };
 
+            std::atomic<uint64_t> session;     ///< 0 if no session is active
+            uint64_t              session_counter;
+            uint32_t              next_tid;
+            Profiler::Mode        mode;
+            size_t                sample_every;
+
+            std::mutex    buffers_mutex;
+            std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
             std::mutex    file_mutex;
-            bool          session_active;
             std::ofstream out_file;
+            std::string   json;
+
+            std::atomic<uint64_t> next_id;
+
+            static inline thread_local std::string thread_name;
 
             static /*inline*/ Profiler& get() {
                 static Profiler instance;
                 return instance;
             }
 
-            Profiler() : session_active{false} {}
+            Profiler()
+                : session{0}
+                , session_counter{0}
+                , next_tid{0}
+                , mode{Mode::Trace}
+                , sample_every{1}
+                , next_id{1}
+            {
+                // Empty
+            }
 
             ~Profiler() {
                 this->EndSession();
             }
 
+            static inline int64_t now_ns(void) {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()
+                ).count();
+            }
+
+            /**
+             *  \brief  The event buffer of the calling thread for the active
+             *          session, or nullptr if no session is active.
+             */
+            inline ThreadBuffer* thread_buffer(void) {
+                thread_local std::shared_ptr<ThreadBuffer> local;
+                const uint64_t current = this->session.load(std::memory_order_acquire);
+
+                if (HEDLEY_UNLIKELY(current == 0)) {
+                    return nullptr;
+                }
+
+                if (HEDLEY_LIKELY(local && local->session == current)) {
+                    return local.get();
+                }
+
+                return this->register_thread(local, current);
+            }
+
+            ThreadBuffer* register_thread(std::shared_ptr<ThreadBuffer>& local, const uint64_t current) {
+                LOCK_BLOCK(this->buffers_mutex);
+
+                if (this->session.load() != current) {
+                    return nullptr;
+                }
+
+                local = std::make_shared<ThreadBuffer>(current, this->next_tid++,
+                                                       this->mode == Mode::Aggregate,
+                                                       this->out_file.is_open(),
+                                                       this->sample_every,
+                                                       Profiler::thread_name);
+                this->buffers.push_back(local);
+                return local.get();
+            }
+
+            /**
+             *  \brief  Append \p ns as microseconds with 3 decimals.
+             */
+            void append_us(const int64_t ns) {
+                char digits[24];
+                const int64_t  whole    = ns / 1000;
+                const uint32_t fraction = uint32_t(std::abs(ns % 1000));
+
+                if (ns < 0 && whole == 0) this->json.push_back('-');
+
+                const auto res = std::to_chars(digits, digits + sizeof(digits), whole);
+                this->json.append(digits, res.ptr);
+                this->json.push_back('.');
+                this->json.push_back(char('0' + fraction / 100));
+                this->json.push_back(char('0' + fraction / 10 % 10));
+                this->json.push_back(char('0' + fraction % 10));
+            }
+
+            void append_escaped(const std::string_view str) {
+                for (const char c : str) {
+                    if (c == '"' || c == '\\') this->json.push_back('\\');
+                    this->json.push_back(c);
+                }
+            }
+
+            void append_json(const Event& event, const uint32_t tid) {
+                char digits[32];
+                const auto append_number = [&](const auto value) {
+                    this->json.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+                };
+
+                this->json += ",{\"cat\":\"";
+
+                switch (event.phase) {
+                    case 'X': this->json += "function"; break;
+                    case 'C': this->json += "counter";  break;
+                    case 'b':
+                    case 'e': this->json += "async";    break;
+                    case 's':
+                    case 'f': this->json += "flow";     break;
+                    default : this->json += "event";    break;
+                }
+
+                this->json += "\",\"name\":\"";
+                this->append_escaped(std::string_view(event.name, event.name_len));
+                this->json += "\",\"ph\":\"";
+                this->json.push_back(event.phase);
+                this->json += "\",\"pid\":0,\"tid\":";
+                append_number(tid);
+                this->json += ",\"ts\":";
+                this->append_us(event.start_ns);
+
+                switch (event.phase) {
+                    case 'X':
+                        this->json += ",\"dur\":";
+                        this->append_us(event.duration_ns);
+                        break;
+                    case 'C':
+                        this->json += ",\"args\":{\"value\":";
+                        this->json.append(digits, size_t(std::snprintf(digits, sizeof(digits), "%.15g",
+                                                                       std::isfinite(event.value) ? event.value : 0.0)));
+                        this->json.push_back('}');
+                        break;
+                    case 'f':
+                        this->json += ",\"bp\":\"e\"";
+                        HEDLEY_FALL_THROUGH;
+                    case 'b':
+                    case 'e':
+                    case 's':
+                        this->json += ",\"id\":";
+                        append_number(event.id);
+                        break;
+                    case 'i':
+                        this->json += ",\"s\":\"t\"";
+                        break;
+                }
+
+                this->json.push_back('}');
+            }
+
+            void append_thread_name(const ThreadBuffer& buffer) {
+                char digits[16];
+
+                this->json += ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":";
+                this->json.append(digits, std::to_chars(digits, digits + sizeof(digits), buffer.tid).ptr);
+                this->json += ",\"args\":{\"name\":\"";
+                this->append_escaped(buffer.name);
+                this->json += "\"}}";
+            }
+
+            /**
+             *  \brief  Write all published events to the output.
+             *          Requires buffers_mutex and file_mutex to be held.
+             */
+            void merge_buffers(void) {
+                const auto write_json = [this] {
+                    if (this->out_file.is_open()) {
+                        this->out_file.write(this->json.data(), std::streamsize(this->json.size()));
+                    }
+                    this->json.clear();
+                };
+
+                for (auto& buffer : this->buffers) {
+                    if (buffer->name_dirty) {
+                        this->append_thread_name(*buffer);
+                        buffer->name_dirty = false;
+                    }
+
+                    buffer->consume([&](const Event& event) {
+                        this->append_json(event, buffer->tid);
+
+                        if (HEDLEY_UNLIKELY(this->json.size() >= Profiler::WRITE_BLOCK)) {
+                            write_json();
+                        }
+                    });
+                }
+
+                write_json();
+            }
+
             void CloseOutput() {
-                if (this->session_active) {
+                if (this->out_file.is_open()) {
                     this->out_file << "]}";
                     this->out_file.flush();
                     this->out_file.close();
-                    this->session_active = false;
                 }
             }
 
-            void AppendResults(const std::string_view name, double start, int64_t elapsed, std::thread::id tid) {
-                std::stringstream repr;
+            inline void AppendResults(const std::string_view name, const int64_t start, const int64_t elapsed) {
+                if (ThreadBuffer *buffer = this->thread_buffer()) {
+                    buffer->record(Event{ name.data(), uint32_t(name.size()), 'X', start, { elapsed } });
+                }
+            }
 
-                repr << std::setprecision(3) << std::fixed;
-                repr << ",{";
-                repr << "\"cat\":\"function\",";
-                repr << "\"dur\":" << elapsed << ',';
-                repr << "\"name\":\"" << name << "\",";
-                repr << "\"ph\":\"X\",";
-                repr << "\"pid\":0,";
-                repr << "\"tid\":" << tid << ",";
-                repr << "\"ts\":" << start;
-                repr << "}";
+            static inline Event make_event(const char phase, const std::string_view name, const int64_t ts) {
+                Event event{ name.data(), uint32_t(name.size()), phase, ts, { 0 } };
+                return event;
+            }
 
-                LOCK_BLOCK(this->file_mutex);
-                if (this->session_active) {
-                    this->out_file << repr.str();
-                    this->out_file.flush();
+            inline void emit_id(const char phase, const std::string_view name, const uint64_t id, const int64_t ts) {
+                if (ThreadBuffer *buffer = this->thread_buffer()) {
+                    Event event = Profiler::make_event(phase, name, ts);
+                    event.id = id;
+                    buffer->emit(event);
+                }
+            }
+
+            static void pool_enqueue(utils::threading::ThreadPool& pool, const uint64_t id, const int64_t enqueue_ns) {
+                if (!utils::Profiler::IsActive()) return;
+
+                Profiler& pr = utils::Profiler::get();
+                pr.emit_id('b', "ThreadPool::queued", id, enqueue_ns);
+                pr.emit_id('s', "ThreadPool::task"  , id, enqueue_ns);
+                utils::Profiler::Counter("ThreadPool::tasks_in_queue", double(pool.tasks_in_queue()));
+            }
+
+            static void pool_start(utils::threading::ThreadPool&, const size_t worker, const uint64_t id,
+                                   const int64_t enqueue_ns, const int64_t start_ns)
+            {
+                if (!utils::Profiler::IsActive()) return;
+
+                if (HEDLEY_UNLIKELY(Profiler::thread_name.empty())) {
+                    utils::Profiler::SetThreadName("ThreadPool worker " + std::to_string(worker));
+                }
+
+                Profiler& pr = utils::Profiler::get();
+
+                if (ThreadBuffer *buffer = pr.thread_buffer()) {
+                    if (buffer->aggregate) {
+                        constexpr std::string_view queued = "ThreadPool::queued";
+                        buffer->stats_for(queued.data(), uint32_t(queued.size())).add(uint64_t(start_ns - enqueue_ns));
+                    }
+
+                    pr.emit_id('e', "ThreadPool::queued", id, start_ns);
+                    pr.emit_id('f', "ThreadPool::task"  , id, start_ns);
+                }
+            }
+
+            static void pool_finish(utils::threading::ThreadPool&, const uint64_t,
+                                    const int64_t start_ns, const int64_t end_ns)
+            {
+                utils::Profiler::get().AppendResults("ThreadPool::task", start_ns, end_ns - start_ns);
+            }
+
+            static constexpr size_t histogram_bucket(const uint64_t ns) {
+                constexpr uint64_t SUB = uint64_t(1) << Profiler::HISTOGRAM_SUB_BITS;
+
+                if (ns < SUB) {
+                    return size_t(ns);
+                }
+
+                const size_t exp = size_t(utils::bits::msb(ns)) - 1;
+
+                if (exp >= Profiler::HISTOGRAM_MAX_EXP) {
+                    return Profiler::HISTOGRAM_BUCKETS - 1;
                 }
+
+                return size_t(((exp - Profiler::HISTOGRAM_SUB_BITS + 1) << Profiler::HISTOGRAM_SUB_BITS)
+                            + ((ns >> (exp - Profiler::HISTOGRAM_SUB_BITS)) - SUB));
+            }
+
+            /**
+             *  \brief  The smallest duration that falls in \p bucket.
+             */
+            static constexpr uint64_t histogram_lower(const size_t bucket) {
+                constexpr size_t SUB = size_t(1) << Profiler::HISTOGRAM_SUB_BITS;
+
+                if (bucket < SUB) {
+                    return uint64_t(bucket);
+                }
+
+                const size_t exp = (bucket >> Profiler::HISTOGRAM_SUB_BITS) + Profiler::HISTOGRAM_SUB_BITS - 1;
+                return uint64_t(SUB + (bucket & (SUB - 1))) << (exp - Profiler::HISTOGRAM_SUB_BITS);
+            }
+
+            /**
+             *  \brief  Estimate quantile \p q from a merged histogram,
+             *          as the middle of the bucket it falls in.
+             */
+            static uint64_t histogram_quantile(const std::vector<uint64_t>& histogram,
+                                               const uint64_t count, const double q,
+                                               const uint64_t min, const uint64_t max)
+            {
+                const uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(q * double(count))));
+                uint64_t seen = 0;
+
+                for (size_t b = 0; b < histogram.size(); b++) {
+                    seen += histogram[b];
+
+                    if (seen >= rank) {
+                        const uint64_t lower = Profiler::histogram_lower(b);
+                        const uint64_t upper = (b + 1 < histogram.size() ? Profiler::histogram_lower(b + 1) : max + 1);
+                        return std::clamp(lower + (upper - 1 - lower) / 2, min, max);
+                    }
+                }
+
+                return max;
             }
 
         public:
@@ -105,24 +720,258 @@ namespace utils {
             void operator=(Profiler const&) = delete;
             Profiler& operator=(Profiler&&) = delete;
 
-            static void BeginSession(const std::string& filepath = "trace.json") {
+            /**
+             *  \brief  Start a new session, ending the current one.
+             *
+             *  \param  filepath
+             *      The trace file to write. In Trace mode, no session is
+             *      started if empty. In Aggregate mode, only statistics are
+             *      kept if empty.
+             *  \param  mode
+             *      Whether to keep per-scope statistics (see GetStats()).
+             *  \param  sample_every
+             *      Write only 1 in every \p sample_every scopes (per thread)
+             *      to the trace file, or none if 0.
+             */
+            static void BeginSession(const std::string& filepath = "trace.json",
+                                     const Profiler::Mode mode   = Profiler::Mode::Trace,
+                                     const size_t sample_every   = 1)
+            {
+                Profiler& pr = utils::Profiler::get();
+                utils::Profiler::EndSession();
+
+                if (HEDLEY_LIKELY(filepath.length() > 0 || mode == Mode::Aggregate)) {
+                    LOCK_BLOCK(pr.buffers_mutex);
+                    LOCK_BLOCK(pr.file_mutex);
+
+                    if (filepath.length() > 0) {
+                        pr.out_file.open(filepath, std::ios_base::out);
+                        pr.out_file << "{\"otherData\": {},\"traceEvents\":[{}";
+                        pr.out_file.flush();
+                    }
+
+                    pr.next_tid     = 0;
+                    pr.mode         = mode;
+                    pr.sample_every = sample_every;
+                    pr.session.store(++pr.session_counter);
+                }
+            }
+
+            /**
+             *  \brief  Write the events recorded so far to the trace file,
+             *          and release the buffer memory they used.
+             */
+            static void Flush() {
+                Profiler& pr = utils::Profiler::get();
+                LOCK_BLOCK(pr.buffers_mutex);
+                LOCK_BLOCK(pr.file_mutex);
+                pr.merge_buffers();
+                pr.out_file.flush();
+            }
+
+            static void EndSession() {
                 Profiler& pr = utils::Profiler::get();
+                pr.session.store(0);
+
+                LOCK_BLOCK(pr.buffers_mutex);
                 LOCK_BLOCK(pr.file_mutex);
-                if (pr.session_active) {
-                    pr.CloseOutput();
+                pr.merge_buffers();
+                pr.buffers.clear();
+                pr.CloseOutput();
+            }
+
+            /**
+             *  \brief  Merge the per-thread statistics of the active Aggregate
+             *          session, sorted by total time (descending).
+             *          Scopes with the same name are combined.
+             */
+            static std::vector<ScopeSummary> GetStats() {
+                struct Merged {
+                    uint64_t count = 0, total = 0, min = UINT64_MAX, max = 0;
+                    std::vector<uint64_t> histogram = std::vector<uint64_t>(Profiler::HISTOGRAM_BUCKETS, 0);
+                };
+
+                Profiler& pr = utils::Profiler::get();
+                std::map<std::string, Merged, std::less<>> merged;
+
+                {
+                    LOCK_BLOCK(pr.buffers_mutex);
+
+                    for (const auto& buffer : pr.buffers) {
+                        if (!buffer->aggregate) continue;
+
+                        buffer->for_each_stats([&](const ScopeStats& stats) {
+                            const std::string_view name(stats.name, stats.name_len);
+                            auto it = merged.find(name);
+
+                            if (it == merged.end()) {
+                                it = merged.emplace(std::string(name), Merged{}).first;
+                            }
+
+                            Merged& m = it->second;
+                            m.count += stats.count.load(std::memory_order_relaxed);
+                            m.total += stats.total.load(std::memory_order_relaxed);
+                            m.min    = std::min(m.min, stats.min.load(std::memory_order_relaxed));
+                            m.max    = std::max(m.max, stats.max.load(std::memory_order_relaxed));
+
+                            for (size_t b = 0; b < Profiler::HISTOGRAM_BUCKETS; b++) {
+                                m.histogram[b] += stats.histogram[b].load(std::memory_order_relaxed);
+                            }
+                        });
+                    }
                 }
 
-                if (HEDLEY_LIKELY(filepath.length() > 0)) {
-                    pr.out_file.open(filepath, std::ios_base::out);
-                    pr.out_file << "{\"otherData\": {},\"traceEvents\":[{}";
-                    pr.out_file.flush();
-                    pr.session_active = true;
+                std::vector<ScopeSummary> summary;
+                summary.reserve(merged.size());
+
+                for (const auto& [name, m] : merged) {
+                    if (m.count == 0) continue;
+
+                    summary.push_back(ScopeSummary{
+                        name, m.count, m.total, m.min, m.max,
+                        double(m.total) / double(m.count),
+                        Profiler::histogram_quantile(m.histogram, m.count, 0.5  , m.min, m.max),
+                        Profiler::histogram_quantile(m.histogram, m.count, 0.9  , m.min, m.max),
+                        Profiler::histogram_quantile(m.histogram, m.count, 0.99 , m.min, m.max),
+                        Profiler::histogram_quantile(m.histogram, m.count, 0.999, m.min, m.max)
+                    });
                 }
+
+                std::sort(summary.begin(), summary.end(), [](const auto& a, const auto& b) {
+                    return a.total > b.total;
+                });
+
+                return summary;
             }
 
-            static void EndSession() {
-                LOCK_BLOCK(utils::Profiler::get().file_mutex);
-                utils::Profiler::get().CloseOutput();
+            /**
+             *  \brief  Write GetStats() to \p out as a text table (times in us)
+             *          or as a JSON array (times in ns).
+             */
+            static void DumpStats(std::ostream& out, const Profiler::Format format = Profiler::Format::Text) {
+                const auto stats = utils::Profiler::GetStats();
+                char line[512];
+
+                if (format == Format::Json) {
+                    out << '[';
+
+                    for (size_t i = 0; i < stats.size(); i++) {
+                        const auto& s = stats[i];
+                        out << (i ? ",{" : "{") << "\"name\":\"";
+
+                        for (const char c : s.name) {
+                            if (c == '"' || c == '\\') out << '\\';
+                            out << c;
+                        }
+
+                        std::snprintf(line, sizeof(line),
+                                      "\",\"count\":%" PRIu64 ",\"total\":%" PRIu64 ",\"min\":%" PRIu64
+                                      ",\"max\":%" PRIu64 ",\"mean\":%.1f,\"p50\":%" PRIu64 ",\"p90\":%" PRIu64
+                                      ",\"p99\":%" PRIu64 ",\"p999\":%" PRIu64 "}",
+                                      s.count, s.total, s.min, s.max, s.mean, s.p50, s.p90, s.p99, s.p999);
+                        out << line;
+                    }
+
+                    out << ']';
+                } else {
+                    std::snprintf(line, sizeof(line), "%-40s %10s %12s %10s %10s %10s %10s %10s %10s %10s\n",
+                                  "scope", "count", "total (ms)", "mean (us)", "min", "p50", "p90", "p99", "p99.9", "max");
+                    out << line;
+
+                    for (const auto& s : stats) {
+                        std::snprintf(line, sizeof(line),
+                                      "%-40.40s %10" PRIu64 " %12.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+                                      s.name.c_str(), s.count, double(s.total) / 1.0e6, s.mean / 1.0e3,
+                                      double(s.min) / 1.0e3, double(s.p50)  / 1.0e3, double(s.p90) / 1.0e3,
+                                      double(s.p99) / 1.0e3, double(s.p999) / 1.0e3, double(s.max) / 1.0e3);
+                        out << line;
+                    }
+                }
+            }
+
+            /**
+             *  \brief  Record the value of counter \p name at the current time.
+             */
+            static inline void Counter(const std::string_view name, const double value) {
+                if (ThreadBuffer *buffer = utils::Profiler::get().thread_buffer()) {
+                    Event event = Profiler::make_event('C', name, Profiler::now_ns());
+                    event.value = value;
+                    buffer->emit(event);
+                }
+            }
+
+            /**
+             *  \brief  Begin async slice \p name with \p id, which may end on another thread.
+             */
+            static inline void AsyncBegin(const std::string_view name, const uint64_t id) {
+                utils::Profiler::get().emit_id('b', name, id, Profiler::now_ns());
+            }
+
+            static inline void AsyncEnd(const std::string_view name, const uint64_t id) {
+                utils::Profiler::get().emit_id('e', name, id, Profiler::now_ns());
+            }
+
+            /**
+             *  \brief  Start flow \p id from the enclosing scope on this thread.
+             */
+            static inline void FlowStart(const std::string_view name, const uint64_t id) {
+                utils::Profiler::get().emit_id('s', name, id, Profiler::now_ns());
+            }
+
+            /**
+             *  \brief  End flow \p id at the enclosing scope on this thread.
+             */
+            static inline void FlowEnd(const std::string_view name, const uint64_t id) {
+                utils::Profiler::get().emit_id('f', name, id, Profiler::now_ns());
+            }
+
+            static inline void Instant(const std::string_view name) {
+                if (ThreadBuffer *buffer = utils::Profiler::get().thread_buffer()) {
+                    buffer->emit(Profiler::make_event('i', name, Profiler::now_ns()));
+                }
+            }
+
+            /**
+             *  \brief  A process-wide unique id for async and flow events.
+             */
+            static inline uint64_t NewId() {
+                return utils::Profiler::get().next_id.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /**
+             *  \brief  Name the calling thread in the trace (copied).
+             */
+            static void SetThreadName(const std::string_view name) {
+                Profiler& pr = utils::Profiler::get();
+                Profiler::thread_name = name;
+
+                if (ThreadBuffer *buffer = pr.thread_buffer()) {
+                    LOCK_BLOCK(pr.buffers_mutex);
+                    buffer->name       = Profiler::thread_name;
+                    buffer->name_dirty = true;
+                }
+            }
+
+            /**
+             *  \brief  Install (or remove) ThreadPoolHooks on all ThreadPools that
+             *          record, per task, the time between enqueue and start
+             *          ("ThreadPool::queued" async slices and statistics), the run
+             *          time ("ThreadPool::task" scopes), a flow from the enqueuing
+             *          scope to the task, and the queue depth as counter.
+             *          Workers are named in the trace on their first task.
+             */
+            static void InstrumentThreadPools(const bool enable = true) {
+                static constexpr utils::threading::ThreadPoolHooks hooks = {
+                    &Profiler::pool_enqueue,
+                    &Profiler::pool_start,
+                    &Profiler::pool_finish
+                };
+
+                utils::threading::ThreadPool::set_hooks(enable ? &hooks : nullptr);
+            }
+
+            static inline bool IsActive() {
+                return utils::Profiler::get().session.load(std::memory_order_relaxed) != 0;
             }
 
             ATTR_NODISCARD ATTR_MAYBE_UNUSED
@@ -134,14 +983,31 @@ namespace utils {
 
 #if defined(UTILS_PROFILER_ENABLE) && UTILS_PROFILER_ENABLE
     #define UTILS_PROFILE_BEGIN_SESSION(filepath) utils::Profiler::BeginSession(filepath)
+    #define UTILS_PROFILE_BEGIN_AGGREGATE(filepath, sample_every) \
+        utils::Profiler::BeginSession(filepath, utils::Profiler::Mode::Aggregate, sample_every)
     #define UTILS_PROFILE_END_SESSION()           utils::Profiler::EndSession()
     #define UTILS_PROFILE_SCOPE(name)             auto HEDLEY_CONCAT(profile_scope_, __LINE__) = utils::Profiler::CreateTimer(name)
     #define UTILS_PROFILE_FUNCTION()              UTILS_PROFILE_SCOPE(UTILS_FUNCTION_NAME)
+    #define UTILS_PROFILE_COUNTER(name, value)    utils::Profiler::Counter(name, value)
+    #define UTILS_PROFILE_ASYNC_BEGIN(name, id)   utils::Profiler::AsyncBegin(name, id)
+    #define UTILS_PROFILE_ASYNC_END(name, id)     utils::Profiler::AsyncEnd(name, id)
+    #define UTILS_PROFILE_FLOW_START(name, id)    utils::Profiler::FlowStart(name, id)
+    #define UTILS_PROFILE_FLOW_END(name, id)      utils::Profiler::FlowEnd(name, id)
+    #define UTILS_PROFILE_INSTANT(name)           utils::Profiler::Instant(name)
+    #define UTILS_PROFILE_THREAD_NAME(name)       utils::Profiler::SetThreadName(name)
 #else
     #define UTILS_PROFILE_BEGIN_SESSION(filepath)
+    #define UTILS_PROFILE_BEGIN_AGGREGATE(filepath, sample_every)
     #define UTILS_PROFILE_END_SESSION()
     #define UTILS_PROFILE_SCOPE(name)
     #define UTILS_PROFILE_FUNCTION()
+    #define UTILS_PROFILE_COUNTER(name, value)
+    #define UTILS_PROFILE_ASYNC_BEGIN(name, id)
+    #define UTILS_PROFILE_ASYNC_END(name, id)
+    #define UTILS_PROFILE_FLOW_START(name, id)
+    #define UTILS_PROFILE_FLOW_END(name, id)
+    #define UTILS_PROFILE_INSTANT(name)
+    #define UTILS_PROFILE_THREAD_NAME(name)
 #endif
 
 #endif // UTILS_PROFILER_HPP
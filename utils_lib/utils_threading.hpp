@@ -8,9 +8,18 @@
 #include <thread>
 #include <future>
 #include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 
 #include <vector>
-#include <queue>
+#include <memory>
+#include <tuple>
+#include <new>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <exception>
 
 #include <functional>
 
@@ -21,24 +30,669 @@
 
 
 namespace utils::threading {
+    /**
+     *  \brief  A move-only `void()` callable with small buffer optimization.
+     *
+     *          Callables up to Task::INLINE_SIZE bytes (that are nothrow
+     *          move constructible) are stored inline, larger ones on the heap.
+     */
+    class Task {
+        public:
+            static constexpr size_t INLINE_SIZE = 48;
+
+        private:
+            struct Ops {
+                void (*invoke) (void*);
+                void (*move)   (void* dst, void* src) noexcept;
+                void (*destroy)(void*) noexcept;
+            };
+
+            template<class F>
+            struct InlineOps {
+                static void invoke(void *p) {
+                    (*static_cast<F*>(p))();
+                }
+                static void move(void *dst, void *src) noexcept {
+                    ::new (dst) F(std::move(*static_cast<F*>(src)));
+                    static_cast<F*>(src)->~F();
+                }
+                static void destroy(void *p) noexcept {
+                    static_cast<F*>(p)->~F();
+                }
+            };
+
+            template<class F>
+            struct HeapOps {
+                static void invoke(void *p) {
+                    (**static_cast<F**>(p))();
+                }
+                static void move(void *dst, void *src) noexcept {
+                    *static_cast<F**>(dst) = *static_cast<F**>(src);
+                }
+                static void destroy(void *p) noexcept {
+                    delete *static_cast<F**>(p);
+                }
+            };
+
+            template<class Impl>
+            static inline constexpr Ops ops_for = { &Impl::invoke, &Impl::move, &Impl::destroy };
+
+            alignas(std::max_align_t) unsigned char storage[INLINE_SIZE];
+            const Ops *ops;
+
+        public:
+            /**
+             *  \brief  Whether a callable of type \p F will be stored without allocation.
+             */
+            template<class F>
+            static inline constexpr bool fits_inline_v =
+                   sizeof(F)  <= INLINE_SIZE
+                && alignof(F) <= alignof(std::max_align_t)
+                && std::is_nothrow_move_constructible_v<F>;
+
+            Task() noexcept : ops(nullptr) {}
+
+            template<
+                class F,
+                class Fn = std::decay_t<F>,
+                class = std::enable_if_t<!std::is_same_v<Fn, Task>>
+            >
+            Task(F&& f) : ops(nullptr) {
+                static_assert(utils::traits::is_invocable_v<Fn&>,
+                              "Task: Callable function required.");
+
+                if constexpr (Task::fits_inline_v<Fn>) {
+                    ::new (static_cast<void*>(this->storage)) Fn(std::forward<F>(f));
+                    this->ops = &Task::ops_for<InlineOps<Fn>>;
+                } else {
+                    *reinterpret_cast<Fn**>(this->storage) = new Fn(std::forward<F>(f));
+                    this->ops = &Task::ops_for<HeapOps<Fn>>;
+                }
+            }
+
+            Task(Task&& other) noexcept : ops(other.ops) {
+                if (this->ops) {
+                    this->ops->move(this->storage, other.storage);
+                    other.ops = nullptr;
+                }
+            }
+
+            Task& operator=(Task&& other) noexcept {
+                if (this != &other) {
+                    this->reset();
+
+                    if (other.ops) {
+                        other.ops->move(this->storage, other.storage);
+                        this->ops = other.ops;
+                        other.ops = nullptr;
+                    }
+                }
+
+                return *this;
+            }
+
+            Task(const Task&)            = delete;
+            Task& operator=(const Task&) = delete;
+
+            ~Task() {
+                this->reset();
+            }
+
+            /**
+             *  \brief  Destroy the stored callable, if any.
+             */
+            inline void reset(void) noexcept {
+                if (this->ops) {
+                    this->ops->destroy(this->storage);
+                    this->ops = nullptr;
+                }
+            }
+
+            inline explicit operator bool() const noexcept {
+                return this->ops != nullptr;
+            }
+
+            inline void operator()() {
+                this->ops->invoke(this->storage);
+            }
+    };
+
+    /**
+     *  \brief  A bounded lock-free multi-producer/multi-consumer ring buffer.
+     *
+     *          Every slot carries a sequence number that tells producers and
+     *          consumers whether it is free or filled (Vyukov), so pushing and
+     *          popping is a single CAS on the respective position.
+     *
+     *          Slots are constructed once and reused: producers fill and
+     *          consumers read them in place through a callback, so a T that
+     *          owns memory (e.g. a std::string) keeps its capacity between
+     *          uses and the steady state does not allocate.
+     */
+    template<class T>
+    class RingBuffer {
+        private:
+            struct alignas(64) Slot {
+                std::atomic<size_t> sequence;
+                T value;
+            };
+
+            const size_t mask;
+            std::unique_ptr<Slot[]> slots;
+
+            alignas(64) std::atomic<size_t> enqueue_pos;
+            alignas(64) std::atomic<size_t> dequeue_pos;
+
+            static constexpr size_t round_capacity(size_t capacity) {
+                size_t cap = 2;
+                while (cap < capacity) cap <<= 1;
+                return cap;
+            }
+
+        public:
+            /**
+             *  \brief  Create a ring with room for at least \p capacity
+             *          elements (rounded up to a power of 2).
+             */
+            explicit RingBuffer(const size_t capacity)
+                : mask(RingBuffer::round_capacity(capacity) - 1)
+                , slots(new Slot[this->mask + 1])
+                , enqueue_pos(0)
+                , dequeue_pos(0)
+            {
+                for (size_t i = 0; i <= this->mask; i++) {
+                    this->slots[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            RingBuffer(const RingBuffer&)            = delete;
+            RingBuffer& operator=(const RingBuffer&) = delete;
+
+            /**
+             *  \brief  Claim a free slot and fill it in place.
+             *
+             *  \param  fill
+             *      Called as `fill(T&)` on the claimed slot. Must not throw.
+             *  \return Returns false if the ring is full.
+             */
+            template<class F>
+            bool try_push_with(F&& fill) {
+                size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+                Slot *slot;
+
+                for (;;) {
+                    slot = &this->slots[pos & this->mask];
+                    const size_t seq  = slot->sequence.load(std::memory_order_acquire);
+                    const auto   diff = std::ptrdiff_t(seq) - std::ptrdiff_t(pos);
+
+                    if (diff == 0) {
+                        if (this->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if (diff < 0) {
+                        return false;
+                    } else {
+                        pos = this->enqueue_pos.load(std::memory_order_relaxed);
+                    }
+                }
+
+                fill(slot->value);
+                slot->sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+
+            /**
+             *  \brief  Take the oldest filled slot and read it in place.
+             *
+             *  \param  consume
+             *      Called as `consume(T&)` on the slot before it is released.
+             *      Must not throw.
+             *  \return Returns false if the ring is empty (or the oldest
+             *          element is still being filled).
+             */
+            template<class F>
+            bool try_pop_with(F&& consume) {
+                size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+                Slot *slot;
+
+                for (;;) {
+                    slot = &this->slots[pos & this->mask];
+                    const size_t seq  = slot->sequence.load(std::memory_order_acquire);
+                    const auto   diff = std::ptrdiff_t(seq) - std::ptrdiff_t(pos + 1);
+
+                    if (diff == 0) {
+                        if (this->dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if (diff < 0) {
+                        return false;
+                    } else {
+                        pos = this->dequeue_pos.load(std::memory_order_relaxed);
+                    }
+                }
+
+                consume(slot->value);
+                slot->sequence.store(pos + this->mask + 1, std::memory_order_release);
+                return true;
+            }
+
+            inline size_t capacity(void) const noexcept {
+                return this->mask + 1;
+            }
+
+            /**
+             *  \brief  Total number of slots ever claimed by producers.
+             */
+            inline size_t pushed(void) const noexcept {
+                return this->enqueue_pos.load();
+            }
+
+            /**
+             *  \brief  Total number of slots ever claimed by consumers.
+             */
+            inline size_t popped(void) const noexcept {
+                return this->dequeue_pos.load();
+            }
+
+            /**
+             *  \brief  Approximate element count (exact when quiescent).
+             */
+            inline size_t size(void) const noexcept {
+                const size_t out = this->popped();
+                const size_t in  = this->pushed();
+                return in > out ? in - out : 0;
+            }
+
+            inline bool empty(void) const noexcept {
+                return this->size() == 0;
+            }
+    };
+
+    template<class T>
+    class TaskFuture;
+
+    class ThreadPool;
+
+    /**
+     *  \brief  Optional callbacks to instrument every ThreadPool, see
+     *          ThreadPool::set_hooks(). Times are steady_clock nanoseconds
+     *          since its epoch. Any member may be nullptr.
+     */
+    struct ThreadPoolHooks {
+        /// Called on the enqueuing thread after a task was queued at \p enqueue_ns.
+        void (*on_enqueue)(ThreadPool& pool, uint64_t task_id, int64_t enqueue_ns);
+        /// Called on worker \p worker right before running a task.
+        void (*on_start)(ThreadPool& pool, size_t worker, uint64_t task_id, int64_t enqueue_ns, int64_t start_ns);
+        /// Called on the worker right after the task returned.
+        void (*on_finish)(ThreadPool& pool, uint64_t task_id, int64_t start_ns, int64_t end_ns);
+    };
+
     /**
      *  \brief  The ThreadPool class
      *
      *          Adapted from https://github.com/progschj/ThreadPool
      *                       https://github.com/jhasse/ThreadPool
+     *
+     *          In Mode::SharedQueue (default) all workers take tasks from a
+     *          single queue behind one mutex.
+     *
+     *          In Mode::WorkStealing every worker owns a deque: tasks enqueued
+     *          from within a worker are pushed on its own deque (and popped LIFO),
+     *          tasks from other threads are distributed round-robin, and idle
+     *          workers steal the oldest task from the other deques.
+     *
+     *          Tasks are stored in intrusive nodes that are recycled through
+     *          a free list per queue, so after warm-up, post() with a small
+     *          callable does not allocate.
+     *
+     *          While ThreadPoolHooks are installed, every task gets an id and
+     *          an enqueue time, and the hooks are called around it.
      */
     class ThreadPool {
+        public:
+            enum class Mode {
+                SharedQueue,
+                WorkStealing,
+            };
+
         private:
+            struct TaskNode {
+                TaskNode *prev = nullptr;
+                TaskNode *next = nullptr;
+                Task      task;
+                uint64_t  id          = 0;   ///< Non-zero if hooks were installed on enqueue
+                int64_t   enqueued_ns = 0;
+            };
+
+            /**
+             *  \brief  Doubly linked list of pending task nodes, with a free list
+             *          of recycled nodes. Must be guarded by the owner's mutex.
+             */
+            struct TaskQueue {
+                TaskNode *head       = nullptr;
+                TaskNode *tail       = nullptr;
+                TaskNode *free_nodes = nullptr;
+                size_t    count      = 0;
+
+                TaskQueue() = default;
+                TaskQueue(const TaskQueue&) = delete;
+                TaskQueue& operator=(const TaskQueue&) = delete;
+
+                ~TaskQueue() {
+                    while (this->head) {
+                        delete this->pop_front();
+                    }
+
+                    while (this->free_nodes) {
+                        TaskNode *node = this->free_nodes;
+                        this->free_nodes = node->next;
+                        delete node;
+                    }
+                }
+
+                inline bool empty(void) const {
+                    return this->count == 0;
+                }
+
+                inline size_t size(void) const {
+                    return this->count;
+                }
+
+                inline void push_back(Task&& task, const uint64_t id, const int64_t enqueued_ns) {
+                    TaskNode *node = this->free_nodes;
+
+                    if (HEDLEY_LIKELY(node != nullptr)) {
+                        this->free_nodes = node->next;
+                    } else {
+                        node = new TaskNode;
+                    }
+
+                    node->task        = std::move(task);
+                    node->id          = id;
+                    node->enqueued_ns = enqueued_ns;
+                    node->next        = nullptr;
+                    node->prev = this->tail;
+
+                    if (this->tail) {
+                        this->tail->next = node;
+                    } else {
+                        this->head = node;
+                    }
+
+                    this->tail = node;
+                    ++this->count;
+                }
+
+                inline TaskNode* pop_front(void) {
+                    TaskNode *node = this->head;
+                    this->head = node->next;
+
+                    if (this->head) {
+                        this->head->prev = nullptr;
+                    } else {
+                        this->tail = nullptr;
+                    }
+
+                    --this->count;
+                    return node;
+                }
+
+                inline TaskNode* pop_back(void) {
+                    TaskNode *node = this->tail;
+                    this->tail = node->prev;
+
+                    if (this->tail) {
+                        this->tail->next = nullptr;
+                    } else {
+                        this->head = nullptr;
+                    }
+
+                    --this->count;
+                    return node;
+                }
+
+                /**
+                 *  \brief  Return an executed node (with an empty task) to the free list.
+                 */
+                inline void release(TaskNode *node) {
+                    node->next = this->free_nodes;
+                    this->free_nodes = node;
+                }
+            };
+
+            /**
+             *  \brief  Per-worker task deque for Mode::WorkStealing.
+             *          Aligned to avoid false sharing between neighbouring workers.
+             */
+            struct alignas(64) WorkerQueue {
+                std::mutex mutex;
+                TaskQueue  tasks;
+            };
+
             // Need to keep track of threads so we can join them
             std::vector<std::thread> workers;
 
             // The task queue
-            std::queue<std::packaged_task<void()>> tasks;
+            TaskQueue tasks;
+
+            // Per-worker queues and bookkeeping for Mode::WorkStealing
+            const Mode mode;
+            size_t     worker_count;
+            std::unique_ptr<WorkerQueue[]> local_queues;
+            std::atomic<size_t> pending;
+            std::atomic<size_t> idle;
+            std::atomic<size_t> next_queue;
 
             // Synchronization
             std::mutex queue_mutex;
             std::condition_variable condition;
-            bool stop;
+            std::atomic<bool> stop;
+
+            /**
+             *  \brief  The pool and index of the worker running on the current thread,
+             *          used to push tasks enqueued from a worker on its own deque.
+             */
+            static inline thread_local ThreadPool *current_pool  = nullptr;
+            static inline thread_local size_t      current_index = 0;
+
+            static inline std::atomic<const ThreadPoolHooks*> hooks{nullptr};
+            static inline std::atomic<uint64_t>               next_task_id{1};
+
+            static inline int64_t now_ns(void) {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()
+                ).count();
+            }
+
+            /**
+             *  \brief  Run the task in \p node on worker \p index and clear it.
+             */
+            inline void run_node(TaskNode *node, const size_t index) {
+                if (HEDLEY_UNLIKELY(node->id != 0)) {
+                    const ThreadPoolHooks *h = ThreadPool::hooks.load(std::memory_order_acquire);
+                    const int64_t start = ThreadPool::now_ns();
+
+                    if (h && h->on_start) {
+                        h->on_start(*this, index, node->id, node->enqueued_ns, start);
+                    }
+
+                    node->task();
+
+                    if (h && h->on_finish) {
+                        h->on_finish(*this, node->id, start, ThreadPool::now_ns());
+                    }
+                } else {
+                    node->task();
+                }
+
+                node->task.reset();
+            }
+
+            /**
+             *  \brief  Pop a task from the back of the own deque, or steal one
+             *          from the front of another worker's deque.
+             *
+             *  \param  index
+             *      The index of the calling worker.
+             *  \param  spare
+             *      A previously executed node to recycle, or nullptr.
+             *  \return Returns the retrieved node, or nullptr.
+             */
+            inline TaskNode* try_pop_task(const size_t index, TaskNode *spare) {
+                const size_t count = this->worker_count;
+
+                for (size_t i = 0; i < count; ++i) {
+                    WorkerQueue& queue = this->local_queues[(index + i) % count];
+                    LOCK_BLOCK(queue.mutex);
+
+                    if (spare) {
+                        queue.tasks.release(spare);
+                        spare = nullptr;
+                    }
+
+                    if (!queue.tasks.empty()) {
+                        this->pending.fetch_sub(1);
+                        return (i == 0) ? queue.tasks.pop_back()
+                                        : queue.tasks.pop_front();
+                    }
+                }
+
+                return nullptr;
+            }
+
+            inline void run_shared_worker(const size_t index) {
+                TaskNode *spare = nullptr;
+
+                while(true) {
+                    TaskNode *node;
+
+                    {
+                        LOCK_UNIQUE_BLOCK(this->queue_mutex);
+
+                        if (spare) {
+                            this->tasks.release(spare);
+                            spare = nullptr;
+                        }
+
+                        this->condition.wait(__lock, [this]{
+                            return this->stop || !this->tasks.empty();
+                        });
+
+                        if (this->stop && this->tasks.empty())
+                            return;
+
+                        node = this->tasks.pop_front();
+                    }
+
+                    this->run_node(node, index);
+                    spare = node;
+                }
+            }
+
+            inline void run_stealing_worker(const size_t index) {
+                ThreadPool::current_pool  = this;
+                ThreadPool::current_index = index;
+
+                TaskNode *spare = nullptr;
+
+                while(true) {
+                    if (TaskNode *node = this->try_pop_task(index, spare); node) {
+                        this->run_node(node, index);
+                        spare = node;
+                        continue;
+                    }
+
+                    spare = nullptr;
+
+                    LOCK_UNIQUE_BLOCK(this->queue_mutex);
+
+                    // Announce sleeping before re-checking pending, so enqueue()
+                    // either sees an idle worker or we see its task.
+                    this->idle.fetch_add(1);
+                    this->condition.wait(__lock, [this]{
+                        return this->stop || this->pending.load() > 0;
+                    });
+                    this->idle.fetch_sub(1);
+
+                    if (this->stop && this->pending.load() == 0)
+                        return;
+                }
+            }
+
+            /**
+             *  \brief  Add a task to the pool according to the pool's mode.
+             */
+            inline void push_task(Task&& task) {
+                const ThreadPoolHooks *h = ThreadPool::hooks.load(std::memory_order_acquire);
+                uint64_t id       = 0;
+                int64_t  enqueued = 0;
+
+                if (HEDLEY_UNLIKELY(h != nullptr)) {
+                    id       = ThreadPool::next_task_id.fetch_add(1, std::memory_order_relaxed);
+                    enqueued = ThreadPool::now_ns();
+                }
+
+                this->push_task_node(std::move(task), id, enqueued);
+
+                if (HEDLEY_UNLIKELY(h != nullptr && h->on_enqueue != nullptr)) {
+                    h->on_enqueue(*this, id, enqueued);
+                }
+            }
+
+            inline void push_task_node(Task&& task, const uint64_t id, const int64_t enqueued) {
+                if (this->mode == Mode::SharedQueue) {
+                    {
+                        LOCK_BLOCK(this->queue_mutex);
+
+                        // Don't allow enqueueing after stopping the pool
+                        if (this->stop)
+                            throw utils::exceptions::Exception("ThreadPool::enqueue",
+                                                               "Pool already stopped, cannot enqueue.");
+
+                        this->tasks.push_back(std::move(task), id, enqueued);
+                    }
+
+                    this->condition.notify_one();
+                    return;
+                }
+
+                if (HEDLEY_UNLIKELY(this->stop))
+                    throw utils::exceptions::Exception("ThreadPool::enqueue",
+                                                       "Pool already stopped, cannot enqueue.");
+
+                const size_t index = (ThreadPool::current_pool == this)
+                                   ? ThreadPool::current_index
+                                   : this->next_queue.fetch_add(1) % this->worker_count;
+
+                {
+                    WorkerQueue& queue = this->local_queues[index];
+                    LOCK_BLOCK(queue.mutex);
+                    this->pending.fetch_add(1);
+                    queue.tasks.push_back(std::move(task), id, enqueued);
+                }
+
+                if (this->idle.load() > 0) {
+                    // Lock to make sure a worker that is about to sleep has reached wait().
+                    { LOCK_BLOCK(this->queue_mutex); }
+                    this->condition.notify_one();
+                }
+            }
+
+            /**
+             *  \brief  Wrap \p f and \p args in a single callable without std::bind.
+             *          Arguments are decay-copied, std::reference_wrapper is unwrapped.
+             */
+            template<class F, class ...Args>
+            static inline auto bind_args(F&& f, Args&& ... args) {
+                if constexpr (sizeof...(Args) == 0) {
+                    return std::forward<F>(f);
+                } else {
+                    return [f    = std::forward<F>(f),
+                            args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                        return std::apply(std::move(f), std::move(args));
+                    };
+                }
+            }
 
         public:
             /**
@@ -46,35 +700,32 @@ namespace utils::threading {
              *
              *  \param  threads
              *      The amount of worker threads to create.
+             *  \param  mode
+             *      The scheduling mode, see ThreadPool::Mode.
              */
-            inline explicit ThreadPool(size_t threads)
-                : stop(false)
+            inline explicit ThreadPool(size_t threads, Mode mode = Mode::SharedQueue)
+                : mode(mode)
+                , pending(0)
+                , idle(0)
+                , next_queue(0)
+                , stop(false)
             {
-                this->workers.reserve(threads);
-
-                for (size_t i = 0; i < threads; ++i) {
-                    this->workers.emplace_back( [this] {
-                            while(true) {
-                                std::packaged_task<void()> task;
+                if (HEDLEY_UNLIKELY(threads == 0))
+                    threads = 1;
 
-                                {
-                                    LOCK_UNIQUE_BLOCK(this->queue_mutex);
-
-                                    this->condition.wait(__lock, [this]{
-                                        return this->stop || !this->tasks.empty();
-                                    });
-
-                                    if (this->stop && this->tasks.empty())
-                                        return;
+                this->worker_count = threads;
+                this->workers.reserve(threads);
 
-                                    task = std::move(this->tasks.front());
-                                    this->tasks.pop();
-                                }
+                if (this->mode == Mode::WorkStealing) {
+                    this->local_queues = std::make_unique<WorkerQueue[]>(threads);
+                }
 
-                                task();
-                            }
-                        }
-                    );
+                for (size_t i = 0; i < threads; ++i) {
+                    if (this->mode == Mode::WorkStealing) {
+                        this->workers.emplace_back([this, i] { this->run_stealing_worker(i); });
+                    } else {
+                        this->workers.emplace_back([this, i] { this->run_shared_worker(i); });
+                    }
                 }
             }
 
@@ -94,10 +745,31 @@ namespace utils::threading {
             }
 
             inline size_t size(void) const {
-                return this->workers.size();
+                return this->worker_count;
+            }
+
+            inline Mode get_mode(void) const {
+                return this->mode;
+            }
+
+            /**
+             *  \brief  Install instrumentation \p h for all pools, or remove it with nullptr.
+             *          \p h must stay valid while installed, and while tasks
+             *          enqueued under it are still running.
+             */
+            static inline void set_hooks(const ThreadPoolHooks *h) {
+                ThreadPool::hooks.store(h, std::memory_order_release);
+            }
+
+            static inline const ThreadPoolHooks* get_hooks(void) {
+                return ThreadPool::hooks.load(std::memory_order_acquire);
             }
 
             inline size_t tasks_in_queue(void) {
+                if (this->mode == Mode::WorkStealing) {
+                    return this->pending.load();
+                }
+
                 LOCK_BLOCK(this->queue_mutex);
                 return this->tasks.size();
             }
@@ -112,26 +784,445 @@ namespace utils::threading {
                               "ThreadPool::enqueue: Callable function required.");
 
                 std::packaged_task<result_type_t()> task(
-                    std::bind(std::forward<F>(f), std::forward<Args>(args)...)
+                    ThreadPool::bind_args(std::forward<F>(f), std::forward<Args>(args)...)
                 );
 
                 std::future<result_type_t> res = task.get_future();
+                this->push_task(Task(std::move(task)));
+
+                return res;
+            }
+
+            /**
+             *  \brief  Fire-and-forget variant of enqueue(): no future is created
+             *          and the result of \p f is discarded.
+             *
+             *          If the bound callable fits in Task::INLINE_SIZE, this does
+             *          not allocate once the pool's free lists are warmed up.
+             *          An exception escaping \p f will call std::terminate().
+             */
+            template<class F, class ...Args>
+            void post(F&& f, Args&& ... args) {
+                static_assert(utils::traits::is_invocable_v<F, Args...>,
+                              "ThreadPool::post: Callable function required.");
+
+                this->push_task(Task(ThreadPool::bind_args(std::forward<F>(f), std::forward<Args>(args)...)));
+            }
+
+            /**
+             *  \brief  Like enqueue(), but return a TaskFuture that supports
+             *          continuations with then(), when_all() and when_any().
+             */
+            template<
+                class F,
+                class ...Args,
+                class result_type_t = typename std::invoke_result_t<F, Args...>
+            >
+            TaskFuture<result_type_t> submit(F&& f, Args&& ... args);
+    };
+
+    namespace internal {
+        /**
+         *  \brief  Shared state of a TaskFuture: the result (or exception)
+         *          and the continuations to run once it becomes ready.
+         */
+        template<class T>
+        struct FutureState {
+            using stored_t = std::conditional_t<std::is_void_v<T>, bool, T>;
+
+            std::mutex              mutex;
+            std::condition_variable condition;
+            bool                    ready = false;
+            std::optional<stored_t> value;
+            std::exception_ptr      error;
+            std::vector<Task>       continuations;
+
+            /**
+             *  \brief  Run \p cont once the state is ready, on the thread that
+             *          makes it ready, or immediately if it already is.
+             *          Continuations should be short and must not throw.
+             */
+            inline void on_ready(Task&& cont) {
                 {
-                    LOCK_BLOCK(this->queue_mutex);
+                    LOCK_BLOCK(this->mutex);
+
+                    if (!this->ready) {
+                        this->continuations.emplace_back(std::move(cont));
+                        return;
+                    }
+                }
+
+                cont();
+            }
+
+            template<class ...V>
+            inline void set_value(V&& ... v) {
+                std::vector<Task> conts;
 
-                    // Don't allow enqueueing after stopping the pool
-                    if (this->stop)
-                        throw utils::exceptions::Exception("ThreadPool::enqueue",
-                                                           "Pool already stopped, cannot enqueue.");
+                {
+                    LOCK_BLOCK(this->mutex);
+                    this->value.emplace(std::forward<V>(v)...);
+                    this->ready = true;
+                    conts.swap(this->continuations);
+                }
+
+                this->condition.notify_all();
 
-                    this->tasks.emplace(std::move(task));
+                for (Task& cont : conts) {
+                    cont();
                 }
+            }
 
-                this->condition.notify_one();
+            inline void set_error(std::exception_ptr e) {
+                std::vector<Task> conts;
 
-                return res;
+                {
+                    LOCK_BLOCK(this->mutex);
+                    this->error = std::move(e);
+                    this->ready = true;
+                    conts.swap(this->continuations);
+                }
+
+                this->condition.notify_all();
+
+                for (Task& cont : conts) {
+                    cont();
+                }
+            }
+
+            inline bool is_ready(void) {
+                LOCK_BLOCK(this->mutex);
+                return this->ready;
+            }
+
+            inline void wait(void) {
+                LOCK_UNIQUE_BLOCK(this->mutex);
+                this->condition.wait(__lock, [this]{ return this->ready; });
+            }
+        };
+
+        /**
+         *  \brief  Invoke \p f with \p args and store the result or exception in \p state.
+         */
+        template<class T, class F, class ...Args>
+        static inline void fulfill(FutureState<T>& state, F&& f, Args&& ... args) {
+            std::optional<typename FutureState<T>::stored_t> result;
+
+            try {
+                if constexpr (std::is_void_v<T>) {
+                    std::invoke(std::forward<F>(f), std::forward<Args>(args)...);
+                    result.emplace(true);
+                } else {
+                    result.emplace(std::invoke(std::forward<F>(f), std::forward<Args>(args)...));
+                }
+            } catch (...) {
+                state.set_error(std::current_exception());
+                return;
+            }
+
+            state.set_value(std::move(*result));
+        }
+
+        /**
+         *  \brief  The result type of a continuation \p F on a TaskFuture<T>.
+         */
+        template<class F, class T>
+        struct continuation_result {
+            using type = std::invoke_result_t<F, const T&>;
+        };
+
+        template<class F>
+        struct continuation_result<F, void> {
+            using type = std::invoke_result_t<F>;
+        };
+
+        struct FutureAccess;
+    }
+
+    /**
+     *  \brief  Result of utils::threading::when_any: the index of the first
+     *          future that became ready, and all the given futures.
+     */
+    template<class Sequence>
+    struct WhenAnyResult {
+        size_t   index;
+        Sequence futures;
+    };
+
+    /**
+     *  \brief  A shareable handle to the result of a task submitted with
+     *          ThreadPool::submit(), which can be chained without blocking.
+     *
+     *          then() schedules a continuation on the same pool once this
+     *          result is ready, when_all() and when_any() combine several
+     *          futures. Unlike get(), none of these block a thread, so a
+     *          graph of any size can run on a pool with a single worker.
+     *
+     *          Exceptions are propagated along then() chains: a continuation
+     *          of a failed task is not run, and get() on it rethrows.
+     *          The pool must outlive all pending continuations.
+     */
+    template<class T>
+    class TaskFuture {
+        private:
+            friend struct internal::FutureAccess;
+
+            std::shared_ptr<internal::FutureState<T>> state;
+            ThreadPool *pool;
+
+        public:
+            using value_type = T;
+
+            TaskFuture() : pool(nullptr) {}
+
+            TaskFuture(std::shared_ptr<internal::FutureState<T>> state, ThreadPool *pool)
+                : state(std::move(state))
+                , pool(pool)
+            {
+                // Empty
+            }
+
+            inline bool valid(void) const {
+                return this->state != nullptr;
+            }
+
+            inline bool is_ready(void) const {
+                return this->state->is_ready();
+            }
+
+            inline ThreadPool& get_pool(void) const {
+                return *this->pool;
+            }
+
+            /**
+             *  \brief  Block until the result is ready.
+             *          Avoid this inside tasks, use then() instead.
+             */
+            inline void wait(void) const {
+                this->state->wait();
+            }
+
+            /**
+             *  \brief  Wait for and return the result, or rethrow the task's exception.
+             */
+            inline decltype(auto) get(void) const {
+                this->wait();
+
+                if (this->state->error) {
+                    std::rethrow_exception(this->state->error);
+                }
+
+                if constexpr (!std::is_void_v<T>) {
+                    return static_cast<const T&>(*this->state->value);
+                }
+            }
+
+            /**
+             *  \brief  Schedule \p f on the pool once this result is ready.
+             *
+             *  \param  f
+             *      The continuation, invocable with `const T&` (or nothing for void).
+             *  \return Returns a TaskFuture for the result of \p f.
+             */
+            template<class F>
+            auto then(F&& f) const {
+                using result_t = typename internal::continuation_result<F, T>::type;
+
+                auto next = std::make_shared<internal::FutureState<result_t>>();
+
+                this->state->on_ready(
+                    [parent = this->state, next, pool = this->pool, fn = std::decay_t<F>(std::forward<F>(f))]() mutable {
+                        if (parent->error) {
+                            next->set_error(parent->error);
+                            return;
+                        }
+
+                        // This may run on a worker while the pool is stopping, so a
+                        // failed post must end up in next instead of leaving the worker.
+                        try {
+                            pool->post([parent, next, fn = std::move(fn)]() mutable {
+                                if constexpr (std::is_void_v<T>) {
+                                    internal::fulfill(*next, fn);
+                                } else {
+                                    internal::fulfill(*next, fn, std::as_const(*parent->value));
+                                }
+                            });
+                        } catch (...) {
+                            next->set_error(std::current_exception());
+                        }
+                    }
+                );
+
+                return TaskFuture<result_t>(std::move(next), this->pool);
             }
     };
+
+    namespace internal {
+        struct FutureAccess {
+            template<class T>
+            static inline auto& state(const TaskFuture<T>& f) {
+                return f.state;
+            }
+
+            template<class T>
+            static inline ThreadPool* pool(const TaskFuture<T>& f) {
+                return f.pool;
+            }
+        };
+
+        /**
+         *  \brief  Register a continuation on every future in \p ctx->futures that
+         *          sets \p next to its index, for the first one to become ready.
+         */
+        template<class Context, class Result, size_t ...I>
+        static inline void when_any_register(const std::shared_ptr<Context>& ctx,
+                                             const std::shared_ptr<FutureState<Result>>& next,
+                                             std::index_sequence<I...>)
+        {
+            (FutureAccess::state(std::get<I>(ctx->futures))->on_ready([ctx, next] {
+                if (!ctx->done.exchange(true)) {
+                    next->set_value(Result{ I, ctx->futures });
+                }
+            }), ...);
+        }
+    }
+
+    template<class F, class ...Args, class result_type_t>
+    TaskFuture<result_type_t> ThreadPool::submit(F&& f, Args&& ... args) {
+        static_assert(utils::traits::is_invocable_v<F, Args...>,
+                      "ThreadPool::submit: Callable function required.");
+
+        auto state = std::make_shared<internal::FutureState<result_type_t>>();
+
+        this->post([state, fn = ThreadPool::bind_args(std::forward<F>(f), std::forward<Args>(args)...)]() mutable {
+            internal::fulfill(*state, fn);
+        });
+
+        return TaskFuture<result_type_t>(std::move(state), this);
+    }
+
+    /**
+     *  \brief  Return a future that becomes ready when all \p futures are ready.
+     *          Exceptions are not propagated, call get() on the contained futures.
+     *
+     *  \param  futures
+     *      The futures to wait for, must not be empty.
+     *  \return Returns a TaskFuture holding the (ready) futures.
+     */
+    template<class T>
+    static inline TaskFuture<std::vector<TaskFuture<T>>> when_all(const std::vector<TaskFuture<T>>& futures) {
+        using result_t = std::vector<TaskFuture<T>>;
+
+        if (HEDLEY_UNLIKELY(futures.empty()))
+            throw utils::exceptions::Exception("utils::threading::when_all", "No futures given.");
+
+        struct Context {
+            std::atomic<size_t> remaining;
+            result_t            futures;
+        };
+
+        auto next = std::make_shared<internal::FutureState<result_t>>();
+        auto ctx  = std::make_shared<Context>();
+        ctx->remaining = futures.size();
+        ctx->futures   = futures;
+
+        for (const auto& f : futures) {
+            internal::FutureAccess::state(f)->on_ready([ctx, next] {
+                if (ctx->remaining.fetch_sub(1) == 1) {
+                    next->set_value(std::move(ctx->futures));
+                }
+            });
+        }
+
+        return TaskFuture<result_t>(std::move(next), internal::FutureAccess::pool(futures.front()));
+    }
+
+    template<class T, class ...Ts>
+    static inline TaskFuture<std::tuple<TaskFuture<T>, TaskFuture<Ts>...>>
+    when_all(const TaskFuture<T>& first, const TaskFuture<Ts>& ... rest) {
+        using result_t = std::tuple<TaskFuture<T>, TaskFuture<Ts>...>;
+
+        struct Context {
+            std::atomic<size_t> remaining;
+            result_t            futures;
+        };
+
+        auto next = std::make_shared<internal::FutureState<result_t>>();
+        auto ctx  = std::make_shared<Context>();
+        ctx->remaining = 1 + sizeof...(Ts);
+        ctx->futures   = result_t(first, rest...);
+
+        const auto cont = [&] {
+            return [ctx, next] {
+                if (ctx->remaining.fetch_sub(1) == 1) {
+                    next->set_value(std::move(ctx->futures));
+                }
+            };
+        };
+
+        internal::FutureAccess::state(first)->on_ready(cont());
+        (internal::FutureAccess::state(rest)->on_ready(cont()), ...);
+
+        return TaskFuture<result_t>(std::move(next), internal::FutureAccess::pool(first));
+    }
+
+    /**
+     *  \brief  Return a future that becomes ready when any of \p futures is ready.
+     *
+     *  \param  futures
+     *      The futures to wait for, must not be empty.
+     *  \return Returns a TaskFuture holding the index of the first ready future,
+     *          and the futures.
+     */
+    template<class T>
+    static inline TaskFuture<WhenAnyResult<std::vector<TaskFuture<T>>>>
+    when_any(const std::vector<TaskFuture<T>>& futures) {
+        using result_t = WhenAnyResult<std::vector<TaskFuture<T>>>;
+
+        if (HEDLEY_UNLIKELY(futures.empty()))
+            throw utils::exceptions::Exception("utils::threading::when_any", "No futures given.");
+
+        struct Context {
+            std::atomic<bool>           done;
+            std::vector<TaskFuture<T>>  futures;
+        };
+
+        auto next = std::make_shared<internal::FutureState<result_t>>();
+        auto ctx  = std::make_shared<Context>();
+        ctx->done    = false;
+        ctx->futures = futures;
+
+        for (size_t i = 0; i < futures.size(); ++i) {
+            internal::FutureAccess::state(futures[i])->on_ready([ctx, next, i] {
+                if (!ctx->done.exchange(true)) {
+                    next->set_value(result_t{ i, ctx->futures });
+                }
+            });
+        }
+
+        return TaskFuture<result_t>(std::move(next), internal::FutureAccess::pool(futures.front()));
+    }
+
+    template<class T, class ...Ts>
+    static inline TaskFuture<WhenAnyResult<std::tuple<TaskFuture<T>, TaskFuture<Ts>...>>>
+    when_any(const TaskFuture<T>& first, const TaskFuture<Ts>& ... rest) {
+        using futures_t = std::tuple<TaskFuture<T>, TaskFuture<Ts>...>;
+        using result_t  = WhenAnyResult<futures_t>;
+
+        struct Context {
+            std::atomic<bool> done;
+            futures_t         futures;
+        };
+
+        auto next = std::make_shared<internal::FutureState<result_t>>();
+        auto ctx  = std::make_shared<Context>();
+        ctx->done    = false;
+        ctx->futures = futures_t(first, rest...);
+
+        internal::when_any_register(ctx, next, std::index_sequence_for<T, Ts...>{});
+
+        return TaskFuture<result_t>(std::move(next), internal::FutureAccess::pool(first));
+    }
 }
 
 #endif // UTILS_THREADING_HPP
@@ -6,7 +6,11 @@
 
 #include <chrono>
 #include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
 #include <ctime>
+#include <limits>
 #include <functional>
 #include <thread>
 
@@ -201,6 +205,250 @@ namespace utils::time {
     {
         return utils::time::Timestamp(frmt, &stamp);
     }
+
+    /**
+     *  \brief  Render timestamps for a fixed format, re-rendering only what changed.
+     *
+     *          The format is split around its `%S` field. The parts before and
+     *          after it are rendered with localtime + strftime once per minute;
+     *          within the same minute only the seconds digits (and the optional
+     *          sub-second digits, placed right after them) are rewritten in place.
+     *          If the format has no `%S` field, the whole string is re-rendered
+     *          once per second and no sub-second digits are added.
+     *          The same happens if seconds also appear elsewhere in the format
+     *          (a second `%S` or `%T`, or `%r`, `%X`, `%c`, `%s`), but the
+     *          first `%S` still gets the sub-second digits.
+     *
+     *          Not thread-safe: use one instance per thread, or guard it.
+     */
+    class TimestampCache {
+        public:
+            /**
+             *  \brief  Amount of fractional digits after the seconds.
+             */
+            enum class Precision : uint8_t {
+                Seconds      = 0,
+                Milliseconds = 3,
+                Microseconds = 6,
+                Nanoseconds  = 9
+            };
+
+        private:
+            static constexpr std::time_t INVALID_KEY = std::numeric_limits<std::time_t>::min();
+
+            std::string head_format;
+            std::string tail_format;
+            bool        has_seconds;
+            bool        per_minute;
+            Precision   precision;
+
+            std::string buffer;
+            size_t      seconds_pos;
+            std::time_t cached_key;
+
+            static void append_strftime(std::string& out, const std::string& frmt, const std::tm& tm) {
+                if (frmt.empty()) return;
+
+                char fixed[128];
+                const size_t len = std::strftime(fixed, sizeof(fixed), frmt.c_str(), &tm);
+
+                if (HEDLEY_LIKELY(len > 0)) {
+                    out.append(fixed, len);
+                } else {
+                    std::ostringstream ss;
+                    ss << std::put_time(&tm, frmt.c_str());
+                    out += ss.str();
+                }
+            }
+
+            /**
+             *  \brief  Whether the strftime conversion \p spec changes every second.
+             */
+            static constexpr bool is_seconds_spec(const char spec) {
+                return spec == 'S' || spec == 'T' || spec == 'r'
+                    || spec == 'X' || spec == 'c' || spec == 's';
+            }
+
+            static inline void write_digits(char *dst, uint32_t value, size_t digits) {
+                while (digits-- > 0) {
+                    dst[digits] = char('0' + value % 10);
+                    value /= 10;
+                }
+            }
+
+            void render_full(const std::time_t stamp) {
+                std::tm tm{};
+
+                #if defined(UTILS_COMPILER_MSVC)
+                    localtime_s(&tm, &stamp);
+                #else
+                    localtime_r(&stamp, &tm);
+                #endif
+
+                this->buffer.clear();
+                TimestampCache::append_strftime(this->buffer, this->head_format, tm);
+
+                if (this->has_seconds) {
+                    this->seconds_pos = this->buffer.size();
+                    this->buffer.append(2, '0');
+
+                    if (this->precision != Precision::Seconds) {
+                        this->buffer.push_back('.');
+                        this->buffer.append(size_t(this->precision), '0');
+                    }
+
+                    TimestampCache::append_strftime(this->buffer, this->tail_format, tm);
+                }
+            }
+
+        public:
+            /**
+             *  \param  frmt
+             *      The strftime format, see utils::time::Timestamp.
+             *      `%T` is treated as `%H:%M:%S`.
+             *  \param  precision
+             *      The sub-second digits to add after `%S`.
+             */
+            explicit TimestampCache(const std::string_view frmt = utils::time::TIMESTAMP_FORMAT,
+                                    const Precision precision   = Precision::Seconds)
+                : has_seconds(false)
+                , per_minute(true)
+                , precision(precision)
+                , seconds_pos(0)
+                , cached_key(INVALID_KEY)
+            {
+                std::string expanded;
+                expanded.reserve(frmt.size());
+
+                for (size_t i = 0; i < frmt.size(); i++) {
+                    if (frmt[i] == '%' && i + 1 < frmt.size()) {
+                        const char spec = frmt[++i];
+
+                        if ((spec == 'E' || spec == 'O') && i + 1 < frmt.size()) {
+                            // Modified conversion, e.g. `%OS` or `%EX`
+                            if (TimestampCache::is_seconds_spec(frmt[i + 1])) {
+                                this->per_minute = false;
+                            }
+
+                            expanded.push_back('%');
+                            expanded.push_back(spec);
+                            expanded.push_back(frmt[++i]);
+                            continue;
+                        }
+
+                        if (spec == 'S' && !this->has_seconds) {
+                            this->head_format = expanded;
+                            this->has_seconds = true;
+                            expanded.clear();
+                            continue;
+                        }
+
+                        if (spec == 'T') {
+                            expanded += "%H:%M:";
+
+                            if (!this->has_seconds) {
+                                this->head_format = expanded;
+                                this->has_seconds = true;
+                                expanded.clear();
+                            } else {
+                                expanded += "%S";
+                                this->per_minute = false;
+                            }
+
+                            continue;
+                        }
+
+                        if (TimestampCache::is_seconds_spec(spec)) {
+                            this->per_minute = false;
+                        }
+
+                        expanded.push_back('%');
+                        expanded.push_back(spec);
+                    } else {
+                        expanded.push_back(frmt[i]);
+                    }
+                }
+
+                if (this->has_seconds) {
+                    this->tail_format = std::move(expanded);
+                } else {
+                    this->head_format = std::move(expanded);
+                    this->precision   = Precision::Seconds;
+                }
+            }
+
+            /**
+             *  \brief  Render the given time.
+             *
+             *  \param  stamp
+             *      Seconds since epoch.
+             *  \param  nanoseconds
+             *      Sub-second part, only used with a Precision other than Seconds.
+             *  \return Returns a view on the internal buffer, valid until the next call.
+             */
+            std::string_view render(const std::time_t stamp, const uint32_t nanoseconds = 0) {
+                std::time_t key     = stamp;
+                std::time_t seconds = 0;
+
+                if (this->has_seconds) {
+                    key     = stamp / 60;
+                    seconds = stamp % 60;
+
+                    if (seconds < 0) {
+                        seconds += 60;
+                        key--;
+                    }
+
+                    if (!this->per_minute) {
+                        key = stamp;
+                    }
+                }
+
+                if (HEDLEY_UNLIKELY(key != this->cached_key)) {
+                    this->render_full(stamp);
+                    this->cached_key = key;
+                }
+
+                if (this->has_seconds) {
+                    char *dst = this->buffer.data() + this->seconds_pos;
+                    TimestampCache::write_digits(dst, uint32_t(seconds), 2);
+
+                    if (this->precision != Precision::Seconds) {
+                        const size_t digits = size_t(this->precision);
+                        uint32_t fraction   = nanoseconds % 1000000000u;
+
+                        for (size_t i = digits; i < 9; i++) fraction /= 10;
+
+                        TimestampCache::write_digits(dst + 3, fraction, digits);
+                    }
+                }
+
+                return this->buffer;
+            }
+
+            std::string_view render(const std::chrono::system_clock::time_point tp) {
+                const auto since_epoch = tp.time_since_epoch();
+                auto       secs        = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+
+                if (secs > since_epoch) {
+                    secs -= std::chrono::seconds(1);
+                }
+
+                const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch - secs);
+                return this->render(std::time_t(secs.count()), uint32_t(ns.count()));
+            }
+
+            /**
+             *  \brief  Render the current time.
+             */
+            inline std::string_view now(void) {
+                return this->render(std::chrono::system_clock::now());
+            }
+
+            inline Precision get_precision(void) const {
+                return this->precision;
+            }
+    };
 }
 
 #endif // UTILS_TIME_HPP
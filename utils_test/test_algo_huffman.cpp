@@ -0,0 +1,577 @@
+#include "test_settings.hpp"
+
+#ifdef ENABLE_TESTS
+#include "../utils_lib/external/doctest.hpp"
+
+#include "../utils_lib/algo/algo_huffman.hpp"
+
+#include "../utils_lib/utils_random.hpp"
+#include "../utils_lib/utils_threading.hpp"
+#include "../utils_lib/utils_logger.hpp"
+#include "../utils_lib/utils_time.hpp"
+
+#include <sstream>
+
+
+namespace {
+    /**
+     *  \brief  Generate \p length bytes with a skewed distribution,
+     *          so Huffman coding has something to gain.
+     */
+    std::vector<uint8_t> skewed_bytes(const size_t length) {
+        std::vector<uint8_t> data(length);
+
+        for (auto& b : data) {
+            b = uint8_t(utils::random::Random::get<int>(0, 15) * utils::random::Random::get<int>(0, 15));
+        }
+
+        return data;
+    }
+
+    /**
+     *  \brief  An input buffer that cannot seek, like a pipe.
+     */
+    struct PipeBuffer : std::streambuf {
+        explicit PipeBuffer(std::vector<uint8_t>& data) {
+            char *begin = reinterpret_cast<char*>(data.data());
+            this->setg(begin, begin, begin + data.size());
+        }
+    };
+
+    std::vector<uint8_t> to_vector(const std::string& str) {
+        return std::vector<uint8_t>(str.begin(), str.end());
+    }
+
+    std::vector<uint8_t> round_trip(const std::vector<uint8_t>& data) {
+        utils::io::BitStreamReader input(data);
+        utils::algo::Huffman<uint8_t> encoder;
+        auto encoded = encoder.encode(input);
+        REQUIRE(encoded);
+
+        utils::io::BitStreamReader packed(encoded->get_buffer(), encoded->get_last_byte_position());
+        utils::algo::Huffman<uint8_t> decoder;
+        auto decoded = decoder.decode(packed);
+        REQUIRE(decoded);
+
+        return std::vector<uint8_t>(decoded->get_buffer(), decoded->get_buffer() + decoded->get_size());
+    }
+}
+
+TEST_CASE("Test utils::algo::Huffman") {
+    utils::Logger::PauseScreen();
+
+    SUBCASE("Test utils::algo::Huffman round trip") {
+        for (const size_t length : { 1, 2, 100, 5000, 65535, 65536, 200000 }) {
+            CAPTURE(length);
+            const auto data = skewed_bytes(length);
+            CHECK((round_trip(data) == data));
+        }
+    }
+
+    SUBCASE("Test utils::algo::Huffman incompressible data") {
+        const auto data = utils::random::generate_x<uint8_t>(20000);
+        CHECK((round_trip(data) == data));
+    }
+
+    SUBCASE("Test utils::algo::Huffman single symbol") {
+        const std::vector<uint8_t> data(1000, 'x');
+        CHECK((round_trip(data) == data));
+    }
+
+    SUBCASE("Test utils::algo::Huffman few symbols") {
+        std::vector<uint8_t> data;
+        for (size_t i = 0; i < 3000; i++) {
+            data.push_back(uint8_t(i % 3 ? 'a' : 'b' + i % 2));
+        }
+
+        CHECK((round_trip(data) == data));
+    }
+
+    SUBCASE("Test utils::algo::Huffman code length limit") {
+        // Fibonacci frequencies give the deepest possible tree
+        std::vector<uint8_t> data;
+        for (uint64_t symbol = 0, a = 1, b = 1; symbol < 26; symbol++, b += a, a = b - a) {
+            data.insert(data.end(), size_t(a), uint8_t(symbol));
+        }
+
+        REQUIRE(data.size() > (size_t(1) << 17));
+        CHECK((round_trip(data) == data));
+    }
+
+    SUBCASE("Test utils::algo::Huffman word symbols") {
+        // Few distinct words, with bytes that differ within a word
+        std::vector<uint8_t> data;
+        for (size_t i = 0; i < 20000; i++) {
+            const uint8_t pick = uint8_t(utils::random::Random::get<int>(0, 3) * utils::random::Random::get<int>(0, 3));
+            data.push_back(uint8_t(0x10 + pick));
+            data.push_back(uint8_t(0xA0 + 2 * pick));
+        }
+
+        utils::io::BitStreamReader input(data);
+        utils::algo::Huffman<uint16_t> encoder;
+        const auto encoded = encoder.encode(input);
+        REQUIRE(encoded);
+        CHECK(encoded->get_last_byte_position() < data.size() / 4u);
+
+        utils::io::BitStreamReader packed(encoded->get_buffer(), encoded->get_last_byte_position());
+        utils::algo::Huffman<uint16_t> decoder;
+        const auto decoded = decoder.decode(packed);
+        REQUIRE(decoded);
+        CHECK((std::vector<uint8_t>(decoded->get_buffer(), decoded->get_buffer() + decoded->get_size()) == data));
+    }
+
+    SUBCASE("Test utils::algo::Huffman optimal code lengths") {
+        // Frequencies 1:1:2:4 give code lengths 3, 3, 2 and 1
+        std::vector<uint8_t> data;
+        for (const auto& [symbol, count] : { std::pair('a', 1000), std::pair('b', 1000), std::pair('c', 2000), std::pair('d', 4000) }) {
+            data.insert(data.end(), size_t(count), uint8_t(symbol));
+        }
+
+        utils::io::BitStreamReader input(data);
+        utils::algo::Huffman<uint8_t> encoder;
+        const auto encoded = encoder.encode(input);
+        REQUIRE(encoded);
+
+        // Header, max length, a count per length and the keys, then the data
+        constexpr size_t header_bits = 88u + 5u + 3u * 9u + 4u * 8u;
+        constexpr size_t data_bits   = 3000u + 3000u + 4000u + 4000u;
+        CHECK(encoded->get_last_byte_position() == (header_bits + data_bits + 7u) / 8u);
+        CHECK((round_trip(data) == data));
+    }
+
+    SUBCASE("Test utils::algo::Huffman versioned header") {
+        using Huffman = utils::algo::Huffman<uint8_t>;
+
+        for (const auto& [data, mode] : { std::make_pair(skewed_bytes(1000), Huffman::MODE_CANONICAL),
+                                          std::make_pair(utils::random::generate_x<uint8_t>(1000), Huffman::MODE_STORED) })
+        {
+            utils::io::BitStreamReader input(data);
+            Huffman encoder;
+            auto encoded = encoder.encode(input);
+
+            utils::io::BitStreamReader packed(encoded->get_buffer(), encoded->get_last_byte_position());
+            CHECK(packed.get(8) == Huffman::HDR_MARKER);
+            CHECK(packed.get(8) == Huffman::HDR_VERSION);
+            CHECK(packed.get(8) == mode);
+            CHECK(packed.get64(Huffman::SIZE_BITS / 2) == 0u);
+            CHECK(packed.get64(Huffman::SIZE_BITS / 2) == data.size());
+
+            // A newer version is refused
+            encoded->get_buffer()[1] = Huffman::HDR_VERSION + 1;
+            utils::io::BitStreamReader future(encoded->get_buffer(), encoded->get_last_byte_position());
+            CHECK_THROWS_AS(Huffman().decode(future), utils::exceptions::Exception);
+        }
+    }
+
+    SUBCASE("Test utils::algo::Huffman legacy streams") {
+        const std::vector<uint8_t> data{ 'a', 'b', 'a', 'c', 'a', 'a', 'c', 'b' };
+
+        // Dictionary groups of {has items, 7-bit count, 4-bit length}, with {key: code} pairs
+        utils::io::BitStreamWriter writer(1);
+        writer.put(1, 1); writer.put(7, 1); writer.put(4, 1);
+        writer.put(8, 'a'); writer.put(1, 0b0);
+        writer.put(1, 1); writer.put(7, 2); writer.put(4, 2);
+        writer.put(8, 'b'); writer.put(2, 0b10);
+        writer.put(8, 'c'); writer.put(2, 0b11);
+        writer.put_bit(0);
+        writer.put(16, data.size());
+
+        for (const uint8_t symbol : data) {
+            if (symbol == 'a') writer.put(1, 0b0);
+            else               writer.put(2, symbol == 'b' ? 0b10 : 0b11);
+        }
+
+        utils::io::BitStreamReader packed(writer.get_buffer(), writer.get_last_byte_position());
+        utils::algo::Huffman<uint8_t> decoder;
+        auto decoded = decoder.decode(packed);
+        REQUIRE(decoded);
+        CHECK((std::vector<uint8_t>(decoded->get_buffer(), decoded->get_buffer() + decoded->get_size()) == data));
+
+        // Uncompressed: a '0' bit followed by the data
+        utils::io::BitStreamWriter raw(1);
+        raw.put_bit(0);
+        for (const uint8_t symbol : data) raw.put(8, symbol);
+
+        utils::io::BitStreamReader packed_raw(raw.get_buffer(), raw.get_last_byte_position());
+        decoded = utils::algo::Huffman<uint8_t>().decode(packed_raw);
+        REQUIRE(decoded);
+        CHECK((std::vector<uint8_t>(decoded->get_buffer(), decoded->get_buffer() + decoded->get_size()) == data));
+    }
+
+    utils::Logger::ResumeScreen();
+}
+
+TEST_CASE("Test utils::algo::Huffman framed streams") {
+    using Huffman = utils::algo::Huffman<uint8_t>;
+    constexpr size_t BLOCK = 4096;
+
+    utils::Logger::PauseScreen();
+    utils::threading::ThreadPool pool(3);
+
+    // Compressible and incompressible blocks, and a short last block
+    auto data = skewed_bytes(10 * BLOCK);
+    const auto noise = utils::random::generate_x<uint8_t>(BLOCK + 123);
+    data.insert(data.begin() + 3 * BLOCK, noise.begin(), noise.end());
+
+    utils::io::BitStreamReader input(data);
+    auto encoded = Huffman::encode(input, pool, BLOCK);
+    REQUIRE(encoded);
+
+    utils::io::BitStreamReader packed(encoded->get_buffer(), encoded->get_last_byte_position());
+
+    SUBCASE("Test utils::algo::Huffman framed round trip") {
+        auto decoded = Huffman::decode(packed, pool);
+        REQUIRE(decoded);
+        CHECK((std::vector<uint8_t>(decoded->get_buffer(), decoded->get_buffer() + decoded->get_size()) == data));
+        CHECK(packed.get_position() == packed.get_size_bits());
+
+        // Without a pool, blocks are decoded one by one
+        packed.reset();
+        decoded = Huffman().decode(packed);
+        REQUIRE(decoded);
+        CHECK((std::vector<uint8_t>(decoded->get_buffer(), decoded->get_buffer() + decoded->get_size()) == data));
+
+        // A plain stream is decoded as well
+        utils::io::BitStreamReader plain_input(data);
+        auto plain = Huffman().encode(plain_input);
+        utils::io::BitStreamReader plain_packed(plain->get_buffer(), plain->get_last_byte_position());
+        decoded = Huffman::decode(plain_packed, pool);
+        REQUIRE(decoded);
+        CHECK(decoded->get_size() == data.size());
+    }
+
+    SUBCASE("Test utils::algo::Huffman framed seeking") {
+        const auto index = Huffman::readFrameIndex(packed);
+        REQUIRE(index.block_count() == 12);
+        CHECK(index.size == data.size());
+        CHECK(index.block_size == BLOCK);
+        CHECK(index.block_length(11) == data.size() - 11 * BLOCK);
+
+        for (const size_t block : { 7, 0, 11, 3 }) {
+            CAPTURE(block);
+            auto decoded = Huffman::decodeBlock(packed, index, block);
+            REQUIRE(decoded->get_size() == index.block_length(block));
+            CHECK(std::equal(decoded->get_buffer(), decoded->get_buffer() + decoded->get_size(),
+                             data.begin() + std::ptrdiff_t(block * BLOCK)));
+        }
+
+        CHECK_THROWS_AS(Huffman::decodeBlock(packed, index, 12), utils::exceptions::Exception);
+    }
+
+    SUBCASE("Test utils::algo::Huffman framed errors") {
+        // Truncated
+        utils::io::BitStreamReader truncated(encoded->get_buffer(), encoded->get_last_byte_position() - 1);
+        CHECK_THROWS_AS(Huffman::decode(truncated, pool), utils::exceptions::Exception);
+
+        // A corrupt block
+        const auto index = Huffman::readFrameIndex(packed);
+        encoded->get_buffer()[index.data_offset + index.ends[4] + 1] ^= 0xFF;
+        packed.reset();
+        CHECK_THROWS_AS(Huffman::decode(packed, pool), utils::exceptions::Exception);
+
+        // A huge size with an empty block must be rejected before anything is allocated
+        utils::io::BitStreamWriter crafted(27);
+        crafted.put(8, Huffman::HDR_MARKER);
+        crafted.put(8, Huffman::HDR_VERSION);
+        crafted.put(8, Huffman::MODE_FRAMED);
+        crafted.put(Huffman::SIZE_BITS, uint64_t(1) << 44);
+        crafted.put(Huffman::SIZE_BITS, uint64_t(1) << 44);
+        crafted.put(Huffman::SIZE_BITS, 0);
+        REQUIRE(crafted.get_last_byte_position() == 27);
+
+        utils::io::BitStreamReader huge(crafted.get_buffer(), crafted.get_last_byte_position());
+        CHECK_THROWS_AS(Huffman::readFrameIndex(huge), utils::exceptions::Exception);
+        huge.reset();
+        CHECK_THROWS_AS(Huffman::decode(huge, pool), utils::exceptions::Exception);
+        huge.reset();
+        CHECK_THROWS_AS(Huffman().decode(huge), utils::exceptions::Exception);
+    }
+
+    SUBCASE("Test utils::algo::Huffman framed from a task on the same pool") {
+        utils::threading::ThreadPool single(1);
+
+        auto result = single.enqueue([&data, &single] {
+            utils::io::BitStreamReader nested_input(data);
+            auto nested = Huffman::encode(nested_input, single, BLOCK);
+            utils::io::BitStreamReader nested_packed(nested->get_buffer(), nested->get_last_byte_position());
+            auto decoded = Huffman::decode(nested_packed, single);
+            return std::vector<uint8_t>(decoded->get_buffer(), decoded->get_buffer() + decoded->get_size());
+        });
+
+        CHECK(result.get() == data);
+    }
+
+    utils::Logger::ResumeScreen();
+}
+
+TEST_CASE("Test utils::algo::Huffman streaming") {
+    using Huffman = utils::algo::Huffman<uint8_t>;
+
+    utils::Logger::PauseScreen();
+
+    auto data = skewed_bytes(3 * Huffman::STREAM_CHUNK_SIZE + 1234);
+    const std::string raw(data.begin(), data.end());
+
+    SUBCASE("Test utils::algo::Huffman two-pass streaming") {
+        // Same stream as encoding in memory
+        utils::io::BitStreamReader input(data);
+        auto expected = Huffman().encode(input);
+
+        for (const size_t chunk_size : { size_t(1000), Huffman::STREAM_CHUNK_SIZE }) {
+            CAPTURE(chunk_size);
+            std::istringstream in(raw);
+            std::ostringstream out;
+
+            CHECK(Huffman::encode(in, out, chunk_size) == data.size());
+            CHECK((to_vector(out.str()) == std::vector<uint8_t>(expected->get_buffer(),
+                                                                 expected->get_buffer() + expected->get_last_byte_position())));
+
+            std::istringstream packed(out.str());
+            std::ostringstream decoded;
+            CHECK(Huffman::decode(packed, decoded) == data.size());
+            CHECK((to_vector(decoded.str()) == data));
+        }
+
+        // Incompressible data is stored
+        const auto noise = utils::random::generate_x<uint8_t>(5000);
+        std::istringstream in(std::string(noise.begin(), noise.end()));
+        std::ostringstream out;
+        Huffman::encode(in, out, 1000);
+        CHECK(out.str().size() == noise.size() + Huffman::HDR_BITS / 8);
+
+        std::istringstream packed(out.str());
+        std::ostringstream decoded;
+        Huffman::decode(packed, decoded);
+        CHECK((to_vector(decoded.str()) == noise));
+    }
+
+    SUBCASE("Test utils::algo::Huffman chunked streaming") {
+        // Unseekable input is encoded chunk by chunk
+        PipeBuffer pipe(data);
+        std::istream in(&pipe);
+        REQUIRE(in.tellg() == std::istream::pos_type(-1));
+
+        std::ostringstream out;
+        CHECK(Huffman::encode(in, out, 100000) == data.size());
+
+        std::istringstream packed(out.str());
+        std::ostringstream decoded;
+        CHECK(Huffman::decode(packed, decoded) == data.size());
+        CHECK((to_vector(decoded.str()) == data));
+
+        // Pushed in pieces of any size
+        std::ostringstream pushed;
+        utils::algo::HuffmanStreamEncoder<uint8_t> encoder(pushed, 100000);
+
+        for (size_t offset = 0, piece = 1; offset < data.size(); offset += piece, piece = piece * 3 + 1) {
+            encoder.push(data.data() + offset, std::min(piece, data.size() - offset));
+        }
+
+        encoder.finish();
+        CHECK(encoder.get_consumed() == data.size());
+        CHECK(encoder.get_written() == pushed.str().size());
+        CHECK(pushed.str() == out.str());
+    }
+
+    SUBCASE("Test utils::algo::Huffman streaming decode of framed streams") {
+        utils::threading::ThreadPool pool(2);
+        utils::io::BitStreamReader input(data);
+        auto framed = Huffman::encode(input, pool, 300000);
+
+        std::istringstream packed(std::string(reinterpret_cast<const char*>(framed->get_buffer()),
+                                              framed->get_last_byte_position()));
+        std::ostringstream decoded;
+        CHECK(Huffman::decode(packed, decoded) == data.size());
+        CHECK((to_vector(decoded.str()) == data));
+    }
+
+    SUBCASE("Test utils::algo::Huffman streaming errors") {
+        std::istringstream in(raw);
+        std::ostringstream out;
+        Huffman::encode(in, out);
+
+        std::istringstream truncated(out.str().substr(0, out.str().size() / 2));
+        std::ostringstream decoded;
+        CHECK_THROWS_AS(Huffman::decode(truncated, decoded), utils::exceptions::Exception);
+
+        std::istringstream empty;
+        CHECK(Huffman::decode(empty, decoded) == 0);
+        CHECK(Huffman::encode(empty, decoded) == 0);
+    }
+
+    SUBCASE("Test utils::algo::Huffman file helpers") {
+        utils::io::TemporaryFile raw_file(false, ""), enc_file(false, ""), dec_file(false, "");
+        utils::io::bytes_to_file(raw_file.get_name(), data.data(), data.size());
+
+        utils::threading::ThreadPool pool(2);
+
+        for (utils::threading::ThreadPool *p : { (utils::threading::ThreadPool*)nullptr, &pool }) {
+            REQUIRE(Huffman::encode(raw_file.get_name(), enc_file.get_name(), p));
+            REQUIRE(Huffman::decode(enc_file.get_name(), dec_file.get_name(), p));
+            CHECK((*utils::io::file_to_bytes(dec_file.get_name()) == data));
+        }
+    }
+
+    utils::Logger::ResumeScreen();
+}
+
+TEST_CASE("Test utils::algo::HuffmanTable") {
+    // Unary code: symbol i is i ones and a zero, the last one has no zero.
+    constexpr uint32_t SYMBOLS = 22;
+    std::vector<std::pair<uint8_t, utils::algo::Codeword>> codes;
+
+    for (uint32_t i = 0; i < SYMBOLS - 1; i++) {
+        codes.emplace_back(uint8_t(i), utils::algo::Codeword{ utils::bits::mask_lsb<uint32_t>(i) << 1, i + 1 });
+    }
+    codes.emplace_back(uint8_t(SYMBOLS - 1), utils::algo::Codeword{ utils::bits::mask_lsb<uint32_t>(SYMBOLS - 1), SYMBOLS - 1 });
+
+    REQUIRE(codes.back().second.len > utils::algo::HuffmanTable<uint8_t>::PRIMARY_BITS);
+
+    utils::algo::HuffmanTable<uint8_t> table;
+    CHECK(table.empty());
+    table.build(codes);
+    CHECK_FALSE(table.empty());
+
+    const auto symbols = utils::random::generate_x<uint8_t>(10000, 0, SYMBOLS - 1);
+
+    utils::io::BitStreamWriter writer(1);
+    for (const uint8_t symbol : symbols) {
+        writer.put(codes[symbol].second.len, codes[symbol].second.word);
+    }
+
+    utils::io::BitStreamReader reader(writer.get_buffer(), writer.get_last_byte_position());
+    for (const uint8_t symbol : symbols) {
+        REQUIRE(table.decode(reader) == symbol);
+    }
+
+    CHECK(reader.get_position() == writer.get_position());
+
+    // Not a complete code: a lone '1' has no symbol.
+    table.build({ { uint8_t('a'), utils::algo::Codeword{ 0, 1 } } });
+    uint8_t ones[] = { 0xFF };
+    utils::io::BitStreamReader invalid(ones, 1);
+    CHECK_THROWS_AS(table.decode(invalid), utils::exceptions::Exception);
+
+    CHECK_THROWS_AS(table.build({ { uint8_t('a'), utils::algo::Codeword{ 0, 0 } } }), utils::exceptions::Exception);
+
+    // Codes longer than Codeword::word can hold are rejected.
+    constexpr uint32_t TOO_LONG = utils::algo::HuffmanTable<uint8_t>::MAX_CODE_BITS + 1;
+    CHECK(utils::algo::HuffmanTable<uint8_t>::MAX_CODE_BITS <= 32u);
+    CHECK_THROWS_AS(table.build({ { uint8_t('a'), utils::algo::Codeword{ 0, TOO_LONG } } }), utils::exceptions::Exception);
+    CHECK_THROWS_AS(table.build({ { uint8_t('a'), utils::algo::Codeword{ 0, 57 } } }), utils::exceptions::Exception);
+}
+
+TEST_CASE("Benchmark utils::algo::Huffman decode" * doctest::skip()) {
+    constexpr size_t SIZE = 1 << 24;
+
+    const auto data = skewed_bytes(SIZE);
+
+    utils::Logger::PauseScreen();
+
+    utils::io::BitStreamReader input(data);
+    utils::algo::Huffman<uint8_t> encoder;
+    utils::memory::unique_t<utils::io::BitStreamWriter> encoded;
+
+    const double t_encode = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+        encoded = encoder.encode(input);
+    });
+
+    utils::io::BitStreamReader packed(encoded->get_buffer(), encoded->get_last_byte_position());
+    size_t decoded_size = 0;
+
+    const double t_decode = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+        utils::algo::Huffman<uint8_t> decoder;
+        decoded_size = decoder.decode(packed)->get_size();
+    });
+
+    std::istringstream stream_in(std::string(data.begin(), data.end()));
+    std::ostringstream stream_packed;
+
+    const double t_stream_encode = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+        utils::algo::Huffman<uint8_t>::encode(stream_in, stream_packed);
+    });
+
+    std::istringstream stream_encoded(stream_packed.str());
+    std::ostringstream stream_out;
+
+    const double t_stream_decode = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+        utils::algo::Huffman<uint8_t>::decode(stream_encoded, stream_out);
+    });
+
+    utils::Logger::ResumeScreen();
+
+    REQUIRE(decoded_size == SIZE);
+    REQUIRE(stream_out.str().size() == SIZE);
+
+    const double mb = double(SIZE) / (1024.0 * 1024.0);
+    utils::Logger::Writef("\n%-28s %10.1f MB (%.1f%%)\n", "Huffman encoded", double(packed.get_size()) / (1024.0 * 1024.0),
+                          100.0 * double(packed.get_size()) / double(SIZE));
+    utils::Logger::Writef("%-28s %10.1f MB/s\n", "Huffman encode", mb / (t_encode / 1000.0));
+    utils::Logger::Writef("%-28s %10.1f MB/s\n", "Huffman decode", mb / (t_decode / 1000.0));
+    utils::Logger::Writef("%-28s %10.1f MB/s\n", "Huffman stream encode", mb / (t_stream_encode / 1000.0));
+    utils::Logger::Writef("%-28s %10.1f MB/s\n", "Huffman stream decode", mb / (t_stream_decode / 1000.0));
+}
+
+TEST_CASE("Benchmark utils::algo::Huffman small payloads" * doctest::skip()) {
+    constexpr size_t COUNT = 20000;
+    constexpr size_t SIZE  = 512;
+
+    std::vector<std::vector<uint8_t>> payloads(COUNT);
+    for (auto& payload : payloads) {
+        payload = skewed_bytes(SIZE);
+    }
+
+    utils::Logger::PauseScreen();
+
+    size_t packed_size = 0;
+
+    const double t_encode = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+        for (const auto& payload : payloads) {
+            utils::io::BitStreamReader input(payload);
+            utils::algo::Huffman<uint8_t> encoder;
+            packed_size += encoder.encode(input)->get_last_byte_position();
+        }
+    });
+
+    utils::Logger::ResumeScreen();
+
+    REQUIRE(packed_size > 0);
+    utils::Logger::Writef("\n%-28s %10.2f us/payload (%zu bytes, %.1f%%)\n", "Huffman encode", t_encode * 1000.0 / double(COUNT),
+                          SIZE, 100.0 * double(packed_size) / double(COUNT * SIZE));
+}
+
+TEST_CASE("Benchmark utils::algo::Huffman framed" * doctest::skip()) {
+    constexpr size_t SIZE = 1 << 26;
+
+    const auto data = skewed_bytes(SIZE);
+    const double mb = double(SIZE) / (1024.0 * 1024.0);
+    const size_t max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1u);
+
+    utils::Logger::Writef("\n%-10s %14s %14s\n", "threads", "encode MB/s", "decode MB/s");
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        utils::threading::ThreadPool pool(threads);
+        utils::io::BitStreamReader input(data);
+
+        utils::Logger::PauseScreen();
+
+        utils::memory::unique_t<utils::io::BitStreamWriter> encoded;
+        const double t_encode = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            encoded = utils::algo::Huffman<uint8_t>::encode(input, pool);
+        });
+
+        utils::io::BitStreamReader packed(encoded->get_buffer(), encoded->get_last_byte_position());
+        size_t decoded_size = 0;
+
+        const double t_decode = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            decoded_size = utils::algo::Huffman<uint8_t>::decode(packed, pool)->get_size();
+        });
+
+        utils::Logger::ResumeScreen();
+
+        REQUIRE(decoded_size == SIZE);
+        utils::Logger::Writef("%-10zu %14.1f %14.1f\n", threads, mb / (t_encode / 1000.0), mb / (t_decode / 1000.0));
+    }
+}
+
+#endif
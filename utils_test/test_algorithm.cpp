@@ -6,7 +6,10 @@
 #include "../utils_lib/utils_algorithm.hpp"
 
 #include "../utils_lib/utils_random.hpp"
+#include "../utils_lib/utils_logger.hpp"
+#include "../utils_lib/utils_time.hpp"
 #include <map>
+#include <atomic>
 
 
 TEST_CASE("Test utils::algorithm::contains") {
@@ -330,6 +333,187 @@ TEST_CASE("Test utils::algorithm::sort") {
     REQUIRE(utils::algorithm::is_ascending(test));
 }
 
+TEST_CASE("Test utils::algorithm::histogram") {
+    const auto bytes = utils::random::generate_x<uint8_t>(100003);
+    const auto words = utils::random::generate_x<uint16_t>(70001);
+
+    std::vector<uint64_t> expect_bytes(utils::algorithm::histogram_bins_v<uint8_t>, 0u);
+    std::vector<uint64_t> expect_words(utils::algorithm::histogram_bins_v<uint16_t>, 0u);
+    for (const auto b : bytes) expect_bytes[b]++;
+    for (const auto w : words) expect_words[w]++;
+
+    CHECK(utils::algorithm::histogram(bytes.data(), bytes.size()) == expect_bytes);
+    CHECK(utils::algorithm::histogram(words.data(), words.size()) == expect_words);
+
+    // Runs of a single value and lengths that do not fill every table
+    const std::vector<uint8_t> run(1001, 0x7F);
+    const auto counts = utils::algorithm::histogram(run.data(), run.size());
+    CHECK(counts[0x7F] == run.size());
+    CHECK(utils::algorithm::sum(counts) == run.size());
+
+    // Counts are added to
+    std::vector<uint64_t> twice(expect_bytes.size(), 0u);
+    utils::algorithm::histogram(bytes.data(), bytes.size(), twice.data());
+    utils::algorithm::histogram(bytes.data(), bytes.size(), twice.data());
+    CHECK(twice[bytes[0]] == 2 * expect_bytes[bytes[0]]);
+
+    CHECK(utils::algorithm::sum(utils::algorithm::histogram(bytes.data(), 0)) == 0);
+}
+
+TEST_CASE("Test utils::algorithm::parallel") {
+    utils::threading::ThreadPool pool(4, utils::threading::ThreadPool::Mode::WorkStealing);
+
+    std::vector<int64_t> test(1 << 18);
+    std::iota(test.begin(), test.end(), 1);
+    const int64_t sum = int64_t(test.size()) * int64_t(test.size() + 1) / 2;
+
+    SUBCASE("Test utils::algorithm::parallel::sum") {
+        const std::vector<int> small{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+        const std::vector<int> e{};
+
+        CHECK(utils::algorithm::parallel::sum(pool, e) == 0);
+        CHECK(utils::algorithm::parallel::sum(pool, small) == 55);
+        CHECK(utils::algorithm::parallel::sum(pool, test) == sum);
+        CHECK(utils::algorithm::parallel::sum(pool, test.begin(), test.end()) == sum);
+        CHECK(utils::algorithm::parallel::sum(test) == sum);
+        CHECK(utils::algorithm::parallel::reduce(pool, test.begin(), test.end(), int64_t(10)) == sum + 10);
+    }
+
+    SUBCASE("Test utils::algorithm::parallel::product") {
+        const std::vector<int> e{};
+        std::vector<double> ones(1 << 16, 1.0);
+        ones[12345] = 3.0;
+        ones[54321] = 0.5;
+
+        CHECK(utils::algorithm::parallel::product(pool, e) == 0);
+        CHECK(utils::algorithm::parallel::product(pool, ones) == doctest::Approx(1.5));
+        CHECK(utils::algorithm::parallel::product(ones.begin(), ones.end()) == doctest::Approx(1.5));
+    }
+
+    SUBCASE("Test utils::algorithm::parallel::for_each") {
+        utils::algorithm::parallel::for_each(pool, test, [](int64_t& x) { x *= 2; });
+        CHECK(utils::algorithm::sum(test) == 2 * sum);
+
+        std::atomic<int64_t> total{0};
+        utils::algorithm::parallel::for_each(test.begin(), test.end(), [&](int64_t x) { total += x; });
+        CHECK(total == 2 * sum);
+    }
+
+    SUBCASE("Test utils::algorithm::parallel::min_element / max_element") {
+        test[1000]   = -5;
+        test[200000] = -5;
+        test[3000]   = sum;
+        test[150000] = sum;
+
+        CHECK(utils::algorithm::parallel::min_element(pool, test) == test.begin() + 1000);
+        CHECK(utils::algorithm::parallel::max_element(pool, test) == test.begin() + 3000);
+        CHECK(utils::algorithm::parallel::min_element(test.begin(), test.end()) == test.begin() + 1000);
+        CHECK(utils::algorithm::parallel::max_element(test.begin(), test.end()) == test.begin() + 3000);
+        CHECK(utils::algorithm::parallel::max_element(pool, test, std::greater<int64_t>{}) == test.begin() + 1000);
+    }
+
+    SUBCASE("Test utils::algorithm::parallel::sort") {
+        utils::random::Random::shuffle(test.begin(), test.end());
+        utils::algorithm::parallel::sort(pool, test.begin(), test.end());
+        CHECK(utils::algorithm::is_ascending(test));
+
+        utils::algorithm::parallel::sort(test.begin(), test.end(), std::greater<int64_t>{});
+        CHECK(utils::algorithm::is_descending(test));
+    }
+
+    SUBCASE("Test utils::algorithm::parallel::histogram") {
+        const auto bytes = utils::random::generate_x<uint8_t>(1 << 20);
+        const auto words = utils::random::generate_x<uint16_t>(1 << 22);
+
+        CHECK(utils::algorithm::parallel::histogram(pool, bytes.data(), bytes.size())
+              == utils::algorithm::histogram(bytes.data(), bytes.size()));
+        CHECK(utils::algorithm::parallel::histogram(pool, words.data(), words.size())
+              == utils::algorithm::histogram(words.data(), words.size()));
+        CHECK(utils::algorithm::parallel::histogram(bytes.data(), 100)
+              == utils::algorithm::histogram(bytes.data(), 100));
+    }
+
+    SUBCASE("Test utils::algorithm::parallel from within a task") {
+        utils::threading::ThreadPool single(1);
+
+        auto result = single.enqueue([&] {
+            return utils::algorithm::parallel::sum(single, test);
+        });
+
+        CHECK(result.get() == sum);
+    }
+
+    SUBCASE("Test utils::algorithm::parallel exceptions") {
+        CHECK_THROWS_AS(utils::algorithm::parallel::for_each(pool, test, [](int64_t x) {
+            if (x == 100000) throw std::runtime_error("parallel");
+        }), std::runtime_error);
+    }
+}
+
+TEST_CASE("Benchmark utils::algorithm::parallel" * doctest::skip()) {
+    utils::threading::ThreadPool pool(std::thread::hardware_concurrency(),
+                                      utils::threading::ThreadPool::Mode::WorkStealing);
+
+    utils::Logger::Writef("\n%10s %14s %14s %14s %14s\n", "elements",
+                          "sum (ms)", "par sum (ms)", "sort (ms)", "par sort (ms)");
+
+    for (size_t length = 1 << 12; length <= (1 << 24); length <<= 4) {
+        auto data = utils::random::generate_x<int>(length, -1000, 1000);
+        auto copy = data;
+        int64_t a = 0, b = 0;
+
+        const double t_sum = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            a = std::accumulate(data.begin(), data.end(), int64_t(0));
+        });
+        const double t_par_sum = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            b = utils::algorithm::parallel::reduce(pool, data.begin(), data.end(), int64_t(0));
+        });
+        const double t_sort = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            std::sort(data.begin(), data.end());
+        });
+        const double t_par_sort = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            utils::algorithm::parallel::sort(pool, copy.begin(), copy.end());
+        });
+
+        REQUIRE(a == b);
+        REQUIRE(data == copy);
+        utils::Logger::Writef("%10zu %14.3f %14.3f %14.3f %14.3f\n", length,
+                              t_sum, t_par_sum, t_sort, t_par_sort);
+    }
+}
+
+TEST_CASE("Benchmark utils::algorithm::histogram" * doctest::skip()) {
+    utils::threading::ThreadPool pool(std::thread::hardware_concurrency(),
+                                      utils::threading::ThreadPool::Mode::WorkStealing);
+
+    constexpr size_t SIZE = 1 << 26;
+    const auto random = utils::random::generate_x<uint8_t>(SIZE);
+    const std::vector<uint8_t> run(SIZE, 0x55);
+
+    utils::Logger::Writef("\n%-10s %14s %14s %14s\n", "data", "single (MB/s)", "histogram", "par histogram");
+
+    for (const auto& [name, data] : { std::pair("random", &random), std::pair("run", &run) }) {
+        std::vector<uint64_t> single(256, 0u), counts, par_counts;
+
+        const double t_single = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            for (const auto b : *data) single[b]++;
+        });
+        const double t_hist = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            counts = utils::algorithm::histogram(data->data(), data->size());
+        });
+        const double t_par_hist = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            par_counts = utils::algorithm::parallel::histogram(pool, data->data(), data->size());
+        });
+
+        REQUIRE(single == counts);
+        REQUIRE(counts == par_counts);
+
+        const double mb = double(SIZE) / (1024.0 * 1024.0);
+        utils::Logger::Writef("%-10s %14.1f %14.1f %14.1f\n", name,
+                              mb / (t_single / 1000.0), mb / (t_hist / 1000.0), mb / (t_par_hist / 1000.0));
+    }
+}
+
 TEST_CASE("Test utils::algorithm::enumerate") {
     std::vector<int> test(10);
     std::iota(test.begin(), test.end(), 0);
@@ -6,6 +6,50 @@
 #include "../utils_lib/crypto/crypto_aes.hpp"
 #include "../utils_lib/utils_random.hpp"
 #include "../utils_lib/utils_logger.hpp"
+#include "../utils_lib/utils_time.hpp"
+
+#include <string>
+#include <vector>
+
+
+namespace {
+    std::vector<uint8_t> from_hex(const std::string& hex) {
+        std::vector<uint8_t> bytes;
+
+        for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+            bytes.push_back(uint8_t(std::stoul(hex.substr(i, 2), nullptr, 16)));
+        }
+
+        return bytes;
+    }
+
+    std::vector<uint8_t> to_vector(const uint8_t *data, size_t length) {
+        return std::vector<uint8_t>(data, data + length);
+    }
+
+    using Engine = utils::crypto::AES::Engine;
+
+    const char *engine_name(Engine engine) {
+        switch (engine) {
+            case Engine::Reference: return "Reference";
+            case Engine::TTable:    return "TTable";
+            case Engine::AESNI:     return "AESNI";
+        }
+        return "";
+    }
+
+    std::vector<Engine> supported_engines(void) {
+        std::vector<Engine> engines;
+
+        for (const auto engine : { Engine::Reference, Engine::TTable, Engine::AESNI }) {
+            if (utils::crypto::AES::IsSupported(engine)) {
+                engines.push_back(engine);
+            }
+        }
+
+        return engines;
+    }
+}
 
 TEST_CASE("Test utils::crypto::aes") {
 //#define PRINT_DEBUG
@@ -47,4 +91,612 @@ TEST_CASE("Test utils::crypto::aes") {
 #endif
 }
 
+TEST_CASE("Test utils::crypto::AES known answers") {
+    // FIPS-197 appendix C and NIST SP 800-38A appendix F
+    const auto plain = from_hex("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51");
+    const auto key   = from_hex("2b7e151628aed2a6abf7158809cf4f3c");
+    const auto iv    = from_hex("000102030405060708090a0b0c0d0e0f");
+    const uint32_t length = uint32_t(plain.size());
+
+    utils::crypto::AES aes(128);
+    const auto ctx = aes.MakeContext(key.data());
+    CHECK(ctx.get_rounds() == 10);
+
+    uint32_t out_len = 0;
+
+    SUBCASE("Test utils::crypto::AES ECB") {
+        auto enc = aes.EncryptECB(plain.data(), length, ctx, out_len);
+        REQUIRE(out_len == length);
+        CHECK((to_vector(enc.get(), out_len)
+               == from_hex("3ad77bb40d7a3660a89ecaf32466ef97f5d3d58503b9699de785895a96fdbaaf")));
+        CHECK((to_vector(aes.DecryptECB(enc.get(), out_len, key.data()).get(), out_len) == plain));
+
+        for (const auto& [bits, k, p, c] : {
+            std::tuple(192, "000102030405060708090a0b0c0d0e0f1011121314151617",
+                       "00112233445566778899aabbccddeeff", "dda97ca4864cdfe06eaf70a0ec0d7191"),
+            std::tuple(256, "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4",
+                       "6bc1bee22e409f96e93d7e117393172a", "f3eed1bdb5d2a03c064b5a7e3db181f8"),
+        }) {
+            CAPTURE(bits);
+            utils::crypto::AES wide(bits);
+            const auto wide_key = from_hex(k);
+            const auto wide_in  = from_hex(p);
+            uint32_t wide_len = 0;
+
+            auto wide_enc = wide.EncryptECB(wide_in.data(), uint32_t(wide_in.size()), wide_key.data(), wide_len);
+            CHECK((to_vector(wide_enc.get(), wide_len) == from_hex(c)));
+            CHECK((to_vector(wide.DecryptECB(wide_enc.get(), wide_len, wide_key.data()).get(), wide_len) == wide_in));
+        }
+    }
+
+    SUBCASE("Test utils::crypto::AES CBC") {
+        auto enc = aes.EncryptCBC(plain.data(), length, ctx, iv.data(), out_len);
+        REQUIRE(out_len == length);
+        CHECK((to_vector(enc.get(), out_len)
+               == from_hex("7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2")));
+        CHECK((to_vector(aes.DecryptCBC(enc.get(), out_len, ctx, iv.data()).get(), out_len) == plain));
+        CHECK((to_vector(aes.DecryptCBC(enc.get(), out_len, key.data(), iv.data()).get(), out_len) == plain));
+    }
+
+    SUBCASE("Test utils::crypto::AES CFB") {
+        auto enc = aes.EncryptCFB(plain.data(), length, ctx, iv.data(), out_len);
+        REQUIRE(out_len == length);
+        CHECK((to_vector(enc.get(), out_len)
+               == from_hex("3b3fd92eb72dad20333449f8e83cfb4ac8a64537a0b3a93fcde3cdad9f1ce58b")));
+        CHECK((to_vector(aes.DecryptCFB(enc.get(), out_len, ctx, iv.data()).get(), out_len) == plain));
+        CHECK((to_vector(aes.DecryptCFB(enc.get(), out_len, key.data(), iv.data()).get(), out_len) == plain));
+    }
+}
+
+TEST_CASE("Test utils::crypto::AES engines") {
+    const auto plain = from_hex("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51");
+    const auto key   = from_hex("2b7e151628aed2a6abf7158809cf4f3c");
+    const auto iv    = from_hex("000102030405060708090a0b0c0d0e0f");
+    const uint32_t length = uint32_t(plain.size());
+
+    CHECK(utils::crypto::AES::IsSupported(Engine::Reference));
+    CHECK(utils::crypto::AES::IsSupported(Engine::TTable));
+    CHECK(utils::crypto::AES::IsSupported(utils::crypto::AES::BestEngine()));
+    CHECK(utils::crypto::AES::BestEngine() != Engine::Reference);
+
+    if (!utils::crypto::AES::IsSupported(Engine::AESNI)) {
+        CHECK_THROWS_AS(utils::crypto::AES(128).MakeContext(key.data(), Engine::AESNI),
+                        utils::exceptions::Exception);
+    }
+
+    SUBCASE("Test utils::crypto::AES engines known answers") {
+        for (const auto engine : supported_engines()) {
+            CAPTURE(engine_name(engine));
+
+            utils::crypto::AES aes(128);
+            const auto ctx = aes.MakeContext(key.data(), engine);
+            CHECK(ctx.get_engine() == engine);
+            uint32_t out_len = 0;
+
+            auto ecb = aes.EncryptECB(plain.data(), length, ctx, out_len);
+            CHECK((to_vector(ecb.get(), out_len)
+                   == from_hex("3ad77bb40d7a3660a89ecaf32466ef97f5d3d58503b9699de785895a96fdbaaf")));
+            CHECK((to_vector(aes.DecryptECB(ecb.get(), out_len, ctx).get(), out_len) == plain));
+
+            auto cbc = aes.EncryptCBC(plain.data(), length, ctx, iv.data(), out_len);
+            CHECK((to_vector(cbc.get(), out_len)
+                   == from_hex("7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2")));
+            CHECK((to_vector(aes.DecryptCBC(cbc.get(), out_len, ctx, iv.data()).get(), out_len) == plain));
+
+            auto cfb = aes.EncryptCFB(plain.data(), length, ctx, iv.data(), out_len);
+            CHECK((to_vector(cfb.get(), out_len)
+                   == from_hex("3b3fd92eb72dad20333449f8e83cfb4ac8a64537a0b3a93fcde3cdad9f1ce58b")));
+            CHECK((to_vector(aes.DecryptCFB(cfb.get(), out_len, ctx, iv.data()).get(), out_len) == plain));
+
+            for (const auto& [bits, k, p, c] : {
+                std::tuple(192, "000102030405060708090a0b0c0d0e0f1011121314151617",
+                           "00112233445566778899aabbccddeeff", "dda97ca4864cdfe06eaf70a0ec0d7191"),
+                std::tuple(256, "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4",
+                           "6bc1bee22e409f96e93d7e117393172a", "f3eed1bdb5d2a03c064b5a7e3db181f8"),
+            }) {
+                CAPTURE(bits);
+                utils::crypto::AES wide(bits);
+                const auto wide_ctx = wide.MakeContext(from_hex(k).data(), engine);
+                const auto wide_in  = from_hex(p);
+                uint32_t wide_len = 0;
+
+                auto wide_enc = wide.EncryptECB(wide_in.data(), uint32_t(wide_in.size()), wide_ctx, wide_len);
+                CHECK((to_vector(wide_enc.get(), wide_len) == from_hex(c)));
+                CHECK((to_vector(wide.DecryptECB(wide_enc.get(), wide_len, wide_ctx).get(), wide_len) == wide_in));
+            }
+        }
+    }
+
+    SUBCASE("Test utils::crypto::AES engines match the reference") {
+        const auto data = utils::random::generate_x<uint8_t>(4096);
+
+        for (const int bits : { 128, 192, 256 }) {
+            CAPTURE(bits);
+
+            utils::crypto::AES aes(bits);
+            const auto random_key = utils::random::generate_x<uint8_t>(size_t(bits / 8));
+            const auto reference  = aes.MakeContext(random_key.data(), Engine::Reference);
+            uint32_t out_len = 0;
+
+            auto enc = aes.EncryptCBC(data.data(), uint32_t(data.size()), reference, iv.data(), out_len);
+            const auto expected = to_vector(enc.get(), out_len);
+
+            for (const auto engine : supported_engines()) {
+                CAPTURE(engine_name(engine));
+                const auto ctx = aes.MakeContext(random_key.data(), engine);
+
+                enc = aes.EncryptCBC(data.data(), uint32_t(data.size()), ctx, iv.data(), out_len);
+                CHECK((to_vector(enc.get(), out_len) == expected));
+                CHECK((to_vector(aes.DecryptCBC(expected.data(), out_len, ctx, iv.data()).get(), out_len) == data));
+            }
+        }
+    }
+}
+
+TEST_CASE("Test utils::crypto::AES CTR and GCM") {
+    SUBCASE("Test utils::crypto::AES CTR known answers") {
+        // NIST SP 800-38A F.5.1, the counter carries over two bytes
+        const auto plain = from_hex("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                                    "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710");
+        const auto key   = from_hex("2b7e151628aed2a6abf7158809cf4f3c");
+        const auto iv    = from_hex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");
+        const auto ctext = from_hex("874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"
+                                    "5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee");
+
+        for (const auto engine : supported_engines()) {
+            CAPTURE(engine_name(engine));
+
+            utils::crypto::AES aes(128);
+            const auto ctx = aes.MakeContext(key.data(), engine);
+
+            CHECK((to_vector(aes.EncryptCTR(plain.data(), uint32_t(plain.size()), ctx, iv.data()).get(), plain.size()) == ctext));
+            CHECK((to_vector(aes.DecryptCTR(ctext.data(), uint32_t(ctext.size()), ctx, iv.data()).get(), ctext.size()) == plain));
+
+            // No padding: a partial last block is cut from the key stream
+            CHECK((to_vector(aes.EncryptCTR(plain.data(), 37, ctx, iv.data()).get(), 37) == std::vector<uint8_t>(ctext.begin(), ctext.begin() + 37)));
+        }
+    }
+
+    SUBCASE("Test utils::crypto::AES GCM known answers") {
+        // Test cases 1 to 4 and 6 from the GCM specification (McGrew and Viega)
+        const std::string k3 = "feffe9928665731c6d6a8f9467308308";
+        const std::string p3 = "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+                               "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255";
+        const std::string p4 = p3.substr(0, 120);
+        const std::string a4 = "feedfacedeadbeeffeedfacedeadbeefabaddad2";
+
+        for (const auto& [name, k, iv_hex, p, a, c, t] : {
+            std::tuple("1", "00000000000000000000000000000000", "000000000000000000000000", "", "", "",
+                       "58e2fccefa7e3061367f1d57a4e7455a"),
+            std::tuple("2", "00000000000000000000000000000000", "000000000000000000000000",
+                       "00000000000000000000000000000000", "", "0388dace60b6a392f328c2b971b2fe78",
+                       "ab6e47d42cec13bdf53a67b21257bddf"),
+            std::tuple("3", k3.c_str(), "cafebabefacedbaddecaf888", p3.c_str(), "",
+                       "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e"
+                       "21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091473f5985",
+                       "4d5c2af327cd64a62cf35abd2ba6fab4"),
+            std::tuple("4", k3.c_str(), "cafebabefacedbaddecaf888", p4.c_str(), a4.c_str(),
+                       "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e"
+                       "21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091",
+                       "5bc94fbc3221a5db94fae95ae7121a47"),
+            std::tuple("6", k3.c_str(), "9313225df88406e555909c5aff5269aa6a7a9538534f7da1e4c303d2a318a728"
+                                        "c3c0c95156809539fcf0e2429a6b525416aedbf5a0de6a57a637b39b",
+                       p4.c_str(), a4.c_str(),
+                       "8ce24998625615b603a033aca13fb894be9112a5c3a211a8ba262a3cca7e2ca7"
+                       "01e4a9a4fba43c90ccdcb281d48c7c6fd62875d2aca417034c34aee5",
+                       "619cc5aefffe0bfa462af43c1699d050"),
+        }) {
+            const auto key = from_hex(k), iv = from_hex(iv_hex), plain = from_hex(p), aad = from_hex(a);
+            const uint32_t length = uint32_t(plain.size());
+
+            for (const auto engine : supported_engines()) {
+                CAPTURE(name);
+                CAPTURE(engine_name(engine));
+
+                utils::crypto::AES aes(128);
+                const auto ctx = aes.MakeContext(key.data(), engine);
+                uint8_t tag[utils::crypto::AES::BLOCK_BYTES];
+
+                auto enc = aes.EncryptGCM(plain.data(), length, ctx, iv.data(), uint32_t(iv.size()),
+                                          aad.data(), uint32_t(aad.size()), tag);
+                CHECK((to_vector(enc.get(), length) == from_hex(c)));
+                CHECK((to_vector(tag, sizeof(tag)) == from_hex(t)));
+
+                auto dec = aes.DecryptGCM(enc.get(), length, ctx, iv.data(), uint32_t(iv.size()),
+                                          aad.data(), uint32_t(aad.size()), tag);
+                CHECK((to_vector(dec.get(), length) == plain));
+            }
+        }
+    }
+
+    SUBCASE("Test utils::crypto::AES GCM rejects changed data") {
+        utils::crypto::AES aes;
+        const auto key   = utils::random::generate_x<uint8_t>(256 / 8);
+        const auto iv    = utils::random::generate_x<uint8_t>(12);
+        const auto aad   = utils::random::generate_x<uint8_t>(20);
+        const auto plain = utils::random::generate_x<uint8_t>(100);
+        uint8_t tag[utils::crypto::AES::BLOCK_BYTES];
+
+        auto enc = aes.EncryptGCM(plain.data(), uint32_t(plain.size()), key.data(), iv.data(), 12,
+                                  aad.data(), uint32_t(aad.size()), tag);
+        CHECK((to_vector(aes.DecryptGCM(enc.get(), uint32_t(plain.size()), key.data(), iv.data(), 12,
+                                        aad.data(), uint32_t(aad.size()), tag).get(), plain.size()) == plain));
+
+        enc[42] ^= 0x01;
+        CHECK_THROWS_AS(aes.DecryptGCM(enc.get(), uint32_t(plain.size()), key.data(), iv.data(), 12,
+                                       aad.data(), uint32_t(aad.size()), tag), utils::exceptions::Exception);
+        enc[42] ^= 0x01;
+
+        CHECK_THROWS_AS(aes.DecryptGCM(enc.get(), uint32_t(plain.size()), key.data(), iv.data(), 12,
+                                       aad.data(), uint32_t(aad.size() - 1), tag), utils::exceptions::Exception);
+
+        tag[0] ^= 0x80;
+        CHECK_THROWS_AS(aes.DecryptGCM(enc.get(), uint32_t(plain.size()), key.data(), iv.data(), 12,
+                                       aad.data(), uint32_t(aad.size()), tag), utils::exceptions::Exception);
+    }
+
+    SUBCASE("Test utils::crypto::AES split over a pool") {
+        // Several chunks, and a last one that is not a whole number of blocks
+        const uint32_t length = 5 * 64 * 1024 + 21;
+        const auto data = utils::random::generate_x<uint8_t>(length);
+        const auto iv   = utils::random::generate_x<uint8_t>(16);
+        const auto key  = utils::random::generate_x<uint8_t>(256 / 8);
+
+        utils::threading::ThreadPool pool(3);
+        utils::crypto::AES aes;
+
+        for (const auto engine : supported_engines()) {
+            if (engine == Engine::Reference) continue;  // Too slow for this size
+            CAPTURE(engine_name(engine));
+
+            const auto ctx = aes.MakeContext(key.data(), engine);
+            uint32_t out_len = 0, pool_len = 0;
+
+            auto ecb      = aes.EncryptECB(data.data(), length, ctx, out_len);
+            auto ecb_pool = aes.EncryptECB(data.data(), length, ctx, pool_len, &pool);
+            CHECK((to_vector(ecb_pool.get(), pool_len) == to_vector(ecb.get(), out_len)));
+            CHECK((to_vector(aes.DecryptECB(ecb.get(), out_len, ctx, &pool).get(), length) == data));
+
+            auto cbc = aes.EncryptCBC(data.data(), length, ctx, iv.data(), out_len);
+            CHECK((to_vector(aes.DecryptCBC(cbc.get(), out_len, ctx, iv.data(), &pool).get(), length) == data));
+
+            auto cfb = aes.EncryptCFB(data.data(), length, ctx, iv.data(), out_len);
+            CHECK((to_vector(aes.DecryptCFB(cfb.get(), out_len, ctx, iv.data(), &pool).get(), length) == data));
+
+            auto ctr = aes.EncryptCTR(data.data(), length, ctx, iv.data());
+            CHECK((to_vector(aes.EncryptCTR(data.data(), length, ctx, iv.data(), &pool).get(), length) == to_vector(ctr.get(), length)));
+            CHECK((to_vector(aes.DecryptCTR(ctr.get(), length, ctx, iv.data(), &pool).get(), length) == data));
+
+            uint8_t tag[utils::crypto::AES::BLOCK_BYTES], pool_tag[utils::crypto::AES::BLOCK_BYTES];
+            auto gcm = aes.EncryptGCM(data.data(), length, ctx, iv.data(), 12, key.data(), 7, tag);
+            CHECK((to_vector(aes.EncryptGCM(data.data(), length, ctx, iv.data(), 12, key.data(), 7, pool_tag, &pool).get(), length)
+                   == to_vector(gcm.get(), length)));
+            CHECK((to_vector(pool_tag, sizeof(pool_tag)) == to_vector(tag, sizeof(tag))));
+            CHECK((to_vector(aes.DecryptGCM(gcm.get(), length, ctx, iv.data(), 12, key.data(), 7, tag, &pool).get(), length) == data));
+        }
+    }
+}
+
+TEST_CASE("Test utils::crypto::AES buffers and padding") {
+    using AES     = utils::crypto::AES;
+    using Padding = AES::Padding;
+
+    const auto key = utils::random::generate_x<uint8_t>(256 / 8);
+    const auto iv  = utils::random::generate_x<uint8_t>(AES::BLOCK_BYTES);
+
+    AES aes;
+    const auto ctx = aes.MakeContext(AES::const_bytes_t(key));
+
+    SUBCASE("Test utils::crypto::AES PKCS#7 padding") {
+        for (const size_t length : { 0, 1, 15, 16, 17, 33 }) {
+            CAPTURE(length);
+            const auto data = utils::random::generate_x<uint8_t>(length);
+            const size_t padded = AES::PaddedSize(length, Padding::PKCS7);
+            CHECK(padded == (length / 16 + 1) * 16);
+
+            std::vector<uint8_t> enc(padded), dec(padded);
+
+            REQUIRE(aes.EncryptECB(data, enc, ctx) == padded);
+            REQUIRE(aes.DecryptECB(enc, dec, ctx) == length);
+            CHECK((std::vector<uint8_t>(dec.begin(), dec.begin() + long(length)) == data));
+            CHECK(dec.back() == uint8_t(padded - length));
+
+            REQUIRE(aes.EncryptCBC(data, enc, ctx, iv) == padded);
+            REQUIRE(aes.DecryptCBC(enc, dec, ctx, iv) == length);
+            CHECK((std::vector<uint8_t>(dec.begin(), dec.begin() + long(length)) == data));
+
+            REQUIRE(aes.EncryptCFB(data, enc, ctx, iv, Padding::PKCS7) == padded);
+            REQUIRE(aes.DecryptCFB(enc, dec, ctx, iv, Padding::PKCS7) == length);
+            CHECK((std::vector<uint8_t>(dec.begin(), dec.begin() + long(length)) == data));
+        }
+
+        // A whole number of blocks gets a full block of padding
+        std::vector<uint8_t> block(16, 0x42), enc(32), dec(32);
+        REQUIRE(aes.EncryptECB(block, enc, ctx) == 32);
+        REQUIRE(aes.DecryptECB(enc, dec, ctx, Padding::None) == 32);
+        CHECK((std::vector<uint8_t>(dec.begin() + 16, dec.end()) == std::vector<uint8_t>(16, 0x10)));
+
+        // A last byte of 0x00 or above 0x10 is never valid padding
+        for (const uint8_t last : { 0x00, 0x11 }) {
+            CAPTURE(int(last));
+            block.back() = last;
+            REQUIRE(aes.EncryptECB(block, enc, ctx, Padding::None) == 16);
+            CHECK_THROWS_AS(aes.DecryptECB(AES::const_bytes_t(enc.data(), 16), dec, ctx), utils::exceptions::Exception);
+        }
+    }
+
+    SUBCASE("Test utils::crypto::AES in place") {
+        const auto data = utils::random::generate_x<uint8_t>(100);
+        std::vector<uint8_t> out(AES::PaddedSize(data.size(), Padding::PKCS7));
+        std::vector<uint8_t> buf(out.size());
+
+        for (size_t mode = 0; mode < 3; mode++) {
+            CAPTURE(mode);
+            std::copy(data.begin(), data.end(), buf.begin());
+            const AES::const_bytes_t in(buf.data(), data.size());
+            size_t out_len = 0, buf_len = 0;
+
+            switch (mode) {
+                case 0:
+                    out_len = aes.EncryptECB(data, out, ctx);
+                    buf_len = aes.EncryptECB(in, buf, ctx);
+                    break;
+                case 1:
+                    out_len = aes.EncryptCBC(data, out, ctx, iv);
+                    buf_len = aes.EncryptCBC(in, buf, ctx, iv);
+                    break;
+                default:
+                    out_len = aes.EncryptCFB(data, out, ctx, iv);
+                    buf_len = aes.EncryptCFB(in, buf, ctx, iv);
+                    break;
+            }
+
+            REQUIRE(buf_len == out_len);
+            CHECK((std::vector<uint8_t>(buf.begin(), buf.begin() + long(buf_len)) == std::vector<uint8_t>(out.begin(), out.begin() + long(out_len))));
+
+            const AES::const_bytes_t enc(buf.data(), buf_len);
+            switch (mode) {
+                case 0:  buf_len = aes.DecryptECB(enc, buf, ctx);     break;
+                case 1:  buf_len = aes.DecryptCBC(enc, buf, ctx, iv); break;
+                default: buf_len = aes.DecryptCFB(enc, buf, ctx, iv); break;
+            }
+
+            REQUIRE(buf_len == data.size());
+            CHECK((std::vector<uint8_t>(buf.begin(), buf.begin() + long(buf_len)) == data));
+        }
+
+        // Without padding, CFB keeps a partial last block
+        CHECK(aes.EncryptCFB(data, out, ctx, iv) == data.size());
+
+        std::vector<uint8_t> tag(12);
+        buf = data;
+        REQUIRE(aes.EncryptGCM(buf, buf, ctx, iv, key, tag) == data.size());
+        CHECK(buf != data);
+        REQUIRE(aes.DecryptGCM(buf, buf, ctx, iv, key, tag) == data.size());
+        CHECK(buf == data);
+
+        REQUIRE(aes.EncryptCTR(buf, buf, ctx, iv) == data.size());
+        REQUIRE(aes.DecryptCTR(buf, buf, ctx, iv) == data.size());
+        CHECK(buf == data);
+    }
+
+    SUBCASE("Test utils::crypto::AES in place over a pool") {
+        const auto data = utils::random::generate_x<uint8_t>(5 * 64 * 1024 + 7);
+        utils::threading::ThreadPool pool(3);
+
+        std::vector<uint8_t> buf(AES::PaddedSize(data.size(), Padding::PKCS7));
+        std::copy(data.begin(), data.end(), buf.begin());
+        const AES::const_bytes_t in(buf.data(), data.size());
+
+        size_t len = aes.EncryptCBC(in, buf, ctx, iv);
+        REQUIRE(aes.DecryptCBC(AES::const_bytes_t(buf.data(), len), buf, ctx, iv, Padding::PKCS7, &pool) == data.size());
+        CHECK((std::vector<uint8_t>(buf.begin(), buf.begin() + long(data.size())) == data));
+
+        len = aes.EncryptCFB(in, buf, ctx, iv);
+        REQUIRE(aes.DecryptCFB(AES::const_bytes_t(buf.data(), len), buf, ctx, iv, Padding::None, &pool) == data.size());
+        CHECK((std::vector<uint8_t>(buf.begin(), buf.begin() + long(data.size())) == data));
+
+        len = aes.EncryptECB(in, buf, ctx, Padding::PKCS7, &pool);
+        REQUIRE(aes.DecryptECB(AES::const_bytes_t(buf.data(), len), buf, ctx, Padding::PKCS7, &pool) == data.size());
+        CHECK((std::vector<uint8_t>(buf.begin(), buf.begin() + long(data.size())) == data));
+    }
+
+    SUBCASE("Test utils::crypto::AES pointer and span modes match") {
+        const auto data = utils::random::generate_x<uint8_t>(37);
+        std::vector<uint8_t> out(AES::PaddedSize(data.size(), Padding::Zeros));
+        uint32_t out_len = 0;
+
+        auto ecb = aes.EncryptECB(data.data(), uint32_t(data.size()), ctx, out_len);
+        REQUIRE(aes.EncryptECB(data, out, ctx, Padding::Zeros) == out_len);
+        CHECK((to_vector(ecb.get(), out_len) == out));
+
+        auto cbc = aes.EncryptCBC(data.data(), uint32_t(data.size()), ctx, iv.data(), out_len);
+        REQUIRE(aes.EncryptCBC(data, out, ctx, iv, Padding::Zeros) == out_len);
+        CHECK((to_vector(cbc.get(), out_len) == out));
+
+        auto cfb = aes.EncryptCFB(data.data(), uint32_t(data.size()), ctx, iv.data(), out_len);
+        REQUIRE(aes.EncryptCFB(data, out, ctx, iv, Padding::Zeros) == out_len);
+        CHECK((to_vector(cfb.get(), out_len) == out));
+    }
+
+    SUBCASE("Test utils::crypto::AES rejects bad buffers") {
+        const auto data = utils::random::generate_x<uint8_t>(40);
+        std::vector<uint8_t> out(48);
+
+        // Output too small, partial blocks without padding, wrong IV and key sizes
+        CHECK_THROWS_AS(aes.EncryptECB(data, AES::bytes_t(out.data(), 47), ctx), utils::exceptions::Exception);
+        CHECK_THROWS_AS(aes.EncryptECB(data, out, ctx, Padding::None), utils::exceptions::Exception);
+        CHECK_THROWS_AS(aes.DecryptCBC(data, out, ctx, iv), utils::exceptions::Exception);
+        CHECK_THROWS_AS(aes.EncryptCTR(data, out, ctx, AES::const_bytes_t(iv.data(), 12)), utils::exceptions::Exception);
+        CHECK_THROWS_AS(aes.MakeContext(AES::const_bytes_t(key.data(), 16)), utils::exceptions::Exception);
+
+        // Overlapping, but not in place
+        std::vector<uint8_t> buf(64);
+        CHECK_THROWS_AS(aes.EncryptCTR(AES::const_bytes_t(buf.data(), 32), AES::bytes_t(buf.data() + 16, 32), ctx, iv),
+                        utils::exceptions::Exception);
+    }
+}
+
+TEST_CASE("Test utils::crypto::AES streaming") {
+    using AES  = utils::crypto::AES;
+    using Mode = AES::Stream::Mode;
+
+    const auto key = utils::random::generate_x<uint8_t>(192 / 8);
+    const auto iv  = utils::random::generate_x<uint8_t>(AES::BLOCK_BYTES);
+
+    AES aes(192);
+    const auto ctx = aes.MakeContext(AES::const_bytes_t(key));
+
+    // Run the stream over data in pieces of varying sizes
+    const auto run = [](AES::Stream& stream, const std::vector<uint8_t>& data) {
+        static constexpr size_t pieces[] = { 1, 7, 16, 0, 3, 48, 13, 200, 32 };
+        std::vector<uint8_t> out(data.size() + AES::BLOCK_BYTES);
+        size_t pos = 0, written = 0;
+
+        for (size_t i = 0; pos < data.size(); i++) {
+            const size_t length = std::min(pieces[i % std::size(pieces)], data.size() - pos);
+            written += stream.update(AES::const_bytes_t(data.data() + pos, length),
+                                     AES::bytes_t(out.data() + written, out.size() - written));
+            pos += length;
+        }
+
+        written += stream.finalize(AES::bytes_t(out.data() + written, out.size() - written));
+        out.resize(written);
+        return out;
+    };
+
+    SUBCASE("Test utils::crypto::AES streaming matches whole buffers") {
+        for (const size_t length : { 0, 1, 15, 16, 17, 100, 1024, 3001 }) {
+            CAPTURE(length);
+            const auto data = utils::random::generate_x<uint8_t>(length);
+
+            for (const auto mode : { Mode::CBC, Mode::CFB, Mode::CTR }) {
+                CAPTURE(int(mode));
+                std::vector<uint8_t> expected(AES::PaddedSize(length, AES::Padding::PKCS7));
+
+                switch (mode) {
+                    case Mode::CBC: expected.resize(aes.EncryptCBC(data, expected, ctx, iv)); break;
+                    case Mode::CFB: expected.resize(aes.EncryptCFB(data, expected, ctx, iv)); break;
+                    case Mode::CTR: expected.resize(aes.EncryptCTR(data, expected, ctx, iv)); break;
+                }
+
+                AES::Stream enc(mode, true);
+                enc.init(key, iv);
+                const auto cipher = run(enc, data);
+                CHECK(cipher == expected);
+
+                AES::Stream dec(mode, false);
+                dec.init(ctx, iv);
+                CHECK(run(dec, cipher) == data);
+
+                // A new message after finalize
+                dec.init(ctx, iv);
+                CHECK(run(dec, cipher) == data);
+            }
+        }
+    }
+
+    SUBCASE("Test utils::crypto::AES streaming in place") {
+        const auto data = utils::random::generate_x<uint8_t>(777);
+
+        for (const auto mode : { Mode::CFB, Mode::CTR }) {
+            CAPTURE(int(mode));
+            auto buf = data;
+            AES::Stream enc(mode, true), dec(mode, false);
+            enc.init(ctx, iv);
+            dec.init(ctx, iv);
+
+            const AES::bytes_t head(buf.data(), 333), tail(buf.data() + 333, buf.size() - 333);
+            CHECK(enc.update(head, head) == head.size());
+            CHECK(enc.update(tail, tail) == tail.size());
+            CHECK(enc.finalize({}) == 0);
+            CHECK(buf != data);
+
+            CHECK(dec.update(buf, buf) == buf.size());
+            CHECK(dec.finalize({}) == 0);
+            CHECK(buf == data);
+        }
+    }
+
+    SUBCASE("Test utils::crypto::AES streaming errors") {
+        std::vector<uint8_t> data(20), out(48);
+        AES::Stream cbc(Mode::CBC, false);
+
+        CHECK_THROWS_AS(cbc.update(data, out), utils::exceptions::Exception);
+        CHECK_THROWS_AS(cbc.init(AES::const_bytes_t(key.data(), 20), iv), utils::exceptions::Exception);
+
+        // Not a whole number of blocks
+        cbc.init(ctx, iv);
+        CHECK(cbc.update(data, out) == 16);
+        CHECK_THROWS_AS(cbc.finalize(out), utils::exceptions::Exception);
+
+        // Invalid padding: the plaintext ends in 0x00
+        std::vector<uint8_t> bad(16);
+        REQUIRE(aes.EncryptCBC(AES::const_bytes_t(data.data(), 16), bad, ctx, iv, AES::Padding::None) == 16);
+        cbc.init(ctx, iv);
+        CHECK(cbc.update(bad, out) == 0);
+        CHECK_THROWS_AS(cbc.finalize(out), utils::exceptions::Exception);
+
+        // Without padding, the input must be whole blocks
+        AES::Stream raw(Mode::CBC, true, AES::Padding::None);
+        raw.init(ctx, iv);
+        CHECK(raw.update(data, out) == 16);
+        CHECK_THROWS_AS(raw.finalize(out), utils::exceptions::Exception);
+
+        raw.init(ctx, iv);
+        CHECK_THROWS_AS(raw.update(data, AES::bytes_t(data)), utils::exceptions::Exception);
+    }
+}
+
+TEST_CASE("Benchmark utils::crypto::AES" * doctest::skip()) {
+    constexpr uint32_t SIZE = 1 << 20;
+
+    utils::crypto::AES aes;
+    const auto key  = utils::random::generate_x<uint8_t>(256 / 8);
+    const auto iv   = utils::random::generate_x<uint8_t>(16);
+    const auto data = utils::random::generate_x<uint8_t>(SIZE);
+    uint32_t out_len = 0;
+
+    auto& pool = utils::algorithm::parallel::default_pool();
+    uint8_t tag[utils::crypto::AES::BLOCK_BYTES];
+
+    const double mb = double(SIZE) / (1024.0 * 1024.0);
+    utils::Logger::Writef("\n%zu threads in the pool for the *-mt modes\n", pool.size());
+    utils::Logger::Writef("%-10s %-7s %14s %14s\n", "engine", "mode", "encrypt MB/s", "decrypt MB/s");
+
+    for (const auto engine : supported_engines()) {
+        const auto ctx = aes.MakeContext(key.data(), engine);
+
+        const auto run = [&](const char *name, auto&& encrypt, auto&& decrypt) {
+            utils::memory::unique_arr_t<uint8_t> enc(nullptr, &utils::memory::delete_array<uint8_t>), dec(nullptr, &utils::memory::delete_array<uint8_t>);
+
+            const double t_enc = utils::time::Timer::time<utils::time::Timer::time_ms>([&] { enc = encrypt(); });
+            const double t_dec = utils::time::Timer::time<utils::time::Timer::time_ms>([&] { dec = decrypt(enc.get()); });
+
+            REQUIRE(std::equal(data.begin(), data.end(), dec.get()));
+            utils::Logger::Writef("%-10s %-7s %14.1f %14.1f\n", engine_name(engine), name, mb / (t_enc / 1000.0), mb / (t_dec / 1000.0));
+        };
+
+        run("ECB", [&] { return aes.EncryptECB(data.data(), SIZE, ctx, out_len); },
+                   [&](const uint8_t *enc) { return aes.DecryptECB(enc, out_len, ctx); });
+        run("CBC", [&] { return aes.EncryptCBC(data.data(), SIZE, ctx, iv.data(), out_len); },
+                   [&](const uint8_t *enc) { return aes.DecryptCBC(enc, out_len, ctx, iv.data()); });
+        run("CFB", [&] { return aes.EncryptCFB(data.data(), SIZE, ctx, iv.data(), out_len); },
+                   [&](const uint8_t *enc) { return aes.DecryptCFB(enc, out_len, ctx, iv.data()); });
+        run("CTR", [&] { return aes.EncryptCTR(data.data(), SIZE, ctx, iv.data()); },
+                   [&](const uint8_t *enc) { return aes.DecryptCTR(enc, SIZE, ctx, iv.data()); });
+        run("GCM", [&] { return aes.EncryptGCM(data.data(), SIZE, ctx, iv.data(), 12, nullptr, 0, tag); },
+                   [&](const uint8_t *enc) { return aes.DecryptGCM(enc, SIZE, ctx, iv.data(), 12, nullptr, 0, tag); });
+
+        run("ECB-mt", [&] { return aes.EncryptECB(data.data(), SIZE, ctx, out_len, &pool); },
+                      [&](const uint8_t *enc) { return aes.DecryptECB(enc, out_len, ctx, &pool); });
+        run("CBC-mt", [&] { return aes.EncryptCBC(data.data(), SIZE, ctx, iv.data(), out_len); },
+                      [&](const uint8_t *enc) { return aes.DecryptCBC(enc, out_len, ctx, iv.data(), &pool); });
+        run("CTR-mt", [&] { return aes.EncryptCTR(data.data(), SIZE, ctx, iv.data(), &pool); },
+                      [&](const uint8_t *enc) { return aes.DecryptCTR(enc, SIZE, ctx, iv.data(), &pool); });
+        run("GCM-mt", [&] { return aes.EncryptGCM(data.data(), SIZE, ctx, iv.data(), 12, nullptr, 0, tag, &pool); },
+                      [&](const uint8_t *enc) { return aes.DecryptGCM(enc, SIZE, ctx, iv.data(), 12, nullptr, 0, tag, &pool); });
+    }
+}
+
 #endif
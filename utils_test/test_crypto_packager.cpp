@@ -0,0 +1,68 @@
+#include "test_settings.hpp"
+
+#ifdef ENABLE_TESTS
+#include "../utils_lib/external/doctest.hpp"
+
+#include "../utils_lib/crypto/crypto_packager.hpp"
+#include "../utils_lib/utils_random.hpp"
+
+#include <vector>
+
+
+TEST_CASE("Test utils::crypto::EncipherAES files") {
+    using Packager = utils::crypto::EncipherAES<>;
+    using AES      = utils::crypto::AES;
+
+    Packager packager;
+    std::array<uint8_t, 32> key;
+    Packager::iv_t iv;
+    const auto random_key = utils::random::generate_x<uint8_t>(key.size());
+    const auto random_iv  = utils::random::generate_x<uint8_t>(iv.size());
+    std::copy(random_key.begin(), random_key.end(), key.begin());
+    std::copy(random_iv.begin(), random_iv.end(), iv.begin());
+
+    utils::io::TemporaryFile src(false, ""), enc(false, ""), dec(false, "");
+
+    SUBCASE("Test utils::crypto::EncipherAES file round trip") {
+        constexpr size_t chunk = Packager::file_chunk_bytes;
+
+        for (const size_t length : { size_t(0), size_t(1), chunk, 3 * chunk + 5 }) {
+            CAPTURE(length);
+            const auto data = utils::random::generate_x<uint8_t>(length);
+            utils::io::bytes_to_file(src.get_name(), data.data(), data.size());
+
+            packager.PackFile(src.get_name(), enc.get_name(), key, iv);
+
+            const auto cipher = utils::io::file_to_bytes(enc.get_name());
+            REQUIRE(cipher->size() == iv.size() + AES::PaddedSize(length, AES::Padding::PKCS7));
+            CHECK(std::equal(iv.begin(), iv.end(), cipher->begin()));
+
+            packager.UnpackFile(enc.get_name(), dec.get_name(), key);
+            CHECK((*utils::io::file_to_bytes(dec.get_name()) == data));
+        }
+    }
+
+    SUBCASE("Test utils::crypto::EncipherAES invalid padding removes the output") {
+        constexpr size_t length = 3 * Packager::file_chunk_bytes + 5;
+        const auto data = utils::random::generate_x<uint8_t>(length);
+        utils::io::bytes_to_file(src.get_name(), data.data(), data.size());
+        packager.PackFile(src.get_name(), enc.get_name(), key, iv);
+
+        // Flip the top bit of the last padding byte (11) through the previous ciphertext block.
+        auto cipher = utils::io::file_to_bytes(enc.get_name());
+        (*cipher)[cipher->size() - AES::BLOCK_BYTES - 1] ^= 0x80;
+        utils::io::bytes_to_file(enc.get_name(), cipher->data(), cipher->size());
+
+        CHECK_THROWS_AS(packager.UnpackFile(enc.get_name(), dec.get_name(), key), utils::exceptions::Exception);
+        CHECK_FALSE(utils::io::fs::exists(dec.get_path()));
+    }
+
+    SUBCASE("Test utils::crypto::EncipherAES missing files") {
+        CHECK_THROWS_AS(packager.PackFile(src.get_name() + ".missing", enc.get_name(), key, iv),
+                        utils::exceptions::FileReadException);
+        CHECK_THROWS_AS(packager.UnpackFile(src.get_name() + ".missing", dec.get_name(), key),
+                        utils::exceptions::FileReadException);
+    }
+}
+
+#endif
@@ -7,6 +7,52 @@
 
 #include "../utils_lib/utils_string.hpp"
 #include "../utils_lib/utils_random.hpp"
+#include "../utils_lib/utils_time.hpp"
+#include "../utils_lib/utils_logger.hpp"
+
+#include <fstream>
+#include <tuple>
+
+
+namespace {
+    /**
+     *  \brief  Bit-at-a-time reference reader, as BitStreamReader used to be.
+     */
+    struct ReferenceBitReader {
+        const std::vector<uint8_t>& data;
+        size_t position = 0;
+
+        uint8_t get_bit(void) {
+            if (this->position / 8u >= this->data.size()) return 0u;
+            const uint8_t value = this->data[this->position / 8u];
+            return (value >> (7u - this->position++ % 8u)) & 1u;
+        }
+
+        uint64_t get(uint_fast32_t l) {
+            uint64_t value = 0;
+            while (l--) value = (value << 1) | this->get_bit();
+            return value;
+        }
+    };
+
+    /**
+     *  \brief  Bit-at-a-time reference writer, as BitStreamWriter used to be.
+     */
+    struct ReferenceBitWriter {
+        std::vector<uint8_t>& data;
+        size_t position = 0;
+
+        void put_bit(uint8_t value) {
+            const uint8_t mask = uint8_t(0x80u >> (this->position % 8u));
+            uint8_t& byte = this->data[this->position++ / 8u];
+            byte = value ? (byte | mask) : (byte & ~mask);
+        }
+
+        void put(uint_fast32_t length, uint64_t value) {
+            while (length--) this->put_bit((value >> length) & 1u);
+        }
+    };
+}
 
 
 TEST_CASE("Test utils::io::TemporaryFile") {
@@ -65,4 +111,375 @@ TEST_CASE("Test utils::io::TemporaryFile") {
     }
 }
 
+TEST_CASE("Test utils::io bulk file I/O") {
+    utils::io::TemporaryFile tmp(false, "");
+
+    SUBCASE("Test utils::io::bulk round trip") {
+        using Hint = utils::io::bulk::Hint;
+
+        for (const size_t length : { size_t(0), size_t(1), size_t(4095), size_t(70001),
+                                     utils::io::bulk::DIRECT_BLOCK_SIZE + 3 })
+        {
+            CAPTURE(length);
+            const auto data = utils::random::generate_x<uint8_t>(length);
+            utils::io::bytes_to_file(tmp.get_name(), data.data(), data.size());
+
+            CHECK((*utils::io::file_to_bytes(tmp.get_name()) == data));
+            CHECK((*utils::io::file_to_string(tmp.get_name()) == std::string(data.begin(), data.end())));
+
+            for (const auto hint : { Hint::Sequential, Hint::NoCache, Hint::Direct }) {
+                std::vector<uint8_t> read(7, 0xFF);  // Replaced, not appended to
+                utils::io::bulk::read(tmp.get_name(), read, hint);
+                CHECK((read == data));
+
+                utils::io::bulk::write(tmp.get_name(), data.data(), data.size(), hint);
+                CHECK((*utils::io::file_to_bytes(tmp.get_name()) == data));
+            }
+        }
+
+        const std::string text = "Hello World!\nSecond line\n";
+        utils::io::string_to_file(tmp.get_name(), text);
+        CHECK(*utils::io::file_to_string(tmp.get_name()) == text);
+    }
+
+#if defined(UTILS_OS_LINUX)
+    SUBCASE("Test utils::io::bulk files without a size") {
+        // Reports a size of 0, but has contents
+        const auto status = utils::io::file_to_string("/proc/self/status");
+        CHECK(status->find("Name:") == 0);
+    }
+#endif
+
+    SUBCASE("Test utils::io::bulk errors") {
+        CHECK_THROWS_AS(std::ignore = utils::io::file_to_bytes(tmp.get_name() + ".missing"), utils::exceptions::FileReadException);
+        CHECK_THROWS_AS(std::ignore = utils::io::file_to_string(tmp.get_name() + ".missing"), utils::exceptions::FileReadException);
+        CHECK_THROWS_AS(utils::io::bulk::write(tmp.get_name() + ".missing/file", "x", 1), utils::exceptions::FileWriteException);
+        CHECK_NOTHROW(utils::io::string_to_file(tmp.get_name() + ".missing/file", "x"));
+    }
+}
+
+TEST_CASE("Test utils::io::MappedFile") {
+    utils::io::TemporaryFile tmp(false, "");
+    const auto data = utils::random::generate_x<uint8_t>(10000);
+    utils::io::bytes_to_file(tmp.get_name(), data.data(), data.size());
+
+    SUBCASE("Test utils::io::MappedFile contents") {
+        const utils::io::MappedFile file(tmp.get_name());
+
+        REQUIRE(file.size() == data.size());
+        CHECK(std::equal(file.begin(), file.end(), data.begin(), data.end()));
+        CHECK(file.view() == std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
+    }
+
+    SUBCASE("Test utils::io::BitStreamReader over a mapped file") {
+        const utils::io::MappedFile file(tmp.get_name());
+        utils::io::BitStreamReader reader(file);
+
+        // Borrowed, not copied
+        CHECK(reader.get_buffer() == file.data());
+        CHECK(reader.get_size() == data.size());
+        CHECK(reader.get(8) == data[0]);
+        CHECK(reader.get(16) == ((uint32_t(data[1]) << 8) | data[2]));
+
+        auto owning = utils::io::BitStreamReader::from_file(tmp.get_name());
+        REQUIRE(owning->get_size() == data.size());
+        CHECK(std::equal(owning->get_buffer(), owning->get_buffer() + owning->get_size(), data.begin()));
+    }
+
+    SUBCASE("Test utils::io::MappedFile empty and missing files") {
+        utils::io::TemporaryFile empty(false, "");
+        utils::io::bytes_to_file(empty.get_name(), nullptr, 0);
+
+        const utils::io::MappedFile file(empty.get_name());
+        CHECK(file.empty());
+        CHECK(file.view().empty());
+        CHECK(utils::io::BitStreamReader::from_file(empty.get_name())->get_size() == 0);
+
+        CHECK_THROWS_AS(utils::io::MappedFile(empty.get_name() + ".missing"), utils::exceptions::FileReadException);
+        CHECK_THROWS_AS(utils::io::BitStreamReader::from_file(empty.get_name() + ".missing"), utils::exceptions::FileReadException);
+    }
+}
+
+TEST_CASE("Benchmark utils::io bulk file I/O" * doctest::skip()) {
+    utils::io::TemporaryFile tmp(false, "");
+
+    // The implementations before utils::io::bulk
+    const auto stream_read = [](const std::string& filename) {
+        std::ifstream file(filename, std::ifstream::binary | std::ifstream::ate);
+        std::vector<uint8_t> buffer;
+        buffer.reserve(size_t(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return buffer;
+    };
+
+    const auto stream_write = [](const std::string& filename, const std::string_view str) {
+        std::ofstream file(filename);
+        file << str;
+    };
+
+    utils::Logger::Writef("\n%10s %12s %12s %12s %12s %12s\n", "size (KiB)", "istreambuf", "bulk read",
+                          "mmap copy", "operator<<", "bulk write");
+
+    for (size_t length = 1 << 12; length <= (1 << 28); length <<= 4) {
+        const auto data = utils::random::generate_x<uint8_t>(length);
+        const std::string_view view(reinterpret_cast<const char*>(data.data()), data.size());
+        const size_t repeat = std::max<size_t>(1, (1 << 24) / length);
+        size_t checked = 0;
+
+        utils::io::bulk::write(tmp.get_name(), data.data(), data.size());
+
+        const auto time = [&](auto&& fn) {
+            return utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+                for (size_t i = 0; i < repeat; i++) fn();
+            }) / double(repeat);
+        };
+
+        const double t_stream = time([&] { checked += stream_read(tmp.get_name()).size(); });
+        const double t_bulk   = time([&] { checked += utils::io::file_to_bytes(tmp.get_name())->size(); });
+        const double t_mmap   = time([&] {
+            const utils::io::MappedFile file(tmp.get_name());
+            checked += std::vector<uint8_t>(file.begin(), file.end()).size();
+        });
+        const double t_stream_write = time([&] { stream_write(tmp.get_name(), view); });
+        const double t_bulk_write   = time([&] { utils::io::string_to_file(tmp.get_name(), view); });
+
+        REQUIRE(checked == 3 * repeat * length);
+
+        const double mb = double(length) / (1024.0 * 1024.0);
+        utils::Logger::Writef("%10zu %9.1f MB/s %7.1f MB/s %7.1f MB/s %7.1f MB/s %7.1f MB/s\n", length / 1024,
+                              mb / (t_stream / 1000.0), mb / (t_bulk / 1000.0), mb / (t_mmap / 1000.0),
+                              mb / (t_stream_write / 1000.0), mb / (t_bulk_write / 1000.0));
+    }
+}
+
+TEST_CASE("Test utils::io::BitStreamReader") {
+    auto data = utils::random::generate_x<uint8_t>(1000);
+
+    SUBCASE("Test utils::io::BitStreamReader get against reference") {
+        for (const size_t length : { size_t(0), size_t(1), size_t(7), size_t(8), size_t(9), data.size() }) {
+            CAPTURE(length);
+            std::vector<uint8_t> part(data.begin(), data.begin() + std::ptrdiff_t(length));
+            utils::io::BitStreamReader reader(part);
+            ReferenceBitReader ref{ part };
+
+            // Reads past the end as well, which must give zeroes.
+            for (size_t read = 0; read <= part.size() / 2u + 8u; read++) {
+                const auto n = utils::random::Random::get<uint_fast32_t>(0, 32);
+                CAPTURE(ref.position);
+                CAPTURE(n);
+                REQUIRE(reader.get(n) == uint32_t(ref.get(n)));
+                REQUIRE(reader.get_position() == std::min(ref.position, part.size() * 8u));
+            }
+        }
+    }
+
+    SUBCASE("Test utils::io::BitStreamReader peek, skip and get64") {
+        utils::io::BitStreamReader reader(data);
+        ReferenceBitReader ref{ data };
+
+        while (ref.position < data.size() * 8u) {
+            const auto n = utils::random::Random::get<uint_fast32_t>(0, utils::io::BitStreamReader::MAX_BITS);
+            CAPTURE(ref.position);
+            CAPTURE(n);
+
+            const size_t before = reader.get_position();
+            const uint64_t expected = ref.get(n);
+            REQUIRE(reader.peek(n) == expected);
+            REQUIRE(reader.get_position() == before);
+
+            if (n % 2) {
+                reader.skip(n);
+            } else {
+                REQUIRE(reader.get64(n) == expected);
+            }
+        }
+
+        CHECK(reader.get_bit() == 0);
+        CHECK(reader.get_position() == data.size() * 8u);
+    }
+
+    SUBCASE("Test utils::io::BitStreamReader external position changes") {
+        utils::io::BitStreamReader reader(data);
+        ReferenceBitReader ref{ data };
+
+        for (size_t i = 0; i < 1000; i++) {
+            const size_t pos = utils::random::Random::get<size_t>(0, data.size() * 8u - 1);
+            ref.position = pos;
+
+            reader.set_position(pos);
+
+            REQUIRE(reader.get(17) == uint32_t(ref.get(17)));
+            REQUIRE(reader.get_bit() == ref.get_bit());
+        }
+
+        reader.set_position(3);
+        reader.flush();
+        ref.position = 8;
+        CHECK(reader.get(32) == uint32_t(ref.get(32)));
+    }
+
+    SUBCASE("Test utils::io::BitStreamReader get more than 32 bits") {
+        utils::io::BitStreamReader reader(data);
+        ReferenceBitReader ref{ data };
+
+        CHECK(reader.get(40) == uint32_t(ref.get(40)));
+        CHECK(reader.get(100) == uint32_t(ref.get(100)));
+        CHECK(reader.get_position() == 140);
+    }
+}
+
+TEST_CASE("Benchmark utils::io::BitStreamReader" * doctest::skip()) {
+    constexpr size_t SIZE = 1 << 22;
+    const auto data = utils::random::generate_x<uint8_t>(SIZE);
+
+    utils::Logger::Writef("\n%6s %16s %16s %10s\n", "bits", "bit-wise (MB/s)", "cached (MB/s)", "speedup");
+
+    for (const uint_fast32_t n : { 1u, 5u, 8u, 13u, 32u }) {
+        const size_t reads = SIZE * 8u / n;
+        uint64_t sum_ref = 0, sum_new = 0;
+
+        ReferenceBitReader ref{ data };
+        const double t_ref = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            for (size_t i = 0; i < reads; i++) sum_ref += ref.get(n);
+        });
+
+        utils::io::BitStreamReader reader(data);
+        const double t_new = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            for (size_t i = 0; i < reads; i++) sum_new += reader.get(n);
+        });
+
+        REQUIRE(sum_ref == sum_new);
+
+        const double mb = double(SIZE) / (1024.0 * 1024.0);
+        utils::Logger::Writef("%6u %16.1f %16.1f %9.1fx\n", unsigned(n),
+                              mb / (t_ref / 1000.0), mb / (t_new / 1000.0), t_ref / t_new);
+    }
+}
+
+TEST_CASE("Test utils::io::BitStreamWriter") {
+    SUBCASE("Test utils::io::BitStreamWriter put against reference") {
+        std::vector<uint8_t> expected(1024, 0);
+        ReferenceBitWriter ref{ expected };
+        utils::io::BitStreamWriter writer(1);  // Grows
+
+        while (ref.position + 64u <= expected.size() * 8u) {
+            const auto n = utils::random::Random::get<uint_fast32_t>(0, utils::io::BitStreamWriter::MAX_BITS);
+            const auto v = utils::random::Random::get<uint64_t>();
+            ref.put(n, v);
+
+            if (n == 1 && v % 2) {
+                writer.put_bit(uint8_t(v));
+            } else {
+                writer.put(n, v);
+            }
+
+            REQUIRE(writer.get_position() == ref.position);
+        }
+
+        REQUIRE(writer.get_size() >= writer.get_last_byte_position());
+        CHECK(std::equal(expected.begin(), expected.begin() + std::ptrdiff_t(writer.get_last_byte_position()),
+                         writer.get_buffer()));
+    }
+
+    SUBCASE("Test utils::io::BitStreamWriter keeps the exact size") {
+        utils::io::BitStreamWriter writer(9);
+
+        for (size_t i = 0; i < 9; i++) {
+            writer.put(7, 0x55);
+            writer.put_bit(1);
+        }
+
+        CHECK(writer.get_size() == 9);
+        CHECK(writer.get_position() == 72);
+
+        for (size_t i = 0; i < 9; i++) {
+            CHECK(writer[i] == 0xAB);
+        }
+
+        writer.put_bit(1);
+        CHECK(writer.get_size() > 9);
+        CHECK(writer.get_buffer()[9] == 0x80);
+    }
+
+    SUBCASE("Test utils::io::BitStreamWriter unmanaged buffer") {
+        uint8_t buffer[3] = { 0xFF, 0xFF, 0xFF };
+        utils::io::BitStreamWriter writer(buffer, 3);
+
+        writer.put(3, 0b101);
+        writer.flush();
+        CHECK(writer.get_position() == 8);
+        CHECK(writer.get_buffer()[0] == 0xA0);
+
+        // Unwritten bits are kept until flushed.
+        writer.put(12, 0);
+        CHECK(writer.get_buffer()[1] == 0x00);
+        CHECK(buffer[2] == 0x0F);
+
+        CHECK_THROWS_AS(writer.put(5, 0), utils::exceptions::Exception);
+    }
+
+    SUBCASE("Test utils::io::BitStreamWriter external position changes") {
+        std::vector<uint8_t> expected(64, 0);
+        ReferenceBitWriter ref{ expected };
+        utils::io::BitStreamWriter writer(64);
+
+        for (size_t i = 0; i < 1000; i++) {
+            const auto n   = utils::random::Random::get<uint_fast32_t>(0, 64);
+            const auto v   = utils::random::Random::get<uint64_t>();
+            const auto pos = utils::random::Random::get<size_t>(0, expected.size() * 8u - 64u);
+
+            ref.position = pos;
+            writer.set_position(pos);
+            ref.put(n, v);
+            writer.put(n, v);
+        }
+
+        CHECK(std::equal(expected.begin(), expected.end(), writer.get_buffer()));
+    }
+
+    SUBCASE("Test utils::io::BitStreamWriter put_unchecked") {
+        utils::io::BitStreamWriter writer(0);
+        writer.reserve(125);
+
+        for (uint32_t i = 0; i < 100; i++) {
+            writer.put_unchecked(10, i);
+        }
+
+        CHECK(writer.get_size() == 125);
+
+        utils::io::BitStreamReader reader(writer.get_buffer(), writer.get_size());
+        for (uint32_t i = 0; i < 100; i++) {
+            REQUIRE(reader.get(10) == i);
+        }
+    }
+}
+
+TEST_CASE("Benchmark utils::io::BitStreamWriter" * doctest::skip()) {
+    constexpr size_t SIZE = 1 << 22;
+
+    utils::Logger::Writef("\n%6s %16s %16s %10s\n", "bits", "bit-wise (MB/s)", "buffered (MB/s)", "speedup");
+
+    for (const uint_fast32_t n : { 1u, 5u, 8u, 13u, 32u }) {
+        const size_t writes = SIZE * 8u / n;
+
+        std::vector<uint8_t> expected(SIZE + 8u, 0);
+        ReferenceBitWriter ref{ expected };
+        const double t_ref = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            for (size_t i = 0; i < writes; i++) ref.put(n, i);
+        });
+
+        utils::io::BitStreamWriter writer(SIZE + 8u);
+        const double t_new = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            for (size_t i = 0; i < writes; i++) writer.put(n, i);
+        });
+
+        REQUIRE(std::equal(expected.begin(), expected.end(), writer.get_buffer()));
+
+        const double mb = double(SIZE) / (1024.0 * 1024.0);
+        utils::Logger::Writef("%6u %16.1f %16.1f %9.1fx\n", unsigned(n),
+                              mb / (t_ref / 1000.0), mb / (t_new / 1000.0), t_ref / t_new);
+    }
+}
+
 #endif
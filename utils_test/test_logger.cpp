@@ -0,0 +1,161 @@
+#include "test_settings.hpp"
+
+#ifdef ENABLE_TESTS
+#include "../utils_lib/external/doctest.hpp"
+
+#include "../utils_lib/utils_logger.hpp"
+
+#include "../utils_lib/utils_io.hpp"
+#include "../utils_lib/utils_string.hpp"
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <cstring>
+#include <cwchar>
+
+
+namespace {
+    std::vector<std::string> read_lines(const utils::io::fs::path& path) {
+        std::ifstream in(path);
+        std::vector<std::string> lines;
+
+        for (std::string line; std::getline(in, line);) {
+            if (!line.empty()) lines.emplace_back(line);
+        }
+
+        return lines;
+    }
+}
+
+TEST_CASE("Test utils::Logger async mode") {
+    utils::io::TemporaryFile tmp(false, "");
+    const auto path = tmp.get_path();
+
+    utils::Logger::PauseScreen();
+    utils::Logger::InitFile(path.string());
+
+    SUBCASE("Test utils::Logger async ordering and Flush") {
+        constexpr size_t THREADS = 4, LINES = 500;
+
+        utils::Logger::EnableAsync(64, utils::Logger::OverflowPolicy::Block);
+        REQUIRE(utils::Logger::IsAsync());
+
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < THREADS; t++) {
+            producers.emplace_back([t] {
+                for (size_t i = 0; i < LINES; i++) {
+                    utils::Logger::Info("%zu %zu", t, i);
+                }
+            });
+        }
+        for (auto& p : producers) p.join();
+
+        utils::Logger::Flush();
+
+        const auto lines = read_lines(path);
+        REQUIRE(lines.size() == THREADS * LINES);
+        CHECK(utils::Logger::GetDroppedCount() == 0);
+
+        // Per producer, records must arrive in order and unbroken.
+        std::vector<size_t> next(THREADS, 0);
+        for (const auto& line : lines) {
+            const auto pos = line.find("[Info] ");
+            REQUIRE(pos != std::string::npos);
+
+            size_t t = 0, i = 0;
+            REQUIRE(std::sscanf(line.c_str() + pos + 7, "%zu %zu", &t, &i) == 2);
+            REQUIRE(t < THREADS);
+            CHECK(i == next[t]++);
+        }
+
+        utils::Logger::DisableAsync();
+        CHECK_FALSE(utils::Logger::IsAsync());
+    }
+
+    SUBCASE("Test utils::Logger async overflow policies") {
+        constexpr size_t LINES = 20000;
+
+        for (const auto policy : { utils::Logger::OverflowPolicy::Drop,
+                                   utils::Logger::OverflowPolicy::DropOldest })
+        {
+            CAPTURE(int(policy));
+            utils::Logger::InitFile(path.string());
+            const size_t before = read_lines(path).size();
+
+            utils::Logger::EnableAsync(4, policy);
+
+            for (size_t i = 0; i < LINES; i++) {
+                utils::Logger::Writef("%zu\n", i);
+            }
+
+            utils::Logger::Flush();
+
+            const size_t written = read_lines(path).size() - before;
+            CHECK(written + utils::Logger::GetDroppedCount() == LINES);
+
+            utils::Logger::DisableAsync();
+        }
+    }
+
+    SUBCASE("Test utils::Logger Write while async") {
+        utils::Logger::EnableAsync();
+        utils::Logger::WriteLn("first");
+        utils::Logger::Write("second", true);
+        utils::Logger::DisableAsync();
+
+        const auto lines = read_lines(path);
+        REQUIRE(lines.size() == 2);
+        CHECK(lines[0] == "first");
+        CHECK(lines[1].substr(lines[1].size() - 6) == "second");
+        CHECK(lines[1].front() == '[');
+    }
+
+    SUBCASE("Test utils::Logger async deferred formatting") {
+        utils::Logger::EnableAsync();
+
+        char name[16] = "first";
+        utils::Logger::Info("%s %d %.2f %c", name, -3, 0.5, 'x');
+        std::strcpy(name, "changed");
+        utils::Logger::Writef("%s|%u|%p\n", static_cast<const char*>(nullptr), 7u, static_cast<void*>(nullptr));
+
+        // Too many arguments to pack, formatted on the calling thread instead.
+        utils::Logger::Writef("%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d\n",
+                              1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7);
+        utils::Logger::Flush();
+
+        const auto lines = read_lines(path);
+        REQUIRE(lines.size() == 3);
+        CHECK(lines[0].substr(lines[0].find("[Info]")) == "[Info] first -3 0.50 x");
+        CHECK(lines[1].substr(lines[1].find("(null)")) == utils::string::format("(null)|7|%p", static_cast<void*>(nullptr)));
+        CHECK(lines[2].substr(lines[2].size() - 17) == "12345678901234567");
+
+        utils::Logger::DisableAsync();
+    }
+
+    SUBCASE("Test utils::Logger async copies pointed-to strings") {
+        utils::Logger::EnableAsync();
+
+        unsigned char ubuf[16] = "unsigned";
+        signed char   sbuf[16] = "signed";
+        wchar_t       wbuf[16] = L"wide";
+        utils::Logger::Info("%s %s %ls", static_cast<const unsigned char*>(ubuf),
+                            static_cast<signed char*>(sbuf), static_cast<const wchar_t*>(wbuf));
+
+        // Clobber the caller's buffers before the writer thread runs.
+        std::memcpy(ubuf, "CLOBBERD", 9);
+        std::memcpy(sbuf, "CLOBBERD", 9);
+        std::wmemcpy(wbuf, L"CLOBBERD", 9);
+        utils::Logger::Flush();
+
+        const auto lines = read_lines(path);
+        REQUIRE(lines.size() == 1);
+        CHECK(lines[0].substr(lines[0].find("[Info]")) == "[Info] unsigned signed wide");
+
+        utils::Logger::DisableAsync();
+    }
+
+    utils::Logger::DestroyFile();
+    utils::Logger::ResumeScreen();
+}
+
+#endif
@@ -23,6 +23,40 @@ TEST_CASE("Test utils::memory::bit_cast") {
     REQUIRE(doctest::Approx(2.125) == double(utils::memory::bit_cast<float>(b)));
 }
 
+TEST_CASE("Test utils::memory::span") {
+    std::vector<int> vec(10);
+    std::iota(vec.begin(), vec.end(), 0);
+
+    utils::memory::span<int> view(vec);
+    REQUIRE(view.data() == vec.data());
+    REQUIRE(view.size() == vec.size());
+    CHECK(view.size_bytes() == vec.size() * sizeof(int));
+    CHECK_FALSE(view.empty());
+    CHECK(std::accumulate(view.begin(), view.end(), 0) == 45);
+
+    view[3] = 42;
+    CHECK(vec[3] == 42);
+
+    const auto sub = view.subspan(2, 4);
+    CHECK(sub.data() == vec.data() + 2);
+    CHECK(sub.size() == 4);
+    CHECK(view.subspan(7).size() == 3);
+    CHECK(view.first(2).size() == 2);
+    CHECK(view.last(2).data() == vec.data() + 8);
+
+    // Read-only views, also from temporaries and arrays
+    const utils::memory::span<const int> cview = view;
+    CHECK(cview.data() == vec.data());
+    CHECK(utils::memory::span<const int>(std::vector<int>{ 1, 2, 3 }).size() == 3);
+
+    int arr[5] = { 0 };
+    CHECK(utils::memory::span<int>(arr).size() == 5);
+    CHECK(utils::memory::span<int>().empty());
+
+    CHECK_FALSE((std::is_constructible_v<utils::memory::span<int>, const std::vector<int>&>));
+    CHECK_FALSE((std::is_constructible_v<utils::memory::span<int>, utils::memory::span<const int>>));
+}
+
 TEST_CASE("Test utils::memory::allocVar") {
     int *test     = utils::memory::new_var<int>();
     int *test_val = utils::memory::new_var<int>(0xDEADBEEF);
@@ -0,0 +1,310 @@
+#include "test_settings.hpp"
+
+#ifdef ENABLE_TESTS
+#include "../utils_lib/external/doctest.hpp"
+
+#include "../utils_lib/utils_profiler.hpp"
+
+#include "../utils_lib/utils_io.hpp"
+#include "../utils_lib/utils_json.hpp"
+#include "../utils_lib/utils_logger.hpp"
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <map>
+#include <sstream>
+
+
+namespace {
+    utils::json read_trace(const utils::io::fs::path& path) {
+        std::ifstream in(path);
+        return utils::json::parse(in);
+    }
+}
+
+TEST_CASE("Test utils::Profiler trace output") {
+    utils::io::TemporaryFile tmp(false, "");
+
+    SUBCASE("Test utils::Profiler per-thread buffers") {
+        constexpr size_t THREADS = 4;
+        constexpr size_t SCOPES  = utils::Profiler::CHUNK_EVENTS + 100;  // Spans a chunk boundary
+
+        UTILS_PROFILE_BEGIN_SESSION(tmp.get_name());
+        REQUIRE(utils::Profiler::IsActive());
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < THREADS; t++) {
+            threads.emplace_back([] {
+                for (size_t i = 0; i < SCOPES; i++) {
+                    UTILS_PROFILE_SCOPE("inner \"scope\"");
+                }
+            });
+        }
+
+        {
+            UTILS_PROFILE_SCOPE("outer");
+            for (auto& t : threads) t.join();
+        }
+
+        // A flush halfway must not lose or duplicate events.
+        utils::Profiler::Flush();
+        { UTILS_PROFILE_SCOPE("after flush"); }
+
+        UTILS_PROFILE_END_SESSION();
+        CHECK_FALSE(utils::Profiler::IsActive());
+
+        { UTILS_PROFILE_SCOPE("not recorded"); }
+
+        const auto trace = read_trace(tmp.get_path());
+        std::map<std::string, size_t> names;
+        std::map<uint32_t, size_t> tids;
+
+        for (const auto& ev : trace["traceEvents"]) {
+            if (ev.empty()) continue;
+            CHECK(ev["ph"] == "X");
+            CHECK(ev["dur"].get<double>() >= 0.0);
+            names[ev["name"].get<std::string>()]++;
+            tids[ev["tid"].get<uint32_t>()]++;
+        }
+
+        CHECK(names.size() == 3);
+        CHECK(names["inner \"scope\""] == THREADS * SCOPES);
+        CHECK(names["outer"] == 1);
+        CHECK(names["after flush"] == 1);
+        CHECK(tids.size() == THREADS + 1);
+    }
+}
+
+TEST_CASE("Test utils::Profiler aggregate mode") {
+    utils::io::TemporaryFile tmp(false, "");
+
+    constexpr size_t THREADS = 3;
+    constexpr size_t FAST    = 1000;
+    constexpr size_t SLOW    = 5;
+    constexpr size_t SAMPLE  = 100;
+
+    UTILS_PROFILE_BEGIN_AGGREGATE(tmp.get_name(), SAMPLE);
+    REQUIRE(utils::Profiler::IsActive());
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREADS; t++) {
+        threads.emplace_back([] {
+            for (size_t i = 0; i < FAST; i++) {
+                UTILS_PROFILE_SCOPE("fast");
+            }
+            for (size_t i = 0; i < SLOW; i++) {
+                UTILS_PROFILE_SCOPE("slow");
+                utils::time::sleep(utils::time::milliseconds(2));
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    // Same name through a different pointer must be merged.
+    const std::string other_fast("fast");
+    { UTILS_PROFILE_SCOPE(other_fast); }
+
+    const auto stats = utils::Profiler::GetStats();
+    REQUIRE(stats.size() == 2);
+    CHECK(stats[0].name == "slow");
+    CHECK(stats[1].name == "fast");
+
+    for (const auto& s : stats) {
+        CAPTURE(s.name);
+        CHECK(s.min  <= s.p50);
+        CHECK(s.p50  <= s.p90);
+        CHECK(s.p90  <= s.p99);
+        CHECK(s.p99  <= s.p999);
+        CHECK(s.p999 <= s.max);
+        CHECK(s.total >= s.count * s.min);
+    }
+
+    CHECK(stats[0].count == THREADS * SLOW);
+    CHECK(stats[1].count == THREADS * FAST + 1);
+    CHECK(stats[0].p50 >= 2000000 * 7 / 8);
+
+    std::stringstream text, json;
+    utils::Profiler::DumpStats(text);
+    utils::Profiler::DumpStats(json, utils::Profiler::Format::Json);
+    CHECK(text.str().find("slow") != std::string::npos);
+
+    const auto parsed = utils::json::parse(json.str());
+    REQUIRE(parsed.size() == 2);
+    CHECK(parsed[0]["name"] == "slow");
+    CHECK(parsed[1]["count"] == THREADS * FAST + 1);
+
+    UTILS_PROFILE_END_SESSION();
+    CHECK(utils::Profiler::GetStats().empty());
+
+    // Only 1 in SAMPLE scopes, per thread, is written as a trace event.
+    const auto trace = read_trace(tmp.get_path());
+    size_t fast_events = 0;
+    for (const auto& ev : trace["traceEvents"]) {
+        if (!ev.empty() && ev["name"] == "fast") fast_events++;
+    }
+    CHECK(fast_events == THREADS * (FAST / SAMPLE));
+}
+
+TEST_CASE("Test utils::Profiler event kinds") {
+    utils::io::TemporaryFile tmp(false, "");
+
+    SUBCASE("Test utils::Profiler counter, async, flow and instant events") {
+        UTILS_PROFILE_BEGIN_SESSION(tmp.get_name());
+
+        const uint64_t id = utils::Profiler::NewId();
+        CHECK(utils::Profiler::NewId() != id);
+
+        UTILS_PROFILE_THREAD_NAME("main \"thread\"");
+        UTILS_PROFILE_COUNTER("queue", 3.5);
+        UTILS_PROFILE_ASYNC_BEGIN("request", id);
+        UTILS_PROFILE_FLOW_START("handoff", id);
+
+        std::thread([id] {
+            UTILS_PROFILE_THREAD_NAME("helper");
+            UTILS_PROFILE_SCOPE("helper work");
+            UTILS_PROFILE_FLOW_END("handoff", id);
+            UTILS_PROFILE_ASYNC_END("request", id);
+        }).join();
+
+        UTILS_PROFILE_INSTANT("done");
+        UTILS_PROFILE_END_SESSION();
+
+        const auto trace = read_trace(tmp.get_path());
+        std::map<std::string, utils::json> events;
+        std::map<uint32_t, std::string> thread_names;
+
+        for (const auto& ev : trace["traceEvents"]) {
+            if (ev.empty()) continue;
+
+            if (ev["ph"] == "M") {
+                CHECK(ev["name"] == "thread_name");
+                thread_names[ev["tid"].get<uint32_t>()] = ev["args"]["name"].get<std::string>();
+            } else {
+                events[ev["ph"].get<std::string>()] = ev;
+            }
+        }
+
+        REQUIRE(events.size() == 7);
+        CHECK(events["C"]["name"] == "queue");
+        CHECK(events["C"]["args"]["value"].get<double>() == 3.5);
+        CHECK(events["b"]["id"] == id);
+        CHECK(events["e"]["id"] == id);
+        CHECK(events["s"]["id"] == id);
+        CHECK(events["f"]["id"] == id);
+        CHECK(events["f"]["bp"] == "e");
+        CHECK(events["i"]["name"] == "done");
+        CHECK(events["X"]["name"] == "helper work");
+
+        // The flow and async slice cross threads.
+        CHECK(events["b"]["tid"] != events["e"]["tid"]);
+        CHECK(events["s"]["tid"] != events["f"]["tid"]);
+        CHECK(events["f"]["tid"] == events["X"]["tid"]);
+
+        REQUIRE(thread_names.size() == 2);
+        CHECK(thread_names[events["s"]["tid"].get<uint32_t>()] == "main \"thread\"");
+        CHECK(thread_names[events["f"]["tid"].get<uint32_t>()] == "helper");
+    }
+
+    SUBCASE("Test utils::Profiler ThreadPool instrumentation") {
+        using Mode = utils::threading::ThreadPool::Mode;
+        constexpr size_t TASKS = 50;
+
+        for (const auto mode : { Mode::SharedQueue, Mode::WorkStealing }) {
+            CAPTURE(int(mode));
+
+            UTILS_PROFILE_BEGIN_SESSION(tmp.get_name());
+            utils::Profiler::InstrumentThreadPools();
+
+            {
+                utils::threading::ThreadPool pool(2, mode);
+                for (size_t i = 0; i < TASKS; i++) {
+                    pool.post([] { UTILS_PROFILE_SCOPE("work"); });
+                }
+            }
+
+            utils::Profiler::InstrumentThreadPools(false);
+            CHECK(utils::threading::ThreadPool::get_hooks() == nullptr);
+            UTILS_PROFILE_END_SESSION();
+
+            const auto trace = read_trace(tmp.get_path());
+            std::map<std::string, size_t> counts;
+            size_t worker_names = 0;
+
+            for (const auto& ev : trace["traceEvents"]) {
+                if (ev.empty()) continue;
+
+                if (ev["ph"] == "M") {
+                    worker_names += ev["args"]["name"].get<std::string>().rfind("ThreadPool worker ", 0) == 0;
+                } else {
+                    counts[ev["ph"].get<std::string>() + ev["name"].get<std::string>()]++;
+                }
+            }
+
+            CHECK(counts["XThreadPool::task"]          == TASKS);
+            CHECK(counts["Xwork"]                      == TASKS);
+            CHECK(counts["bThreadPool::queued"]        == TASKS);
+            CHECK(counts["eThreadPool::queued"]        == TASKS);
+            CHECK(counts["sThreadPool::task"]          == TASKS);
+            CHECK(counts["fThreadPool::task"]          == TASKS);
+            CHECK(counts["CThreadPool::tasks_in_queue"] == TASKS);
+            CHECK(worker_names >= 1);
+            CHECK(worker_names <= 2);
+        }
+    }
+
+    SUBCASE("Test utils::Profiler ThreadPool queue latency statistics") {
+        UTILS_PROFILE_BEGIN_AGGREGATE("", 0);
+        utils::Profiler::InstrumentThreadPools();
+
+        {
+            utils::threading::ThreadPool pool(1);
+            for (size_t i = 0; i < 10; i++) {
+                pool.post([] {});
+            }
+        }
+
+        utils::Profiler::InstrumentThreadPools(false);
+
+        const auto stats = utils::Profiler::GetStats();
+        std::map<std::string, size_t> counts;
+        for (const auto& s : stats) counts[s.name] = s.count;
+
+        CHECK(counts["ThreadPool::queued"] == 10);
+        CHECK(counts["ThreadPool::task"]   == 10);
+
+        UTILS_PROFILE_END_SESSION();
+    }
+}
+
+TEST_CASE("Benchmark utils::Profiler scope overhead" * doctest::skip()) {
+    constexpr size_t N = 1000000;
+    utils::io::TemporaryFile tmp(false, "");
+
+    UTILS_PROFILE_BEGIN_SESSION(tmp.get_name());
+
+    const double t_scope = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+        for (size_t i = 0; i < N; i++) {
+            UTILS_PROFILE_SCOPE("bench");
+        }
+    });
+
+    const double t_end = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+        UTILS_PROFILE_END_SESSION();
+    });
+
+    UTILS_PROFILE_BEGIN_AGGREGATE("", 0);
+
+    const double t_aggregate = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+        for (size_t i = 0; i < N; i++) {
+            UTILS_PROFILE_SCOPE("bench");
+        }
+    });
+
+    UTILS_PROFILE_END_SESSION();
+
+    utils::Logger::Writef("\n%-24s %12.1f ns/scope\n", "UTILS_PROFILE_SCOPE", t_scope * 1.0e6 / double(N));
+    utils::Logger::Writef("%-24s %12.1f ms (%zu events)\n", "EndSession merge", t_end, N);
+    utils::Logger::Writef("%-24s %12.1f ns/scope\n", "Aggregate mode", t_aggregate * 1.0e6 / double(N));
+}
+
+#endif
@@ -0,0 +1,266 @@
+#include "test_settings.hpp"
+
+#ifdef ENABLE_TESTS
+#include "../utils_lib/external/doctest.hpp"
+
+#include "../utils_lib/utils_threading.hpp"
+
+#include "../utils_lib/utils_logger.hpp"
+#include "../utils_lib/utils_time.hpp"
+#include <atomic>
+#include <numeric>
+#include <array>
+#include <chrono>
+#include <thread>
+
+
+TEST_CASE("Test utils::threading::Task") {
+    SUBCASE("Test utils::threading::Task inline storage") {
+        int value = 0;
+        auto small = [&value] { value += 1; };
+        static_assert(utils::threading::Task::fits_inline_v<decltype(small)>);
+
+        utils::threading::Task task(small);
+        REQUIRE(task);
+        task();
+        CHECK(value == 1);
+
+        utils::threading::Task moved(std::move(task));
+        CHECK_FALSE(task);
+        REQUIRE(moved);
+        moved();
+        CHECK(value == 2);
+
+        moved.reset();
+        CHECK_FALSE(moved);
+    }
+
+    SUBCASE("Test utils::threading::Task heap storage") {
+        std::array<int, 64> values{};
+        values.fill(1);
+        auto out   = std::make_shared<int>(0);
+        auto large = [values, out] { *out = std::accumulate(values.begin(), values.end(), 0); };
+        static_assert(!utils::threading::Task::fits_inline_v<decltype(large)>);
+
+        utils::threading::Task task(std::move(large));
+        utils::threading::Task other;
+        other = std::move(task);
+        CHECK_FALSE(task);
+        REQUIRE(other);
+        other();
+        CHECK(*out == 64);
+
+        other.reset();
+        CHECK(out.use_count() == 1);
+    }
+}
+
+TEST_CASE("Test utils::threading::ThreadPool") {
+    using Mode = utils::threading::ThreadPool::Mode;
+
+    for (const Mode mode : { Mode::SharedQueue, Mode::WorkStealing }) {
+        CAPTURE(int(mode));
+
+        SUBCASE("Test utils::threading::ThreadPool::enqueue results") {
+            utils::threading::ThreadPool pool(4, mode);
+            REQUIRE(pool.size() == 4);
+            CHECK(pool.get_mode() == mode);
+
+            std::vector<std::future<int>> results;
+
+            for (int i = 0; i < 1000; i++) {
+                results.emplace_back(pool.enqueue([](int a, int b) { return a * b; }, i, 2));
+            }
+
+            for (int i = 0; i < 1000; i++) {
+                CHECK(results[size_t(i)].get() == i * 2);
+            }
+        }
+
+        SUBCASE("Test utils::threading::ThreadPool::enqueue from within a task") {
+            std::atomic<int> counter{0};
+            utils::threading::ThreadPool pool(3, mode);
+
+            for (int i = 0; i < 100; i++) {
+                pool.enqueue([&] {
+                    for (int j = 0; j < 10; j++) {
+                        pool.enqueue([&] { ++counter; });
+                    }
+                });
+            }
+
+            const auto start = utils::time::Timer::Start();
+            while (counter < 1000 && utils::time::Timer::time_s::duration(start) < 10.0) {
+                std::this_thread::yield();
+            }
+
+            CHECK(counter == 1000);
+        }
+
+        SUBCASE("Test utils::threading::ThreadPool::post") {
+            std::atomic<int> counter{0};
+
+            {
+                utils::threading::ThreadPool pool(4, mode);
+
+                for (int i = 0; i < 1000; i++) {
+                    pool.post([&counter](int v) { counter += v; }, 2);
+                }
+            }
+
+            CHECK(counter == 2000);
+        }
+
+        SUBCASE("Test utils::threading::ThreadPool::enqueue exceptions") {
+            utils::threading::ThreadPool pool(2, mode);
+
+            auto fut = pool.enqueue([]() -> int { throw std::runtime_error("task"); });
+            CHECK_THROWS_AS(fut.get(), std::runtime_error);
+        }
+    }
+}
+
+TEST_CASE("Test utils::threading::TaskFuture") {
+    using Mode = utils::threading::ThreadPool::Mode;
+
+    for (const Mode mode : { Mode::SharedQueue, Mode::WorkStealing }) {
+        CAPTURE(int(mode));
+
+        // A single worker would deadlock if any stage blocked on another.
+        utils::threading::ThreadPool pool(1, mode);
+
+        SUBCASE("Test utils::threading::TaskFuture::then") {
+            auto fut = pool.submit([](int x) { return x + 1; }, 1)
+                           .then([](int x) { return x * 10; })
+                           .then([](int x) { return std::to_string(x); });
+
+            CHECK(fut.get() == "20");
+            CHECK(fut.is_ready());
+
+            std::atomic<int> called{0};
+            auto v = pool.submit([&] { ++called; })
+                         .then([&] { ++called; return 5; });
+            CHECK(v.get() == 5);
+            CHECK(called == 2);
+        }
+
+        SUBCASE("Test utils::threading::TaskFuture exceptions") {
+            std::atomic<bool> called{false};
+            auto fut = pool.submit([]() -> int { throw std::runtime_error("task"); })
+                           .then([&](int x) { called = true; return x; });
+
+            CHECK_THROWS_AS(fut.get(), std::runtime_error);
+            CHECK_FALSE(called);
+        }
+
+        SUBCASE("Test utils::threading::TaskFuture::then while the pool stops") {
+            std::atomic<bool> called{false};
+            utils::threading::TaskFuture<int> fut;
+
+            {
+                utils::threading::ThreadPool stopping(1, mode);
+                fut = stopping.submit([] {
+                          std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                          return 1;
+                      })
+                      .then([&](int x) { called = true; return x + 1; });
+            }
+
+            // The continuation cannot be scheduled any more, its error ends up in the future.
+            CHECK(fut.is_ready());
+            CHECK_THROWS_AS(fut.get(), utils::exceptions::Exception);
+            CHECK_FALSE(called);
+        }
+
+        SUBCASE("Test utils::threading::when_all") {
+            std::vector<utils::threading::TaskFuture<int>> futures;
+
+            for (int i = 0; i < 10; i++) {
+                futures.emplace_back(pool.submit([i] { return i; }));
+            }
+
+            auto total = utils::threading::when_all(futures).then([](const auto& all) {
+                int sum = 0;
+                for (const auto& f : all) sum += f.get();
+                return sum;
+            });
+
+            CHECK(total.get() == 45);
+
+            auto mixed = utils::threading::when_all(pool.submit([] { return 2; }),
+                                                    pool.submit([] {}),
+                                                    pool.submit([] { return std::string("a"); }))
+                .then([](const auto& all) {
+                    std::get<1>(all).get();
+                    return std::string(size_t(std::get<0>(all).get()), 'b') + std::get<2>(all).get();
+                });
+
+            CHECK(mixed.get() == "bba");
+        }
+
+        SUBCASE("Test utils::threading::when_any") {
+            std::promise<void> gate;
+            auto blocked = gate.get_future().share();
+
+            utils::threading::ThreadPool other(1, mode);
+            std::vector<utils::threading::TaskFuture<int>> futures;
+            futures.emplace_back(other.submit([blocked] { blocked.wait(); return 1; }));
+            futures.emplace_back(pool.submit([] { return 2; }));
+
+            auto first = utils::threading::when_any(futures);
+            CHECK(first.get().index == 1);
+            CHECK(first.get().futures[1].get() == 2);
+
+            auto first2 = utils::threading::when_any(futures[0], pool.submit([] { return std::string("x"); }));
+            CHECK(first2.get().index == 1);
+
+            gate.set_value();
+            CHECK(futures[0].get() == 1);
+        }
+    }
+}
+
+TEST_CASE("Benchmark utils::threading::ThreadPool throughput" * doctest::skip()) {
+    using Mode = utils::threading::ThreadPool::Mode;
+
+    constexpr size_t TASKS = 200000;
+    const size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const auto run = [&](const size_t threads, const Mode mode, const bool post) {
+        std::atomic<size_t> counter{0};
+
+        const double ms = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+            utils::threading::ThreadPool pool(threads, mode);
+
+            for (size_t i = 0; i < TASKS; i++) {
+                if (post) {
+                    pool.post([&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+                } else {
+                    pool.enqueue([&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+                }
+            }
+        });
+
+        REQUIRE(counter == TASKS);
+        return double(TASKS) / ms * 1000.0;
+    };
+
+    utils::Logger::Writef("\n%8s %18s %18s %18s %18s\n", "threads",
+                          "shared (tasks/s)", "stealing (tasks/s)",
+                          "shared post", "stealing post");
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        const double shared        = run(threads, Mode::SharedQueue , false);
+        const double stealing      = run(threads, Mode::WorkStealing, false);
+        const double shared_post   = run(threads, Mode::SharedQueue , true);
+        const double stealing_post = run(threads, Mode::WorkStealing, true);
+        utils::Logger::Writef("%8zu %18.0f %18.0f %18.0f %18.0f\n", threads,
+                              shared, stealing, shared_post, stealing_post);
+
+        if (threads < max_threads && threads * 2 > max_threads) {
+            threads = max_threads / 2;
+        }
+    }
+}
+
+#endif
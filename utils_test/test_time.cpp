@@ -0,0 +1,112 @@
+#include "test_settings.hpp"
+
+#ifdef ENABLE_TESTS
+#include "../utils_lib/external/doctest.hpp"
+
+#include "../utils_lib/utils_time.hpp"
+
+#include "../utils_lib/utils_logger.hpp"
+
+
+TEST_CASE("Test utils::time::TimestampCache") {
+    using Precision = utils::time::TimestampCache::Precision;
+
+    const std::time_t base = 1600000000 - 90;  // Crosses a few minute boundaries
+
+    SUBCASE("Test utils::time::TimestampCache matches Timestamp") {
+        for (const char *frmt : { "[%Y-%m-%d %H:%M:%S] ", "%S", "%H:%M:%S (%Y)", "%Y-%m-%d %H:%M", "100%% %S%%" }) {
+            CAPTURE(frmt);
+            utils::time::TimestampCache cache(frmt);
+
+            for (std::time_t t = base; t < base + 200; t += 7) {
+                CHECK(cache.render(t) == utils::time::Timestamp(frmt, &t));
+            }
+
+            // Going back in time must re-render as well.
+            CHECK(cache.render(base) == utils::time::Timestamp(frmt, &base));
+        }
+    }
+
+    SUBCASE("Test utils::time::TimestampCache %T") {
+        utils::time::TimestampCache cache("%F %T");
+
+        for (std::time_t t = base; t < base + 130; t += 13) {
+            CHECK(cache.render(t) == utils::time::Timestamp("%F %H:%M:%S", &t));
+        }
+    }
+
+    SUBCASE("Test utils::time::TimestampCache repeated seconds") {
+        for (const char *frmt : { "%T (%S)", "%S %T", "%S %r", "%S %X", "%S %c", "%S %s", "%S %OS" }) {
+            CAPTURE(frmt);
+            utils::time::TimestampCache cache(frmt);
+
+            for (std::time_t t = base; t < base + 130; t += 13) {
+                CHECK(cache.render(t) == utils::time::Timestamp(frmt, &t));
+            }
+        }
+
+        utils::time::TimestampCache ms("%S (%S)", Precision::Milliseconds);
+        const std::time_t next = base + 1;
+        CHECK(ms.render(base, 5000000) == utils::time::Timestamp("%S.005 (%S)", &base));
+        CHECK(ms.render(next, 5000000) == utils::time::Timestamp("%S.005 (%S)", &next));
+    }
+
+    SUBCASE("Test utils::time::TimestampCache sub-second precision") {
+        utils::time::TimestampCache ms("%H:%M:%S", Precision::Milliseconds);
+        utils::time::TimestampCache us("%H:%M:%S", Precision::Microseconds);
+        utils::time::TimestampCache ns("%H:%M:%S", Precision::Nanoseconds);
+
+        const std::string secs = utils::time::Timestamp("%H:%M:%S", &base);
+
+        CHECK(ms.render(base, 5123456) == secs + ".005");
+        CHECK(us.render(base, 5123456) == secs + ".005123");
+        CHECK(ns.render(base, 5123456) == secs + ".005123456");
+        CHECK(ms.render(base, 999999999) == secs + ".999");
+
+        const auto tp = std::chrono::system_clock::from_time_t(base) + std::chrono::microseconds(250);
+        CHECK(us.render(tp) == secs + ".000250");
+
+        // Without a seconds field there is nowhere to put the fraction.
+        utils::time::TimestampCache minutes("%H:%M", Precision::Milliseconds);
+        CHECK(minutes.get_precision() == Precision::Seconds);
+        CHECK(minutes.render(base, 5123456) == utils::time::Timestamp("%H:%M", &base));
+    }
+}
+
+TEST_CASE("Benchmark utils::time::TimestampCache" * doctest::skip()) {
+    constexpr size_t N = 1000000;
+    const char *frmt = "[%Y-%m-%d %H:%M:%S] ";
+    const std::time_t base = std::time(nullptr);
+
+    size_t sink = 0;
+
+    const double t_plain = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+        for (size_t i = 0; i < N / 100; i++) {
+            const std::time_t t = base + std::time_t(i / 1000);
+            sink += utils::time::Timestamp(frmt, &t).size();
+        }
+    }) * 100.0;
+
+    utils::time::TimestampCache cache(frmt);
+    const double t_cache = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+        for (size_t i = 0; i < N; i++) {
+            sink += cache.render(base + std::time_t(i / 1000)).size();
+        }
+    });
+
+    utils::time::TimestampCache cache_us(frmt, utils::time::TimestampCache::Precision::Microseconds);
+    const double t_now = utils::time::Timer::time<utils::time::Timer::time_ms>([&] {
+        for (size_t i = 0; i < N; i++) {
+            sink += cache_us.now().size();
+        }
+    });
+
+    REQUIRE(sink > 0);
+
+    utils::Logger::Writef("\n%-28s %12s\n", "", "ns/stamp");
+    utils::Logger::Writef("%-28s %12.1f\n", "Timestamp()",             t_plain * 1.0e6 / double(N));
+    utils::Logger::Writef("%-28s %12.1f\n", "TimestampCache::render()", t_cache * 1.0e6 / double(N));
+    utils::Logger::Writef("%-28s %12.1f\n", "TimestampCache::now() (us)", t_now * 1.0e6 / double(N));
+}
+
+#endif